@@ -14,6 +14,7 @@ typedef struct {
 
 /**
  * Initialize the authentication module
+ * Starts the PAM helper process; without one, PAM runs in the greeter
  * @return KIA_SUCCESS on success, KIA_ERROR_PAM on error
  */
 int auth_init(void);
@@ -29,6 +30,43 @@ int auth_init(void);
 int auth_authenticate(const char *username, const char *password,
                       const kia_config_t *config, auth_state_t *state);
 
+/* Authentication running on a worker thread */
+typedef struct auth_request auth_request_t;
+
+/**
+ * Start authenticating a user on a worker thread
+ * @param username Username to authenticate, copied
+ * @param password Password to authenticate, copied
+ * @param config Configuration containing max_attempts and lockout_duration
+ * @param state Authentication state the attempt is counted against
+ * @return Request to collect with auth_finish() or auth_cancel(), or NULL on error
+ */
+auth_request_t *auth_start(const char *username, const char *password,
+                           const kia_config_t *config, const auth_state_t *state);
+
+/**
+ * Get the descriptor that becomes readable once an authentication finished
+ * @param req Request from auth_start()
+ * @return Readable descriptor, or -1 if req is NULL
+ */
+int auth_request_fd(const auth_request_t *req);
+
+/**
+ * Collect the result of an authentication and free its request
+ * Waits for the worker if it has not finished yet
+ * @param req Request from auth_start()
+ * @param state Receives the authentication state updated by the attempt
+ * @return KIA_SUCCESS on success, KIA_ERROR_AUTH or KIA_ERROR_PAM on failure
+ */
+int auth_finish(auth_request_t *req, auth_state_t *state);
+
+/**
+ * Give up on an authentication without waiting for it
+ * The attempt is not counted and the worker frees the request
+ * @param req Request from auth_start(), not to be used afterwards
+ */
+void auth_cancel(auth_request_t *req);
+
 /**
  * Check if user is currently locked out
  * @param state Authentication state to check
@@ -43,7 +81,13 @@ bool auth_is_locked_out(auth_state_t *state);
 void auth_reset_attempts(auth_state_t *state);
 
 /**
- * Cleanup authentication module resources
+ * Get the environment PAM modules exported for the last authenticated user
+ * @return NULL-terminated NAME=value list, or NULL if there is none
+ */
+const char *const *auth_get_env(void);
+
+/**
+ * Cleanup authentication module resources, stopping the PAM helper
  */
 void auth_cleanup(void);
 
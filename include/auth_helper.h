@@ -0,0 +1,84 @@
+#ifndef KIA_AUTH_HELPER_H
+#define KIA_AUTH_HELPER_H
+
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+/* Longest username or password a request carries, terminator included */
+#define AUTH_HELPER_FIELD_LEN 256
+
+/* Room for the environment a reply carries, NAME=value strings included */
+#define AUTH_HELPER_ENV_MAX 16384
+
+/**
+ * Authenticate a user inside the helper
+ * @param username Username to authenticate
+ * @param password Password to authenticate
+ * @param env Receives a malloc()ed NULL-terminated NAME=value list on
+ *            success, whose strings are malloc()ed too, or NULL
+ * @return KIA_SUCCESS, KIA_ERROR_AUTH for rejected credentials or
+ *         KIA_ERROR_PAM if the attempt could not be made
+ */
+typedef int (*auth_helper_fn)(const char *username, const char *password, char ***env);
+
+/* Process running authentications away from the greeter */
+typedef struct {
+    pid_t pid;                  /* 0 or -1 while no helper runs */
+    int fd;                     /* Greeter end of the helper's socketpair */
+    pid_t spawner_pid;          /* Process forking helpers, 0 or -1 if none */
+    int spawner_fd;             /* Greeter end of the spawner's socketpair */
+    int restarts;               /* Helpers started again after one died */
+    bool interrupted;           /* Set by auth_helper_interrupt() until restarted */
+    pthread_mutex_t lock;       /* Guards pid, fd and interrupted */
+} auth_helper_t;
+
+/* Initializer for a helper that has not been started */
+#define AUTH_HELPER_INIT \
+    { .pid = -1, .fd = -1, .spawner_pid = -1, .spawner_fd = -1, \
+      .lock = PTHREAD_MUTEX_INITIALIZER }
+
+/**
+ * Fork the spawner, which forks a helper serving authentications over a
+ * socketpair now and whenever one has to be replaced
+ * Call before any thread starts, so nothing is forked from a threaded process
+ * @param helper Helper to start; does nothing if it already runs
+ * @param authenticate Function answering each request in the helper
+ * @param prepare Function run once in each helper before serving, or NULL
+ * @return KIA_SUCCESS on success, KIA_ERROR_SYSTEM on error
+ */
+int auth_helper_start(auth_helper_t *helper, auth_helper_fn authenticate, void (*prepare)(void));
+
+/**
+ * Check whether a helper is there to send requests to
+ * @param helper Helper to check
+ * @return true if the helper has been started and not stopped
+ */
+bool auth_helper_running(const auth_helper_t *helper);
+
+/**
+ * Authenticate a user through the helper, restarting it if it died
+ * @param helper Running helper
+ * @param username Username to authenticate
+ * @param password Password to authenticate
+ * @param env Receives the environment the helper returned on success, or NULL
+ * @return The helper's result, or KIA_ERROR_PAM if it could not answer
+ */
+int auth_helper_authenticate(auth_helper_t *helper, const char *username,
+                             const char *password, char ***env);
+
+/**
+ * Make the authentication under way give up, from any thread
+ * @param helper Running helper
+ * @return KIA_SUCCESS if a helper was interrupted, KIA_ERROR_PAM otherwise
+ */
+int auth_helper_interrupt(auth_helper_t *helper);
+
+/**
+ * Stop a helper and its spawner and reap them
+ * A helper stuck inside PAM is terminated rather than waited for
+ * @param helper Helper to stop
+ */
+void auth_helper_stop(auth_helper_t *helper);
+
+#endif /* KIA_AUTH_HELPER_H */
@@ -15,10 +15,13 @@
 typedef struct {
     char autologin_user[256];
     bool autologin_enabled;
+    bool kiosk_mode;       /* Restart the autologin session as soon as it exits */
     char default_session[256];
     int max_attempts;
     bool enable_logs;
     int lockout_duration;  /* seconds */
+    int auth_timeout;      /* seconds PAM may take before the login is given up */
+    int session_stop_timeout;  /* seconds between SIGTERM and SIGKILL at logout */
 } kia_config_t;
 
 /**
@@ -29,6 +32,12 @@ typedef struct {
  */
 int config_load(const char *path, kia_config_t *config);
 
+/**
+ * Initialize configuration with default values
+ * @param config Pointer to configuration structure to reset
+ */
+void config_set_defaults(kia_config_t *config);
+
 /**
  * Validate configuration values
  * @param config Pointer to configuration structure to validate
@@ -1,9 +1,25 @@
 #ifndef KIA_CONTROLLER_H
 #define KIA_CONTROLLER_H
 
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
 #include "config.h"
 #include "auth.h"
 #include "session.h"
+#include "session_watch.h"
+#include "session_user.h"
+#include "session_supervisor.h"
+#include "session_backoff.h"
+
+/* Time sessions get to exit after SIGTERM before they are killed, unless configured */
+#define CONTROLLER_SESSION_STOP_TIMEOUT_MS 5000
+
+/* Time authentication may take before it is given up, unless configured */
+#define CONTROLLER_AUTH_TIMEOUT_MS 30000
+
+/* Spinner frame interval while authentication runs */
+#define CONTROLLER_AUTH_TICK_MS 100
 
 /* Application states */
 typedef enum {
@@ -14,7 +30,9 @@ typedef enum {
     STATE_GET_CREDENTIALS,
     STATE_SELECT_SESSION,
     STATE_AUTHENTICATE,
+    STATE_AUTHENTICATING,
     STATE_START_SESSION,
+    STATE_SESSION_RUNNING,
     STATE_EXIT
 } app_state_t;
 
@@ -23,7 +41,29 @@ typedef struct {
     app_state_t state;
     kia_config_t config;
     auth_state_t auth_state;
+    auth_request_t *auth_request;     /* Authentication running on its worker, or NULL */
+    int auth_frame;                   /* Spinner frame shown while it runs */
     session_list_t sessions;
+    session_watch_t session_watch;
+    session_user_t session_users;   /* Sessions in the data home of each user logging in */
+    session_supervisor_t supervisor;  /* Running sessions, tracked by pidfd */
+    session_proc_t session_proc;      /* Processes of the running session */
+    session_latency_t latency;        /* Phases of the current login */
+    bool latency_pending;             /* Launched, latency not reported yet */
+    const char *stats_path;           /* Login latency records, NULL to only log */
+    session_backoff_t backoff;        /* Recent session failures, holding autologin back */
+    bool kiosk;                       /* Restart the autologin session whenever it exits */
+    session_plan_t kiosk_plan;        /* Launch plan reused by every kiosk restart */
+    int kiosk_restarts;
+    struct timespec kiosk_exited_at;  /* First process of the running kiosk instance exited */
+    volatile sig_atomic_t shutdown_requested;
+    struct timespec session_ended_at;
+    bool returning;             /* Back from a session, login screen not drawn yet */
+    pthread_t discovery_thread;
+    bool discovery_pending;     /* Discovery thread started and not yet joined */
+    int discovery_result;
+    double discovery_ms;        /* Time the discovery thread spent scanning */
+    struct timespec started_at;
     char username[256];
     char password[256];
     int selected_session;
@@ -38,14 +78,34 @@ typedef struct {
  */
 int controller_init(app_context_t *ctx);
 
+/**
+ * Run the handler of the current state once
+ * @param ctx Pointer to application context
+ * @return Result of the state handler
+ */
+int controller_step(app_context_t *ctx);
+
 /**
  * Main event loop processing state transitions
- * Implements the state machine for login flow
+ * Returns to the login screen when a session ends, until shutdown or error
  * @param ctx Pointer to application context
  * @return KIA_SUCCESS on success, error code on failure
  */
 int controller_run(app_context_t *ctx);
 
+/**
+ * Shrink the greeter while a session runs
+ * Frees the curses screen and caches, and returns free heap pages to the kernel
+ * @param ctx Pointer to application context
+ */
+void controller_release_memory(app_context_t *ctx);
+
+/**
+ * Ask the controller to stop its sessions and return; async-signal-safe
+ * @param ctx Pointer to application context
+ */
+void controller_request_shutdown(app_context_t *ctx);
+
 /**
  * Cleanup all resources allocated by the controller
  * Frees config, sessions, and clears sensitive data
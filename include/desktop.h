@@ -0,0 +1,94 @@
+#ifndef KIA_DESKTOP_H
+#define KIA_DESKTOP_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Slice of a desktop file buffer; not NUL-terminated */
+typedef struct {
+    const char *ptr;
+    size_t len;
+} desktop_span_t;
+
+/* Keys of the [Desktop Entry] group used by Kia */
+typedef struct {
+    desktop_span_t name;
+    desktop_span_t exec;
+    desktop_span_t try_exec;
+    desktop_span_t desktop_names;
+    bool hidden;
+    bool no_display;
+} desktop_entry_t;
+
+/* Desktop files larger than this are not session entries */
+#define DESKTOP_MAX_FILE_SIZE (64 * 1024)
+
+/* File name suffix of desktop entries */
+#define DESKTOP_SUFFIX ".desktop"
+#define DESKTOP_SUFFIX_LEN (sizeof(DESKTOP_SUFFIX) - 1)
+
+/* Reusable file buffer, grown to the largest file read through it */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} desktop_buf_t;
+
+/**
+ * Read a whole desktop file into a reusable buffer with a single read
+ * @param buf Buffer to fill (data is NUL-terminated on success)
+ * @param path Path to desktop file
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int desktop_buf_read(desktop_buf_t *buf, const char *path);
+
+/**
+ * Check whether a file name is a desktop file ID, i.e. ends in exactly
+ * ".desktop" after a non-empty stem (so "foo.desktop.bak" is not one)
+ * @param name File name
+ * @return true if the name is a desktop file ID
+ */
+bool desktop_is_file_id(const char *name);
+
+/**
+ * Release a desktop file buffer
+ * @param buf Buffer to release
+ */
+void desktop_buf_free(desktop_buf_t *buf);
+
+/**
+ * Parse a desktop file in a single pass without copying
+ * The returned spans point into buf and hold raw, still-escaped values
+ * @param buf Desktop file contents
+ * @param len Length of buf
+ * @param entry Parsed entry
+ * @return KIA_SUCCESS if a [Desktop Entry] group was found,
+ *         KIA_ERROR_SESSION otherwise
+ */
+int desktop_entry_parse(const char *buf, size_t len, desktop_entry_t *entry);
+
+/**
+ * Copy a span into a NUL-terminated string, resolving the \s \n \t \r
+ * and \\ escapes of desktop file string values
+ * @param span Span to copy
+ * @param dst Destination buffer
+ * @param size Size of dst
+ * @return Length of the copied string, or -1 if empty or it does not fit
+ */
+int desktop_span_copy(const desktop_span_t *span, char *dst, size_t size);
+
+/* Most arguments a tokenised Exec line may have */
+#define DESKTOP_EXEC_MAX_ARGS 255
+
+/**
+ * Split an Exec value into arguments following the desktop entry quoting rules
+ * Field codes are dropped; out never needs more than strlen(exec) + 1 bytes
+ * @param exec Exec value with desktop string escapes already resolved
+ * @param out Buffer receiving the arguments, each NUL-terminated
+ * @param size Size of out
+ * @param out_len Set to the number of bytes written to out
+ * @return Number of arguments, or 0 if the line must run through a shell
+ */
+int desktop_exec_split(const char *exec, char *out, size_t size, size_t *out_len);
+
+#endif /* KIA_DESKTOP_H */
@@ -0,0 +1,99 @@
+#ifndef KIA_DESKTOP_BATCH_H
+#define KIA_DESKTOP_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Submission queue size of the io_uring used for batched reads */
+#define DESKTOP_BATCH_RING_ENTRIES 128
+
+/* One file of a batch */
+typedef struct {
+    uint32_t name_off;   /* Offset into the name pool */
+    uint32_t data_off;   /* Offset into the data arena */
+    uint32_t len;        /* Bytes read, excluding the terminator */
+    int error;           /* errno of a failed open or read, 0 once read */
+} desktop_batch_file_t;
+
+struct desktop_ring;
+
+/* Reader of many desktop files from one directory at a time */
+typedef struct {
+    desktop_batch_file_t *files;
+    int count;
+    int cap;
+    char *names;               /* NUL-terminated file names */
+    size_t names_len;
+    size_t names_cap;
+    char *data;                /* File contents, each NUL-terminated */
+    size_t data_len;
+    size_t data_cap;
+    struct desktop_ring *ring; /* NULL when reads use plain syscalls */
+    unsigned long submits;     /* io_uring_enter() calls made */
+} desktop_batch_t;
+
+/**
+ * Set up an empty batch
+ * Falls back to plain syscalls when io_uring is unavailable
+ * @param batch Batch to initialize
+ * @param use_ring Whether to try io_uring
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int desktop_batch_init(desktop_batch_t *batch, bool use_ring);
+
+/**
+ * Check whether reads are submitted through io_uring
+ * @param batch Batch
+ * @return true if an io_uring is in use
+ */
+bool desktop_batch_uses_ring(const desktop_batch_t *batch);
+
+/**
+ * Queue a file, named relative to the directory the batch is read from
+ * @param batch Batch
+ * @param name File name without any slash
+ * @return Index of the file, or KIA_ERROR_SESSION on error
+ */
+int desktop_batch_add(desktop_batch_t *batch, const char *name);
+
+/**
+ * Read every queued file relative to a directory descriptor
+ * Files that are not regular or too large fail with EFBIG
+ * @param batch Batch
+ * @param dirfd Directory the queued names are relative to
+ * @return Number of files read, or KIA_ERROR_SESSION if memory ran out
+ */
+int desktop_batch_read(desktop_batch_t *batch, int dirfd);
+
+/**
+ * Get the name of a queued file
+ * @param batch Batch
+ * @param idx File index
+ * @return File name, or NULL if idx is out of range
+ */
+const char *desktop_batch_name(const desktop_batch_t *batch, int idx);
+
+/**
+ * Get the contents of a file after desktop_batch_read()
+ * @param batch Batch
+ * @param idx File index
+ * @param len Set to the length of the contents
+ * @return NUL-terminated contents, or NULL if the file could not be read
+ *         (see files[idx].error)
+ */
+const char *desktop_batch_data(const desktop_batch_t *batch, int idx, size_t *len);
+
+/**
+ * Forget the queued files, keeping buffers and the ring for the next directory
+ * @param batch Batch
+ */
+void desktop_batch_clear(desktop_batch_t *batch);
+
+/**
+ * Free batch resources
+ * @param batch Batch to free
+ */
+void desktop_batch_free(desktop_batch_t *batch);
+
+#endif /* KIA_DESKTOP_BATCH_H */
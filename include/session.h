@@ -1,7 +1,16 @@
 #ifndef KIA_SESSION_H
 #define KIA_SESSION_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
 #include "config.h"
+#include "session_xorg.h"
+#include "session_display.h"
+#include "session_ready.h"
+#include "session_output.h"
+#include "session_env.h"
+#include <sys/resource.h>
 
 /* Session types */
 typedef enum {
@@ -9,27 +18,219 @@ typedef enum {
     SESSION_WAYLAND
 } session_type_t;
 
-/* Session information structure */
+/* Longest name or Exec line accepted into a session list */
+#define SESSION_MAX_FIELD_LEN 4095
+
+/* Session information, a view into a session list's string arena */
 typedef struct {
-    char name[256];
-    char exec[512];
+    const char *name;
+    const char *exec;
     session_type_t type;
+    const char *args;    /* Exec line split into argc NUL-terminated arguments */
+    int argc;            /* 0 if exec has to run through /bin/sh */
+    const char *desktop_names;  /* XDG_CURRENT_DESKTOP value, or NULL/empty */
 } session_info_t;
 
+/* Directory index of sessions not loaded from a session directory */
+#define SESSION_DIR_NONE 0xffff
+
+/*
+ * Compact session record; name and exec are NUL-terminated in the arena,
+ * and exec is followed by the desktop file ID the session was read from,
+ * then by the tokenised Exec line: an argument count byte (0 if the line
+ * needs a shell) and that many NUL-terminated arguments, and last by the
+ * XDG_CURRENT_DESKTOP value made of its DesktopNames (empty if none)
+ */
+typedef struct {
+    uint32_t name_off;
+    uint32_t exec_off;
+    uint16_t name_len;
+    uint16_t exec_len;
+    uint16_t type;
+    uint16_t dir;        /* Index into the discovery directories, or SESSION_DIR_NONE */
+} session_record_t;
+
 /* Session list structure */
 typedef struct {
-    session_info_t *sessions;
+    session_record_t *records;
     int count;
+    int capacity;        /* 0 while records and arena live in a cache mapping */
+    char *arena;
+    size_t arena_len;
+    size_t arena_cap;
+    size_t arena_dead;   /* Bytes of removed sessions still held in the arena */
+    void *mapping;       /* Cache mapping backing the list, or NULL if heap */
+    size_t mapping_len;
 } session_list_t;
 
+/* Session search directory */
+typedef struct {
+    const char *path;
+    session_type_t type;
+} session_dir_t;
+
+/* Data directories used when XDG_DATA_DIRS is unset or empty */
+#define SESSION_DEFAULT_DATA_DIRS "/usr/local/share:/usr/share"
+
+/* Most XDG_DATA_DIRS roots searched for sessions */
+#define SESSION_MAX_DATA_DIRS 64
+
 /**
  * Discover available X11 and Wayland sessions
- * Scans /usr/share/xsessions/ and /usr/share/wayland-sessions/
+ * Scans xsessions/ and wayland-sessions/ under every XDG_DATA_DIRS root
  * @param list Pointer to session list to populate
  * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
  */
 int session_discover(session_list_t *list);
 
+/**
+ * Get the directories searched by session_discover()
+ * Built once from XDG_DATA_DIRS on first use
+ * @param dir_count Set to the number of directories
+ * @return Directories, in search order
+ */
+const session_dir_t *session_default_dirs(int *dir_count);
+
+/**
+ * Build session directories from a colon-separated list of data roots
+ * @param data_dirs Colon-separated roots, or NULL/empty for the defaults
+ * @param dirs Array of at least 2 * SESSION_MAX_DATA_DIRS entries to fill
+ * @return Number of directories filled; free them with session_dirs_free()
+ */
+int session_dirs_from_data_dirs(const char *data_dirs, session_dir_t *dirs);
+
+/**
+ * Free directory paths allocated by session_dirs_from_data_dirs()
+ * @param dirs Directories to free
+ * @param dir_count Number of entries in dirs
+ */
+void session_dirs_free(session_dir_t *dirs, int dir_count);
+
+/**
+ * Discover sessions in an explicit set of directories
+ * Uses the cache at cache_path while it is valid, otherwise rescans
+ * @param list Pointer to session list to populate
+ * @param dirs Directories to scan, in order
+ * @param dir_count Number of entries in dirs
+ * @param cache_path Path to session cache, or NULL to disable caching
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_discover_in(session_list_t *list, const session_dir_t *dirs,
+                        int dir_count, const char *cache_path);
+
+/**
+ * Append a session to a list
+ * @param list Session list to append to
+ * @param name Display name of the session
+ * @param exec Exec line of the session
+ * @param type Session type
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_list_add(session_list_t *list, const char *name, const char *exec,
+                     session_type_t type);
+
+/**
+ * Re-read one desktop file and replace, add or remove its session
+ * @param list Session list to update
+ * @param dirs Directories the list was discovered from
+ * @param dir_idx Index of the directory holding the file
+ * @param file_id Desktop file name within the directory
+ * @return KIA_SUCCESS if the file yields a session, KIA_ERROR_SESSION otherwise
+ */
+int session_list_load_file(session_list_t *list, const session_dir_t *dirs,
+                           int dir_idx, const char *file_id);
+
+/**
+ * Find the session read from a desktop file ID
+ * @param list Session list
+ * @param type Session type the ID belongs to
+ * @param file_id Desktop file name
+ * @return Index of the session, or -1 if there is none
+ */
+int session_list_find_file(const session_list_t *list, session_type_t type, const char *file_id);
+
+/**
+ * Re-resolve a desktop file ID across the directories of its type
+ * @param list Session list discovered from dirs
+ * @param dirs Directories the list was discovered from
+ * @param dir_count Number of entries in dirs
+ * @param type Session type the ID belongs to
+ * @param file_id Desktop file name
+ * @return KIA_SUCCESS if the list holds a session for the ID afterwards,
+ *         KIA_ERROR_SESSION otherwise
+ */
+int session_list_resolve_file(session_list_t *list, const session_dir_t *dirs, int dir_count,
+                              session_type_t type, const char *file_id);
+
+/**
+ * Merge the sessions of an overlay list into a list, replacing same IDs
+ * @param list Session list to merge into
+ * @param overlay Sessions to merge
+ * @param dir_base Directory count of list, added to overlay directory indexes
+ * @return Number of sessions merged, or KIA_ERROR_SESSION on error
+ */
+int session_list_merge(session_list_t *list, const session_list_t *overlay, int dir_base);
+
+/**
+ * Drop every session merged from an overlay and restore what it shadowed
+ * @param list Session list
+ * @param dirs Directories the list was discovered from
+ * @param dir_count Number of entries in dirs; sessions with a directory
+ *                  index from dir_count up are overlay sessions
+ * @return Number of sessions dropped
+ */
+int session_list_drop_overlay(session_list_t *list, const session_dir_t *dirs, int dir_count);
+
+/**
+ * Remove a session from a list, keeping the order of the others
+ * @param list Session list
+ * @param idx Index of the session
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION if idx is out of range
+ */
+int session_list_remove(session_list_t *list, int idx);
+
+/**
+ * Get a view of a session in a list
+ * The view stays valid until the list is modified or freed
+ * @param list Session list
+ * @param idx Index of the session
+ * @param info View to fill
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION if idx is out of range
+ */
+int session_list_get(const session_list_t *list, int idx, session_info_t *info);
+
+/**
+ * Get the display name of a session in a list
+ * @param list Session list
+ * @param idx Index of the session
+ * @return Session name, or NULL if idx is out of range
+ */
+const char *session_list_name(const session_list_t *list, int idx);
+
+/**
+ * Get the Exec line of a session in a list
+ * @param list Session list
+ * @param idx Index of the session
+ * @return Session Exec line, or NULL if idx is out of range
+ */
+const char *session_list_exec(const session_list_t *list, int idx);
+
+/**
+ * Get the desktop file ID a session was read from
+ * @param list Session list
+ * @param idx Index of the session
+ * @return File ID, empty for sessions added directly, or NULL if idx is out of range
+ */
+const char *session_list_file(const session_list_t *list, int idx);
+
+/**
+ * Get the type of a session in a list
+ * @param list Session list
+ * @param idx Index of the session (must be in range)
+ * @return Session type
+ */
+session_type_t session_list_type(const session_list_t *list, int idx);
+
 /**
  * Free session list resources
  * @param list Pointer to session list to free
@@ -37,12 +238,109 @@ int session_discover(session_list_t *list);
 void session_list_free(session_list_t *list);
 
 /**
- * Start a session for the specified user
- * Forks a process, drops privileges, sets environment, and executes session
+ * Point session output logs and display state somewhere other than the defaults
+ * Call before any session is launched; the strings must outlive the sessions
+ * @param output Directory of per-user output logs, or NULL for SESSION_OUTPUT_DIR
+ * @param state Directory of display locks and X authority files,
+ *              or NULL for SESSION_DISPLAY_LOCK_DIR
+ */
+void session_set_dirs(const char *output, const char *state);
+
+/**
+ * Free the process-wide command resolution cache, rebuilt on next use
+ */
+void session_release_caches(void);
+
+/* Processes started for a session */
+typedef struct {
+    pid_t pid;               /* Session command */
+    session_xorg_t xorg;     /* X server started for it; xorg.pid is 0 if none */
+    session_display_t display;  /* X display or Wayland socket allocated to it */
+    session_ready_t ready;      /* Readiness pipe, read end only once launched */
+    session_output_t output;    /* stdout/stderr pipe, read end only once launched */
+    struct timespec spawn_start;  /* Session command spawn began */
+    struct timespec exec_done;    /* Session command was exec'd */
+} session_proc_t;
+
+/* Everything about launching a session that stays the same between launches */
+typedef struct {
+    session_info_t session;   /* Copy of the session; its strings belong to the plan */
+    const char *username;
+    uid_t uid;
+    gid_t gid;
+    const char *home;
+    gid_t *groups;            /* Supplementary groups */
+    int group_count;
+    session_env_t env;        /* Environment without the display variables of a launch */
+    char runtime_dir[256];    /* Where the Wayland socket of a launch is allocated */
+    char command[512];        /* Resolved session command, empty to search PATH at exec */
+    char server[512];         /* Resolved SESSION_XORG_SERVER, empty if not installed */
+    char startx[512];         /* Resolved startx, empty to search PATH at exec */
+    char output_path[512];    /* Output file, empty to keep output in memory only */
+    char *strings;            /* Storage of the copied strings, NULL if not prepared */
+} session_plan_t;
+
+/**
+ * Resolve what every launch of a session shares: user, environment, paths
+ * @param plan Plan to fill; free it with session_plan_free()
+ * @param session Session to plan; its strings are copied
+ * @param username Username to start the session for
+ * @param pam_env NAME=value list from pam_getenvlist(), or NULL
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_plan_prepare(session_plan_t *plan, const session_info_t *session,
+                         const char *username, const char *const *pam_env);
+
+/**
+ * Free what a launch plan holds
+ * @param plan Plan to free, left unprepared
+ */
+void session_plan_free(session_plan_t *plan);
+
+/**
+ * Launch a prepared session without waiting for it
+ * @param plan Plan filled in by session_plan_prepare()
+ * @param proc Receives the session's processes; reap them, then session_end()
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_launch_plan(const session_plan_t *plan, session_proc_t *proc);
+
+/**
+ * Launch a session for the specified user without waiting for it
+ * Same as session_plan_prepare() followed by session_launch_plan()
  * @param session Session to start
  * @param username Username to start session for
+ * @param pam_env NAME=value list from pam_getenvlist(), or NULL
+ * @param proc Receives the session's processes; reap them, then session_end()
  * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
  */
-int session_start(const session_info_t *session, const char *username);
+int session_launch(const session_info_t *session, const char *username,
+                   const char *const *pam_env, session_proc_t *proc);
+
+/**
+ * Wait for the command of a launched session to exit, draining its output
+ * @param proc Processes filled in by session_launch()
+ * @param status Receives the wait status
+ * @param ru Receives the resource usage of the session command
+ * @return The session's PID, or -1 on error with errno set
+ */
+pid_t session_wait(session_proc_t *proc, int *status, struct rusage *ru);
+
+/**
+ * Release what a launched session held once all its processes are gone
+ * @param proc Processes filled in by session_launch()
+ */
+void session_end(session_proc_t *proc);
+
+/**
+ * Start a session and wait for it to end
+ * @param session Session to start
+ * @param username Username to start session for
+ * @param pam_env NAME=value list from pam_getenvlist(), or NULL
+ * @return KIA_SUCCESS if the session exited with status 0,
+ *         KIA_ERROR_SESSION otherwise
+ */
+int session_start(const session_info_t *session, const char *username,
+                  const char *const *pam_env);
 
 #endif /* KIA_SESSION_H */
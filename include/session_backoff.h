@@ -0,0 +1,82 @@
+#ifndef KIA_SESSION_BACKOFF_H
+#define KIA_SESSION_BACKOFF_H
+
+#include <stdbool.h>
+
+/* Failure history, kept in /run so it survives service restarts but not reboots */
+#define SESSION_BACKOFF_PATH "/run/kia/session-failures"
+
+/* Failures older than this are forgotten */
+#define SESSION_BACKOFF_WINDOW_S 300
+
+/* Failures within the window after which autologin is given up */
+#define SESSION_BACKOFF_MAX_FAILURES 5
+
+/* Delay after the first failure, doubled for each further one */
+#define SESSION_BACKOFF_BASE_S 2
+#define SESSION_BACKOFF_MAX_S 60
+
+/* Sessions ending sooner than this after launch count as failed */
+#define SESSION_BACKOFF_MIN_RUNTIME_S 10
+
+/* Recent session failures, oldest first */
+typedef struct {
+    double failures[SESSION_BACKOFF_MAX_FAILURES];  /* CLOCK_BOOTTIME seconds */
+    int count;
+    const char *path;   /* History file, NULL to keep it in memory only */
+} session_backoff_t;
+
+/**
+ * Current time on the boot-wide clock failure times are kept in
+ * @return Seconds since boot, including time suspended
+ */
+double session_backoff_now(void);
+
+/**
+ * Initialize an empty failure history
+ * @param backoff History to initialize
+ * @param path History file, NULL to keep it in memory only
+ */
+void session_backoff_init(session_backoff_t *backoff, const char *path);
+
+/**
+ * Load the history left by earlier runs, dropping failures outside the window
+ * A missing or unreadable file is an empty history
+ * @param backoff History to fill in
+ * @param now Current time from session_backoff_now()
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on invalid parameters
+ */
+int session_backoff_load(session_backoff_t *backoff, double now);
+
+/**
+ * Record a failed session and save the history
+ * Once SESSION_BACKOFF_MAX_FAILURES are recorded the oldest is dropped
+ * @param backoff History to update
+ * @param now Current time from session_backoff_now()
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION if it could not be saved
+ */
+int session_backoff_record(session_backoff_t *backoff, double now);
+
+/**
+ * Forget all failures after a session that ran properly
+ * @param backoff History to clear; its file is removed
+ */
+void session_backoff_reset(session_backoff_t *backoff);
+
+/**
+ * Check whether sessions keep failing and should not be retried unattended
+ * @param backoff History to check
+ * @param now Current time from session_backoff_now()
+ * @return true if SESSION_BACKOFF_MAX_FAILURES failures are within the window
+ */
+bool session_backoff_exhausted(const session_backoff_t *backoff, double now);
+
+/**
+ * Time left before the next unattended attempt
+ * @param backoff History to check
+ * @param now Current time from session_backoff_now()
+ * @return Seconds to wait, 0 if an attempt can be made right away
+ */
+double session_backoff_remaining(const session_backoff_t *backoff, double now);
+
+#endif /* KIA_SESSION_BACKOFF_H */
@@ -0,0 +1,49 @@
+#ifndef KIA_SESSION_CACHE_H
+#define KIA_SESSION_CACHE_H
+
+#include <stdint.h>
+#include "session.h"
+
+/* Snapshot of one session directory, used to decide cache validity */
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint32_t path_hash;
+    uint32_t present;
+} session_dir_stamp_t;
+
+/**
+ * Take stamps of the given directories, before they are scanned
+ * @param dirs Directories to stamp
+ * @param dir_count Number of entries in dirs
+ * @param stamps Array of dir_count stamps to fill
+ */
+void session_cache_stamp(const session_dir_t *dirs, int dir_count,
+                         session_dir_stamp_t *stamps);
+
+/**
+ * Map a session list from the binary session cache if it is still valid
+ * @param path Path to cache file
+ * @param dirs Directories the cache must have been built from
+ * @param dir_count Number of entries in dirs
+ * @param list Session list to populate
+ * @return KIA_SUCCESS on a valid cache hit, KIA_ERROR_SESSION otherwise
+ */
+int session_cache_load(const char *path, const session_dir_t *dirs,
+                       int dir_count, session_list_t *list);
+
+/**
+ * Write a session list to the binary session cache
+ * Skipped while a directory was modified within the last second
+ * @param path Path to cache file
+ * @param stamps Directory stamps taken before scanning
+ * @param dir_count Number of entries in stamps
+ * @param list Session list to store
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION if not written
+ */
+int session_cache_store(const char *path, const session_dir_stamp_t *stamps,
+                        int dir_count, const session_list_t *list);
+
+#endif /* KIA_SESSION_CACHE_H */
@@ -0,0 +1,55 @@
+#ifndef KIA_SESSION_DISPLAY_H
+#define KIA_SESSION_DISPLAY_H
+
+#include <stddef.h>
+
+/* Directory holding Kia's allocation locks */
+#define SESSION_DISPLAY_LOCK_DIR "/run/kia"
+
+/* Directory where X servers keep their .X<n>-lock files */
+#define SESSION_DISPLAY_X_LOCK_DIR "/tmp"
+
+/* Display numbers and socket names tried before giving up */
+#define SESSION_DISPLAY_MAX 64
+
+/* Display and Wayland socket held by one session */
+typedef struct {
+    int x_display;               /* Allocated X display number, or -1 */
+    int x_lock_fd;               /* Lock held on it, or -1 */
+    char wayland_display[32];    /* Allocated socket name, or empty */
+    int wayland_lock_fd;         /* Lock held on it, or -1 */
+} session_display_t;
+
+/**
+ * Set up a display record holding nothing
+ * @param display Record to initialize
+ */
+void session_display_init(session_display_t *display);
+
+/**
+ * Allocate the lowest free X display number
+ * @param display Record to fill in
+ * @param lock_dir Directory for Kia's locks, created mode 0711
+ * @param x_lock_dir Directory of X server lock files
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION if none is free
+ */
+int session_display_alloc_x(session_display_t *display, const char *lock_dir,
+                            const char *x_lock_dir);
+
+/**
+ * Allocate the lowest free Wayland socket name, wayland-<n>
+ * @param display Record to fill in
+ * @param lock_dir Directory for Kia's locks, created mode 0711
+ * @param runtime_dir Session's XDG_RUNTIME_DIR, or NULL if unknown
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION if none is free
+ */
+int session_display_alloc_wayland(session_display_t *display, const char *lock_dir,
+                                  const char *runtime_dir);
+
+/**
+ * Release whatever a display record holds
+ * @param display Record to release, left holding nothing
+ */
+void session_display_release(session_display_t *display);
+
+#endif /* KIA_SESSION_DISPLAY_H */
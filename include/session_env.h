@@ -0,0 +1,54 @@
+#ifndef KIA_SESSION_ENV_H
+#define KIA_SESSION_ENV_H
+
+#include <stdbool.h>
+
+/* Greeter variables carried into sessions; nothing else is inherited */
+#define SESSION_ENV_PASSTHROUGH { "PATH", "TERM", "LANG", "LANGUAGE", "LC_ALL", "TZ", NULL }
+
+/* Environment block of a session, built before it is spawned */
+typedef struct {
+    char **vars;   /* NAME=value strings, NULL-terminated once non-empty */
+    int count;
+    int cap;
+} session_env_t;
+
+/**
+ * Set a variable, replacing any earlier value in place
+ * @param env Environment
+ * @param name Variable name, non-empty and without '='
+ * @param value Value
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_env_set(session_env_t *env, const char *name, const char *value);
+
+/**
+ * Set a variable from a NAME=value string, as returned by pam_getenvlist()
+ * @param env Environment
+ * @param var NAME=value string
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error or a malformed string
+ */
+int session_env_put(session_env_t *env, const char *var);
+
+/**
+ * Look up a variable
+ * @param env Environment
+ * @param name Variable name
+ * @return Value, or NULL if unset
+ */
+const char *session_env_get(const session_env_t *env, const char *name);
+
+/**
+ * Get the block to pass to execve()
+ * @param env Environment
+ * @return NULL-terminated NAME=value array, valid until the next change
+ */
+char *const *session_env_block(session_env_t *env);
+
+/**
+ * Free environment resources
+ * @param env Environment to free
+ */
+void session_env_free(session_env_t *env);
+
+#endif /* KIA_SESSION_ENV_H */
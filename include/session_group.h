@@ -0,0 +1,72 @@
+#ifndef KIA_SESSION_GROUP_H
+#define KIA_SESSION_GROUP_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/* Time lingering session processes get after SIGTERM when nobody configured one */
+#define SESSION_GROUP_STOP_TIMEOUT_MS 5000
+
+/* Time killed processes get to be reaped, e.g. out of uninterruptible sleep */
+#define SESSION_GROUP_KILL_WAIT_MS 1000
+
+/* How often a stopping group is checked for survivors */
+#define SESSION_GROUP_POLL_MS 10
+
+/* Children that are no session's, such as the PAM helper and X server */
+#define SESSION_GROUP_MAX_TRACKED 8
+
+/* Stray children handled per pass */
+#define SESSION_GROUP_MAX_STRAYS 256
+
+/**
+ * Make this process the reaper of orphaned descendants
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_group_subreaper(void);
+
+/**
+ * Keep a child of this process out of every session's teardown
+ * @param pid Child that is managed elsewhere
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION if pid is invalid or
+ *         the table is full
+ */
+int session_group_track(pid_t pid);
+
+/**
+ * Undo session_group_track() once the child has been reaped
+ * @param pid Child that was tracked; untracked ones are ignored
+ */
+void session_group_untrack(pid_t pid);
+
+/**
+ * Send a signal to every process of a session, untracked children included
+ * @param pgid Process group of the session, which its command leads
+ * @param sig Signal number
+ * @return KIA_SUCCESS if any process was signalled, KIA_ERROR_SESSION otherwise
+ */
+int session_group_signal(pid_t pgid, int sig);
+
+/**
+ * Check whether any process of a session is left, unreaped ones included
+ * @param pgid Process group of the session
+ * @return true if the group or an untracked child is left
+ */
+bool session_group_alive(pid_t pgid);
+
+/**
+ * Reap exited children of a process group, and untracked children
+ * @param pgid Process group of the session
+ * @return Number of processes reaped
+ */
+int session_group_reap(pid_t pgid);
+
+/**
+ * Tear down and reap whatever is left of a session whose command has exited
+ * @param pgid Process group of the session
+ * @param timeout_ms Time the processes get to exit after SIGTERM before SIGKILL
+ * @return KIA_SUCCESS once no process is left, KIA_ERROR_SESSION otherwise
+ */
+int session_group_stop(pid_t pgid, int timeout_ms);
+
+#endif /* KIA_SESSION_GROUP_H */
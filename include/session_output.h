@@ -0,0 +1,103 @@
+#ifndef KIA_SESSION_OUTPUT_H
+#define KIA_SESSION_OUTPUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/* Where the output of each user's latest session is written, as <user>.log */
+#define SESSION_OUTPUT_DIR "/var/log/kia"
+
+/* Most recent output kept in memory */
+#define SESSION_OUTPUT_RING_SIZE (64 * 1024)
+
+/* At most one write to the file per interval */
+#define SESSION_OUTPUT_FLUSH_INTERVAL_MS 1000
+
+/* Output of a failed session copied to Kia's log */
+#define SESSION_OUTPUT_LOG_TAIL 1024
+
+/* A file growing beyond this is moved to <file>.old and started over */
+#define SESSION_OUTPUT_MAX_FILE_SIZE (1024 * 1024)
+
+/* Captured stdout/stderr of a session */
+typedef struct {
+    int fd;                   /* Read end of the pipe, -1 once closed */
+    int session_fd;           /* Write end, the session's stdout/stderr until launched */
+    int file_fd;              /* Output file, -1 to keep output in memory only */
+    char path[512];
+    char *ring;               /* Last SESSION_OUTPUT_RING_SIZE bytes of output */
+    uint64_t total;           /* Bytes read from the session */
+    uint64_t flushed;         /* Bytes of the stream written or dropped */
+    uint64_t dropped;         /* Bytes overwritten before they could be written */
+    uint64_t dropped_noted;   /* Dropped bytes already marked in the file */
+    uint64_t file_size;
+    struct timespec last_flush;
+} session_output_t;
+
+/**
+ * Initialize an output capture that is not open
+ * @param output Capture to initialize
+ */
+void session_output_init(session_output_t *output);
+
+/**
+ * Create the pipe a session writes its output to, rotating the old file
+ * @param output Capture to open
+ * @param path Output file, or NULL to keep output in memory only
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_output_open(session_output_t *output, const char *path);
+
+/**
+ * Close the write end once the session has inherited it
+ * @param output Capture the session was launched with
+ */
+void session_output_close_session(session_output_t *output);
+
+/**
+ * Read whatever the session has written without blocking, flushing when due
+ * @param output Capture to drain
+ * @return 0 while the session may write more, -1 once every writer is gone
+ */
+int session_output_drain(session_output_t *output);
+
+/**
+ * Time until buffered output is due to be written
+ * @param output Capture to check
+ * @return Milliseconds to wait before calling session_output_flush(),
+ *         -1 if nothing is pending
+ */
+int session_output_flush_timeout(const session_output_t *output);
+
+/**
+ * Write buffered output to the file
+ * @param output Capture to flush
+ * @param force Write even if the interval has not passed
+ */
+void session_output_flush(session_output_t *output, bool force);
+
+/**
+ * Copy the end of the captured output, starting at a line boundary
+ * @param output Capture to read
+ * @param buf Receives the NUL-terminated tail
+ * @param len Size of buf
+ * @return Number of bytes copied
+ */
+size_t session_output_tail(const session_output_t *output, char *buf, size_t len);
+
+/**
+ * Log the end of the captured output line by line, for a session that failed
+ * @param output Capture to read
+ * @param max_bytes Most output to log
+ */
+void session_output_log_tail(const session_output_t *output, size_t max_bytes);
+
+/**
+ * Drain and write what is left, then close the capture
+ * @param output Capture to close; it can be opened again
+ */
+void session_output_close(session_output_t *output);
+
+#endif /* KIA_SESSION_OUTPUT_H */
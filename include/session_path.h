@@ -0,0 +1,90 @@
+#ifndef KIA_SESSION_PATH_H
+#define KIA_SESSION_PATH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "session.h"
+
+/* Command search path used when PATH is unset or empty */
+#define SESSION_PATH_DEFAULT "/usr/local/bin:/usr/bin:/bin"
+
+/* Most PATH directories searched for session commands */
+#define SESSION_PATH_MAX_DIRS 64
+
+/* One PATH directory; results memoised for it expire when it changes */
+typedef struct {
+    char *path;
+    uint64_t dev;
+    uint64_t ino;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    bool present;
+    uint32_t generation;   /* Bumped whenever the directory is seen to change */
+} session_path_dir_t;
+
+/* Memoised result of looking a command up in one PATH directory */
+typedef struct {
+    uint32_t hash;
+    uint32_t name_off;     /* Offset + 1 into the name pool, 0 for an empty slot */
+    uint32_t generation;   /* Directory generation the result was taken at */
+    uint16_t dir;
+    uint16_t found;
+} session_path_entry_t;
+
+/* Resolution cache for session commands over the PATH directories */
+typedef struct {
+    session_path_dir_t *dirs;
+    int dir_count;
+    session_path_entry_t *entries;
+    uint32_t capacity;     /* Power of two */
+    uint32_t count;
+    char *pool;            /* NUL-terminated command names */
+    size_t pool_len;
+    size_t pool_cap;
+    unsigned long hits;    /* Lookups answered from memoised results */
+    unsigned long probes;  /* Lookups that had to stat a candidate */
+} session_path_t;
+
+/**
+ * Set up a resolution cache over a colon-separated search path
+ * Relative and repeated entries are skipped
+ * @param cache Cache to initialize
+ * @param search_path Search path, or NULL/empty for SESSION_PATH_DEFAULT
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_path_init(session_path_t *cache, const char *search_path);
+
+/**
+ * Re-stat the PATH directories and expire results of changed ones
+ * @param cache Resolution cache
+ * @return Number of directories that changed
+ */
+int session_path_refresh(session_path_t *cache);
+
+/**
+ * Resolve a command the way execvp() would, reusing memoised results
+ * @param cache Resolution cache
+ * @param name Command name or path
+ * @param resolved Buffer receiving the path of the command, or NULL
+ * @param size Size of resolved
+ * @return KIA_SUCCESS if the command is an executable file,
+ *         KIA_ERROR_SESSION otherwise
+ */
+int session_path_find(session_path_t *cache, const char *name, char *resolved, size_t size);
+
+/**
+ * List the PATH directories in the form the session cache stamps
+ * @param cache Resolution cache
+ * @param dirs Array of at least cache->dir_count entries to fill
+ * @return Number of directories filled
+ */
+int session_path_dirs(const session_path_t *cache, session_dir_t *dirs);
+
+/**
+ * Free resolution cache resources
+ * @param cache Cache to free
+ */
+void session_path_free(session_path_t *cache);
+
+#endif /* KIA_SESSION_PATH_H */
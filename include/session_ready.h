@@ -0,0 +1,74 @@
+#ifndef KIA_SESSION_READY_H
+#define KIA_SESSION_READY_H
+
+#include <stdbool.h>
+#include <time.h>
+
+/* Environment variable naming the descriptor a session signals readiness on */
+#define SESSION_READY_ENV "KIA_READY_FD"
+
+/* Machine-readable login latency records, one JSON object per line */
+#define SESSION_READY_STATS_PATH "/var/log/kia-login.jsonl"
+
+/* Pipe a session writes to once its desktop is usable */
+typedef struct {
+    int fd;                      /* Read end kept by Kia, or -1 */
+    int session_fd;              /* Write end inherited by the session, or -1 */
+} session_ready_t;
+
+/* When each phase of a login finished, zero if it did not happen */
+typedef struct {
+    struct timespec submitted;   /* Credentials entered, or autologin chosen */
+    struct timespec auth_start;
+    struct timespec auth_done;   /* Zero for autologin */
+    struct timespec launch_start;
+    struct timespec spawn_start; /* Display, X server and environment are ready */
+    struct timespec exec_done;   /* Session command replaced the trampoline */
+    struct timespec ready;       /* Session wrote to its readiness pipe */
+} session_latency_t;
+
+/**
+ * Set up a readiness channel holding nothing
+ * @param ready Channel to initialize
+ */
+void session_ready_init(session_ready_t *ready);
+
+/**
+ * Open a readiness channel whose write end a spawned session inherits
+ * @param ready Channel to open
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_ready_open(session_ready_t *ready);
+
+/**
+ * Close Kia's copy of the write end once the session has inherited it
+ * @param ready Channel
+ */
+void session_ready_close_session(session_ready_t *ready);
+
+/**
+ * Check whether the session signalled readiness, without blocking
+ * @param ready Channel
+ * @return 1 if the session is ready, 0 if it has not said yet, -1 if it
+ *         closed the channel without signalling or on error
+ */
+int session_ready_check(session_ready_t *ready);
+
+/**
+ * Close both ends of a channel
+ * @param ready Channel, left holding nothing
+ */
+void session_ready_close(session_ready_t *ready);
+
+/**
+ * Log a login's phase durations and append them to stats_path as JSON
+ * @param latency Phase timestamps
+ * @param username User who logged in
+ * @param session Name of the session started
+ * @param stats_path File to append to, or NULL to only log
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION if not written
+ */
+int session_latency_report(const session_latency_t *latency, const char *username,
+                           const char *session, const char *stats_path);
+
+#endif /* KIA_SESSION_READY_H */
@@ -0,0 +1,43 @@
+#ifndef KIA_SESSION_SPAWN_H
+#define KIA_SESSION_SPAWN_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/* Most executables a spawn falls back through */
+#define SESSION_SPAWN_MAX_EXECS 3
+
+/* Stack of the pre-exec trampoline; it only makes system calls */
+#define SESSION_SPAWN_STACK_SIZE (128 * 1024)
+
+/* One exec attempt */
+typedef struct {
+    const char *path;            /* Executable, or NULL to search envp's PATH for argv[0] */
+    const char *const *argv;
+} session_spawn_exec_t;
+
+/* Everything the child needs, prepared by the parent before the spawn */
+typedef struct {
+    session_spawn_exec_t execs[SESSION_SPAWN_MAX_EXECS];  /* Tried in order */
+    int exec_count;
+    char *const *envp;           /* Complete environment of the new program */
+    const char *dir;             /* Working directory, or NULL to keep the current one */
+    bool set_ids;                /* Switch to uid, gid and groups before exec */
+    uid_t uid;
+    gid_t gid;
+    const gid_t *groups;         /* Supplementary groups */
+    int group_count;
+    bool redirect_output;        /* Make output_fd the child's stdout and stderr */
+    int output_fd;
+    bool new_group;              /* Lead a process group of its own */
+} session_spawn_t;
+
+/**
+ * Start a program without copying the caller's address space
+ * @param spawn What to run and how
+ * @param pid Set to the process ID of the program on success
+ * @return KIA_SUCCESS if one of the execs succeeded, KIA_ERROR_SESSION otherwise
+ */
+int session_spawn(const session_spawn_t *spawn, pid_t *pid);
+
+#endif /* KIA_SESSION_SPAWN_H */
@@ -0,0 +1,97 @@
+#ifndef KIA_SESSION_SUPERVISOR_H
+#define KIA_SESSION_SUPERVISOR_H
+
+#include <stdbool.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/types.h>
+#include "session_usage.h"
+
+/* Most session processes tracked at once */
+#define SESSION_SUPERVISOR_MAX_CHILDREN 8
+
+/* A session process and, once it has been reaped, how it ended */
+typedef struct {
+    pid_t pid;
+    int pidfd;                   /* Readable once the process has exited */
+    char name[64];
+    struct timespec started;
+    int exit_status;             /* Exit code, valid when term_signal is 0 */
+    int term_signal;             /* Signal that ended the process, or 0 */
+    double runtime_ms;           /* Time from launch until reaped */
+    session_usage_t usage;       /* Resources used, valid once reaped */
+} session_child_t;
+
+/* Tracks session processes through pidfds behind one epoll descriptor */
+typedef struct {
+    int fd;                      /* epoll descriptor, readable when a child exited */
+    session_child_t children[SESSION_SUPERVISOR_MAX_CHILDREN];
+    int count;
+} session_supervisor_t;
+
+/**
+ * Set up a supervisor with no children
+ * @param sup Supervisor to initialize
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_supervisor_init(session_supervisor_t *sup);
+
+/**
+ * Get the descriptor to poll for child exits
+ * @param sup Supervisor
+ * @return File descriptor, or -1 if not initialized
+ */
+int session_supervisor_fd(const session_supervisor_t *sup);
+
+/**
+ * Start tracking an unreaped child process through a pidfd
+ * @param sup Supervisor
+ * @param pid Process ID
+ * @param name Name used in log messages
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_supervisor_add(session_supervisor_t *sup, pid_t pid, const char *name);
+
+/**
+ * Wait until a child has exited, the timeout passes or a signal arrives
+ * @param sup Supervisor
+ * @param timeout_ms Milliseconds to wait, or -1 to wait indefinitely
+ * @param sigmask Signal mask during the wait, or NULL to keep the current one
+ * @return 1 if a child has exited, 0 on timeout or signal,
+ *         KIA_ERROR_SESSION on error
+ */
+int session_supervisor_wait(session_supervisor_t *sup, int timeout_ms, const sigset_t *sigmask);
+
+/**
+ * Reap and log the children that have exited, without blocking
+ * @param sup Supervisor
+ * @param exited Receives the reaped children, may be NULL if max is 0
+ * @param max Capacity of exited; further exits are left for the next call
+ * @return Number of children reaped, or KIA_ERROR_SESSION on error
+ */
+int session_supervisor_process(session_supervisor_t *sup, session_child_t *exited, int max);
+
+/**
+ * Send a signal to every tracked child
+ * pidfds make this safe against the PID having been reused
+ * @param sup Supervisor
+ * @param sig Signal number
+ * @return Number of children signalled
+ */
+int session_supervisor_signal(session_supervisor_t *sup, int sig);
+
+/**
+ * Get the number of children still tracked
+ * @param sup Supervisor
+ * @return Child count
+ */
+int session_supervisor_count(const session_supervisor_t *sup);
+
+/**
+ * Stop tracking all children and free resources
+ * Children are neither signalled nor reaped
+ * @param sup Supervisor to free
+ */
+void session_supervisor_free(session_supervisor_t *sup);
+
+#endif /* KIA_SESSION_SUPERVISOR_H */
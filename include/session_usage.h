@@ -0,0 +1,34 @@
+#ifndef KIA_SESSION_USAGE_H
+#define KIA_SESSION_USAGE_H
+
+#include <sys/types.h>
+#include <sys/resource.h>
+
+/* Resources a session used, collected when it is reaped */
+typedef struct {
+    /* From wait4()/waitid() rusage: the process and the descendants it reaped */
+    double user_ms;
+    double system_ms;
+    long max_rss_kb;
+    long minor_faults;
+    long major_faults;
+    long voluntary_switches;
+    long involuntary_switches;
+} session_usage_t;
+
+/**
+ * Fill in a usage record
+ * @param usage Record to fill in
+ * @param ru Resource usage from wait4() or waitid()
+ */
+void session_usage_from_rusage(session_usage_t *usage, const struct rusage *ru);
+
+/**
+ * Log a usage record as one line of key=value pairs
+ * @param usage Record to log
+ * @param name Name of the session process
+ * @param pid Its process ID
+ */
+void session_usage_log(const session_usage_t *usage, const char *name, pid_t pid);
+
+#endif /* KIA_SESSION_USAGE_H */
@@ -0,0 +1,98 @@
+#ifndef KIA_SESSION_USER_H
+#define KIA_SESSION_USER_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include "session.h"
+#include "session_cache.h"
+
+/* Most users whose sessions are remembered; the least recently used goes first */
+#define SESSION_USER_MAX 8
+
+/* Session directories under a user's data home, relative to the home directory */
+#define SESSION_USER_DATA_HOME ".local/share"
+
+/* Longest wait for a scan, e.g. of a hung network home, before it is abandoned */
+#define SESSION_USER_SCAN_TIMEOUT_MS 2000
+
+/* Sessions found in one user's data home */
+typedef struct {
+    char *username;
+    uid_t uid;                       /* Identity the directories are read with */
+    gid_t gid;
+    session_dir_t dirs[2];           /* xsessions and wayland-sessions */
+    session_dir_stamp_t stamps[2];   /* Taken before the scan the list came from */
+    session_list_t list;
+    unsigned long generation;        /* Bumped whenever the list is rescanned */
+    unsigned long last_used;
+} session_user_entry_t;
+
+struct session_user_scan;
+
+/* Background scanner of per-user session directories, memoised per user */
+typedef struct {
+    session_user_entry_t entries[SESSION_USER_MAX];
+    int count;
+    int current;                     /* Entry of the user last started, or -1 */
+    int merged;                      /* Entry merged into the session list, or -1 */
+    unsigned long merged_generation;
+    struct session_user_scan *scan;  /* Scan started and not yet collected, or NULL */
+    int fd;                          /* eventfd signalled once results are ready */
+    unsigned long clock;
+    unsigned long scans;             /* Scans of a user's directories */
+    unsigned long hits;              /* Starts answered from a remembered scan */
+    unsigned long abandoned;         /* Scans given up on after the timeout */
+} session_user_t;
+
+/**
+ * Set up an empty per-user session scanner
+ * @param users Scanner to initialize
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_user_init(session_user_t *users);
+
+/**
+ * Start finding the sessions under a user's ~/.local/share in the background
+ * @param users Scanner
+ * @param username User whose sessions to find
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION if the user is unknown
+ */
+int session_user_start(session_user_t *users, const char *username);
+
+/**
+ * Get the descriptor that becomes readable once the user's sessions are ready
+ * @param users Scanner
+ * @return Readable descriptor, or -1 if there is nothing to wait for
+ */
+int session_user_fd(const session_user_t *users);
+
+/**
+ * Merge the sessions of the user last started into a session list
+ * Waits for the scan for at most SESSION_USER_SCAN_TIMEOUT_MS
+ * @param users Scanner
+ * @param list Session list discovered from dirs
+ * @param dirs Directories the list was discovered from
+ * @param dir_count Number of entries in dirs
+ * @return Number of sessions changed in the list, or KIA_ERROR_SESSION on error
+ */
+int session_user_merge(session_user_t *users, session_list_t *list,
+                       const session_dir_t *dirs, int dir_count);
+
+/**
+ * Drop the sessions of a merged user other than the one last started
+ * @param users Scanner
+ * @param list Session list discovered from dirs
+ * @param dirs Directories the list was discovered from
+ * @param dir_count Number of entries in dirs
+ * @return Number of sessions changed in the list (0 if none)
+ */
+int session_user_drop_stale(session_user_t *users, session_list_t *list,
+                            const session_dir_t *dirs, int dir_count);
+
+/**
+ * Wait for a pending scan and free scanner resources
+ * @param users Scanner to free
+ */
+void session_user_free(session_user_t *users);
+
+#endif /* KIA_SESSION_USER_H */
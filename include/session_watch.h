@@ -0,0 +1,90 @@
+#ifndef KIA_SESSION_WATCH_H
+#define KIA_SESSION_WATCH_H
+
+#include "session.h"
+
+/* Watch state of one session directory */
+typedef struct {
+    char *path;
+    session_type_t type;
+    int wd;              /* Watch on the directory, or -1 while it is missing */
+    int parent_wd;       /* Watch on the parent while the directory is missing, or -1 */
+} session_watch_dir_t;
+
+/* Most one-shot sources a watcher dispatches besides its own events */
+#define SESSION_WATCH_MAX_SOURCES 4
+
+/**
+ * Callback run once its source descriptor is readable
+ * @return Number of sessions it changed in the list (0 if none)
+ */
+typedef int (*session_watch_source_fn)(session_list_t *list, void *data);
+
+/* Descriptor whose readiness applies further changes to the list */
+typedef struct {
+    int fd;
+    session_watch_source_fn fn;
+    void *data;
+} session_watch_source_t;
+
+/* inotify watcher over the session directories */
+typedef struct {
+    int fd;                   /* epoll descriptor over inotify_fd and the sources */
+    int inotify_fd;
+    session_watch_source_t sources[SESSION_WATCH_MAX_SOURCES];
+    int source_count;
+    session_watch_dir_t *dirs;
+    session_dir_t *dir_list;  /* Same directories, in the form session.h expects */
+    int dir_count;
+} session_watch_t;
+
+/**
+ * Start watching session directories for desktop file changes
+ * @param watch Watcher to initialize
+ * @param dirs Directories the watched list was discovered from, in order
+ * @param dir_count Number of entries in dirs
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_watch_init(session_watch_t *watch, const session_dir_t *dirs, int dir_count);
+
+/**
+ * Get the descriptor to poll for pending changes
+ * @param watch Watcher
+ * @return Readable descriptor, or -1 if the watcher is not running
+ */
+int session_watch_fd(const session_watch_t *watch);
+
+/**
+ * Have the watcher run a callback once a descriptor becomes readable
+ * @param watch Running watcher
+ * @param fd Descriptor to wait for; it stays owned by the caller
+ * @param fn Callback applying the changes to the list, run once
+ * @param data Passed to fn
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_watch_add_source(session_watch_t *watch, int fd, session_watch_source_fn fn,
+                             void *data);
+
+/**
+ * Drop a source that has not fired yet
+ * @param watch Watcher
+ * @param fd Descriptor the source was added with
+ * @return KIA_SUCCESS if it was dropped, KIA_ERROR_SESSION otherwise
+ */
+int session_watch_remove_source(session_watch_t *watch, int fd);
+
+/**
+ * Apply pending changes to a session list without blocking
+ * @param watch Watcher
+ * @param list Session list discovered from the watched directories
+ * @return Number of changes applied (0 if none), or KIA_ERROR_SESSION on error
+ */
+int session_watch_process(session_watch_t *watch, session_list_t *list);
+
+/**
+ * Stop watching and free watcher resources
+ * @param watch Watcher to close
+ */
+void session_watch_close(session_watch_t *watch);
+
+#endif /* KIA_SESSION_WATCH_H */
@@ -0,0 +1,67 @@
+#ifndef KIA_SESSION_XORG_H
+#define KIA_SESSION_XORG_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/* X server started for X11 sessions, looked up in PATH */
+#define SESSION_XORG_SERVER "Xorg"
+
+/* Time the X server gets to report its display number */
+#define SESSION_XORG_READY_TIMEOUT_MS 10000
+
+/* Length of the MIT-MAGIC-COOKIE-1 secret */
+#define SESSION_XORG_COOKIE_LEN 16
+
+/* An X server started for one session */
+typedef struct {
+    pid_t pid;                   /* Server process, 0 if none is running */
+    int display;                 /* Display number reported through -displayfd, or -1 */
+    unsigned char cookie[SESSION_XORG_COOKIE_LEN];
+    char server_auth[128];       /* Authority file passed to the server with -auth */
+    char client_auth[128];       /* Authority file for the session, owned by the user */
+} session_xorg_t;
+
+/**
+ * Write an X authority file with one MIT-MAGIC-COOKIE-1 entry for any address
+ * @param fd Open file to write to, truncated first
+ * @param cookie Secret of SESSION_XORG_COOKIE_LEN bytes
+ * @param display Display number, or -1 for an entry without one (server side)
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_xorg_write_auth(int fd, const unsigned char *cookie, int display);
+
+/**
+ * Start an X server with -displayfd and wait until it accepts connections
+ * @param xorg Server state to fill in
+ * @param server Server executable, absolute or looked up in PATH
+ * @param auth_dir Directory for authority files
+ * @param display Display number to serve, or -1 to let the server pick one
+ * @param timeout_ms Time to wait for readiness
+ * @return KIA_SUCCESS once the server is ready, KIA_ERROR_SESSION otherwise
+ */
+int session_xorg_start(session_xorg_t *xorg, const char *server, const char *auth_dir,
+                       int display, int timeout_ms);
+
+/**
+ * Write the authority file a session uses to connect to the server
+ * @param xorg Running server
+ * @param uid Owner of the file
+ * @param gid Group of the file
+ * @return KIA_SUCCESS on success, KIA_ERROR_SESSION on error
+ */
+int session_xorg_grant(session_xorg_t *xorg, uid_t uid, gid_t gid);
+
+/**
+ * Stop a server not handed to a supervisor and reap it
+ * @param xorg Server state
+ */
+void session_xorg_stop(session_xorg_t *xorg);
+
+/**
+ * Remove the authority files of a server that has exited
+ * @param xorg Server state
+ */
+void session_xorg_remove_auth(session_xorg_t *xorg);
+
+#endif /* KIA_SESSION_XORG_H */
@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include "session.h"
+#include "session_watch.h"
 
 /**
  * Initialize the TUI (ncurses)
@@ -40,11 +41,13 @@ int tui_get_credentials(char *username, size_t user_len,
 
 /**
  * Display session selection menu with arrow key navigation
+ * Changes reported by the watcher are applied and redrawn while it is open
  * @param sessions List of available sessions
+ * @param watch Watcher over the session directories, or NULL
  * @param default_idx Default session index to highlight
  * @return Selected session index, or -1 on error/cancel
  */
-int tui_select_session(const session_list_t *sessions, int default_idx);
+int tui_select_session(session_list_t *sessions, session_watch_t *watch, int default_idx);
 
 /**
  * Display an error message in distinct color
@@ -58,4 +61,37 @@ void tui_show_error(const char *message);
  */
 void tui_show_message(const char *message);
 
+/* What tui_wait_progress() stopped waiting for */
+typedef enum {
+    TUI_WAIT_READY,     /* The descriptor became readable */
+    TUI_WAIT_CANCEL,    /* Escape was pressed */
+    TUI_WAIT_TICK,      /* Time for the next frame */
+    TUI_WAIT_ERROR
+} tui_wait_t;
+
+/**
+ * Show a message with a spinner until a descriptor, Escape or the next frame
+ * @param message Message shown in front of the spinner
+ * @param frame Spinner frame, advanced by the caller on each tick
+ * @param fd Descriptor to wait for
+ * @param tick_ms Longest wait in milliseconds
+ * @return What ended the wait
+ */
+tui_wait_t tui_wait_progress(const char *message, int frame, int fd, int tick_ms);
+
+/**
+ * Give the terminal back before a session starts, saving the ncurses modes
+ */
+void tui_suspend(void);
+
+/**
+ * Free the suspended screen while a session runs; tui_resume() sets it up again
+ */
+void tui_release(void);
+
+/**
+ * Take the terminal back after a session ended, restoring the saved modes
+ */
+void tui_resume(void);
+
 #endif /* KIA_TUI_H */
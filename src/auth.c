@@ -1,4 +1,5 @@
 #include "auth.h"
+#include "auth_helper.h"
 #include "logger.h"
 #include <security/pam_appl.h>
 #include <string.h>
@@ -8,18 +9,58 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
 
 /* PAM conversation data */
 typedef struct {
     const char *password;
 } pam_conv_data_t;
 
-/* Global PAM handle */
-static struct pam_handle *pam_handle = NULL;
+/* Process the PAM transactions run in, when it could be started */
+static auth_helper_t pam_helper = AUTH_HELPER_INIT;
+
+/* Handle the helper keeps open so the PAM modules of the service stay loaded */
+static struct pam_handle *warm_handle = NULL;
+
+/* Environment exported by PAM modules at the last successful authentication */
+static char **pam_env = NULL;
 
 /* TTY file descriptor for locking */
 static int tty_fd = -1;
 
+/* Held for a whole authentication, as PAM state above is shared */
+static pthread_mutex_t auth_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Longest username or password a request holds, terminator included */
+#define AUTH_FIELD_LEN 256
+
+/* Authentication running on a worker thread */
+struct auth_request {
+    pthread_t thread;
+    pthread_mutex_t lock;    /* Guards done and abandoned */
+    bool done;
+    bool abandoned;          /* Cancelled; the worker frees the request */
+    int fd;                  /* eventfd signalled once the result is in */
+    int result;
+    char username[AUTH_FIELD_LEN];
+    char password[AUTH_FIELD_LEN];
+    kia_config_t config;
+    auth_state_t state;      /* Attempt tracking, handed back by auth_finish() */
+};
+
+/**
+ * Secure memory clearing function
+ * Uses volatile to prevent compiler optimization
+ */
+static void secure_memzero(void *ptr, size_t len) {
+    volatile unsigned char *p = ptr;
+    while (len--) {
+        *p++ = 0;
+    }
+}
+
 /**
  * Lock the TTY to prevent switching during authentication
  * @return KIA_SUCCESS on success, KIA_ERROR_SYSTEM on failure
@@ -121,15 +162,105 @@ static int pam_conversation(int num_msg, const struct pam_message **msg,
     return PAM_SUCCESS;
 }
 
+/**
+ * Free the environment kept from the last authentication
+ */
+static void free_pam_env(void) {
+    if (pam_env) {
+        for (char **var = pam_env; *var; var++) {
+            free(*var);
+        }
+        free(pam_env);
+        pam_env = NULL;
+    }
+}
+
+/**
+ * Run one PAM transaction: authenticate, check the account and establish
+ * credentials; runs in the helper when there is one
+ */
+static int pam_transaction(const char *username, const char *password, char ***env) {
+    struct pam_handle *pamh = NULL;
+
+    *env = NULL;
+
+    /* Setup PAM conversation */
+    pam_conv_data_t conv_data = { .password = password };
+    struct pam_conv conv = {
+        .conv = pam_conversation,
+        .appdata_ptr = &conv_data
+    };
+
+    /* Initialize PAM */
+    int pam_result = pam_start("kia", username, &conv, &pamh);
+    if (pam_result != PAM_SUCCESS) {
+        logger_log(LOG_ERROR, "PAM initialization failed: %s",
+                   pam_strerror(pamh, pam_result));
+        return KIA_ERROR_PAM;
+    }
+
+    /* Authenticate */
+    pam_result = pam_authenticate(pamh, 0);
+    if (pam_result != PAM_SUCCESS) {
+        logger_log(LOG_ERROR, "PAM rejected user '%s': %s",
+                   username, pam_strerror(pamh, pam_result));
+        pam_end(pamh, pam_result);
+        return KIA_ERROR_AUTH;
+    }
+
+    /* Verify account */
+    pam_result = pam_acct_mgmt(pamh, 0);
+    if (pam_result != PAM_SUCCESS) {
+        logger_log(LOG_ERROR, "PAM account verification failed for user '%s': %s",
+                   username, pam_strerror(pamh, pam_result));
+        pam_end(pamh, pam_result);
+        return KIA_ERROR_AUTH;
+    }
+
+    /* Establishing credentials lets modules like pam_env export variables */
+    pam_result = pam_setcred(pamh, PAM_ESTABLISH_CRED);
+    if (pam_result != PAM_SUCCESS) {
+        logger_log(LOG_WARN, "PAM could not establish credentials for user '%s': %s",
+                   username, pam_strerror(pamh, pam_result));
+    }
+    *env = pam_getenvlist(pamh);
+
+    pam_end(pamh, PAM_SUCCESS);
+    return KIA_SUCCESS;
+}
+
+/**
+ * Load the service's PAM modules in the helper once, so transactions only
+ * take references to them instead of mapping and relocating them each time
+ */
+static void warm_pam(void) {
+    struct pam_conv conv = { .conv = pam_conversation, .appdata_ptr = NULL };
+
+    if (pam_start("kia", NULL, &conv, &warm_handle) != PAM_SUCCESS) {
+        logger_log(LOG_WARN, "PAM helper could not preload the PAM modules");
+        warm_handle = NULL;
+    }
+}
+
 int auth_init(void) {
-    /* PAM initialization is done per-authentication in auth_authenticate() */
+    /* PAM runs in a helper process so a crashing module cannot take the greeter down */
+    pthread_mutex_lock(&auth_lock);
+    if (auth_helper_start(&pam_helper, pam_transaction, warm_pam) != KIA_SUCCESS) {
+        logger_log(LOG_WARN, "PAM helper unavailable, authenticating in the greeter");
+    }
+    pthread_mutex_unlock(&auth_lock);
+
     logger_log(LOG_INFO, "Authentication module initialized");
     return KIA_SUCCESS;
 }
 
-int auth_authenticate(const char *username, const char *password,
-                      const kia_config_t *config, auth_state_t *state) {
-    int result = KIA_ERROR_AUTH;
+/**
+ * Authenticate a user; the caller holds auth_lock
+ */
+static int authenticate(const char *username, const char *password,
+                        const kia_config_t *config, auth_state_t *state) {
+    char **env = NULL;
+    int result;
     
     if (!username || !password || !config || !state) {
         logger_log(LOG_ERROR, "Invalid parameters to auth_authenticate");
@@ -153,61 +284,28 @@ int auth_authenticate(const char *username, const char *password,
         state->lockout_until = 0;
     }
 
+    /* Never hand one user's environment to another */
+    free_pam_env();
+
     /* Lock TTY to prevent switching during authentication */
     tty_lock();
 
-    /* Setup PAM conversation */
-    pam_conv_data_t conv_data = { .password = password };
-    struct pam_conv conv = {
-        .conv = pam_conversation,
-        .appdata_ptr = &conv_data
-    };
-
-    /* Initialize PAM */
-    int pam_result = pam_start("kia", username, &conv, &pam_handle);
-    if (pam_result != PAM_SUCCESS) {
-        logger_log(LOG_ERROR, "PAM initialization failed: %s",
-                   pam_strerror(pam_handle, pam_result));
-        tty_unlock();
-        return KIA_ERROR_PAM;
+    if (auth_helper_running(&pam_helper)) {
+        result = auth_helper_authenticate(&pam_helper, username, password, &env);
+    } else {
+        result = pam_transaction(username, password, &env);
     }
 
-    /* Authenticate */
-    pam_result = pam_authenticate(pam_handle, 0);
-
-    if (pam_result == PAM_SUCCESS) {
-        /* Verify account */
-        pam_result = pam_acct_mgmt(pam_handle, 0);
-        if (pam_result != PAM_SUCCESS) {
-            logger_log(LOG_ERROR, "PAM account verification failed for user '%s': %s",
-                       username, pam_strerror(pam_handle, pam_result));
-            pam_end(pam_handle, pam_result);
-            pam_handle = NULL;
-            
-            state->failed_attempts++;
-            if (state->failed_attempts >= config->max_attempts) {
-                state->lockout_until = time(NULL) + config->lockout_duration;
-                logger_log(LOG_WARN, "User '%s' locked out after %d failed attempts",
-                           username, state->failed_attempts);
-            }
-            
-            tty_unlock();
-            return KIA_ERROR_AUTH;
-        }
-
+    if (result == KIA_SUCCESS) {
         /* Authentication successful */
+        pam_env = env;
         logger_log(LOG_INFO, "User '%s' authenticated successfully", username);
         auth_reset_attempts(state);
-        
-        pam_end(pam_handle, PAM_SUCCESS);
-        pam_handle = NULL;
-        result = KIA_SUCCESS;
-    } else {
+    } else if (result == KIA_ERROR_AUTH) {
         /* Authentication failed */
         state->failed_attempts++;
-        logger_log(LOG_ERROR, "Authentication failed for user '%s' (attempt %d/%d): %s",
-                   username, state->failed_attempts, config->max_attempts,
-                   pam_strerror(pam_handle, pam_result));
+        logger_log(LOG_ERROR, "Authentication failed for user '%s' (attempt %d/%d)",
+                   username, state->failed_attempts, config->max_attempts);
 
         /* Check if lockout threshold reached */
         if (state->failed_attempts >= config->max_attempts) {
@@ -215,10 +313,6 @@ int auth_authenticate(const char *username, const char *password,
             logger_log(LOG_WARN, "User '%s' locked out after %d failed attempts",
                        username, state->failed_attempts);
         }
-
-        pam_end(pam_handle, pam_result);
-        pam_handle = NULL;
-        result = KIA_ERROR_AUTH;
     }
     
     /* Unlock TTY after authentication */
@@ -227,6 +321,138 @@ int auth_authenticate(const char *username, const char *password,
     return result;
 }
 
+int auth_authenticate(const char *username, const char *password,
+                      const kia_config_t *config, auth_state_t *state) {
+    pthread_mutex_lock(&auth_lock);
+    int result = authenticate(username, password, config, state);
+    pthread_mutex_unlock(&auth_lock);
+    return result;
+}
+
+/**
+ * Free a request once no thread uses it anymore
+ */
+static void request_free(auth_request_t *req) {
+    secure_memzero(req->password, sizeof(req->password));
+    close(req->fd);
+    pthread_mutex_destroy(&req->lock);
+    free(req);
+}
+
+/* Worker thread: authenticate, then signal the result or discard it */
+static void *auth_main(void *arg) {
+    auth_request_t *req = arg;
+
+    pthread_mutex_lock(&auth_lock);
+    int result = authenticate(req->username, req->password, &req->config, &req->state);
+    secure_memzero(req->password, sizeof(req->password));
+
+    pthread_mutex_lock(&req->lock);
+    req->result = result;
+    req->done = true;
+    bool abandoned = req->abandoned;
+    pthread_mutex_unlock(&req->lock);
+
+    if (abandoned) {
+        /* Nobody starts a session with what a cancelled login exported */
+        free_pam_env();
+        pthread_mutex_unlock(&auth_lock);
+        logger_log(LOG_INFO, "Cancelled authentication of '%s' finished, result discarded",
+                   req->username);
+        request_free(req);
+        return NULL;
+    }
+    pthread_mutex_unlock(&auth_lock);
+
+    uint64_t one = 1;
+    if (write(req->fd, &one, sizeof(one)) != (ssize_t)sizeof(one)) {
+        logger_log(LOG_WARN, "Failed to signal authentication result: %s", strerror(errno));
+    }
+    return NULL;
+}
+
+auth_request_t *auth_start(const char *username, const char *password,
+                           const kia_config_t *config, const auth_state_t *state) {
+    /* Validate input parameters */
+    if (!username || !password || !config || !state ||
+        strlen(username) >= AUTH_FIELD_LEN || strlen(password) >= AUTH_FIELD_LEN) {
+        logger_log(LOG_ERROR, "Invalid parameters to auth_start");
+        return NULL;
+    }
+
+    auth_request_t *req = calloc(1, sizeof(*req));
+    if (!req) {
+        logger_log(LOG_ERROR, "Failed to allocate authentication request");
+        return NULL;
+    }
+    req->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (req->fd < 0) {
+        logger_log(LOG_WARN, "Failed to create authentication eventfd: %s", strerror(errno));
+        free(req);
+        return NULL;
+    }
+    pthread_mutex_init(&req->lock, NULL);
+    strcpy(req->username, username);
+    strcpy(req->password, password);
+    req->config = *config;
+    req->state = *state;
+
+    int err = pthread_create(&req->thread, NULL, auth_main, req);
+    if (err != 0) {
+        logger_log(LOG_WARN, "Failed to start authentication thread: %s", strerror(err));
+        request_free(req);
+        return NULL;
+    }
+    return req;
+}
+
+int auth_request_fd(const auth_request_t *req) {
+    return req ? req->fd : -1;
+}
+
+int auth_finish(auth_request_t *req, auth_state_t *state) {
+    /* Validate input parameters */
+    if (!req) {
+        return KIA_ERROR_AUTH;
+    }
+
+    pthread_join(req->thread, NULL);
+    int result = req->result;
+    if (state) {
+        *state = req->state;
+    }
+    request_free(req);
+    return result;
+}
+
+void auth_cancel(auth_request_t *req) {
+    if (!req) {
+        return;
+    }
+
+    pthread_mutex_lock(&req->lock);
+    bool done = req->done;
+    req->abandoned = !done;
+    pthread_mutex_unlock(&req->lock);
+
+    if (!done) {
+        /*
+         * A PAM transaction in the helper is cut short so the worker lets go
+         * of auth_lock and the VT now; one in the greeter cannot be. Either
+         * way the worker frees the request once it returns
+         */
+        auth_helper_interrupt(&pam_helper);
+        pthread_detach(req->thread);
+        return;
+    }
+
+    pthread_join(req->thread, NULL);
+    pthread_mutex_lock(&auth_lock);
+    free_pam_env();
+    pthread_mutex_unlock(&auth_lock);
+    request_free(req);
+}
+
 bool auth_is_locked_out(auth_state_t *state) {
     if (!state) {
         return false;
@@ -254,14 +480,23 @@ void auth_reset_attempts(auth_state_t *state) {
     }
 }
 
+const char *const *auth_get_env(void) {
+    return (const char *const *)pam_env;
+}
+
 void auth_cleanup(void) {
-    if (pam_handle) {
-        pam_end(pam_handle, PAM_SUCCESS);
-        pam_handle = NULL;
+    /* A cancelled authentication may still be stuck in PAM; leave its state alone */
+    if (pthread_mutex_trylock(&auth_lock) != 0) {
+        logger_log(LOG_WARN, "Authentication still in progress at cleanup");
+        return;
     }
+
+    free_pam_env();
+    auth_helper_stop(&pam_helper);
     
     /* Ensure TTY is unlocked */
     tty_unlock();
+    pthread_mutex_unlock(&auth_lock);
     
     logger_log(LOG_INFO, "Authentication module cleaned up");
 }
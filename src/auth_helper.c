@@ -0,0 +1,469 @@
+#define _GNU_SOURCE
+#include "auth_helper.h"
+#include "session_group.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+/* Bumped whenever the message layout changes */
+#define AUTH_HELPER_PROTOCOL 1
+
+/* Request, sent as one message */
+typedef struct {
+    uint32_t protocol;
+    char username[AUTH_HELPER_FIELD_LEN];
+    char password[AUTH_HELPER_FIELD_LEN];
+} helper_request_t;
+
+/* Reply, sent as one message cut after env_len bytes of env */
+typedef struct {
+    uint32_t protocol;
+    int32_t result;
+    uint32_t env_len;
+    char env[AUTH_HELPER_ENV_MAX];   /* NUL-terminated NAME=value strings */
+} helper_reply_t;
+
+/**
+ * Secure memory clearing function
+ * Uses volatile to prevent compiler optimization
+ */
+static void secure_memzero(void *ptr, size_t len) {
+    volatile unsigned char *p = ptr;
+    while (len--) {
+        *p++ = 0;
+    }
+}
+
+/**
+ * Free an environment list and its strings
+ */
+static void free_env(char **env) {
+    if (env) {
+        for (char **var = env; *var; var++) {
+            free(*var);
+        }
+        free(env);
+    }
+}
+
+/**
+ * Answer one request in the helper
+ */
+static void serve(int fd, const helper_request_t *req, size_t len, auth_helper_fn authenticate) {
+    helper_reply_t reply = { .protocol = AUTH_HELPER_PROTOCOL, .result = KIA_ERROR_PAM };
+    char **env = NULL;
+
+    if (len == sizeof(*req) && req->protocol == AUTH_HELPER_PROTOCOL &&
+        memchr(req->username, '\0', sizeof(req->username)) &&
+        memchr(req->password, '\0', sizeof(req->password))) {
+        reply.result = authenticate(req->username, req->password, &env);
+    } else {
+        logger_log(LOG_ERROR, "PAM helper received a malformed request");
+    }
+
+    if (reply.result == KIA_SUCCESS && env) {
+        for (char **var = env; *var; var++) {
+            size_t var_len = strlen(*var) + 1;
+            if (var_len > sizeof(reply.env) - reply.env_len) {
+                logger_log(LOG_WARN, "PAM environment too large, dropping %.*s",
+                           (int)strcspn(*var, "="), *var);
+                continue;
+            }
+            memcpy(reply.env + reply.env_len, *var, var_len);
+            reply.env_len += (uint32_t)var_len;
+        }
+    }
+    free_env(env);
+
+    if (send(fd, &reply, offsetof(helper_reply_t, env) + reply.env_len, MSG_NOSIGNAL) < 0) {
+        logger_log(LOG_WARN, "PAM helper failed to send reply: %s", strerror(errno));
+    }
+    secure_memzero(&reply, sizeof(reply));
+}
+
+/**
+ * Reset what the greeter's handlers and mask would otherwise leave in place
+ */
+static void reset_signals(void) {
+    struct sigaction sa;
+    sigset_t none;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = SIG_DFL;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGCHLD, &sa, NULL);
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL);
+}
+
+/**
+ * Helper process: answer requests until the greeter closes its end
+ */
+static void helper_main(int fd, auth_helper_fn authenticate, void (*prepare)(void)) {
+    helper_request_t req;
+
+    if (prepare) {
+        prepare();
+    }
+
+    for (;;) {
+        ssize_t len = recv(fd, &req, sizeof(req), 0);
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len <= 0) {
+            break;
+        }
+        serve(fd, &req, (size_t)len, authenticate);
+        secure_memzero(&req, sizeof(req));
+    }
+    _exit(0);
+}
+
+/**
+ * Reap helpers that exited, logging those a signal other than our SIGKILL took down
+ */
+static void reap_helpers(int options) {
+    pid_t pid;
+    int status;
+
+    while ((pid = waitpid(-1, &status, options)) != 0) {
+        if (pid < 0 && errno == EINTR) {
+            continue;
+        }
+        if (pid < 0) {
+            break;
+        }
+        if (WIFSIGNALED(status) && WTERMSIG(status) != SIGKILL) {
+            logger_log(LOG_ERROR, "PAM helper (PID %d) was killed by signal %d",
+                       (int)pid, WTERMSIG(status));
+        }
+    }
+}
+
+/**
+ * Spawner process: fork a helper for each request and pass its socket back
+ * Forked while the greeter is still single-threaded, so helpers never come
+ * from a fork of a threaded process
+ */
+static void spawner_main(int ctl, auth_helper_fn authenticate, void (*prepare)(void)) {
+    char request;
+
+    for (;;) {
+        ssize_t len = recv(ctl, &request, 1, 0);
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len <= 0) {
+            break;
+        }
+
+        /* The helper being replaced has been killed by now */
+        reap_helpers(WNOHANG);
+
+        int fds[2] = { -1, -1 };
+        pid_t pid = -1;
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == 0) {
+            pid = fork();
+            if (pid == 0) {
+                close(ctl);
+                close(fds[0]);
+                helper_main(fds[1], authenticate, prepare);
+            }
+            close(fds[1]);
+        }
+
+        /* The PID goes along with the socket, or alone as -1 on failure */
+        char control[CMSG_SPACE(sizeof(int))];
+        struct iovec iov = { .iov_base = &pid, .iov_len = sizeof(pid) };
+        struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+        memset(control, 0, sizeof(control));
+        if (pid > 0) {
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+            memcpy(CMSG_DATA(cmsg), &fds[0], sizeof(int));
+        }
+        if (sendmsg(ctl, &msg, MSG_NOSIGNAL) < 0 && pid > 0) {
+            kill(pid, SIGKILL);
+        }
+        if (fds[0] >= 0) {
+            close(fds[0]);
+        }
+    }
+
+    /* The greeter killed or closed every helper before closing this end */
+    reap_helpers(0);
+    _exit(0);
+}
+
+/**
+ * Have the spawner fork a new helper and take over its socket
+ * Safe from any thread, as nothing is forked here
+ */
+static int spawn_helper(auth_helper_t *helper) {
+    char request = 'H';
+    pid_t pid = -1;
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = { .iov_base = &pid, .iov_len = sizeof(pid) };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+                          .msg_control = control, .msg_controllen = sizeof(control) };
+    ssize_t len;
+
+    if (helper->spawner_pid <= 0 ||
+        send(helper->spawner_fd, &request, 1, MSG_NOSIGNAL) != 1) {
+        logger_log(LOG_ERROR, "PAM helper spawner is gone");
+        return KIA_ERROR_SYSTEM;
+    }
+    do {
+        len = recvmsg(helper->spawner_fd, &msg, MSG_CMSG_CLOEXEC);
+    } while (len < 0 && errno == EINTR);
+
+    struct cmsghdr *cmsg = len == (ssize_t)sizeof(pid) ? CMSG_FIRSTHDR(&msg) : NULL;
+    if (pid <= 0 || !cmsg || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(int))) {
+        logger_log(LOG_ERROR, "Failed to start PAM helper");
+        return KIA_ERROR_SYSTEM;
+    }
+
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    pthread_mutex_lock(&helper->lock);
+    helper->pid = pid;
+    helper->fd = fd;
+    pthread_mutex_unlock(&helper->lock);
+    logger_log(LOG_INFO, "PAM helper started (PID %d)", (int)pid);
+    return KIA_SUCCESS;
+}
+
+int auth_helper_start(auth_helper_t *helper, auth_helper_fn authenticate, void (*prepare)(void)) {
+    int fds[2];
+
+    /* Validate input parameters */
+    if (!helper || !authenticate) {
+        return KIA_ERROR_SYSTEM;
+    }
+    if (auth_helper_running(helper)) {
+        return KIA_SUCCESS;
+    }
+
+    if (helper->spawner_pid <= 0) {
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0) {
+            logger_log(LOG_ERROR, "Failed to create PAM helper socket: %s", strerror(errno));
+            return KIA_ERROR_SYSTEM;
+        }
+
+        /* Only ever called before the greeter starts a thread, see auth_helper.h */
+        pid_t pid = fork();
+        if (pid < 0) {
+            logger_log(LOG_ERROR, "Failed to start PAM helper spawner: %s", strerror(errno));
+            close(fds[0]);
+            close(fds[1]);
+            return KIA_ERROR_SYSTEM;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            reset_signals();
+            spawner_main(fds[1], authenticate, prepare);
+        }
+
+        close(fds[1]);
+        session_group_track(pid);
+        helper->spawner_pid = pid;
+        helper->spawner_fd = fds[0];
+    }
+    return spawn_helper(helper);
+}
+
+bool auth_helper_running(const auth_helper_t *helper) {
+    return helper && helper->pid > 0;
+}
+
+/**
+ * Kill a helper that stopped answering; the spawner reaps it
+ */
+static void reap(auth_helper_t *helper) {
+    pthread_mutex_lock(&helper->lock);
+    pid_t pid = helper->pid;
+    bool interrupted = helper->interrupted;
+    close(helper->fd);
+    helper->fd = -1;
+    helper->pid = -1;
+    helper->interrupted = false;
+    pthread_mutex_unlock(&helper->lock);
+
+    /* A child of the spawner that is only reaped once it forks the next one */
+    if (pid > 0) {
+        kill(pid, SIGKILL);
+    }
+    if (interrupted) {
+        logger_log(LOG_INFO, "PAM helper (PID %d) interrupted", (int)pid);
+    } else {
+        logger_log(LOG_ERROR, "PAM helper (PID %d) stopped answering", (int)pid);
+    }
+}
+
+/**
+ * Replace a helper that died with a fresh one from the spawner
+ */
+static int restart(auth_helper_t *helper) {
+    reap(helper);
+    helper->restarts++;
+    return spawn_helper(helper);
+}
+
+/**
+ * Unpack the environment of a reply into a list
+ */
+static char **unpack_env(const helper_reply_t *reply) {
+    size_t count = 0;
+
+    if (reply->env_len == 0) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < reply->env_len; i++) {
+        count += reply->env[i] == '\0';
+    }
+
+    char **env = calloc(count + 1, sizeof(char *));
+    if (!env) {
+        return NULL;
+    }
+    const char *var = reply->env;
+    for (size_t i = 0; i < count; i++) {
+        env[i] = strdup(var);
+        if (!env[i]) {
+            free_env(env);
+            return NULL;
+        }
+        var += strlen(var) + 1;
+    }
+    return env;
+}
+
+int auth_helper_authenticate(auth_helper_t *helper, const char *username,
+                             const char *password, char ***env) {
+    helper_request_t req = { .protocol = AUTH_HELPER_PROTOCOL };
+    helper_reply_t reply;
+    ssize_t len;
+
+    /* Validate input parameters */
+    if (env) {
+        *env = NULL;
+    }
+    if (!auth_helper_running(helper) || !username || !password ||
+        strlen(username) >= sizeof(req.username) || strlen(password) >= sizeof(req.password)) {
+        return KIA_ERROR_PAM;
+    }
+
+    strcpy(req.username, username);
+    strcpy(req.password, password);
+
+    /* A helper that died since the last request never saw this one, ask a new one */
+    len = send(helper->fd, &req, sizeof(req), MSG_NOSIGNAL);
+    if (len < 0 && (errno == EPIPE || errno == ECONNRESET) &&
+        restart(helper) == KIA_SUCCESS) {
+        len = send(helper->fd, &req, sizeof(req), MSG_NOSIGNAL);
+    }
+    secure_memzero(&req, sizeof(req));
+    if (len != (ssize_t)sizeof(req)) {
+        logger_log(LOG_ERROR, "Failed to send request to PAM helper: %s", strerror(errno));
+        return KIA_ERROR_PAM;
+    }
+
+    do {
+        len = recv(helper->fd, &reply, sizeof(reply), 0);
+    } while (len < 0 && errno == EINTR);
+
+    /* Whatever crashed the helper would crash it again, so the attempt fails */
+    if (len <= 0) {
+        pthread_mutex_lock(&helper->lock);
+        bool interrupted = helper->interrupted;
+        pthread_mutex_unlock(&helper->lock);
+        if (interrupted) {
+            logger_log(LOG_INFO, "Authentication of '%s' interrupted", username);
+        } else {
+            logger_log(LOG_ERROR, "PAM helper died while authenticating '%s'", username);
+        }
+        restart(helper);
+        return KIA_ERROR_PAM;
+    }
+    if ((size_t)len < offsetof(helper_reply_t, env) || reply.protocol != AUTH_HELPER_PROTOCOL ||
+        reply.env_len != (size_t)len - offsetof(helper_reply_t, env) ||
+        (reply.env_len > 0 && reply.env[reply.env_len - 1] != '\0')) {
+        logger_log(LOG_ERROR, "PAM helper sent a malformed reply");
+        return KIA_ERROR_PAM;
+    }
+
+    if (reply.result == KIA_SUCCESS && env) {
+        *env = unpack_env(&reply);
+    }
+    int result = reply.result;
+    secure_memzero(&reply, sizeof(reply));
+    return result;
+}
+
+int auth_helper_interrupt(auth_helper_t *helper) {
+    int result = KIA_ERROR_PAM;
+
+    if (!helper) {
+        return KIA_ERROR_PAM;
+    }
+
+    /* Waking the thread in recv() lets it kill and replace the helper itself */
+    pthread_mutex_lock(&helper->lock);
+    if (helper->pid > 0) {
+        helper->interrupted = true;
+        if (shutdown(helper->fd, SHUT_RDWR) == 0) {
+            result = KIA_SUCCESS;
+        } else {
+            logger_log(LOG_WARN, "Failed to interrupt PAM helper: %s", strerror(errno));
+        }
+    }
+    pthread_mutex_unlock(&helper->lock);
+    return result;
+}
+
+void auth_helper_stop(auth_helper_t *helper) {
+    if (!helper) {
+        return;
+    }
+
+    /* It keeps no state of its own, so one stuck in PAM is not waited for */
+    pthread_mutex_lock(&helper->lock);
+    pid_t pid = helper->pid;
+    if (pid > 0) {
+        close(helper->fd);
+        kill(pid, SIGKILL);
+    }
+    helper->fd = -1;
+    helper->pid = -1;
+    helper->interrupted = false;
+    pthread_mutex_unlock(&helper->lock);
+
+    /* The spawner reaps the helper before it exits */
+    if (helper->spawner_pid > 0) {
+        close(helper->spawner_fd);
+        helper->spawner_fd = -1;
+        waitpid(helper->spawner_pid, NULL, 0);
+        session_group_untrack(helper->spawner_pid);
+        helper->spawner_pid = -1;
+    }
+    if (pid > 0) {
+        logger_log(LOG_INFO, "PAM helper stopped (PID %d)", (int)pid);
+    }
+}
@@ -7,27 +7,38 @@
 /* Default configuration values */
 #define DEFAULT_AUTOLOGIN_ENABLED false
 #define DEFAULT_AUTOLOGIN_USER ""
+#define DEFAULT_KIOSK_MODE false
 #define DEFAULT_SESSION "xfce"
 #define DEFAULT_MAX_ATTEMPTS 3
 #define DEFAULT_ENABLE_LOGS true
 #define DEFAULT_LOCKOUT_DURATION 60
+#define DEFAULT_AUTH_TIMEOUT 30
+#define DEFAULT_SESSION_STOP_TIMEOUT 5
 
 /* Configuration constraints */
 #define MIN_MAX_ATTEMPTS 1
 #define MAX_MAX_ATTEMPTS 10
+#define MIN_SESSION_STOP_TIMEOUT 1
+#define MAX_SESSION_STOP_TIMEOUT 60
+#define MIN_AUTH_TIMEOUT 1
+#define MAX_AUTH_TIMEOUT 300
+
+void config_set_defaults(kia_config_t *config) {
+    if (config == NULL) {
+        return;
+    }
 
-/**
- * Initialize configuration with default values
- */
-static void config_set_defaults(kia_config_t *config) {
     config->autologin_enabled = DEFAULT_AUTOLOGIN_ENABLED;
     strncpy(config->autologin_user, DEFAULT_AUTOLOGIN_USER, sizeof(config->autologin_user) - 1);
     config->autologin_user[sizeof(config->autologin_user) - 1] = '\0';
+    config->kiosk_mode = DEFAULT_KIOSK_MODE;
     strncpy(config->default_session, DEFAULT_SESSION, sizeof(config->default_session) - 1);
     config->default_session[sizeof(config->default_session) - 1] = '\0';
     config->max_attempts = DEFAULT_MAX_ATTEMPTS;
     config->enable_logs = DEFAULT_ENABLE_LOGS;
     config->lockout_duration = DEFAULT_LOCKOUT_DURATION;
+    config->auth_timeout = DEFAULT_AUTH_TIMEOUT;
+    config->session_stop_timeout = DEFAULT_SESSION_STOP_TIMEOUT;
 }
 
 /**
@@ -111,6 +122,8 @@ static int parse_config_line(char *line, kia_config_t *config) {
         }
         strncpy(config->autologin_user, value, sizeof(config->autologin_user) - 1);
         config->autologin_user[sizeof(config->autologin_user) - 1] = '\0';
+    } else if (strcmp(key, "kiosk_mode") == 0) {
+        config->kiosk_mode = parse_bool(value);
     } else if (strcmp(key, "default_session") == 0) {
         /* Validate session name length */
         size_t value_len = strlen(value);
@@ -141,6 +154,26 @@ static int parse_config_line(char *line, kia_config_t *config) {
             return KIA_ERROR_CONFIG;
         }
         config->lockout_duration = duration;
+    } else if (strcmp(key, "auth_timeout") == 0) {
+        /* Validate numeric value */
+        if (value[0] == '\0') {
+            return KIA_ERROR_CONFIG;
+        }
+        int timeout = atoi(value);
+        if (timeout < MIN_AUTH_TIMEOUT || timeout > MAX_AUTH_TIMEOUT) {
+            return KIA_ERROR_CONFIG;
+        }
+        config->auth_timeout = timeout;
+    } else if (strcmp(key, "session_stop_timeout") == 0) {
+        /* Validate numeric value */
+        if (value[0] == '\0') {
+            return KIA_ERROR_CONFIG;
+        }
+        int timeout = atoi(value);
+        if (timeout < MIN_SESSION_STOP_TIMEOUT || timeout > MAX_SESSION_STOP_TIMEOUT) {
+            return KIA_ERROR_CONFIG;
+        }
+        config->session_stop_timeout = timeout;
     }
     /* Unknown keys are silently ignored */
     
@@ -236,6 +269,18 @@ int config_validate(kia_config_t *config) {
         return KIA_ERROR_CONFIG;
     }
     
+    /* Validate auth_timeout is in range [1, 300] */
+    if (config->auth_timeout < MIN_AUTH_TIMEOUT ||
+        config->auth_timeout > MAX_AUTH_TIMEOUT) {
+        return KIA_ERROR_CONFIG;
+    }
+    
+    /* Validate session_stop_timeout is in range [1, 60] */
+    if (config->session_stop_timeout < MIN_SESSION_STOP_TIMEOUT ||
+        config->session_stop_timeout > MAX_SESSION_STOP_TIMEOUT) {
+        return KIA_ERROR_CONFIG;
+    }
+    
     return KIA_SUCCESS;
 }
 
@@ -1,14 +1,29 @@
+#define _GNU_SOURCE
 #include "controller.h"
 #include "config.h"
 #include "logger.h"
 #include "auth.h"
 #include "session.h"
+#include "session_watch.h"
+#include "session_user.h"
+#include "session_supervisor.h"
+#include "session_backoff.h"
+#include "session_group.h"
 #include "tui.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <pwd.h>
 #include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/wait.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 /**
  * Secure memory clearing function
@@ -32,7 +47,9 @@ static int handle_show_login(app_context_t *ctx);
 static int handle_get_credentials(app_context_t *ctx);
 static int handle_select_session(app_context_t *ctx);
 static int handle_authenticate(app_context_t *ctx);
+static int handle_authenticating(app_context_t *ctx);
 static int handle_start_session(app_context_t *ctx);
+static int handle_session_running(app_context_t *ctx);
 
 /* Helper function to get hostname */
 static void get_hostname(char *hostname, size_t len) {
@@ -81,7 +98,7 @@ static bool user_exists(const char *username) {
 /* Helper function to find default session index */
 static int find_default_session(const session_list_t *sessions, const char *default_name) {
     /* Validate input */
-    if (sessions == NULL || sessions->sessions == NULL || sessions->count <= 0) {
+    if (sessions == NULL || sessions->records == NULL || sessions->count <= 0) {
         return 0;
     }
     
@@ -91,8 +108,8 @@ static int find_default_session(const session_list_t *sessions, const char *defa
     
     /* Search for matching session */
     for (int i = 0; i < sessions->count; i++) {
-        if (sessions->sessions[i].name[0] != '\0' &&
-            strcmp(sessions->sessions[i].name, default_name) == 0) {
+        const char *name = session_list_name(sessions, i);
+        if (name != NULL && name[0] != '\0' && strcmp(name, default_name) == 0) {
             return i;
         }
     }
@@ -101,6 +118,84 @@ static int find_default_session(const session_list_t *sessions, const char *defa
     return 0;  /* Return first session if default not found */
 }
 
+/* Helper function to get milliseconds elapsed since a monotonic timestamp */
+static double elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - since->tv_sec) * 1e3 +
+           (double)(now.tv_nsec - since->tv_nsec) / 1e6;
+}
+
+/* Discovery thread: watch the session directories, then scan them */
+static void *discovery_main(void *arg) {
+    app_context_t *ctx = arg;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    /* Watch first so files changed during the scan are not missed */
+    int dir_count;
+    const session_dir_t *dirs = session_default_dirs(&dir_count);
+    if (session_watch_init(&ctx->session_watch, dirs, dir_count) != KIA_SUCCESS) {
+        logger_log(LOG_WARN, "Session directories not watched, new sessions need a restart");
+    }
+    
+    ctx->discovery_result = session_discover(&ctx->sessions);
+    ctx->discovery_ms = elapsed_ms(&start);
+    logger_log(LOG_DEBUG, "Session discovery finished in %.1f ms", ctx->discovery_ms);
+    return NULL;
+}
+
+/* Helper function to start session discovery off the critical path */
+static void start_discovery(app_context_t *ctx) {
+    int err = pthread_create(&ctx->discovery_thread, NULL, discovery_main, ctx);
+    if (err != 0) {
+        logger_log(LOG_WARN, "Failed to start discovery thread: %s, discovering inline",
+                   strerror(err));
+        discovery_main(ctx);
+        return;
+    }
+    ctx->discovery_pending = true;
+}
+
+/* Helper function to wait for session discovery to finish */
+static void join_discovery(app_context_t *ctx) {
+    if (!ctx->discovery_pending) {
+        return;
+    }
+    
+    struct timespec wait_start;
+    clock_gettime(CLOCK_MONOTONIC, &wait_start);
+    pthread_join(ctx->discovery_thread, NULL);
+    ctx->discovery_pending = false;
+    
+    double waited = elapsed_ms(&wait_start);
+    logger_log(LOG_INFO, "Session discovery took %.1f ms, blocked %.1f ms on it (%.1f ms saved)",
+               ctx->discovery_ms, waited, ctx->discovery_ms - waited);
+}
+
+/* Helper function to make sure sessions are available before they are needed */
+static int require_sessions(app_context_t *ctx) {
+    join_discovery(ctx);
+    
+    if (ctx->discovery_result != KIA_SUCCESS || ctx->sessions.count == 0) {
+        logger_log(LOG_ERROR, "No sessions found");
+        tui_show_error("No sessions available. Please install a desktop environment.");
+        ctx->state = STATE_EXIT;
+        return KIA_ERROR_SESSION;
+    }
+    
+    return KIA_SUCCESS;
+}
+
+/* Watch source callback: merge the sessions of the user logging in */
+static int merge_user_sessions(session_list_t *list, void *data) {
+    app_context_t *ctx = data;
+    int dir_count;
+    const session_dir_t *dirs = session_default_dirs(&dir_count);
+    
+    return session_user_merge(&ctx->session_users, list, dirs, dir_count);
+}
+
 int controller_init(app_context_t *ctx) {
     if (!ctx) {
         return KIA_ERROR_SYSTEM;
@@ -113,13 +208,97 @@ int controller_init(app_context_t *ctx) {
     ctx->state = STATE_INIT;
     ctx->running = true;
     ctx->selected_session = -1;
+    ctx->session_watch.fd = -1;
+    ctx->session_watch.inotify_fd = -1;
+    ctx->supervisor.fd = -1;
+    session_display_init(&ctx->session_proc.display);
+    session_ready_init(&ctx->session_proc.ready);
+    session_output_init(&ctx->session_proc.output);
+    ctx->stats_path = SESSION_READY_STATS_PATH;
+    session_backoff_init(&ctx->backoff, SESSION_BACKOFF_PATH);
+    ctx->discovery_pending = false;
+    ctx->discovery_result = KIA_ERROR_SESSION;
     
     /* Initialize auth state */
     memset(&ctx->auth_state, 0, sizeof(auth_state_t));
     
+    /* Without an eventfd, user sessions are merged before the menu opens */
+    session_user_init(&ctx->session_users);
+
+    /* Without a supervisor, sessions are waited for in place */
+    session_supervisor_init(&ctx->supervisor);
+    
     return KIA_SUCCESS;
 }
 
+int controller_step(app_context_t *ctx) {
+    if (!ctx) {
+        return KIA_ERROR_SYSTEM;
+    }
+    
+    int result = KIA_SUCCESS;
+    
+    if (ctx->shutdown_requested && ctx->state != STATE_SESSION_RUNNING) {
+        logger_log(LOG_INFO, "Shutdown requested, leaving the login flow");
+        ctx->state = STATE_EXIT;
+        return KIA_SUCCESS;
+    }
+
+    switch (ctx->state) {
+        case STATE_INIT:
+            result = handle_init(ctx);
+            break;
+            
+        case STATE_LOAD_CONFIG:
+            result = handle_load_config(ctx);
+            break;
+            
+        case STATE_CHECK_AUTOLOGIN:
+            result = handle_check_autologin(ctx);
+            break;
+            
+        case STATE_SHOW_LOGIN:
+            result = handle_show_login(ctx);
+            break;
+            
+        case STATE_GET_CREDENTIALS:
+            result = handle_get_credentials(ctx);
+            break;
+            
+        case STATE_SELECT_SESSION:
+            result = handle_select_session(ctx);
+            break;
+            
+        case STATE_AUTHENTICATE:
+            result = handle_authenticate(ctx);
+            break;
+            
+        case STATE_AUTHENTICATING:
+            result = handle_authenticating(ctx);
+            break;
+            
+        case STATE_START_SESSION:
+            result = handle_start_session(ctx);
+            break;
+
+        case STATE_SESSION_RUNNING:
+            result = handle_session_running(ctx);
+            break;
+            
+        case STATE_EXIT:
+            /* Exit state - will break loop */
+            break;
+            
+        default:
+            logger_log(LOG_ERROR, "Unknown state: %d", ctx->state);
+            ctx->state = STATE_EXIT;
+            result = KIA_ERROR_SYSTEM;
+            break;
+    }
+    
+    return result;
+}
+
 int controller_run(app_context_t *ctx) {
     if (!ctx) {
         return KIA_ERROR_SYSTEM;
@@ -129,49 +308,7 @@ int controller_run(app_context_t *ctx) {
     
     /* Main event loop */
     while (ctx->running && ctx->state != STATE_EXIT) {
-        switch (ctx->state) {
-            case STATE_INIT:
-                result = handle_init(ctx);
-                break;
-                
-            case STATE_LOAD_CONFIG:
-                result = handle_load_config(ctx);
-                break;
-                
-            case STATE_CHECK_AUTOLOGIN:
-                result = handle_check_autologin(ctx);
-                break;
-                
-            case STATE_SHOW_LOGIN:
-                result = handle_show_login(ctx);
-                break;
-                
-            case STATE_GET_CREDENTIALS:
-                result = handle_get_credentials(ctx);
-                break;
-                
-            case STATE_SELECT_SESSION:
-                result = handle_select_session(ctx);
-                break;
-                
-            case STATE_AUTHENTICATE:
-                result = handle_authenticate(ctx);
-                break;
-                
-            case STATE_START_SESSION:
-                result = handle_start_session(ctx);
-                break;
-                
-            case STATE_EXIT:
-                /* Exit state - will break loop */
-                break;
-                
-            default:
-                logger_log(LOG_ERROR, "Unknown state: %d", ctx->state);
-                ctx->state = STATE_EXIT;
-                result = KIA_ERROR_SYSTEM;
-                break;
-        }
+        result = controller_step(ctx);
         
         /* If any state handler fails critically, exit */
         if (result != KIA_SUCCESS && ctx->state == STATE_EXIT) {
@@ -182,6 +319,52 @@ int controller_run(app_context_t *ctx) {
     return result;
 }
 
+/**
+ * Read the resident set size of this process
+ * @return RSS in KiB, or -1 if unavailable
+ */
+static long resident_kb(void) {
+    long pages_total, pages_resident;
+
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (!fp) {
+        return -1;
+    }
+    int fields = fscanf(fp, "%ld %ld", &pages_total, &pages_resident);
+    fclose(fp);
+    if (fields != 2) {
+        return -1;
+    }
+    return pages_resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+void controller_release_memory(app_context_t *ctx) {
+    if (!ctx) {
+        return;
+    }
+
+    long before = resident_kb();
+
+    /* Nothing of the login is needed again until the session ends */
+    secure_memzero(ctx->password, sizeof(ctx->password));
+    session_release_caches();
+    tui_release();
+
+#ifdef __GLIBC__
+    /* Hand free heap pages, including holes below the top, back to the kernel */
+    malloc_trim(0);
+#endif
+
+    logger_log(LOG_INFO, "Greeter memory released while the session runs: RSS %ld KiB -> %ld KiB",
+               before, resident_kb());
+}
+
+void controller_request_shutdown(app_context_t *ctx) {
+    if (ctx) {
+        ctx->shutdown_requested = 1;
+    }
+}
+
 void controller_cleanup(app_context_t *ctx) {
     if (!ctx) {
         return;
@@ -190,11 +373,20 @@ void controller_cleanup(app_context_t *ctx) {
     /* Securely clear sensitive data (password) */
     secure_memzero(ctx->password, sizeof(ctx->password));
     
+    /* An authentication still in PAM is left to finish on its own */
+    auth_cancel(ctx->auth_request);
+    ctx->auth_request = NULL;
+    
     /* Free configuration */
     config_free(&ctx->config);
     
-    /* Free session list */
+    /* Stop watching session directories and free session list */
+    join_discovery(ctx);
+    session_watch_close(&ctx->session_watch);
+    session_user_free(&ctx->session_users);
     session_list_free(&ctx->sessions);
+    session_supervisor_free(&ctx->supervisor);
+    session_plan_free(&ctx->kiosk_plan);
     
     /* Cleanup authentication module */
     auth_cleanup();
@@ -210,8 +402,12 @@ void controller_cleanup(app_context_t *ctx) {
 
 static int handle_init(app_context_t *ctx) {
     logger_log(LOG_INFO, "Kia display manager started (version %s)", KIA_VERSION);
+    clock_gettime(CLOCK_MONOTONIC, &ctx->started_at);
+    
+    /* Whatever a session leaves behind is re-parented here and reaped at logout */
+    session_group_subreaper();
     
-    /* Initialize authentication module */
+    /* Initialize authentication module; its PAM helper spawner is forked before any thread */
     int result = auth_init();
     if (result != KIA_SUCCESS) {
         logger_log(LOG_ERROR, "Failed to initialize authentication module");
@@ -219,6 +415,9 @@ static int handle_init(app_context_t *ctx) {
         return result;
     }
     
+    /* Sessions are only needed at selection time, scan them in the background */
+    start_discovery(ctx);
+    
     /* Initialize TUI */
     result = tui_init();
     if (result != KIA_SUCCESS) {
@@ -244,27 +443,77 @@ static int handle_load_config(app_context_t *ctx) {
     result = config_validate(&ctx->config);
     if (result != KIA_SUCCESS) {
         logger_log(LOG_WARN, "Configuration validation failed, using defaults");
+        config_set_defaults(&ctx->config);
     }
     
-    /* Discover available sessions */
-    result = session_discover(&ctx->sessions);
-    if (result != KIA_SUCCESS || ctx->sessions.count == 0) {
-        logger_log(LOG_ERROR, "No sessions found");
-        tui_show_error("No sessions available. Please install a desktop environment.");
-        ctx->state = STATE_EXIT;
-        return KIA_ERROR_SESSION;
-    }
+    /* Failures of sessions started before a restart still count */
+    session_backoff_load(&ctx->backoff, session_backoff_now());
     
-    logger_log(LOG_INFO, "Discovered %d session(s)", ctx->sessions.count);
+    logger_log(LOG_INFO, "Ready for login %.1f ms after start", elapsed_ms(&ctx->started_at));
     
     /* Transition to autologin check */
     ctx->state = STATE_CHECK_AUTOLOGIN;
     return KIA_SUCCESS;
 }
 
+/**
+ * Hold autologin back while sessions keep failing
+ * Waits out the backoff delay of the recent failures with the shutdown
+ * signals unblocked, so a shutdown request cuts it short
+ * @return true if autologin may go ahead
+ */
+static bool wait_autologin_backoff(app_context_t *ctx) {
+    double now = session_backoff_now();
+    
+    if (session_backoff_exhausted(&ctx->backoff, now)) {
+        logger_log(LOG_ERROR, "Session failed %d times within %d s, not logging in automatically",
+                   SESSION_BACKOFF_MAX_FAILURES, SESSION_BACKOFF_WINDOW_S);
+        tui_show_error("The session keeps failing. Autologin disabled, please log in.");
+        return false;
+    }
+    
+    double remaining = session_backoff_remaining(&ctx->backoff, now);
+    if (remaining <= 0) {
+        return true;
+    }
+    
+    char message[128];
+    logger_log(LOG_WARN, "Session failed %d time(s) recently, delaying autologin by %.1f s",
+               ctx->backoff.count, remaining);
+    snprintf(message, sizeof(message), "Session failed. Retrying in %.0f seconds...", remaining);
+    tui_show_message(message);
+    
+    sigset_t shutdown_signals, orig_mask;
+    sigemptyset(&shutdown_signals);
+    sigaddset(&shutdown_signals, SIGTERM);
+    sigaddset(&shutdown_signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &shutdown_signals, &orig_mask);
+    if (!ctx->shutdown_requested) {
+        struct timespec timeout = {
+            .tv_sec = (time_t)remaining,
+            .tv_nsec = (long)((remaining - (double)(time_t)remaining) * 1e9)
+        };
+        ppoll(NULL, 0, &timeout, &orig_mask);
+    }
+    pthread_sigmask(SIG_SETMASK, &orig_mask, NULL);
+    
+    return !ctx->shutdown_requested;
+}
+
 static int handle_check_autologin(app_context_t *ctx) {
     /* Check if autologin is enabled */
     if (ctx->config.autologin_enabled && ctx->config.autologin_user[0] != '\0') {
+        /* A session that keeps failing is not restarted unattended at full speed */
+        if (!wait_autologin_backoff(ctx)) {
+            ctx->state = STATE_SHOW_LOGIN;
+            return KIA_SUCCESS;
+        }
+        
+        /* Autologin starts a session right away, so it needs the list now */
+        if (require_sessions(ctx) != KIA_SUCCESS) {
+            return KIA_ERROR_SESSION;
+        }
+        
         /* Validate username length */
         size_t username_len = strlen(ctx->config.autologin_user);
         if (username_len == 0 || username_len >= sizeof(ctx->username)) {
@@ -298,7 +547,15 @@ static int handle_check_autologin(app_context_t *ctx) {
         }
         
         logger_log(LOG_INFO, "Autologin enabled for user '%s' with session '%s'", 
-                   ctx->username, ctx->sessions.sessions[ctx->selected_session].name);
+                   ctx->username, session_list_name(&ctx->sessions, ctx->selected_session));
+        memset(&ctx->latency, 0, sizeof(ctx->latency));
+        clock_gettime(CLOCK_MONOTONIC, &ctx->latency.submitted);
+        
+        /* A kiosk session is started again in place of the login screen */
+        ctx->kiosk = ctx->config.kiosk_mode;
+        if (ctx->kiosk) {
+            logger_log(LOG_INFO, "Kiosk mode: the session is restarted whenever it exits");
+        }
         
         /* Skip to session start */
         ctx->state = STATE_START_SESSION;
@@ -317,6 +574,12 @@ static int handle_show_login(app_context_t *ctx) {
     /* Draw the login screen */
     tui_draw_login_screen(hostname, KIA_VERSION);
     
+    if (ctx->returning) {
+        logger_log(LOG_INFO, "Back at login %.1f ms after the session ended",
+                   elapsed_ms(&ctx->session_ended_at));
+        ctx->returning = false;
+    }
+    
     /* Transition to get credentials */
     ctx->state = STATE_GET_CREDENTIALS;
     return KIA_SUCCESS;
@@ -326,6 +589,8 @@ static int handle_get_credentials(app_context_t *ctx) {
     /* Get credentials from user */
     int result = tui_get_credentials(ctx->username, sizeof(ctx->username),
                                      ctx->password, sizeof(ctx->password));
+    memset(&ctx->latency, 0, sizeof(ctx->latency));
+    clock_gettime(CLOCK_MONOTONIC, &ctx->latency.submitted);
     
     if (result != KIA_SUCCESS) {
         logger_log(LOG_ERROR, "Failed to get credentials from TUI: %d", result);
@@ -361,17 +626,43 @@ static int handle_get_credentials(app_context_t *ctx) {
         return KIA_SUCCESS;
     }
     
+    /* Look for the user's own sessions while the system ones are shown */
+    session_user_start(&ctx->session_users, ctx->username);
+    
     /* Transition to session selection */
     ctx->state = STATE_SELECT_SESSION;
     return KIA_SUCCESS;
 }
 
 static int handle_select_session(app_context_t *ctx) {
+    /* Join the discovery thread started at init */
+    if (require_sessions(ctx) != KIA_SUCCESS) {
+        return KIA_ERROR_SESSION;
+    }
+    
+    /* Merge the user's sessions into the open menu once they are found,
+     * or right away if the menu cannot be updated while it is open */
+    int dir_count;
+    const session_dir_t *dirs = session_default_dirs(&dir_count);
+    session_user_drop_stale(&ctx->session_users, &ctx->sessions, dirs, dir_count);
+    int user_fd = session_user_fd(&ctx->session_users);
+    bool user_live = user_fd >= 0 &&
+                     session_watch_add_source(&ctx->session_watch, user_fd,
+                                              merge_user_sessions, ctx) == KIA_SUCCESS;
+    if (!user_live) {
+        merge_user_sessions(&ctx->sessions, ctx);
+    }
+    
     /* Find default session index */
     int default_idx = find_default_session(&ctx->sessions, ctx->config.default_session);
     
     /* Let user select session */
-    ctx->selected_session = tui_select_session(&ctx->sessions, default_idx);
+    ctx->selected_session = tui_select_session(&ctx->sessions, &ctx->session_watch, default_idx);
+    
+    /* A scan still running when the user chose is kept for the next login */
+    if (user_live) {
+        session_watch_remove_source(&ctx->session_watch, user_fd);
+    }
     
     if (ctx->selected_session < 0 || ctx->selected_session >= ctx->sessions.count) {
         logger_log(LOG_ERROR, "Invalid session selection: %d", ctx->selected_session);
@@ -381,33 +672,18 @@ static int handle_select_session(app_context_t *ctx) {
     }
     
     logger_log(LOG_INFO, "User '%s' selected session: %s", 
-               ctx->username, ctx->sessions.sessions[ctx->selected_session].name);
+               ctx->username, session_list_name(&ctx->sessions, ctx->selected_session));
     
     /* Transition to authentication */
     ctx->state = STATE_AUTHENTICATE;
     return KIA_SUCCESS;
 }
 
-static int handle_authenticate(app_context_t *ctx) {
-    /* Check if user is locked out */
-    if (auth_is_locked_out(&ctx->auth_state)) {
-        logger_log(LOG_WARN, "User '%s' is locked out", ctx->username);
-        tui_show_error("Too many failed attempts. Please wait before trying again.");
-        
-        /* Securely clear password */
-        secure_memzero(ctx->password, sizeof(ctx->password));
-        
-        ctx->state = STATE_SHOW_LOGIN;
-        return KIA_SUCCESS;
-    }
-    
-    /* Attempt authentication */
-    int result = auth_authenticate(ctx->username, ctx->password, 
-                                   &ctx->config, &ctx->auth_state);
-    
-    /* Securely clear password from memory immediately after authentication */
-    secure_memzero(ctx->password, sizeof(ctx->password));
-    
+/**
+ * Act on the result of an authentication: start the session, or count the
+ * failure and return to the login screen
+ */
+static int finish_authentication(app_context_t *ctx, int result) {
     if (result == KIA_SUCCESS) {
         /* Authentication successful */
         logger_log(LOG_INFO, "User '%s' authenticated successfully", ctx->username);
@@ -433,37 +709,528 @@ static int handle_authenticate(app_context_t *ctx) {
     return KIA_SUCCESS;
 }
 
-static int handle_start_session(app_context_t *ctx) {
-    /* Validate session selection */
-    if (ctx->selected_session < 0 || ctx->selected_session >= ctx->sessions.count) {
-        logger_log(LOG_ERROR, "Invalid session index: %d", ctx->selected_session);
-        tui_show_error("Invalid session. Please try again.");
+static int handle_authenticate(app_context_t *ctx) {
+    /* Check if user is locked out */
+    if (auth_is_locked_out(&ctx->auth_state)) {
+        logger_log(LOG_WARN, "User '%s' is locked out", ctx->username);
+        tui_show_error("Too many failed attempts. Please wait before trying again.");
+        
+        /* Securely clear password */
+        secure_memzero(ctx->password, sizeof(ctx->password));
+        
         ctx->state = STATE_SHOW_LOGIN;
+        return KIA_SUCCESS;
+    }
+    
+    /* PAM runs on a worker so the screen stays responsive; the result comes back as an event */
+    clock_gettime(CLOCK_MONOTONIC, &ctx->latency.auth_start);
+    ctx->auth_request = auth_start(ctx->username, ctx->password, &ctx->config, &ctx->auth_state);
+    if (!ctx->auth_request) {
+        logger_log(LOG_WARN, "Authenticating without a worker thread");
+        int result = auth_authenticate(ctx->username, ctx->password,
+                                       &ctx->config, &ctx->auth_state);
+        clock_gettime(CLOCK_MONOTONIC, &ctx->latency.auth_done);
+        secure_memzero(ctx->password, sizeof(ctx->password));
+        return finish_authentication(ctx, result);
+    }
+    
+    /* Securely clear password from memory; the worker has its own copy */
+    secure_memzero(ctx->password, sizeof(ctx->password));
+    ctx->auth_frame = 0;
+    ctx->state = STATE_AUTHENTICATING;
+    return KIA_SUCCESS;
+}
+
+/**
+ * Time authentication may take before it is given up
+ */
+static int auth_timeout_ms(const app_context_t *ctx) {
+    if (ctx->config.auth_timeout > 0) {
+        return ctx->config.auth_timeout * 1000;
+    }
+    return CONTROLLER_AUTH_TIMEOUT_MS;
+}
+
+/**
+ * Give up on the running authentication and go back to the login screen
+ */
+static void abandon_authentication(app_context_t *ctx) {
+    auth_cancel(ctx->auth_request);
+    ctx->auth_request = NULL;
+    ctx->state = STATE_SHOW_LOGIN;
+}
+
+static int handle_authenticating(app_context_t *ctx) {
+    double remaining_ms = auth_timeout_ms(ctx) - elapsed_ms(&ctx->latency.auth_start);
+    if (remaining_ms <= 0) {
+        logger_log(LOG_ERROR, "Authentication of user '%s' did not finish within %d ms, giving up",
+                   ctx->username, auth_timeout_ms(ctx));
+        abandon_authentication(ctx);
+        tui_show_error("Authentication timed out. Please try again.");
+        return KIA_SUCCESS;
+    }
+    
+    int tick_ms = remaining_ms < CONTROLLER_AUTH_TICK_MS ? (int)remaining_ms + 1
+                                                         : CONTROLLER_AUTH_TICK_MS;
+    tui_wait_t event = tui_wait_progress("Authenticating", ctx->auth_frame++,
+                                         auth_request_fd(ctx->auth_request), tick_ms);
+    switch (event) {
+        case TUI_WAIT_READY: {
+            int result = auth_finish(ctx->auth_request, &ctx->auth_state);
+            ctx->auth_request = NULL;
+            clock_gettime(CLOCK_MONOTONIC, &ctx->latency.auth_done);
+            return finish_authentication(ctx, result);
+        }
+            
+        case TUI_WAIT_CANCEL:
+            logger_log(LOG_INFO, "Authentication of user '%s' cancelled after %.1f ms",
+                       ctx->username, elapsed_ms(&ctx->latency.auth_start));
+            abandon_authentication(ctx);
+            return KIA_SUCCESS;
+            
+        case TUI_WAIT_TICK:
+            return KIA_SUCCESS;
+            
+        default:
+            logger_log(LOG_ERROR, "Failed to wait for authentication: %s", strerror(errno));
+            abandon_authentication(ctx);
+            return KIA_ERROR_AUTH;
+    }
+}
+
+/**
+ * Time session processes get between SIGTERM and SIGKILL
+ */
+static int stop_timeout_ms(const app_context_t *ctx) {
+    if (ctx->config.session_stop_timeout > 0) {
+        return ctx->config.session_stop_timeout * 1000;
+    }
+    return CONTROLLER_SESSION_STOP_TIMEOUT_MS;
+}
+
+/**
+ * Name of the session being started or running
+ */
+static const char *current_session_name(const app_context_t *ctx) {
+    if (ctx->kiosk_plan.strings) {
+        return ctx->kiosk_plan.session.name;
+    }
+    const char *name = session_list_name(&ctx->sessions, ctx->selected_session);
+    return name ? name : "";
+}
+
+/* Helper function to get milliseconds between two monotonic timestamps */
+static double interval_ms(const struct timespec *from, const struct timespec *to) {
+    return (double)(to->tv_sec - from->tv_sec) * 1e3 +
+           (double)(to->tv_nsec - from->tv_nsec) / 1e6;
+}
+
+/**
+ * Log how long the screen was without a kiosk session: from the exit of
+ * the previous instance until the new one was running and, if it signals
+ * readiness, usable
+ */
+static void report_kiosk_restart(const app_context_t *ctx) {
+    const session_latency_t *l = &ctx->latency;
+    double running_ms = interval_ms(&l->submitted, &l->exec_done);
+
+    if (l->ready.tv_sec != 0 || l->ready.tv_nsec != 0) {
+        logger_log(LOG_INFO, "Kiosk restart %d: running after %.1f ms, ready after %.1f ms",
+                   ctx->kiosk_restarts, running_ms, interval_ms(&l->submitted, &l->ready));
+    } else {
+        logger_log(LOG_INFO, "Kiosk restart %d: running after %.1f ms, no readiness signal",
+                   ctx->kiosk_restarts, running_ms);
+    }
+}
+
+/**
+ * Report the phases of the current login once, when the session signalled
+ * readiness or will not anymore
+ */
+static void report_latency(app_context_t *ctx) {
+    if (!ctx->latency_pending) {
+        return;
+    }
+    ctx->latency_pending = false;
+    if (ctx->kiosk && ctx->kiosk_restarts > 0) {
+        report_kiosk_restart(ctx);
+    }
+    session_latency_report(&ctx->latency, ctx->username, current_session_name(ctx),
+                           ctx->stats_path);
+}
+
+/**
+ * Count a session that ended right after launch as failed, and forget
+ * earlier failures once one ran properly
+ */
+static void track_session_exit(app_context_t *ctx) {
+    const struct timespec *launch = &ctx->latency.launch_start;
+    if (launch->tv_sec == 0 && launch->tv_nsec == 0) {
+        return;
+    }
+
+    double runtime_ms = elapsed_ms(launch);
+    if (runtime_ms < SESSION_BACKOFF_MIN_RUNTIME_S * 1000.0) {
+        logger_log(LOG_WARN, "Session ended %.1f ms after launch", runtime_ms);
+        session_backoff_record(&ctx->backoff, session_backoff_now());
+    } else {
+        session_backoff_reset(&ctx->backoff);
+    }
+}
+
+/**
+ * Forget the login that just ended and go back to the login screen
+ * Configuration, the session list, the watcher and per-user scans are kept,
+ * so the next login starts without reloading anything
+ */
+static void return_to_login(app_context_t *ctx) {
+    secure_memzero(ctx->password, sizeof(ctx->password));
+    memset(ctx->username, 0, sizeof(ctx->username));
+    memset(&ctx->auth_state, 0, sizeof(ctx->auth_state));
+    ctx->selected_session = -1;
+
+    clock_gettime(CLOCK_MONOTONIC, &ctx->session_ended_at);
+    ctx->returning = true;
+    tui_resume();
+    ctx->state = STATE_SHOW_LOGIN;
+}
+
+/**
+ * Leave kiosk mode, dropping the launch plan
+ */
+static void stop_kiosk(app_context_t *ctx) {
+    if (ctx->kiosk) {
+        logger_log(LOG_INFO, "Kiosk mode stopped after %d restart(s)", ctx->kiosk_restarts);
+    }
+    session_plan_free(&ctx->kiosk_plan);
+    ctx->kiosk = false;
+    ctx->kiosk_restarts = 0;
+}
+
+/**
+ * Start the next instance of a kiosk session that ended
+ * The launch plan of the first instance is reused, so the restart goes
+ * straight to spawning. A session that keeps failing is held back like
+ * autologin at startup, and once the backoff is exhausted the login
+ * screen takes over
+ * @return true if the next instance is about to start
+ */
+static bool restart_kiosk(app_context_t *ctx) {
+    if (!ctx->kiosk || ctx->shutdown_requested) {
+        stop_kiosk(ctx);
+        return false;
+    }
+    if (ctx->kiosk_exited_at.tv_sec == 0 && ctx->kiosk_exited_at.tv_nsec == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &ctx->kiosk_exited_at);
+    }
+
+    /* The terminal comes back for the restart message, or the backoff countdown */
+    tui_resume();
+    if (!wait_autologin_backoff(ctx)) {
+        stop_kiosk(ctx);
+        return false;
+    }
+
+    ctx->kiosk_restarts++;
+    logger_log(LOG_INFO, "Restarting kiosk session '%s' (restart %d)",
+               current_session_name(ctx), ctx->kiosk_restarts);
+    memset(&ctx->latency, 0, sizeof(ctx->latency));
+    ctx->latency.submitted = ctx->kiosk_exited_at;
+    ctx->state = STATE_START_SESSION;
+    return true;
+}
+
+/**
+ * Move on from a session that ended: a kiosk session starts again, any
+ * other returns to the login screen
+ */
+static void finish_session(app_context_t *ctx) {
+    if (restart_kiosk(ctx)) {
+        return;
+    }
+    logger_log(LOG_INFO, "Session ended, returning to login");
+    return_to_login(ctx);
+}
+
+/**
+ * Launch the kiosk session from its plan, preparing the plan on first use
+ */
+static int launch_kiosk(app_context_t *ctx, const session_info_t *session, session_proc_t *proc) {
+    if (!ctx->kiosk_plan.strings &&
+        session_plan_prepare(&ctx->kiosk_plan, session, ctx->username,
+                             auth_get_env()) != KIA_SUCCESS) {
         return KIA_ERROR_SESSION;
     }
+    return session_launch_plan(&ctx->kiosk_plan, proc);
+}
+
+static int handle_start_session(app_context_t *ctx) {
+    session_info_t session;
     
-    session_info_t *session = &ctx->sessions.sessions[ctx->selected_session];
+    /* A kiosk restart runs what was planned, whatever became of the session list */
+    if (ctx->kiosk_plan.strings) {
+        session = ctx->kiosk_plan.session;
+    } else {
+        /* Validate session selection */
+        if (ctx->selected_session < 0 || ctx->selected_session >= ctx->sessions.count) {
+            logger_log(LOG_ERROR, "Invalid session index: %d", ctx->selected_session);
+            tui_show_error("Invalid session. Please try again.");
+            ctx->state = STATE_SHOW_LOGIN;
+            return KIA_ERROR_SESSION;
+        }
+        session_list_get(&ctx->sessions, ctx->selected_session, &session);
+    }
     
     logger_log(LOG_INFO, "Starting %s session '%s' for user '%s'",
-               session->type == SESSION_X11 ? "X11" : "Wayland",
-               session->name, ctx->username);
+               session.type == SESSION_X11 ? "X11" : "Wayland",
+               session.name, ctx->username);
     
     /* Show message to user */
     tui_show_message("Starting session...");
     
-    /* Start the session */
-    int result = session_start(session, ctx->username);
+    /* Hand the terminal to the session; the loop supervises it from here on */
+    tui_suspend();
+    session_proc_t *proc = &ctx->session_proc;
+    clock_gettime(CLOCK_MONOTONIC, &ctx->latency.launch_start);
+    memset(&ctx->kiosk_exited_at, 0, sizeof(ctx->kiosk_exited_at));
+    int result = ctx->kiosk ? launch_kiosk(ctx, &session, proc)
+                            : session_launch(&session, ctx->username, auth_get_env(), proc);
     
     if (result != KIA_SUCCESS) {
+        tui_resume();
         logger_log(LOG_ERROR, "Failed to start session for user '%s'", ctx->username);
+        session_backoff_record(&ctx->backoff, session_backoff_now());
         tui_show_error("Failed to start session. Please try again.");
-        ctx->state = STATE_SHOW_LOGIN;
+        if (!restart_kiosk(ctx)) {
+            ctx->state = STATE_SHOW_LOGIN;
+        }
         return result;
     }
+    ctx->latency.spawn_start = proc->spawn_start;
+    ctx->latency.exec_done = proc->exec_done;
+    ctx->latency_pending = true;
+
+    /* The X server is supervised alongside its client; either exiting ends the session */
+    if (session_supervisor_add(&ctx->supervisor, proc->pid, session.name) != KIA_SUCCESS ||
+        (proc->xorg.pid > 0 &&
+         session_supervisor_add(&ctx->supervisor, proc->xorg.pid,
+                                SESSION_XORG_SERVER) != KIA_SUCCESS)) {
+        /* No pidfd support: wait for the session in place as before */
+        logger_log(LOG_WARN, "Cannot supervise session, waiting for it to exit");
+        int status;
+        struct rusage ru;
+        pid_t waited = session_wait(proc, &status, &ru);
+        clock_gettime(CLOCK_MONOTONIC, &ctx->kiosk_exited_at);
+        if (waited > 0) {
+            session_usage_t usage;
+            session_usage_from_rusage(&usage, &ru);
+            session_usage_log(&usage, session.name, proc->pid);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                session_output_drain(&proc->output);
+                session_output_log_tail(&proc->output, SESSION_OUTPUT_LOG_TAIL);
+            }
+        }
+        session_group_stop(proc->pid, stop_timeout_ms(ctx));
+        session_xorg_stop(&proc->xorg);
+        session_group_reap(proc->pid);
+        report_latency(ctx);
+        session_end(proc);
+        track_session_exit(ctx);
+        finish_session(ctx);
+        return KIA_SUCCESS;
+    }
     
-    /* Session started successfully - exit the display manager */
-    logger_log(LOG_INFO, "Session started successfully, exiting display manager");
-    ctx->state = STATE_EXIT;
+    logger_log(LOG_INFO, "Session started successfully, supervising PID %d", proc->pid);
+    controller_release_memory(ctx);
+    ctx->state = STATE_SESSION_RUNNING;
     
     return KIA_SUCCESS;
 }
+
+/**
+ * Drop the processes of a session the supervisor has reaped, releasing
+ * their display and X authority files
+ * Processes the session left in its process group are stopped first, so
+ * the display is only handed out again once nothing uses it
+ * @param timeout_ms Time they get after SIGTERM before they are killed
+ */
+static void forget_session_proc(app_context_t *ctx, int timeout_ms) {
+    session_proc_t *proc = &ctx->session_proc;
+    if (proc->pid > 0) {
+        session_group_stop(proc->pid, timeout_ms);
+    }
+
+    report_latency(ctx);
+    session_end(&ctx->session_proc);
+    memset(&ctx->session_proc, 0, sizeof(ctx->session_proc));
+    session_display_init(&ctx->session_proc.display);
+    session_ready_init(&ctx->session_proc.ready);
+    session_output_init(&ctx->session_proc.output);
+}
+
+/**
+ * Take in the session's readiness signal, reporting the login once the
+ * outcome is known
+ */
+static void check_session_ready(app_context_t *ctx) {
+    int result = session_ready_check(&ctx->session_proc.ready);
+    if (result > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &ctx->latency.ready);
+        report_latency(ctx);
+    } else if (result < 0) {
+        logger_log(LOG_INFO, "Session closed its readiness pipe without signalling");
+        report_latency(ctx);
+    }
+}
+
+/**
+ * Wait for a session process to exit, the session to signal readiness or
+ * write output; buffered output is flushed when it is due
+ * @return 1 if a process exited, 0 on readiness, output, a signal or timeout,
+ *         KIA_ERROR_SESSION on error
+ */
+static int wait_session(app_context_t *ctx, const sigset_t *sigmask) {
+    session_output_t *output = &ctx->session_proc.output;
+    int ready_fd = ctx->session_proc.ready.fd;
+    int flush_ms = session_output_flush_timeout(output);
+    if (ready_fd < 0 && output->fd < 0 && flush_ms < 0) {
+        return session_supervisor_wait(&ctx->supervisor, -1, sigmask);
+    }
+
+    /* Closed descriptors are negative and ignored by ppoll() */
+    struct pollfd fds[3] = {
+        { .fd = session_supervisor_fd(&ctx->supervisor), .events = POLLIN },
+        { .fd = ready_fd, .events = POLLIN },
+        { .fd = output->fd, .events = POLLIN },
+    };
+    struct timespec timeout = { flush_ms / 1000, (long)(flush_ms % 1000) * 1000000 };
+    int result = ppoll(fds, 3, flush_ms >= 0 ? &timeout : NULL, sigmask);
+    if (result < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        logger_log(LOG_ERROR, "Failed to wait for session: %s", strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+    if (fds[1].revents) {
+        check_session_ready(ctx);
+    }
+    if (fds[2].revents) {
+        session_output_drain(output);
+    } else if (result == 0) {
+        session_output_flush(output, false);
+    }
+    return fds[0].revents ? 1 : 0;
+}
+
+/**
+ * Stop every supervised session: SIGTERM to its processes and whatever
+ * they started, then SIGKILL once the grace period has passed
+ */
+static void stop_sessions(app_context_t *ctx) {
+    session_child_t exited[SESSION_SUPERVISOR_MAX_CHILDREN];
+    session_proc_t *proc = &ctx->session_proc;
+    struct timespec start, now;
+    int timeout_ms = stop_timeout_ms(ctx);
+    long waited_ms = 0;
+
+    if (session_supervisor_signal(&ctx->supervisor, SIGTERM) > 0) {
+        logger_log(LOG_INFO, "Sent SIGTERM to %d session process(es)",
+                   session_supervisor_count(&ctx->supervisor));
+    }
+    if (proc->pid > 0) {
+        session_group_signal(proc->pid, SIGTERM);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (session_supervisor_count(&ctx->supervisor) > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        waited_ms = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+        if (waited_ms >= timeout_ms) {
+            logger_log(LOG_WARN, "Sessions did not exit within %d ms, killing them", timeout_ms);
+            session_supervisor_signal(&ctx->supervisor, SIGKILL);
+            if (proc->pid > 0) {
+                session_group_signal(proc->pid, SIGKILL);
+            }
+            break;
+        }
+        if (session_supervisor_wait(&ctx->supervisor, timeout_ms - (int)waited_ms, NULL) < 0 ||
+            session_supervisor_process(&ctx->supervisor, exited,
+                                       SESSION_SUPERVISOR_MAX_CHILDREN) < 0) {
+            break;
+        }
+    }
+
+    /* Killed processes exit promptly; reap them so none is left behind */
+    while (session_supervisor_count(&ctx->supervisor) > 0) {
+        if (session_supervisor_wait(&ctx->supervisor, -1, NULL) < 0 ||
+            session_supervisor_process(&ctx->supervisor, exited,
+                                       SESSION_SUPERVISOR_MAX_CHILDREN) < 0) {
+            break;
+        }
+    }
+
+    /* The rest of the session shares the deadline */
+    forget_session_proc(ctx, waited_ms < timeout_ms ? timeout_ms - (int)waited_ms : 0);
+}
+
+static int handle_session_running(app_context_t *ctx) {
+    session_child_t exited[SESSION_SUPERVISOR_MAX_CHILDREN];
+    sigset_t shutdown_signals, orig_mask;
+
+    /* Block the shutdown signals while checking the flag; the wait unblocks them */
+    sigemptyset(&shutdown_signals);
+    sigaddset(&shutdown_signals, SIGTERM);
+    sigaddset(&shutdown_signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &shutdown_signals, &orig_mask);
+
+    int ready = 0;
+    if (!ctx->shutdown_requested) {
+        ready = wait_session(ctx, &orig_mask);
+    }
+    pthread_sigmask(SIG_SETMASK, &orig_mask, NULL);
+
+    if (ctx->shutdown_requested) {
+        logger_log(LOG_INFO, "Shutdown requested while a session is running");
+        stop_sessions(ctx);
+        ctx->state = STATE_EXIT;
+        return KIA_SUCCESS;
+    }
+
+    int exited_count = 0;
+    if (ready < 0 ||
+        (exited_count = session_supervisor_process(&ctx->supervisor, exited,
+                                                   SESSION_SUPERVISOR_MAX_CHILDREN)) < 0) {
+        stop_sessions(ctx);
+        ctx->state = STATE_EXIT;
+        return KIA_ERROR_SESSION;
+    }
+
+    /* The kiosk restart is timed from the first process of the session to exit */
+    if (exited_count > 0 && ctx->kiosk_exited_at.tv_sec == 0 && ctx->kiosk_exited_at.tv_nsec == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &ctx->kiosk_exited_at);
+    }
+
+    /* What a failed session printed last usually tells why */
+    for (int i = 0; i < exited_count; i++) {
+        if (exited[i].pid == ctx->session_proc.pid &&
+            (exited[i].term_signal != 0 || exited[i].exit_status != 0)) {
+            session_output_drain(&ctx->session_proc.output);
+            session_output_log_tail(&ctx->session_proc.output, SESSION_OUTPUT_LOG_TAIL);
+        }
+    }
+
+    if (session_supervisor_count(&ctx->supervisor) == 0) {
+        forget_session_proc(ctx, stop_timeout_ms(ctx));
+    } else if (ctx->session_proc.xorg.pid > 0) {
+        /* A client without its server, or a server without its client, is of no use */
+        logger_log(LOG_INFO, "Session process exited, stopping the rest of the session");
+        stop_sessions(ctx);
+    }
+    if (session_supervisor_count(&ctx->supervisor) == 0) {
+        track_session_exit(ctx);
+        finish_session(ctx);
+    }
+
+    return KIA_SUCCESS;
+}
@@ -0,0 +1,352 @@
+#include "desktop.h"
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#define DESKTOP_MIN_BUF_SIZE 4096
+
+#define DESKTOP_ENTRY_GROUP "Desktop Entry"
+
+/* Exec characters that only have a meaning to a shell unless quoted */
+#define DESKTOP_EXEC_RESERVED "'\\><~|&;$*?#()`\n\r"
+#define DESKTOP_EXEC_QUOTED_ESCAPES "\"`$\\"
+/* Field codes of the desktop entry spec, including deprecated ones */
+#define DESKTOP_EXEC_FIELD_CODES "fFuUdDnNickvm"
+
+/**
+ * Compare a span against a NUL-terminated literal
+ */
+static bool span_equals(const char *ptr, size_t len, const char *literal) {
+    size_t literal_len = strlen(literal);
+    return len == literal_len && memcmp(ptr, literal, len) == 0;
+}
+
+/**
+ * Parse a desktop file boolean value
+ */
+static bool span_is_true(const desktop_span_t *value) {
+    return span_equals(value->ptr, value->len, "true") ||
+           span_equals(value->ptr, value->len, "1");
+}
+
+/**
+ * Grow a buffer so that it can hold at least size bytes
+ */
+static int buf_reserve(desktop_buf_t *buf, size_t size) {
+    if (size <= buf->cap) {
+        return KIA_SUCCESS;
+    }
+
+    size_t new_cap = buf->cap ? buf->cap : DESKTOP_MIN_BUF_SIZE;
+    while (new_cap < size) {
+        new_cap *= 2;
+    }
+
+    char *data = realloc(buf->data, new_cap);
+    if (data == NULL) {
+        return KIA_ERROR_SESSION;
+    }
+    buf->data = data;
+    buf->cap = new_cap;
+    return KIA_SUCCESS;
+}
+
+int desktop_buf_read(desktop_buf_t *buf, const char *path) {
+    struct stat st;
+
+    /* Validate input parameters */
+    if (buf == NULL || path == NULL || path[0] == '\0') {
+        errno = EINVAL;
+        return KIA_ERROR_SESSION;
+    }
+
+    buf->len = 0;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return KIA_ERROR_SESSION;
+    }
+
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return KIA_ERROR_SESSION;
+    }
+
+    if (!S_ISREG(st.st_mode) || st.st_size > DESKTOP_MAX_FILE_SIZE) {
+        close(fd);
+        errno = EFBIG;
+        return KIA_ERROR_SESSION;
+    }
+
+    /* One spare byte detects growth after fstat and holds the terminator */
+    if (buf_reserve(buf, (size_t)st.st_size + 2) != KIA_SUCCESS) {
+        close(fd);
+        errno = ENOMEM;
+        return KIA_ERROR_SESSION;
+    }
+
+    while (1) {
+        ssize_t n = read(fd, buf->data + buf->len, buf->cap - buf->len - 1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int saved_errno = errno;
+            close(fd);
+            errno = saved_errno;
+            return KIA_ERROR_SESSION;
+        }
+        if (n == 0) {
+            break;
+        }
+        buf->len += (size_t)n;
+
+        /* File grew since fstat: keep reading within the size limit */
+        if (buf->len == buf->cap - 1) {
+            if (buf->len >= DESKTOP_MAX_FILE_SIZE ||
+                buf_reserve(buf, buf->cap * 2) != KIA_SUCCESS) {
+                close(fd);
+                errno = EFBIG;
+                return KIA_ERROR_SESSION;
+            }
+        }
+    }
+
+    close(fd);
+    buf->data[buf->len] = '\0';
+    return KIA_SUCCESS;
+}
+
+bool desktop_is_file_id(const char *name) {
+    if (name == NULL) {
+        return false;
+    }
+    size_t len = strlen(name);
+    return len > DESKTOP_SUFFIX_LEN &&
+           memcmp(name + len - DESKTOP_SUFFIX_LEN, DESKTOP_SUFFIX, DESKTOP_SUFFIX_LEN) == 0;
+}
+
+void desktop_buf_free(desktop_buf_t *buf) {
+    if (buf) {
+        free(buf->data);
+        buf->data = NULL;
+        buf->len = 0;
+        buf->cap = 0;
+    }
+}
+
+int desktop_entry_parse(const char *buf, size_t len, desktop_entry_t *entry) {
+    const char *p = buf;
+    const char *end = buf + len;
+    bool in_entry = false;
+    bool found_entry = false;
+
+    /* Validate input parameters */
+    if (buf == NULL || entry == NULL) {
+        return KIA_ERROR_SESSION;
+    }
+
+    memset(entry, 0, sizeof(*entry));
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (eol == NULL) {
+            eol = end;
+        }
+
+        const char *line_end = eol;
+        if (line_end > p && line_end[-1] == '\r') {
+            line_end--;
+        }
+
+        if (p < line_end && *p == '[') {
+            /* Group header: only [Desktop Entry] is of interest */
+            const char *close = memchr(p, ']', (size_t)(line_end - p));
+            bool is_entry = close != NULL &&
+                            span_equals(p + 1, (size_t)(close - p - 1), DESKTOP_ENTRY_GROUP);
+            if (found_entry && !is_entry) {
+                break;  /* Past the [Desktop Entry] group */
+            }
+            in_entry = is_entry;
+            found_entry = found_entry || is_entry;
+        } else if (in_entry && p < line_end && *p != '#') {
+            /* Key, optional whitespace, '=', optional whitespace, value */
+            const char *key_end = p;
+            while (key_end < line_end && *key_end != '=' &&
+                   *key_end != ' ' && *key_end != '\t') {
+                key_end++;
+            }
+
+            const char *value = key_end;
+            while (value < line_end && (*value == ' ' || *value == '\t')) {
+                value++;
+            }
+
+            if (value < line_end && *value == '=') {
+                value++;
+                while (value < line_end && (*value == ' ' || *value == '\t')) {
+                    value++;
+                }
+
+                size_t key_len = (size_t)(key_end - p);
+                desktop_span_t span = { value, (size_t)(line_end - value) };
+                desktop_span_t *slot = NULL;
+
+                if (span_equals(p, key_len, "Name")) {
+                    slot = &entry->name;
+                } else if (span_equals(p, key_len, "Exec")) {
+                    slot = &entry->exec;
+                } else if (span_equals(p, key_len, "TryExec")) {
+                    slot = &entry->try_exec;
+                } else if (span_equals(p, key_len, "DesktopNames")) {
+                    slot = &entry->desktop_names;
+                } else if (span_equals(p, key_len, "Hidden")) {
+                    entry->hidden = span_is_true(&span);
+                } else if (span_equals(p, key_len, "NoDisplay")) {
+                    entry->no_display = span_is_true(&span);
+                }
+
+                /* First occurrence of a key wins */
+                if (slot != NULL && slot->ptr == NULL) {
+                    *slot = span;
+                }
+            }
+        }
+
+        p = eol + 1;
+    }
+
+    return found_entry ? KIA_SUCCESS : KIA_ERROR_SESSION;
+}
+
+int desktop_span_copy(const desktop_span_t *span, char *dst, size_t size) {
+    size_t out = 0;
+
+    /* Validate input parameters */
+    if (span == NULL || span->ptr == NULL || span->len == 0 || dst == NULL || size == 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < span->len; i++) {
+        char ch = span->ptr[i];
+
+        if (ch == '\\' && i + 1 < span->len) {
+            switch (span->ptr[++i]) {
+                case 's':  ch = ' ';  break;
+                case 'n':  ch = '\n'; break;
+                case 't':  ch = '\t'; break;
+                case 'r':  ch = '\r'; break;
+                case '\\': ch = '\\'; break;
+                default:
+                    /* Unknown escape: keep it for the consumer */
+                    if (out + 1 >= size) {
+                        return -1;
+                    }
+                    dst[out++] = '\\';
+                    ch = span->ptr[i];
+                    break;
+            }
+        }
+
+        if (out + 1 >= size) {
+            return -1;
+        }
+        dst[out++] = ch;
+    }
+
+    dst[out] = '\0';
+    return (int)out;
+}
+
+int desktop_exec_split(const char *exec, char *out, size_t size, size_t *out_len) {
+    size_t used = 0;
+    int argc = 0;
+
+    /* Validate input parameters */
+    if (exec == NULL || out == NULL || out_len == NULL) {
+        return 0;
+    }
+    *out_len = 0;
+
+    const char *p = exec;
+    while (1) {
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+
+        size_t start = used;
+        bool quoted = false;
+
+        while (*p != '\0' && *p != ' ' && *p != '\t') {
+            char ch = *p++;
+
+            if (ch == '"') {
+                /* Inside quotes only \" \` \$ and \\ are escapes */
+                quoted = true;
+                while (*p != '"') {
+                    if (*p == '\0') {
+                        return 0;  /* Unbalanced quote */
+                    }
+                    ch = *p++;
+                    if (ch == '\\' && *p != '\0' &&
+                        strchr(DESKTOP_EXEC_QUOTED_ESCAPES, *p) != NULL) {
+                        ch = *p++;
+                    }
+                    if (used + 1 >= size) {
+                        return 0;
+                    }
+                    out[used++] = ch;
+                }
+                p++;
+                continue;
+            }
+
+            if (ch == '%') {
+                ch = *p;
+                if (ch == '\0' || (ch != '%' && strchr(DESKTOP_EXEC_FIELD_CODES, ch) == NULL)) {
+                    return 0;  /* Unknown field code */
+                }
+                p++;
+                if (ch != '%') {
+                    continue;
+                }
+            } else if (strchr(DESKTOP_EXEC_RESERVED, ch) != NULL) {
+                return 0;
+            }
+
+            if (used + 1 >= size) {
+                return 0;
+            }
+            out[used++] = ch;
+        }
+
+        /* An argument made only of field codes expands to nothing */
+        if (used == start && !quoted) {
+            continue;
+        }
+
+        /* A leading NAME=value is a shell variable assignment */
+        if (argc == 0 && !quoted) {
+            const char *eq = memchr(out, '=', used);
+            if (eq != NULL && eq != out && memchr(out, '/', (size_t)(eq - out)) == NULL) {
+                return 0;
+            }
+        }
+
+        if (argc == DESKTOP_EXEC_MAX_ARGS || used >= size) {
+            return 0;
+        }
+        out[used++] = '\0';
+        argc++;
+    }
+
+    *out_len = used;
+    return argc;
+}
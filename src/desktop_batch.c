@@ -0,0 +1,562 @@
+#define _GNU_SOURCE
+#include "desktop_batch.h"
+#include "desktop.h"
+#include "config.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define BATCH_INITIAL_FILES 32
+#define BATCH_INITIAL_NAMES 1024
+#define BATCH_INITIAL_DATA 16384
+
+/* Mapped io_uring submission and completion queues */
+struct desktop_ring {
+    int fd;
+    unsigned entries;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_map;
+    void *cq_map;
+    size_t sq_map_len;
+    size_t cq_map_len;
+    size_t sqes_len;
+};
+
+/**
+ * Unmap and close a ring
+ */
+static void ring_close(struct desktop_ring *ring) {
+    if (!ring) {
+        return;
+    }
+
+    if (ring->sqes) {
+        munmap(ring->sqes, ring->sqes_len);
+    }
+    if (ring->cq_map && ring->cq_map != ring->sq_map) {
+        munmap(ring->cq_map, ring->cq_map_len);
+    }
+    if (ring->sq_map) {
+        munmap(ring->sq_map, ring->sq_map_len);
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+    free(ring);
+}
+
+/**
+ * Create and map an io_uring
+ * @return Ring, or NULL if io_uring is not available
+ */
+static struct desktop_ring *ring_open(unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+        logger_log(LOG_DEBUG, "io_uring unavailable (%s), reading desktop files with plain calls",
+                   strerror(errno));
+        return NULL;
+    }
+
+    struct desktop_ring *ring = calloc(1, sizeof(*ring));
+    if (!ring) {
+        close(fd);
+        return NULL;
+    }
+    ring->fd = fd;
+    ring->entries = params.sq_entries;
+
+    ring->sq_map_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_map = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_map) {
+        if (ring->cq_map_len > ring->sq_map_len) {
+            ring->sq_map_len = ring->cq_map_len;
+        }
+        ring->cq_map_len = ring->sq_map_len;
+    }
+
+    ring->sq_map = mmap(NULL, ring->sq_map_len, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED) {
+        ring->sq_map = NULL;
+        ring_close(ring);
+        return NULL;
+    }
+
+    ring->cq_map = single_map ? ring->sq_map :
+                   mmap(NULL, ring->cq_map_len, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (ring->cq_map == MAP_FAILED) {
+        ring->cq_map = NULL;
+        ring_close(ring);
+        return NULL;
+    }
+
+    ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        ring_close(ring);
+        return NULL;
+    }
+
+    char *sq = ring->sq_map;
+    char *cq = ring->cq_map;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    return ring;
+}
+
+/**
+ * Get the i-th free submission entry past the current tail, cleared
+ */
+static struct io_uring_sqe *ring_sqe(struct desktop_ring *ring, unsigned i) {
+    unsigned idx = (*ring->sq_tail + i) & *ring->sq_mask;
+    ring->sq_array[idx] = idx;
+    memset(&ring->sqes[idx], 0, sizeof(ring->sqes[idx]));
+    return &ring->sqes[idx];
+}
+
+/**
+ * Submit count prepared entries and wait for all of their completions
+ * Each completion result is stored in res at its user_data index
+ * @return KIA_SUCCESS, or KIA_ERROR_SESSION if the ring failed
+ */
+static int ring_run(desktop_batch_t *batch, unsigned count, int *res) {
+    struct desktop_ring *ring = batch->ring;
+    unsigned pending = count;
+    unsigned done = 0;
+
+    __atomic_store_n(ring->sq_tail, *ring->sq_tail + count, __ATOMIC_RELEASE);
+
+    while (done < count) {
+        int submitted = (int)syscall(__NR_io_uring_enter, ring->fd, pending, 1,
+                                     IORING_ENTER_GETEVENTS, NULL, 0);
+        batch->submits++;
+        if (submitted < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                logger_log(LOG_WARN, "io_uring submission failed: %s", strerror(errno));
+                return KIA_ERROR_SESSION;
+            }
+        } else {
+            pending -= (unsigned)submitted < pending ? (unsigned)submitted : pending;
+        }
+
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+            res[cqe->user_data] = cqe->res;
+            head++;
+            done++;
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    return KIA_SUCCESS;
+}
+
+/**
+ * Grow the data arena so that it can take extra more bytes
+ */
+static int data_reserve(desktop_batch_t *batch, size_t extra) {
+    if (batch->data_len + extra <= batch->data_cap) {
+        return KIA_SUCCESS;
+    }
+
+    size_t new_cap = batch->data_cap ? batch->data_cap * 2 : BATCH_INITIAL_DATA;
+    while (new_cap < batch->data_len + extra) {
+        new_cap *= 2;
+    }
+    if (new_cap > UINT32_MAX) {
+        return KIA_ERROR_SESSION;
+    }
+
+    char *data = realloc(batch->data, new_cap);
+    if (!data) {
+        return KIA_ERROR_SESSION;
+    }
+    batch->data = data;
+    batch->data_cap = new_cap;
+    return KIA_SUCCESS;
+}
+
+/**
+ * Read one file with plain calls, appending it to the data arena
+ * @return KIA_SUCCESS, or KIA_ERROR_SESSION if memory ran out (the file
+ *         error is recorded either way)
+ */
+static int read_plain(desktop_batch_t *batch, int idx, int dirfd) {
+    desktop_batch_file_t *file = &batch->files[idx];
+    struct stat st;
+
+    file->len = 0;
+
+    /* Non-blocking, so a FIFO planted as a desktop file cannot stall the open */
+    int fd = openat(dirfd, batch->names + file->name_off, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        file->error = errno;
+        return KIA_SUCCESS;
+    }
+
+    if (fstat(fd, &st) != 0) {
+        file->error = errno;
+        close(fd);
+        return KIA_SUCCESS;
+    }
+    if (!S_ISREG(st.st_mode) || st.st_size > DESKTOP_MAX_FILE_SIZE) {
+        file->error = EFBIG;
+        close(fd);
+        return KIA_SUCCESS;
+    }
+
+    /* One spare byte detects growth after fstat and one holds the terminator */
+    size_t cap = (size_t)st.st_size + 2;
+    if (data_reserve(batch, cap) != KIA_SUCCESS) {
+        file->error = ENOMEM;
+        close(fd);
+        return KIA_ERROR_SESSION;
+    }
+    file->data_off = (uint32_t)batch->data_len;
+
+    size_t len = 0;
+    while (1) {
+        ssize_t n = read(fd, batch->data + file->data_off + len, cap - len - 1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            file->error = errno;
+            close(fd);
+            return KIA_SUCCESS;
+        }
+        if (n == 0) {
+            break;
+        }
+        len += (size_t)n;
+
+        /* File grew since fstat: keep reading within the size limit */
+        if (len == cap - 1) {
+            if (len >= DESKTOP_MAX_FILE_SIZE) {
+                file->error = EFBIG;
+                close(fd);
+                return KIA_SUCCESS;
+            }
+            if (data_reserve(batch, cap * 2) != KIA_SUCCESS) {
+                file->error = ENOMEM;
+                close(fd);
+                return KIA_ERROR_SESSION;
+            }
+            cap *= 2;
+        }
+    }
+
+    close(fd);
+    batch->data[file->data_off + len] = '\0';
+    batch->data_len += len + 1;
+    file->len = (uint32_t)len;
+    file->error = 0;
+    return KIA_SUCCESS;
+}
+
+/**
+ * Read files [first, first + count) through the ring
+ * Opens and stats go out together, then all reads. Descriptors are closed
+ * with plain calls: a close linked to its read would be cancelled by the
+ * short read every file ends with, and an unlinked one may run first.
+ * Anything unexpected is left to read_plain()
+ * @return KIA_SUCCESS, or KIA_ERROR_SESSION if the ring failed
+ */
+static int read_ring_chunk(desktop_batch_t *batch, int first, int count, int dirfd,
+                           struct statx *stx, int *fds, int *res, bool *retry) {
+    struct desktop_ring *ring = batch->ring;
+
+    for (int i = 0; i < count; i++) {
+        const char *name = batch->names + batch->files[first + i].name_off;
+
+        struct io_uring_sqe *sqe = ring_sqe(ring, (unsigned)(2 * i));
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = dirfd;
+        sqe->addr = (uint64_t)(uintptr_t)name;
+        sqe->open_flags = O_RDONLY | O_NONBLOCK | O_CLOEXEC;
+        sqe->user_data = (uint64_t)(2 * i);
+
+        sqe = ring_sqe(ring, (unsigned)(2 * i + 1));
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = dirfd;
+        sqe->addr = (uint64_t)(uintptr_t)name;
+        sqe->len = STATX_TYPE | STATX_SIZE;
+        sqe->off = (uint64_t)(uintptr_t)&stx[i];
+        sqe->user_data = (uint64_t)(2 * i + 1);
+
+        /* Opens that never complete leave no descriptor to close */
+        res[2 * i] = -ECANCELED;
+    }
+    if (ring_run(batch, (unsigned)(2 * count), res) != KIA_SUCCESS) {
+        for (int i = 0; i < count; i++) {
+            if (res[2 * i] >= 0) {
+                close(res[2 * i]);
+            }
+            retry[i] = true;
+        }
+        return KIA_ERROR_SESSION;
+    }
+
+    /* Lay the files out in the arena now that their sizes are known */
+    size_t needed = 0;
+    for (int i = 0; i < count; i++) {
+        fds[i] = res[2 * i];
+        retry[i] = fds[i] < 0 || res[2 * i + 1] < 0;
+        if (retry[i] || !S_ISREG(stx[i].stx_mode) || stx[i].stx_size > DESKTOP_MAX_FILE_SIZE) {
+            if (!retry[i]) {
+                batch->files[first + i].error = EFBIG;
+            }
+            if (fds[i] >= 0) {
+                close(fds[i]);
+            }
+            fds[i] = -1;
+        } else {
+            needed += (size_t)stx[i].stx_size + 2;
+        }
+    }
+    if (data_reserve(batch, needed) != KIA_SUCCESS) {
+        for (int i = 0; i < count; i++) {
+            if (fds[i] >= 0) {
+                close(fds[i]);
+                retry[i] = true;
+            }
+        }
+        return KIA_SUCCESS;
+    }
+
+    unsigned queued = 0;
+    for (int i = 0; i < count; i++) {
+        desktop_batch_file_t *file = &batch->files[first + i];
+        int fd = fds[i];
+        if (fd < 0) {
+            continue;
+        }
+
+        /* Ask for one byte more than the size to notice a file that grew */
+        file->data_off = (uint32_t)batch->data_len;
+        batch->data_len += (size_t)stx[i].stx_size + 2;
+
+        struct io_uring_sqe *sqe = ring_sqe(ring, queued++);
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t)(uintptr_t)(batch->data + file->data_off);
+        sqe->len = (uint32_t)stx[i].stx_size + 1;
+        sqe->user_data = (uint64_t)i;
+    }
+    int run = queued > 0 ? ring_run(batch, queued, res) : KIA_SUCCESS;
+    for (int i = 0; i < count; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+    if (run != KIA_SUCCESS) {
+        for (int i = 0; i < count; i++) {
+            retry[i] = true;
+        }
+        return KIA_ERROR_SESSION;
+    }
+
+    for (int i = 0; i < count; i++) {
+        desktop_batch_file_t *file = &batch->files[first + i];
+        if (fds[i] < 0) {
+            continue;
+        }
+        int got = res[i];
+        if (got < 0 || (uint64_t)got > stx[i].stx_size) {
+            retry[i] = true;
+            continue;
+        }
+        batch->data[file->data_off + (uint32_t)got] = '\0';
+        file->len = (uint32_t)got;
+    }
+
+    return KIA_SUCCESS;
+}
+
+int desktop_batch_init(desktop_batch_t *batch, bool use_ring) {
+    if (!batch) {
+        return KIA_ERROR_SESSION;
+    }
+
+    memset(batch, 0, sizeof(*batch));
+    if (use_ring) {
+        batch->ring = ring_open(DESKTOP_BATCH_RING_ENTRIES);
+    }
+    return KIA_SUCCESS;
+}
+
+bool desktop_batch_uses_ring(const desktop_batch_t *batch) {
+    return batch && batch->ring != NULL;
+}
+
+int desktop_batch_add(desktop_batch_t *batch, const char *name) {
+    /* Validate input parameters */
+    if (!batch || !name || name[0] == '\0' || strchr(name, '/') != NULL) {
+        return KIA_ERROR_SESSION;
+    }
+
+    if (batch->count == batch->cap) {
+        int new_cap = batch->cap ? batch->cap * 2 : BATCH_INITIAL_FILES;
+        desktop_batch_file_t *files = realloc(batch->files, (size_t)new_cap * sizeof(*files));
+        if (!files) {
+            return KIA_ERROR_SESSION;
+        }
+        batch->files = files;
+        batch->cap = new_cap;
+    }
+
+    size_t len = strlen(name);
+    if (batch->names_len + len + 1 > batch->names_cap) {
+        size_t new_cap = batch->names_cap ? batch->names_cap * 2 : BATCH_INITIAL_NAMES;
+        while (new_cap < batch->names_len + len + 1) {
+            new_cap *= 2;
+        }
+        if (new_cap > UINT32_MAX) {
+            return KIA_ERROR_SESSION;
+        }
+        char *names = realloc(batch->names, new_cap);
+        if (!names) {
+            return KIA_ERROR_SESSION;
+        }
+        batch->names = names;
+        batch->names_cap = new_cap;
+    }
+
+    desktop_batch_file_t *file = &batch->files[batch->count];
+    memset(file, 0, sizeof(*file));
+    file->name_off = (uint32_t)batch->names_len;
+    memcpy(batch->names + batch->names_len, name, len + 1);
+    batch->names_len += len + 1;
+    return batch->count++;
+}
+
+int desktop_batch_read(desktop_batch_t *batch, int dirfd) {
+    int read_count = 0;
+
+    /* Validate input parameters */
+    if (!batch || dirfd < 0) {
+        return KIA_ERROR_SESSION;
+    }
+
+    batch->data_len = 0;
+    bool *retry = calloc((size_t)batch->count + 1, sizeof(*retry));
+    if (!retry) {
+        return KIA_ERROR_SESSION;
+    }
+
+    /* Without a ring every file takes the plain path */
+    for (int i = 0; i < batch->count; i++) {
+        batch->files[i].error = 0;
+        batch->files[i].len = 0;
+        retry[i] = batch->ring == NULL;
+    }
+
+    if (batch->ring) {
+        int chunk = (int)batch->ring->entries / 2;
+        struct statx *stx = calloc((size_t)chunk, sizeof(*stx));
+        int *fds = calloc((size_t)chunk, sizeof(*fds));
+        int *res = calloc((size_t)chunk * 2, sizeof(*res));
+        bool ready = stx && fds && res;
+
+        for (int first = 0; ready && first < batch->count; first += chunk) {
+            int count = batch->count - first < chunk ? batch->count - first : chunk;
+            if (read_ring_chunk(batch, first, count, dirfd, stx, fds, res,
+                                retry + first) != KIA_SUCCESS) {
+                /* The ring is in an unknown state, finish with plain calls */
+                ring_close(batch->ring);
+                batch->ring = NULL;
+                for (int i = first; i < batch->count; i++) {
+                    retry[i] = true;
+                }
+                break;
+            }
+        }
+        if (!ready) {
+            for (int i = 0; i < batch->count; i++) {
+                retry[i] = true;
+            }
+        }
+        free(stx);
+        free(fds);
+        free(res);
+    }
+
+    for (int i = 0; i < batch->count; i++) {
+        if (retry[i] && read_plain(batch, i, dirfd) != KIA_SUCCESS) {
+            free(retry);
+            return KIA_ERROR_SESSION;
+        }
+        read_count += batch->files[i].error == 0;
+    }
+
+    free(retry);
+    return read_count;
+}
+
+const char *desktop_batch_name(const desktop_batch_t *batch, int idx) {
+    if (!batch || idx < 0 || idx >= batch->count) {
+        return NULL;
+    }
+    return batch->names + batch->files[idx].name_off;
+}
+
+const char *desktop_batch_data(const desktop_batch_t *batch, int idx, size_t *len) {
+    if (!batch || idx < 0 || idx >= batch->count || batch->files[idx].error != 0 || !batch->data) {
+        return NULL;
+    }
+    if (len) {
+        *len = batch->files[idx].len;
+    }
+    return batch->data + batch->files[idx].data_off;
+}
+
+void desktop_batch_clear(desktop_batch_t *batch) {
+    if (batch) {
+        batch->count = 0;
+        batch->names_len = 0;
+        batch->data_len = 0;
+    }
+}
+
+void desktop_batch_free(desktop_batch_t *batch) {
+    if (!batch) {
+        return;
+    }
+
+    ring_close(batch->ring);
+    free(batch->files);
+    free(batch->names);
+    free(batch->data);
+    memset(batch, 0, sizeof(*batch));
+}
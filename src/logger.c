@@ -28,6 +28,7 @@ static const char *log_level_strings[] = {
  */
 static void get_iso8601_timestamp(char *buffer, size_t size) {
     time_t now;
+    struct tm tm_buf;
     struct tm *tm_info;
     
     /* Validate input */
@@ -41,7 +42,8 @@ static void get_iso8601_timestamp(char *buffer, size_t size) {
         return;
     }
     
-    tm_info = gmtime(&now);
+    /* Reentrant variant, log calls may come from the discovery thread */
+    tm_info = gmtime_r(&now, &tm_buf);
     
     if (tm_info != NULL) {
         if (strftime(buffer, size, "%Y-%m-%dT%H:%M:%SZ", tm_info) == 0) {
@@ -25,11 +25,15 @@ static volatile sig_atomic_t g_shutdown_requested = 0;
 
 /**
  * Signal handler for SIGTERM and SIGINT
- * Sets shutdown flag for graceful exit
+ * Sets shutdown flag for graceful exit; the controller stops any running
+ * session before returning
  */
 static void signal_handler(int signum) {
     (void)signum;  /* Unused parameter */
     g_shutdown_requested = 1;
+    if (g_app_context != NULL) {
+        controller_request_shutdown(g_app_context);
+    }
 }
 
 /**
@@ -166,6 +170,10 @@ int main(int argc, char *argv[]) {
         logger_log(LOG_ERROR, "Failed to initialize controller: %d", result);
         cleanup_and_exit(EXIT_FAILURE);
     }
+    if (g_shutdown_requested) {
+        /* Signalled before the context was ready */
+        controller_request_shutdown(&app_context);
+    }
     
     /* Load configuration */
     result = config_load(DEFAULT_CONFIG_PATH, &app_context.config);
@@ -1,5 +1,14 @@
 #define _GNU_SOURCE
 #include "session.h"
+#include "session_cache.h"
+#include "session_path.h"
+#include "desktop.h"
+#include "desktop_batch.h"
+#include "session_env.h"
+#include "session_spawn.h"
+#include "session_xorg.h"
+#include "session_usage.h"
+#include "session_group.h"
 #include "logger.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,233 +17,1291 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
 #include <pwd.h>
+#include <grp.h>
 #include <errno.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <poll.h>
 
-#define X11_SESSION_DIR "/usr/share/xsessions"
-#define WAYLAND_SESSION_DIR "/usr/share/wayland-sessions"
-#define MAX_LINE_LENGTH 1024
+#define SESSION_CACHE_PATH "/var/cache/kia/sessions.cache"
+
+/* Directories searched by session_discover(), built once from XDG_DATA_DIRS */
+static session_dir_t default_session_dirs[SESSION_MAX_DATA_DIRS * 2];
+static int default_session_dir_count;
+static pthread_once_t default_session_dirs_once = PTHREAD_ONCE_INIT;
+
+/* Resolution cache for session commands over PATH, shared by discovery and launch */
+static session_path_t exec_path;
+static bool exec_path_ready;
+static pthread_mutex_t exec_path_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Where session output logs, display locks and X authority files go */
+static const char *output_dir = SESSION_OUTPUT_DIR;
+static const char *state_dir = SESSION_DISPLAY_LOCK_DIR;
+
+/*
+ * Set of desktop file IDs seen during a scan, keyed by session type
+ * Open addressing over FNV-1a hashes; IDs are copied into a private pool
+ */
+typedef struct {
+    uint32_t *slots;     /* 0 when empty, otherwise pool offset + 1 */
+    uint32_t *hashes;
+    uint32_t capacity;   /* Power of two */
+    uint32_t count;
+    char *pool;          /* Type byte, ID, NUL per entry */
+    size_t pool_len;
+    size_t pool_cap;
+} id_index_t;
+
+#define ID_INDEX_INITIAL_SLOTS 64
+
+#define SESSION_LIST_INITIAL_RECORDS 16
+#define SESSION_LIST_INITIAL_ARENA 1024
+
+/**
+ * FNV-1a hash of a session type and desktop file ID
+ */
+static uint32_t hash_id(session_type_t type, const char *file_id) {
+    uint32_t hash = 2166136261u;
+
+    hash ^= (uint32_t)type;
+    hash *= 16777619u;
+    for (const unsigned char *p = (const unsigned char *)file_id; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * Rehash the index into twice as many slots
+ */
+static int id_index_grow(id_index_t *index) {
+    uint32_t capacity = index->capacity ? index->capacity * 2 : ID_INDEX_INITIAL_SLOTS;
+    uint32_t *slots = calloc(capacity, sizeof(*slots));
+    uint32_t *hashes = calloc(capacity, sizeof(*hashes));
+    if (!slots || !hashes) {
+        free(slots);
+        free(hashes);
+        return KIA_ERROR_SESSION;
+    }
+
+    for (uint32_t i = 0; i < index->capacity; i++) {
+        if (index->slots[i] == 0) {
+            continue;
+        }
+        uint32_t pos = index->hashes[i] & (capacity - 1);
+        while (slots[pos] != 0) {
+            pos = (pos + 1) & (capacity - 1);
+        }
+        slots[pos] = index->slots[i];
+        hashes[pos] = index->hashes[i];
+    }
+
+    free(index->slots);
+    free(index->hashes);
+    index->slots = slots;
+    index->hashes = hashes;
+    index->capacity = capacity;
+    return KIA_SUCCESS;
+}
+
+/**
+ * Add a desktop file ID to the index
+ * @return 1 if the ID was new, 0 if already present, KIA_ERROR_SESSION on error
+ */
+static int id_index_insert(id_index_t *index, session_type_t type, const char *file_id) {
+    if (index->count * 2 >= index->capacity && id_index_grow(index) != KIA_SUCCESS) {
+        return KIA_ERROR_SESSION;
+    }
+
+    uint32_t hash = hash_id(type, file_id);
+    uint32_t pos = hash & (index->capacity - 1);
+    while (index->slots[pos] != 0) {
+        const char *entry = index->pool + index->slots[pos] - 1;
+        if (index->hashes[pos] == hash && entry[0] == (char)type &&
+            strcmp(entry + 1, file_id) == 0) {
+            return 0;
+        }
+        pos = (pos + 1) & (index->capacity - 1);
+    }
+
+    size_t len = strlen(file_id);
+    if (index->pool_len + len + 2 > index->pool_cap) {
+        size_t new_cap = index->pool_cap ? index->pool_cap * 2 : SESSION_LIST_INITIAL_ARENA;
+        while (new_cap < index->pool_len + len + 2) {
+            new_cap *= 2;
+        }
+        if (new_cap > UINT32_MAX) {
+            return KIA_ERROR_SESSION;
+        }
+        char *pool = realloc(index->pool, new_cap);
+        if (!pool) {
+            return KIA_ERROR_SESSION;
+        }
+        index->pool = pool;
+        index->pool_cap = new_cap;
+    }
+
+    index->pool[index->pool_len] = (char)type;
+    memcpy(index->pool + index->pool_len + 1, file_id, len + 1);
+    index->slots[pos] = (uint32_t)index->pool_len + 1;
+    index->hashes[pos] = hash;
+    index->pool_len += len + 2;
+    index->count++;
+    return 1;
+}
+
+/**
+ * Free an ID index
+ */
+static void id_index_free(id_index_t *index) {
+    free(index->slots);
+    free(index->hashes);
+    free(index->pool);
+    memset(index, 0, sizeof(*index));
+}
+
+/**
+ * Move a list loaded from the cache mapping onto the heap so it can grow
+ */
+static int list_make_writable(session_list_t *list) {
+    if (list->mapping == NULL) {
+        return KIA_SUCCESS;
+    }
+
+    size_t records_len = (size_t)list->count * sizeof(session_record_t);
+    session_record_t *records = malloc(records_len ? records_len : sizeof(session_record_t));
+    char *arena = malloc(list->arena_len ? list->arena_len : 1);
+    if (!records || !arena) {
+        free(records);
+        free(arena);
+        return KIA_ERROR_SESSION;
+    }
+
+    memcpy(records, list->records, records_len);
+    memcpy(arena, list->arena, list->arena_len);
+    munmap(list->mapping, list->mapping_len);
+
+    list->records = records;
+    list->capacity = list->count;
+    list->arena = arena;
+    list->arena_cap = list->arena_len;
+    list->mapping = NULL;
+    list->mapping_len = 0;
+    return KIA_SUCCESS;
+}
+
+/**
+ * Make room for one more record and arena_extra more string bytes
+ */
+static int list_reserve(session_list_t *list, size_t arena_extra) {
+    if (list_make_writable(list) != KIA_SUCCESS) {
+        return KIA_ERROR_SESSION;
+    }
+
+    if (list->count == list->capacity) {
+        int new_capacity = list->capacity ? list->capacity * 2 : SESSION_LIST_INITIAL_RECORDS;
+        session_record_t *records = realloc(list->records,
+                                            (size_t)new_capacity * sizeof(session_record_t));
+        if (!records) {
+            return KIA_ERROR_SESSION;
+        }
+        list->records = records;
+        list->capacity = new_capacity;
+    }
+
+    /* Arena offsets are stored as 32-bit values */
+    if (arena_extra > UINT32_MAX - list->arena_len) {
+        return KIA_ERROR_SESSION;
+    }
+
+    if (list->arena_len + arena_extra > list->arena_cap) {
+        size_t new_cap = list->arena_cap ? list->arena_cap * 2 : SESSION_LIST_INITIAL_ARENA;
+        while (new_cap < list->arena_len + arena_extra) {
+            new_cap *= 2;
+        }
+        char *arena = realloc(list->arena, new_cap);
+        if (!arena) {
+            return KIA_ERROR_SESSION;
+        }
+        list->arena = arena;
+        list->arena_cap = new_cap;
+    }
+
+    return KIA_SUCCESS;
+}
+
+/**
+ * Tokenise an Exec line into the argument block stored after a record's
+ * file ID; dst must have room for exec_len + 2 bytes
+ * @return Size of the block
+ */
+static size_t store_args(char *dst, const char *exec, size_t exec_len) {
+    size_t args_len = 0;
+    int argc = desktop_exec_split(exec, dst + 1, exec_len + 1, &args_len);
+
+    dst[0] = (char)argc;
+    if (argc == 0) {
+        logger_log(LOG_DEBUG, "Exec line needs a shell: %s", exec);
+        return 1;
+    }
+    return 1 + args_len;
+}
+
+/**
+ * Store a DesktopNames list as the XDG_CURRENT_DESKTOP value stored after a
+ * record's argument block, which separates names with ':' rather than ';';
+ * dst must have room for names->len + 1 bytes
+ * @return Size of the value, terminator included
+ */
+static size_t store_desktop_names(char *dst, const desktop_span_t *names) {
+    int len = names->ptr ? desktop_span_copy(names, dst, names->len + 1) : -1;
+    size_t out = 0;
+
+    for (int i = 0; i < len; i++) {
+        if (dst[i] != ';') {
+            dst[out++] = dst[i];
+        } else if (out > 0 && dst[out - 1] != ':') {
+            dst[out++] = ':';
+        }
+    }
+    if (out > 0 && dst[out - 1] == ':') {
+        out--;
+    }
+    dst[out] = '\0';
+    return out + 1;
+}
+
+/**
+ * Append a record for strings already written at the arena tail
+ * @param tail_len Size of the argument block and desktop names after the file ID
+ */
+static void list_commit(session_list_t *list, size_t name_len, size_t exec_len,
+                        size_t file_len, size_t tail_len, session_type_t type, int dir_idx) {
+    session_record_t *record = &list->records[list->count++];
+
+    record->name_off = (uint32_t)list->arena_len;
+    record->name_len = (uint16_t)name_len;
+    record->exec_off = (uint32_t)(list->arena_len + name_len + 1);
+    record->exec_len = (uint16_t)exec_len;
+    record->type = (uint16_t)type;
+    record->dir = (uint16_t)dir_idx;
+
+    list->arena_len += name_len + 1 + exec_len + 1 + file_len + 1 + tail_len;
+}
+
+/**
+ * Get the desktop file ID stored after a record's exec string
+ */
+static const char *record_file(const session_list_t *list, const session_record_t *record) {
+    return list->arena + record->exec_off + record->exec_len + 1;
+}
+
+/**
+ * Get the argument block stored after a record's file ID
+ */
+static const char *record_args(const session_list_t *list, const session_record_t *record) {
+    const char *file = record_file(list, record);
+    return file + strlen(file) + 1;
+}
+
+/**
+ * Get the XDG_CURRENT_DESKTOP value stored after a record's argument block
+ */
+static const char *record_desktop_names(const session_list_t *list,
+                                        const session_record_t *record) {
+    const char *args = record_args(list, record);
+    const char *end = args + 1;
+
+    for (int i = 0; i < (unsigned char)args[0]; i++) {
+        end += strlen(end) + 1;
+    }
+    return end;
+}
+
+/**
+ * Number of arena bytes holding a record's strings
+ */
+static size_t record_span(const session_list_t *list, const session_record_t *record) {
+    const char *names = record_desktop_names(list, record);
+    return (size_t)(names + strlen(names) + 1 - (list->arena + record->name_off));
+}
+
+/**
+ * Rewrite the arena without the strings of removed sessions once they
+ * make up most of it
+ */
+static void list_maybe_compact(session_list_t *list) {
+    if (list->arena_dead < SESSION_LIST_INITIAL_ARENA || list->arena_dead * 2 < list->arena_len) {
+        return;
+    }
+
+    size_t live_len = list->arena_len - list->arena_dead;
+    char *arena = malloc(live_len ? live_len : 1);
+    if (!arena) {
+        return;  /* Keep the dead bytes, the list is still consistent */
+    }
+
+    size_t off = 0;
+    for (int i = 0; i < list->count; i++) {
+        session_record_t *record = &list->records[i];
+        size_t span = record_span(list, record);
+        memcpy(arena + off, list->arena + record->name_off, span);
+        record->name_off = (uint32_t)off;
+        record->exec_off = (uint32_t)(off + record->name_len + 1);
+        off += span;
+    }
+
+    free(list->arena);
+    list->arena = arena;
+    list->arena_len = off;
+    list->arena_cap = live_len;
+    list->arena_dead = 0;
+}
+
+/**
+ * Lock the command resolution cache, setting it up from PATH on first use
+ * and expiring what it knows about PATH directories that changed since
+ * @return Cache, or NULL if it is unavailable; release it either way
+ */
+static session_path_t *exec_path_acquire(void) {
+    pthread_mutex_lock(&exec_path_lock);
+
+    if (!exec_path_ready) {
+        exec_path_ready = session_path_init(&exec_path, getenv("PATH")) == KIA_SUCCESS;
+    } else {
+        session_path_refresh(&exec_path);
+    }
+    return exec_path_ready ? &exec_path : NULL;
+}
+
+/**
+ * Unlock the command resolution cache
+ */
+static void exec_path_release(void) {
+    pthread_mutex_unlock(&exec_path_lock);
+}
+
+void session_set_dirs(const char *output, const char *state) {
+    output_dir = output ? output : SESSION_OUTPUT_DIR;
+    state_dir = state ? state : SESSION_DISPLAY_LOCK_DIR;
+}
+
+void session_release_caches(void) {
+    pthread_mutex_lock(&exec_path_lock);
+    if (exec_path_ready) {
+        session_path_free(&exec_path);
+        exec_path_ready = false;
+    }
+    pthread_mutex_unlock(&exec_path_lock);
+}
+
+/**
+ * Parse the contents of a .desktop file and append its session to the list
+ * The Name and Exec values are unescaped straight into the list arena.
+ * With a resolution cache, sessions whose TryExec, or else first Exec
+ * argument, is not an installed command are left out
+ */
+static int parse_desktop_file(const char *dir_path, const char *file_id,
+                              const char *data, size_t len,
+                              session_path_t *exec_path, session_list_t *list,
+                              session_type_t type, int dir_idx) {
+    desktop_entry_t entry;
+    
+    /* Validate input parameters */
+    if (dir_path == NULL || file_id == NULL || data == NULL || list == NULL) {
+        logger_log(LOG_ERROR, "Invalid parameters to parse_desktop_file");
+        return KIA_ERROR_SESSION;
+    }
+
+    if (desktop_entry_parse(data, len, &entry) != KIA_SUCCESS) {
+        logger_log(LOG_WARN, "No [Desktop Entry] group in desktop file: %s/%s", dir_path, file_id);
+        return KIA_ERROR_SESSION;
+    }
+
+    if (entry.hidden || entry.no_display) {
+        logger_log(LOG_DEBUG, "Skipping hidden desktop file: %s/%s", dir_path, file_id);
+        return KIA_ERROR_SESSION;
+    }
+
+    /* Unescaping never lengthens a value, so the raw spans bound the space needed */
+    size_t file_len = strlen(file_id);
+    if (list_reserve(list, entry.name.len + 1 + entry.exec.len + 1 + file_len + 1 +
+                           entry.exec.len + 2 + entry.desktop_names.len + 1) != KIA_SUCCESS) {
+        logger_log(LOG_ERROR, "Failed to allocate memory for session list: %s", strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+
+    char *name = list->arena + list->arena_len;
+    int name_len = desktop_span_copy(&entry.name, name, SESSION_MAX_FIELD_LEN + 1);
+    int exec_len = -1;
+    if (name_len > 0) {
+        exec_len = desktop_span_copy(&entry.exec, name + name_len + 1, SESSION_MAX_FIELD_LEN + 1);
+    }
+
+    if (name_len <= 0 || exec_len <= 0) {
+        logger_log(LOG_WARN, "Incomplete desktop file: %s/%s (name=%d, exec=%d)", 
+                   dir_path, file_id, name_len > 0, exec_len > 0);
+        return KIA_ERROR_SESSION;
+    }
+
+    char *exec = name + name_len + 1;
+    char *args = exec + exec_len + 1 + file_len + 1;
+    memcpy(exec + exec_len + 1, file_id, file_len + 1);
+    size_t args_len = store_args(args, exec, (size_t)exec_len);
+
+    /* Lines that need a shell are only checked through TryExec */
+    if (exec_path) {
+        char try_exec[512];
+        const char *command = args[0] ? args + 1 : NULL;
+        if (entry.try_exec.ptr != NULL) {
+            bool found = desktop_span_copy(&entry.try_exec, try_exec, sizeof(try_exec)) > 0;
+            command = found ? try_exec : NULL;
+        }
+        if (command && session_path_find(exec_path, command, NULL, 0) != KIA_SUCCESS) {
+            logger_log(LOG_INFO, "Skipping session with missing command %s: %s/%s",
+                       command, dir_path, file_id);
+            return KIA_ERROR_SESSION;
+        }
+    }
+
+    args_len += store_desktop_names(args + args_len, &entry.desktop_names);
+    list_commit(list, (size_t)name_len, (size_t)exec_len, file_len, args_len, type, dir_idx);
+    return KIA_SUCCESS;
+}
 
 /**
- * Parse a .desktop file to extract Name and Exec fields
+ * Scan a directory for .desktop files and add them to the session list
+ * Names are collected first and every file is then read relative to the
+ * directory descriptor in one batch
  */
-static int parse_desktop_file(const char *filepath, session_info_t *session, session_type_t type) {
-    FILE *fp;
-    char line[MAX_LINE_LENGTH];
-    int found_name = 0, found_exec = 0;
+static int scan_session_directory(const char *dir_path, session_type_t type, int dir_idx,
+                                   desktop_batch_t *batch, id_index_t *index,
+                                   session_list_t *list) {
+    DIR *dir;
+    struct dirent *entry;
     
     /* Validate input parameters */
-    if (filepath == NULL || session == NULL) {
-        logger_log(LOG_ERROR, "Invalid parameters to parse_desktop_file");
+    if (dir_path == NULL || batch == NULL || index == NULL || list == NULL) {
+        logger_log(LOG_ERROR, "Invalid parameters to scan_session_directory");
+        return KIA_ERROR_SESSION;
+    }
+    
+    /* Validate count is not negative */
+    if (list->count < 0) {
+        logger_log(LOG_ERROR, "Invalid session count: %d", list->count);
+        return KIA_ERROR_SESSION;
+    }
+    
+    dir = opendir(dir_path);
+    if (!dir) {
+        logger_log(LOG_DEBUG, "Session directory not found: %s (%s)", dir_path, strerror(errno));
+        return KIA_SUCCESS;  /* Not an error if directory doesn't exist */
+    }
+
+    desktop_batch_clear(batch);
+    errno = 0;
+    while ((entry = readdir(dir)) != NULL) {
+        /* Skip anything but *.desktop, including backups such as foo.desktop.bak */
+        if (!desktop_is_file_id(entry->d_name)) {
+            continue;
+        }
+
+        /* FIFOs and devices could block the read; symlinks are checked once opened */
+        if (entry->d_type != DT_REG && entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN) {
+            continue;
+        }
+        
+        /* Validate filename length */
+        size_t name_len = strlen(entry->d_name);
+        if (name_len == 0 || name_len > 255) {
+            logger_log(LOG_WARN, "Invalid filename length: %zu", name_len);
+            continue;
+        }
+
+        /* An earlier directory of the same type already claimed this ID */
+        int fresh = id_index_insert(index, type, entry->d_name);
+        if (fresh == 0) {
+            logger_log(LOG_DEBUG, "Skipping shadowed desktop file: %s/%s", dir_path, entry->d_name);
+            continue;
+        }
+        if (fresh < 0 || desktop_batch_add(batch, entry->d_name) < 0) {
+            logger_log(LOG_ERROR, "Failed to allocate memory for session index");
+            closedir(dir);
+            return KIA_ERROR_SESSION;
+        }
+        
+        errno = 0;
+    }
+    
+    /* Check for readdir errors */
+    if (errno != 0) {
+        logger_log(LOG_ERROR, "Error reading directory %s: %s", dir_path, strerror(errno));
+        closedir(dir);
+        return KIA_ERROR_SESSION;
+    }
+
+    if (batch->count > 0 && desktop_batch_read(batch, dirfd(dir)) < 0) {
+        logger_log(LOG_ERROR, "Failed to allocate memory for desktop files of %s", dir_path);
+        closedir(dir);
+        return KIA_ERROR_SESSION;
+    }
+
+    if (closedir(dir) != 0) {
+        logger_log(LOG_WARN, "Failed to close directory %s: %s", dir_path, strerror(errno));
+    }
+
+    /* Only parsing needs the resolution cache, never a read that may hang */
+    session_path_t *exec_path = exec_path_acquire();
+    for (int i = 0; i < batch->count; i++) {
+        const char *file_id = desktop_batch_name(batch, i);
+        size_t len;
+        const char *data = desktop_batch_data(batch, i, &len);
+        if (data == NULL) {
+            logger_log(LOG_WARN, "Failed to read desktop file: %s/%s (%s)",
+                       dir_path, file_id, strerror(batch->files[i].error));
+            continue;
+        }
+
+        /* Parse desktop file */
+        if (parse_desktop_file(dir_path, file_id, data, len, exec_path, list, type,
+                               dir_idx) == KIA_SUCCESS) {
+            logger_log(LOG_DEBUG, "Discovered session: %s (%s)", 
+                      session_list_name(list, list->count - 1), 
+                      type == SESSION_X11 ? "X11" : "Wayland");
+        }
+    }
+    exec_path_release();
+    
+    return KIA_SUCCESS;
+}
+
+/**
+ * Build the default directory list from the environment
+ */
+static void build_default_dirs(void) {
+    default_session_dir_count = session_dirs_from_data_dirs(getenv("XDG_DATA_DIRS"),
+                                                            default_session_dirs);
+}
+
+int session_dirs_from_data_dirs(const char *data_dirs, session_dir_t *dirs) {
+    char roots[SESSION_MAX_DATA_DIRS][512];
+    int root_count = 0;
+    int count = 0;
+
+    if (!dirs) {
+        return 0;
+    }
+
+    if (!data_dirs || data_dirs[0] == '\0') {
+        data_dirs = SESSION_DEFAULT_DATA_DIRS;
+    }
+
+    for (const char *p = data_dirs; *p && root_count < SESSION_MAX_DATA_DIRS; ) {
+        size_t len = strcspn(p, ":");
+        const char *next = p[len] ? p + len + 1 : p + len;
+
+        /* Relative roots are invalid per the XDG base directory spec */
+        while (len > 1 && p[len - 1] == '/') {
+            len--;
+        }
+        if (len == 0 || p[0] != '/' || len >= sizeof(roots[0])) {
+            p = next;
+            continue;
+        }
+
+        memcpy(roots[root_count], p, len);
+        roots[root_count][len] = '\0';
+
+        bool repeated = false;
+        for (int i = 0; i < root_count && !repeated; i++) {
+            repeated = strcmp(roots[i], roots[root_count]) == 0;
+        }
+        if (!repeated) {
+            root_count++;
+        }
+        p = next;
+    }
+
+    if (root_count == 0 && strcmp(data_dirs, SESSION_DEFAULT_DATA_DIRS) != 0) {
+        logger_log(LOG_WARN, "No usable XDG_DATA_DIRS entries, using %s",
+                   SESSION_DEFAULT_DATA_DIRS);
+        return session_dirs_from_data_dirs(NULL, dirs);
+    }
+
+    static const struct {
+        const char *subdir;
+        session_type_t type;
+    } kinds[] = {
+        { "xsessions", SESSION_X11 },
+        { "wayland-sessions", SESSION_WAYLAND }
+    };
+
+    for (int i = 0; i < root_count; i++) {
+        /* The root "/" must not produce "//xsessions" */
+        const char *root = strcmp(roots[i], "/") == 0 ? "" : roots[i];
+
+        for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++) {
+            size_t len = strlen(root) + 1 + strlen(kinds[k].subdir) + 1;
+            char *path = malloc(len);
+            if (!path) {
+                continue;
+            }
+            snprintf(path, len, "%s/%s", root, kinds[k].subdir);
+            dirs[count].path = path;
+            dirs[count].type = kinds[k].type;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+void session_dirs_free(session_dir_t *dirs, int dir_count) {
+    if (!dirs) {
+        return;
+    }
+
+    for (int i = 0; i < dir_count; i++) {
+        free((char *)dirs[i].path);
+        dirs[i].path = NULL;
+    }
+}
+
+const session_dir_t *session_default_dirs(int *dir_count) {
+    pthread_once(&default_session_dirs_once, build_default_dirs);
+
+    if (dir_count) {
+        *dir_count = default_session_dir_count;
+    }
+    return default_session_dirs;
+}
+
+int session_discover(session_list_t *list) {
+    int dir_count;
+    const session_dir_t *dirs = session_default_dirs(&dir_count);
+
+    return session_discover_in(list, dirs, dir_count, SESSION_CACHE_PATH);
+}
+
+/**
+ * Discover sessions, consulting the cache first when one is given
+ * The cache is tied to the PATH directories as well as the session
+ * directories, since sessions without an installed command are left out.
+ * The command resolution cache is only held while its directories are
+ * stamped and while entries are parsed, never across a directory read
+ */
+static int discover_with_path(session_list_t *list, const session_dir_t *dirs, int dir_count,
+                              const char *cache_path) {
+    session_dir_t *stamp_dirs = NULL;
+    session_dir_stamp_t *stamps = NULL;
+    int stamp_count = dir_count;
+    desktop_batch_t batch;
+    id_index_t index = {0};
+
+    if (cache_path) {
+        stamp_dirs = malloc((size_t)(dir_count + SESSION_PATH_MAX_DIRS) * sizeof(*stamp_dirs));
+    }
+    if (stamp_dirs) {
+        /* PATH directory names belong to the resolution cache, keep it held while in use */
+        memcpy(stamp_dirs, dirs, (size_t)dir_count * sizeof(*stamp_dirs));
+        stamp_count += session_path_dirs(exec_path_acquire(), stamp_dirs + dir_count);
+
+        /* Use the cached list as-is when no session or PATH directory has changed */
+        if (session_cache_load(cache_path, stamp_dirs, stamp_count, list) == KIA_SUCCESS) {
+            exec_path_release();
+            logger_log(LOG_INFO, "Loaded %d session(s) from cache", list->count);
+            free(stamp_dirs);
+            return KIA_SUCCESS;
+        }
+
+        /* Stamp directories before scanning so concurrent changes invalidate the cache */
+        stamps = calloc((size_t)stamp_count, sizeof(*stamps));
+        if (stamps) {
+            session_cache_stamp(stamp_dirs, stamp_count, stamps);
+        }
+        exec_path_release();
+        free(stamp_dirs);
+    }
+
+    desktop_batch_init(&batch, true);
+    for (int i = 0; i < dir_count; i++) {
+        if (scan_session_directory(dirs[i].path, dirs[i].type, i, &batch, &index,
+                                   list) != KIA_SUCCESS) {
+            desktop_batch_free(&batch);
+            id_index_free(&index);
+            free(stamps);
+            session_list_free(list);
+            return KIA_ERROR_SESSION;
+        }
+    }
+
+    desktop_batch_free(&batch);
+    id_index_free(&index);
+
+    if (list->count == 0) {
+        logger_log(LOG_ERROR, "No sessions discovered");
+        free(stamps);
+        session_list_free(list);
+        return KIA_ERROR_SESSION;
+    }
+
+    if (stamps) {
+        session_cache_store(cache_path, stamps, stamp_count, list);
+        free(stamps);
+    }
+
+    logger_log(LOG_INFO, "Discovered %d session(s)", list->count);
+    return KIA_SUCCESS;
+}
+
+int session_discover_in(session_list_t *list, const session_dir_t *dirs,
+                        int dir_count, const char *cache_path) {
+    if (!list) {
+        return KIA_ERROR_SESSION;
+    }
+
+    memset(list, 0, sizeof(*list));
+
+    if (!dirs || dir_count <= 0 || dir_count >= SESSION_DIR_NONE) {
+        return KIA_ERROR_SESSION;
+    }
+
+    return discover_with_path(list, dirs, dir_count, cache_path);
+}
+
+int session_list_add(session_list_t *list, const char *name, const char *exec,
+                     session_type_t type) {
+    /* Validate input parameters */
+    if (!list || !name || !exec || name[0] == '\0' || exec[0] == '\0') {
+        return KIA_ERROR_SESSION;
+    }
+
+    size_t name_len = strlen(name);
+    size_t exec_len = strlen(exec);
+    if (name_len > SESSION_MAX_FIELD_LEN || exec_len > SESSION_MAX_FIELD_LEN) {
+        return KIA_ERROR_SESSION;
+    }
+
+    if (list_reserve(list, name_len + 1 + exec_len + 1 + 1 + exec_len + 2 + 1) != KIA_SUCCESS) {
+        logger_log(LOG_ERROR, "Failed to allocate memory for session list: %s", strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+
+    char *dst = list->arena + list->arena_len;
+    memcpy(dst, name, name_len + 1);
+    memcpy(dst + name_len + 1, exec, exec_len + 1);
+    dst[name_len + 1 + exec_len + 1] = '\0';
+    size_t args_len = store_args(dst + name_len + 1 + exec_len + 2, exec, exec_len);
+    dst[name_len + 1 + exec_len + 2 + args_len] = '\0';  /* No desktop names */
+    list_commit(list, name_len, exec_len, 0, args_len + 1, type, SESSION_DIR_NONE);
+    return KIA_SUCCESS;
+}
+
+int session_list_load_file(session_list_t *list, const session_dir_t *dirs,
+                           int dir_idx, const char *file_id) {
+    char filepath[512];
+    desktop_buf_t buf = {0};
+
+    /* Validate input parameters */
+    if (!list || !dirs || dir_idx < 0 || dir_idx >= SESSION_DIR_NONE ||
+        !file_id || file_id[0] == '\0' || strchr(file_id, '/') != NULL) {
+        return KIA_ERROR_SESSION;
+    }
+
+    int path_len = snprintf(filepath, sizeof(filepath), "%s/%s", dirs[dir_idx].path, file_id);
+    if (path_len < 0 || (size_t)path_len >= sizeof(filepath)) {
+        logger_log(LOG_WARN, "Path too long for: %s/%s", dirs[dir_idx].path, file_id);
+        return KIA_ERROR_SESSION;
+    }
+
+    int existing = session_list_find_file(list, dirs[dir_idx].type, file_id);
+    int result = KIA_ERROR_SESSION;
+    if (desktop_buf_read(&buf, filepath) != KIA_SUCCESS) {
+        logger_log(LOG_WARN, "Failed to read desktop file: %s (%s)", filepath, strerror(errno));
+    } else {
+        session_path_t *exec_path = exec_path_acquire();
+        result = parse_desktop_file(dirs[dir_idx].path, file_id, buf.data, buf.len, exec_path,
+                                    list, dirs[dir_idx].type, dir_idx);
+        exec_path_release();
+    }
+    desktop_buf_free(&buf);
+
+    if (result != KIA_SUCCESS) {
+        if (existing >= 0) {
+            logger_log(LOG_INFO, "Session removed: %s", session_list_name(list, existing));
+            session_list_remove(list, existing);
+        }
+        return KIA_ERROR_SESSION;
+    }
+
+    if (existing >= 0) {
+        /* Move the freshly parsed record into the old one's slot */
+        list->arena_dead += record_span(list, &list->records[existing]);
+        list->records[existing] = list->records[--list->count];
+        list_maybe_compact(list);
+        logger_log(LOG_INFO, "Session updated: %s", session_list_name(list, existing));
+    } else {
+        logger_log(LOG_INFO, "Session added: %s", session_list_name(list, list->count - 1));
+    }
+
+    return KIA_SUCCESS;
+}
+
+int session_list_find_file(const session_list_t *list, session_type_t type, const char *file_id) {
+    if (!list || !list->records || !file_id || file_id[0] == '\0') {
+        return -1;
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        const session_record_t *record = &list->records[i];
+        if (record->type == type && strcmp(record_file(list, record), file_id) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+int session_list_resolve_file(session_list_t *list, const session_dir_t *dirs, int dir_count,
+                              session_type_t type, const char *file_id) {
+    char path[512];
+
+    /* Validate input parameters */
+    if (!list || !dirs || dir_count <= 0 || !file_id || file_id[0] == '\0') {
         return KIA_ERROR_SESSION;
     }
-    
-    /* Validate filepath length */
-    if (strlen(filepath) == 0) {
-        logger_log(LOG_ERROR, "Empty filepath provided");
-        return KIA_ERROR_SESSION;
+
+    int existing = session_list_find_file(list, type, file_id);
+    if (existing >= 0 && list->records[existing].dir != SESSION_DIR_NONE &&
+        list->records[existing].dir >= dir_count) {
+        return KIA_SUCCESS;  /* Shadowed by an overlay */
     }
-    
-    fp = fopen(filepath, "r");
-    if (!fp) {
-        logger_log(LOG_WARN, "Failed to open desktop file: %s (%s)", filepath, strerror(errno));
+
+    for (int i = 0; i < dir_count; i++) {
+        if (dirs[i].type != type) {
+            continue;
+        }
+        int len = snprintf(path, sizeof(path), "%s/%s", dirs[i].path, file_id);
+        if (len < 0 || (size_t)len >= sizeof(path) || access(path, F_OK) != 0) {
+            continue;
+        }
+        return session_list_load_file(list, dirs, i, file_id);
+    }
+
+    if (existing >= 0) {
+        logger_log(LOG_INFO, "Session removed: %s", session_list_name(list, existing));
+        session_list_remove(list, existing);
+    }
+    return KIA_ERROR_SESSION;
+}
+
+int session_list_merge(session_list_t *list, const session_list_t *overlay, int dir_base) {
+    int merged = 0;
+
+    /* Validate input parameters */
+    if (!list || !overlay || overlay == list || dir_base < 0 || dir_base >= SESSION_DIR_NONE) {
         return KIA_ERROR_SESSION;
     }
 
-    /* Initialize session structure */
-    memset(session->name, 0, sizeof(session->name));
-    memset(session->exec, 0, sizeof(session->exec));
+    for (int i = 0; i < overlay->count; i++) {
+        const session_record_t *record = &overlay->records[i];
+        const char *file = record_file(overlay, record);
+        size_t file_len = strlen(file);
+        size_t span = record_span(overlay, record);
+        int dir_idx = record->dir == SESSION_DIR_NONE ? SESSION_DIR_NONE : dir_base + record->dir;
 
-    while (fgets(line, sizeof(line), fp)) {
-        /* Check for line truncation */
-        size_t len = strlen(line);
-        if (len > 0 && line[len - 1] != '\n' && !feof(fp)) {
-            /* Line was truncated - skip rest of line */
-            int ch;
-            while ((ch = fgetc(fp)) != EOF && ch != '\n') {
-                /* Skip to end of line */
-            }
-            continue;
+        if (dir_idx > SESSION_DIR_NONE || list_reserve(list, span) != KIA_SUCCESS) {
+            return KIA_ERROR_SESSION;
         }
-        
-        /* Remove trailing newline */
-        line[strcspn(line, "\n")] = '\0';
-
-        /* Parse Name= field */
-        if (strncmp(line, "Name=", 5) == 0 && !found_name) {
-            size_t name_len = strlen(line + 5);
-            if (name_len > 0 && name_len < sizeof(session->name)) {
-                strncpy(session->name, line + 5, sizeof(session->name) - 1);
-                session->name[sizeof(session->name) - 1] = '\0';
-                found_name = 1;
-            }
+
+        int existing = session_list_find_file(list, (session_type_t)record->type, file);
+        memcpy(list->arena + list->arena_len, overlay->arena + record->name_off, span);
+        list_commit(list, record->name_len, record->exec_len, file_len,
+                    span - (record->name_len + 1u + record->exec_len + 1u + file_len + 1u),
+                    (session_type_t)record->type, dir_idx);
+
+        if (existing >= 0) {
+            list->arena_dead += record_span(list, &list->records[existing]);
+            list->records[existing] = list->records[--list->count];
         }
-        /* Parse Exec= field */
-        else if (strncmp(line, "Exec=", 5) == 0 && !found_exec) {
-            size_t exec_len = strlen(line + 5);
-            if (exec_len > 0 && exec_len < sizeof(session->exec)) {
-                strncpy(session->exec, line + 5, sizeof(session->exec) - 1);
-                session->exec[sizeof(session->exec) - 1] = '\0';
-                found_exec = 1;
-            }
+        merged++;
+    }
+
+    list_maybe_compact(list);
+    return merged;
+}
+
+int session_list_drop_overlay(session_list_t *list, const session_dir_t *dirs, int dir_count) {
+    char file_id[256];
+    int dropped = 0;
+
+    if (!list || !list->records) {
+        return 0;
+    }
+
+    for (int i = 0; i < list->count; ) {
+        const session_record_t *record = &list->records[i];
+        if (record->dir == SESSION_DIR_NONE || record->dir < dir_count) {
+            i++;
+            continue;
         }
 
-        if (found_name && found_exec) {
+        session_type_t type = (session_type_t)record->type;
+        strncpy(file_id, record_file(list, record), sizeof(file_id) - 1);
+        file_id[sizeof(file_id) - 1] = '\0';
+        if (session_list_remove(list, i) != KIA_SUCCESS) {
             break;
         }
+        dropped++;
+
+        /* Bring back the session the overlay shadowed, if any */
+        if (dirs && dir_count > 0 && file_id[0] != '\0') {
+            session_list_resolve_file(list, dirs, dir_count, type, file_id);
+        }
     }
-    
-    /* Check for read errors */
-    if (ferror(fp)) {
-        logger_log(LOG_ERROR, "Error reading desktop file: %s", filepath);
-        fclose(fp);
+
+    return dropped;
+}
+
+int session_list_remove(session_list_t *list, int idx) {
+    if (!list || !list->records || idx < 0 || idx >= list->count) {
+        return KIA_ERROR_SESSION;
+    }
+
+    if (list_make_writable(list) != KIA_SUCCESS) {
         return KIA_ERROR_SESSION;
     }
 
-    fclose(fp);
+    list->arena_dead += record_span(list, &list->records[idx]);
+    memmove(&list->records[idx], &list->records[idx + 1],
+            (size_t)(list->count - idx - 1) * sizeof(session_record_t));
+    list->count--;
+    list_maybe_compact(list);
 
-    if (!found_name || !found_exec) {
-        logger_log(LOG_WARN, "Incomplete desktop file: %s (name=%d, exec=%d)", 
-                   filepath, found_name, found_exec);
+    return KIA_SUCCESS;
+}
+
+int session_list_get(const session_list_t *list, int idx, session_info_t *info) {
+    if (!list || !info || !list->records || idx < 0 || idx >= list->count) {
         return KIA_ERROR_SESSION;
     }
 
-    session->type = type;
+    const session_record_t *record = &list->records[idx];
+    info->name = list->arena + record->name_off;
+    info->exec = list->arena + record->exec_off;
+    info->type = (session_type_t)record->type;
+    info->args = record_args(list, record);
+    info->argc = (unsigned char)info->args[0];
+    info->args++;
+    info->desktop_names = record_desktop_names(list, record);
     return KIA_SUCCESS;
 }
 
+const char *session_list_name(const session_list_t *list, int idx) {
+    if (!list || !list->records || idx < 0 || idx >= list->count) {
+        return NULL;
+    }
+    return list->arena + list->records[idx].name_off;
+}
+
+const char *session_list_exec(const session_list_t *list, int idx) {
+    if (!list || !list->records || idx < 0 || idx >= list->count) {
+        return NULL;
+    }
+    return list->arena + list->records[idx].exec_off;
+}
+
+const char *session_list_file(const session_list_t *list, int idx) {
+    if (!list || !list->records || idx < 0 || idx >= list->count) {
+        return NULL;
+    }
+    return record_file(list, &list->records[idx]);
+}
+
+session_type_t session_list_type(const session_list_t *list, int idx) {
+    return (session_type_t)list->records[idx].type;
+}
+
+void session_list_free(session_list_t *list) {
+    if (!list) {
+        return;
+    }
+
+    if (list->mapping) {
+        munmap(list->mapping, list->mapping_len);
+    } else {
+        free(list->records);
+        free(list->arena);
+    }
+    memset(list, 0, sizeof(*list));
+}
+
 /**
- * Scan a directory for .desktop files and add them to the session list
+ * Build the part of a session's environment that is the same for every
+ * launch
+ * Layered so later sources win: a few greeter variables, the user's
+ * identity, then whatever PAM modules exported
  */
-static int scan_session_directory(const char *dir_path, session_type_t type, 
-                                   session_info_t **sessions, int *count) {
-    DIR *dir;
-    struct dirent *entry;
-    
-    /* Validate input parameters */
-    if (dir_path == NULL || sessions == NULL || count == NULL) {
-        logger_log(LOG_ERROR, "Invalid parameters to scan_session_directory");
-        return KIA_ERROR_SESSION;
+static int build_base_env(session_env_t *env, const struct passwd *pw, const char *username,
+                          const char *const *pam_env) {
+    static const char *const passthrough[] = SESSION_ENV_PASSTHROUGH;
+
+    for (int i = 0; passthrough[i]; i++) {
+        const char *value = getenv(passthrough[i]);
+        if (value && session_env_set(env, passthrough[i], value) != KIA_SUCCESS) {
+            return KIA_ERROR_SESSION;
+        }
     }
-    
-    /* Validate count is not negative */
-    if (*count < 0) {
-        logger_log(LOG_ERROR, "Invalid session count: %d", *count);
+    if (!session_env_get(env, "PATH") &&
+        session_env_set(env, "PATH", SESSION_PATH_DEFAULT) != KIA_SUCCESS) {
         return KIA_ERROR_SESSION;
     }
-    
-    dir = opendir(dir_path);
-    if (!dir) {
-        logger_log(LOG_DEBUG, "Session directory not found: %s (%s)", dir_path, strerror(errno));
-        return KIA_SUCCESS;  /* Not an error if directory doesn't exist */
+
+    if (session_env_set(env, "HOME", pw->pw_dir) != KIA_SUCCESS ||
+        session_env_set(env, "USER", username) != KIA_SUCCESS ||
+        session_env_set(env, "LOGNAME", username) != KIA_SUCCESS ||
+        session_env_set(env, "SHELL", pw->pw_shell) != KIA_SUCCESS) {
+        return KIA_ERROR_SESSION;
     }
 
-    errno = 0;
-    while ((entry = readdir(dir)) != NULL) {
-        /* Skip non-.desktop files */
-        if (strstr(entry->d_name, ".desktop") == NULL) {
-            continue;
-        }
-        
-        /* Validate filename length */
-        size_t name_len = strlen(entry->d_name);
-        if (name_len == 0 || name_len > 255) {
-            logger_log(LOG_WARN, "Invalid filename length: %zu", name_len);
-            continue;
+    for (int i = 0; pam_env && pam_env[i]; i++) {
+        if (session_env_put(env, pam_env[i]) != KIA_SUCCESS) {
+            logger_log(LOG_WARN, "Ignoring malformed PAM environment entry");
         }
+    }
+    return KIA_SUCCESS;
+}
 
-        /* Build full path with bounds checking */
-        char filepath[512];
-        int path_len = snprintf(filepath, sizeof(filepath), "%s/%s", dir_path, entry->d_name);
-        if (path_len < 0 || (size_t)path_len >= sizeof(filepath)) {
-            logger_log(LOG_WARN, "Path too long for: %s/%s", dir_path, entry->d_name);
-            continue;
+/**
+ * Build the environment block of one launch: the plan's base environment,
+ * then the display variables of the session type and its desktop names,
+ * which win over it
+ */
+static int build_session_env(session_env_t *env, const session_plan_t *plan,
+                             const session_proc_t *proc) {
+    for (int i = 0; i < plan->env.count; i++) {
+        if (session_env_put(env, plan->env.vars[i]) != KIA_SUCCESS) {
+            return KIA_ERROR_SESSION;
         }
+    }
 
-        /* Allocate space for new session */
-        session_info_t *new_sessions = realloc(*sessions, 
-                                               sizeof(session_info_t) * (*count + 1));
-        if (!new_sessions) {
-            logger_log(LOG_ERROR, "Failed to allocate memory for session list: %s", strerror(errno));
-            closedir(dir);
+    if (plan->session.type == SESSION_X11) {
+        /* The server reports the display it serves; startx makes its own authority */
+        bool own_server = proc->xorg.pid > 0;
+        char display[16];
+        snprintf(display, sizeof(display), ":%d",
+                 own_server ? proc->xorg.display : proc->display.x_display);
+        if (session_env_set(env, "XDG_SESSION_TYPE", "x11") != KIA_SUCCESS ||
+            session_env_set(env, "DISPLAY", display) != KIA_SUCCESS ||
+            (own_server &&
+             session_env_set(env, "XAUTHORITY", proc->xorg.client_auth) != KIA_SUCCESS)) {
             return KIA_ERROR_SESSION;
         }
-        *sessions = new_sessions;
-
-        /* Parse desktop file */
-        if (parse_desktop_file(filepath, &(*sessions)[*count], type) == KIA_SUCCESS) {
-            logger_log(LOG_DEBUG, "Discovered session: %s (%s)", 
-                      (*sessions)[*count].name, 
-                      type == SESSION_X11 ? "X11" : "Wayland");
-            (*count)++;
+    } else {
+        if (session_env_set(env, "XDG_SESSION_TYPE", "wayland") != KIA_SUCCESS ||
+            session_env_set(env, "WAYLAND_DISPLAY", proc->display.wayland_display) != KIA_SUCCESS) {
+            return KIA_ERROR_SESSION;
         }
-        
-        errno = 0;
     }
-    
-    /* Check for readdir errors */
-    if (errno != 0) {
-        logger_log(LOG_ERROR, "Error reading directory %s: %s", dir_path, strerror(errno));
-        closedir(dir);
+
+    /* Lets toolkits and autostart entries pick the desktop's own settings */
+    const char *desktop_names = plan->session.desktop_names;
+    if (desktop_names && desktop_names[0] != '\0' &&
+        session_env_set(env, "XDG_CURRENT_DESKTOP", desktop_names) != KIA_SUCCESS) {
         return KIA_ERROR_SESSION;
     }
 
-    if (closedir(dir) != 0) {
-        logger_log(LOG_WARN, "Failed to close directory %s: %s", dir_path, strerror(errno));
+    if (proc->ready.session_fd >= 0) {
+        char fd[16];
+        snprintf(fd, sizeof(fd), "%d", proc->ready.session_fd);
+        if (session_env_set(env, SESSION_READY_ENV, fd) != KIA_SUCCESS) {
+            return KIA_ERROR_SESSION;
+        }
+    }
+
+    /* Names only: PAM modules may export tokens or credentials as values */
+    for (int i = 0; i < env->count; i++) {
+        logger_log(LOG_DEBUG, "Session environment: %.*s",
+                   (int)strcspn(env->vars[i], "="), env->vars[i]);
     }
-    
     return KIA_SUCCESS;
 }
 
-int session_discover(session_list_t *list) {
-    if (!list) {
-        return KIA_ERROR_SESSION;
+/**
+ * Look up the supplementary groups of a user
+ * @return Allocated group list, or NULL on error
+ */
+static gid_t *user_groups(const char *username, gid_t gid, int *count) {
+    int n = 32;
+    gid_t *groups = NULL;
+
+    for (;;) {
+        gid_t *grown = realloc(groups, (size_t)n * sizeof(*groups));
+        if (!grown) {
+            free(groups);
+            return NULL;
+        }
+        groups = grown;
+
+        int found = n;
+        if (getgrouplist(username, gid, groups, &found) >= 0) {
+            *count = found;
+            return groups;
+        }
+        /* found now holds the number of groups needed */
+        n = found > n ? found : n * 2;
     }
+}
 
-    list->sessions = NULL;
-    list->count = 0;
+/**
+ * Fill in the exec attempts of a session
+ * command holds the resolved path of the session command, or is empty to
+ * search PATH at exec time. startx is NULL to run the command itself, or
+ * the resolved path of startx (empty to search PATH) to wrap it, serving
+ * display. argv must hold DESKTOP_EXEC_MAX_ARGS + 1 entries and
+ * startx_argv DESKTOP_EXEC_MAX_ARGS + 4
+ */
+static void plan_session_execs(session_spawn_t *spawn, const session_info_t *session,
+                               const char *command, const char *startx, const char *display,
+                               const char **argv, const char **startx_argv) {
+    bool shell = session->argc <= 0 || session->argc > DESKTOP_EXEC_MAX_ARGS ||
+                 session->args == NULL;
+    int argc = 0;
 
-    /* Scan X11 sessions */
-    if (scan_session_directory(X11_SESSION_DIR, SESSION_X11, 
-                               &list->sessions, &list->count) != KIA_SUCCESS) {
-        session_list_free(list);
-        return KIA_ERROR_SESSION;
+    if (shell) {
+        /* Exec lines using shell syntax */
+        argv[argc++] = "sh";
+        argv[argc++] = "-c";
+        argv[argc++] = session->exec;
+    } else {
+        const char *arg = session->args;
+        for (int i = 0; i < session->argc; i++) {
+            argv[argc++] = arg;
+            arg += strlen(arg) + 1;
+        }
     }
+    argv[argc] = NULL;
 
-    /* Scan Wayland sessions */
-    if (scan_session_directory(WAYLAND_SESSION_DIR, SESSION_WAYLAND, 
-                               &list->sessions, &list->count) != KIA_SUCCESS) {
-        session_list_free(list);
-        return KIA_ERROR_SESSION;
+    if (startx) {
+        /* startx only takes an absolute path as the client to run */
+        int n = 0;
+        startx_argv[n++] = "startx";
+        startx_argv[n++] = shell ? "/bin/sh" : (command[0] != '\0' ? command : argv[0]);
+        for (int i = 1; i < argc; i++) {
+            startx_argv[n++] = argv[i];
+        }
+        startx_argv[n++] = "--";
+        startx_argv[n++] = display;
+        startx_argv[n] = NULL;
+        spawn->execs[spawn->exec_count++] =
+            (session_spawn_exec_t){ startx[0] ? startx : NULL, startx_argv };
+    }
+    if (shell) {
+        spawn->execs[spawn->exec_count++] = (session_spawn_exec_t){ "/bin/sh", argv };
+    } else {
+        spawn->execs[spawn->exec_count++] =
+            (session_spawn_exec_t){ command[0] ? command : NULL, argv };
     }
+}
 
-    if (list->count == 0) {
-        logger_log(LOG_ERROR, "No sessions discovered");
-        return KIA_ERROR_SESSION;
+/**
+ * Look up a variable in a pam_getenvlist() list
+ */
+static const char *pam_env_get(const char *const *pam_env, const char *name) {
+    size_t len = strlen(name);
+    for (int i = 0; pam_env && pam_env[i]; i++) {
+        if (strncmp(pam_env[i], name, len) == 0 && pam_env[i][len] == '=') {
+            return pam_env[i] + len + 1;
+        }
     }
+    return NULL;
+}
 
-    logger_log(LOG_INFO, "Discovered %d session(s)", list->count);
-    return KIA_SUCCESS;
+/**
+ * Undo a launch that failed after its display was allocated
+ */
+static int abort_launch(session_proc_t *proc) {
+    session_xorg_stop(&proc->xorg);
+    session_end(proc);
+    return KIA_ERROR_SESSION;
 }
 
-void session_list_free(session_list_t *list) {
-    if (list && list->sessions) {
-        free(list->sessions);
-        list->sessions = NULL;
-        list->count = 0;
+/**
+ * Resolve the session command, X server and startx on the session's PATH,
+ * so the child can execute them directly
+ * The shared cache is built from the greeter's PATH; a session with a PATH
+ * of its own, e.g. from pam_env, is resolved on that instead
+ */
+static void plan_resolve_commands(session_plan_t *plan, const session_info_t *session) {
+    const char *search_path = session_env_get(&plan->env, "PATH");
+    const char *own_path = getenv("PATH");
+    session_path_t session_path;
+    session_path_t *cache = NULL;
+
+    if (!own_path || own_path[0] == '\0') {
+        own_path = SESSION_PATH_DEFAULT;
+    }
+    bool shared = !search_path || strcmp(search_path, own_path) == 0;
+    if (shared) {
+        cache = exec_path_acquire();
+    } else if (session_path_init(&session_path, search_path) == KIA_SUCCESS) {
+        cache = &session_path;
+    }
+
+    if (cache) {
+        if (session->argc > 0 && session->args != NULL &&
+            session_path_find(cache, session->args, plan->command,
+                              sizeof(plan->command)) != KIA_SUCCESS) {
+            plan->command[0] = '\0';
+        }
+        if (session->type == SESSION_X11 &&
+            session_path_find(cache, SESSION_XORG_SERVER, plan->server,
+                              sizeof(plan->server)) != KIA_SUCCESS) {
+            plan->server[0] = '\0';
+        }
+        if (session->type == SESSION_X11 && plan->server[0] == '\0' &&
+            session_path_find(cache, "startx", plan->startx,
+                              sizeof(plan->startx)) != KIA_SUCCESS) {
+            plan->startx[0] = '\0';
+        }
+    }
+
+    if (shared) {
+        exec_path_release();
+    } else if (cache) {
+        session_path_free(cache);
+    }
+}
+
+/**
+ * Length of the tokenised arguments of a session, terminators included
+ */
+static size_t args_span(const session_info_t *session) {
+    size_t len = 0;
+    if (session->argc <= 0 || session->args == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < session->argc; i++) {
+        len += strlen(session->args + len) + 1;
     }
+    return len;
 }
 
-int session_start(const session_info_t *session, const char *username) {
+int session_plan_prepare(session_plan_t *plan, const session_info_t *session,
+                         const char *username, const char *const *pam_env) {
     struct passwd *pw;
-    pid_t pid;
-    int status;
     
     /* Validate input parameters */
-    if (!session || !username) {
+    if (!plan || !session || !username) {
         logger_log(LOG_ERROR, "Invalid session or username");
         return KIA_ERROR_SESSION;
     }
+    memset(plan, 0, sizeof(*plan));
     
     /* Validate username is not empty */
     if (username[0] == '\0') {
@@ -243,7 +1310,8 @@ int session_start(const session_info_t *session, const char *username) {
     }
     
     /* Validate session name and exec are not empty */
-    if (session->name[0] == '\0' || session->exec[0] == '\0') {
+    if (!session->name || !session->exec ||
+        session->name[0] == '\0' || session->exec[0] == '\0') {
         logger_log(LOG_ERROR, "Invalid session: empty name or exec");
         return KIA_ERROR_SESSION;
     }
@@ -271,105 +1339,271 @@ int session_start(const session_info_t *session, const char *username) {
         pw->pw_shell = "/bin/sh";
     }
 
-    logger_log(LOG_INFO, "Starting %s session '%s' for user '%s'",
-              session->type == SESSION_X11 ? "X11" : "Wayland",
-              session->name, username);
+    /* The plan owns copies of its strings, so the session list may change under it */
+    size_t name_len = strlen(session->name) + 1;
+    size_t exec_len = strlen(session->exec) + 1;
+    size_t args_len = args_span(session);
+    size_t names_len = session->desktop_names ? strlen(session->desktop_names) + 1 : 0;
+    size_t user_len = strlen(username) + 1;
+    size_t home_len = strlen(pw->pw_dir) + 1;
+    plan->strings = malloc(name_len + exec_len + args_len + names_len + user_len + home_len);
+    if (!plan->strings) {
+        logger_log(LOG_ERROR, "Failed to allocate launch plan");
+        return KIA_ERROR_SESSION;
+    }
+    char *p = plan->strings;
+    plan->session = *session;
+    plan->session.name = memcpy(p, session->name, name_len);
+    p += name_len;
+    plan->session.exec = memcpy(p, session->exec, exec_len);
+    p += exec_len;
+    plan->session.args = args_len > 0 ? memcpy(p, session->args, args_len) : NULL;
+    p += args_len;
+    plan->session.desktop_names = names_len > 0 ? memcpy(p, session->desktop_names, names_len)
+                                                : NULL;
+    p += names_len;
+    plan->username = memcpy(p, username, user_len);
+    p += user_len;
+    plan->home = memcpy(p, pw->pw_dir, home_len);
+    plan->uid = pw->pw_uid;
+    plan->gid = pw->pw_gid;
 
-    pid = fork();
-    if (pid < 0) {
-        logger_log(LOG_ERROR, "Failed to fork: %s", strerror(errno));
+    plan->groups = user_groups(username, pw->pw_gid, &plan->group_count);
+    if (!plan->groups) {
+        logger_log(LOG_ERROR, "Failed to get groups of user '%s'", username);
+        session_plan_free(plan);
+        return KIA_ERROR_SESSION;
+    }
+    if (build_base_env(&plan->env, pw, username, pam_env) != KIA_SUCCESS) {
+        logger_log(LOG_ERROR, "Failed to build session environment");
+        session_plan_free(plan);
         return KIA_ERROR_SESSION;
     }
 
-    if (pid == 0) {
-        /* Child process */
-        
-        /* Set environment variables with error checking */
-        if (setenv("HOME", pw->pw_dir, 1) != 0) {
-            logger_log(LOG_ERROR, "Failed to set HOME: %s", strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        
-        if (setenv("USER", username, 1) != 0) {
-            logger_log(LOG_ERROR, "Failed to set USER: %s", strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        
-        if (setenv("LOGNAME", username, 1) != 0) {
-            logger_log(LOG_ERROR, "Failed to set LOGNAME: %s", strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        
-        if (setenv("SHELL", pw->pw_shell, 1) != 0) {
-            logger_log(LOG_ERROR, "Failed to set SHELL: %s", strerror(errno));
-            exit(EXIT_FAILURE);
+    const char *runtime_dir = pam_env_get(pam_env, "XDG_RUNTIME_DIR");
+    if (runtime_dir) {
+        snprintf(plan->runtime_dir, sizeof(plan->runtime_dir), "%s", runtime_dir);
+    } else {
+        snprintf(plan->runtime_dir, sizeof(plan->runtime_dir), "/run/user/%u",
+                 (unsigned)pw->pw_uid);
+    }
+
+    plan_resolve_commands(plan, session);
+
+    /* Output goes to a bounded file rather than over the greeter's terminal */
+    if (strchr(username, '/') == NULL && username[0] != '.') {
+        int len = snprintf(plan->output_path, sizeof(plan->output_path), "%s/%s.log",
+                           output_dir, username);
+        if (len < 0 || (size_t)len >= sizeof(plan->output_path)) {
+            plan->output_path[0] = '\0';
         }
-        
-        if (session->type == SESSION_X11) {
-            if (setenv("XDG_SESSION_TYPE", "x11", 1) != 0 ||
-                setenv("DISPLAY", ":0", 1) != 0) {
-                logger_log(LOG_ERROR, "Failed to set X11 environment: %s", strerror(errno));
-                exit(EXIT_FAILURE);
+    }
+    return KIA_SUCCESS;
+}
+
+void session_plan_free(session_plan_t *plan) {
+    if (!plan) {
+        return;
+    }
+    session_env_free(&plan->env);
+    free(plan->groups);
+    free(plan->strings);
+    memset(plan, 0, sizeof(*plan));
+}
+
+int session_launch_plan(const session_plan_t *plan, session_proc_t *proc) {
+    /* Validate input parameters */
+    if (!plan || !plan->strings || !proc) {
+        logger_log(LOG_ERROR, "Invalid launch plan");
+        return KIA_ERROR_SESSION;
+    }
+    const session_info_t *session = &plan->session;
+
+    logger_log(LOG_INFO, "Starting %s session '%s' for user '%s'",
+              session->type == SESSION_X11 ? "X11" : "Wayland",
+              session->name, plan->username);
+
+    bool use_startx = false;
+    memset(proc, 0, sizeof(*proc));
+    proc->xorg.display = -1;
+    session_display_init(&proc->display);
+    session_ready_init(&proc->ready);
+    session_output_init(&proc->output);
+
+    /* Every session gets a display or socket name no other session uses */
+    int allocated;
+    if (session->type == SESSION_X11) {
+        allocated = session_display_alloc_x(&proc->display, state_dir,
+                                            SESSION_DISPLAY_X_LOCK_DIR);
+    } else {
+        allocated = session_display_alloc_wayland(&proc->display, state_dir,
+                                                  plan->runtime_dir);
+    }
+    if (allocated != KIA_SUCCESS) {
+        logger_log(LOG_ERROR, "No display available for session '%s'", session->name);
+        return abort_launch(proc);
+    }
+
+    /* X11 sessions get a server of their own, started and waited for here */
+    if (session->type == SESSION_X11) {
+        if (plan->server[0] != '\0') {
+            if (session_xorg_start(&proc->xorg, plan->server, state_dir,
+                                   proc->display.x_display,
+                                   SESSION_XORG_READY_TIMEOUT_MS) != KIA_SUCCESS ||
+                session_xorg_grant(&proc->xorg, plan->uid, plan->gid) != KIA_SUCCESS) {
+                logger_log(LOG_ERROR, "Failed to start X server for session '%s'", session->name);
+                return abort_launch(proc);
             }
         } else {
-            if (setenv("XDG_SESSION_TYPE", "wayland", 1) != 0 ||
-                setenv("WAYLAND_DISPLAY", "wayland-0", 1) != 0) {
-                logger_log(LOG_ERROR, "Failed to set Wayland environment: %s", strerror(errno));
-                exit(EXIT_FAILURE);
-            }
+            logger_log(LOG_WARN, "%s not found, starting session through startx",
+                       SESSION_XORG_SERVER);
+            use_startx = true;
         }
+    }
 
-        /* Change to user's home directory */
-        if (chdir(pw->pw_dir) != 0) {
-            logger_log(LOG_ERROR, "Failed to change to home directory '%s': %s", 
-                      pw->pw_dir, strerror(errno));
-            exit(EXIT_FAILURE);
-        }
+    /* Opened after the X server started, so only the session inherits it */
+    if (session_ready_open(&proc->ready) != KIA_SUCCESS) {
+        logger_log(LOG_WARN, "Session '%s' runs without a readiness pipe", session->name);
+    }
+    if (session_output_open(&proc->output,
+                            plan->output_path[0] ? plan->output_path : NULL) != KIA_SUCCESS) {
+        logger_log(LOG_WARN, "Session '%s' writes its output to the terminal", session->name);
+    }
 
-        /* Drop privileges - order matters! */
-        if (setgid(pw->pw_gid) != 0) {
-            logger_log(LOG_ERROR, "Failed to setgid(%d): %s", pw->pw_gid, strerror(errno));
-            exit(EXIT_FAILURE);
-        }
+    /* Everything the child needs is prepared here; it only switches user and execs */
+    session_env_t env = {0};
+    const char *argv[DESKTOP_EXEC_MAX_ARGS + 1];
+    const char *startx_argv[DESKTOP_EXEC_MAX_ARGS + 4];
+    char x_display[16];
+    session_spawn_t spawn = {
+        .dir = plan->home,
+        .set_ids = true,
+        .uid = plan->uid,
+        .gid = plan->gid,
+        .groups = plan->groups,
+        .group_count = plan->group_count,
+        .redirect_output = proc->output.session_fd >= 0,
+        .output_fd = proc->output.session_fd,
+        .new_group = true,
+    };
 
-        if (setuid(pw->pw_uid) != 0) {
-            logger_log(LOG_ERROR, "Failed to setuid(%d): %s", pw->pw_uid, strerror(errno));
-            exit(EXIT_FAILURE);
-        }
+    if (build_session_env(&env, plan, proc) != KIA_SUCCESS) {
+        logger_log(LOG_ERROR, "Failed to build session environment");
+        session_env_free(&env);
+        return abort_launch(proc);
+    }
+    spawn.envp = session_env_block(&env);
+    snprintf(x_display, sizeof(x_display), ":%d", proc->display.x_display);
+    plan_session_execs(&spawn, session, plan->command, use_startx ? plan->startx : NULL, x_display,
+                       argv, startx_argv);
 
-        /* Verify privilege drop - critical security check */
-        if (getuid() != pw->pw_uid || geteuid() != pw->pw_uid ||
-            getgid() != pw->pw_gid || getegid() != pw->pw_gid) {
-            logger_log(LOG_ERROR, "Failed to drop privileges properly (uid=%d/%d, gid=%d/%d)",
-                      getuid(), geteuid(), getgid(), getegid());
-            exit(EXIT_FAILURE);
+    clock_gettime(CLOCK_MONOTONIC, &proc->spawn_start);
+    int result = session_spawn(&spawn, &proc->pid);
+    session_env_free(&env);
+    if (result != KIA_SUCCESS) {
+        logger_log(LOG_ERROR, "Failed to start session '%s'", session->exec);
+        return abort_launch(proc);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &proc->exec_done);
+    session_ready_close_session(&proc->ready);
+    session_output_close_session(&proc->output);
+
+    logger_log(LOG_INFO, "Session started with PID %d", proc->pid);
+    return KIA_SUCCESS;
+}
+
+int session_launch(const session_info_t *session, const char *username,
+                   const char *const *pam_env, session_proc_t *proc) {
+    session_plan_t plan;
+
+    /* Validate input parameters */
+    if (!proc) {
+        logger_log(LOG_ERROR, "Invalid session process");
+        return KIA_ERROR_SESSION;
+    }
+    if (session_plan_prepare(&plan, session, username, pam_env) != KIA_SUCCESS) {
+        return KIA_ERROR_SESSION;
+    }
+    int result = session_launch_plan(&plan, proc);
+    session_plan_free(&plan);
+    return result;
+}
+
+pid_t session_wait(session_proc_t *proc, int *status, struct rusage *ru) {
+    /* Validate input parameters */
+    if (!proc || !status || !ru) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (;;) {
+        /* Once the pipe is closed there is nothing left to drain */
+        int options = proc->output.fd >= 0 ? WNOHANG : 0;
+        pid_t result = wait4(proc->pid, status, options, ru);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result != 0) {
+            return result;
         }
 
-        /* Execute session */
-        if (session->type == SESSION_X11) {
-            /* Try startx first, fall back to direct execution */
-            execlp("startx", "startx", session->exec, NULL);
-            /* If startx fails, try direct execution */
-            execlp("/bin/sh", "sh", "-c", session->exec, NULL);
+        /* Look for the exit at least every 100 ms while the session is quiet */
+        struct pollfd pfd = { .fd = proc->output.fd, .events = POLLIN };
+        int timeout = session_output_flush_timeout(&proc->output);
+        if (timeout < 0 || timeout > 100) {
+            timeout = 100;
+        }
+        if (poll(&pfd, 1, timeout) > 0) {
+            session_output_drain(&proc->output);
         } else {
-            /* Wayland: direct compositor execution */
-            execlp("/bin/sh", "sh", "-c", session->exec, NULL);
+            session_output_flush(&proc->output, false);
         }
+    }
+}
 
-        /* If we get here, exec failed */
-        logger_log(LOG_ERROR, "Failed to execute session '%s': %s", session->exec, strerror(errno));
-        exit(EXIT_FAILURE);
+void session_end(session_proc_t *proc) {
+    if (!proc) {
+        return;
+    }
+    /* A supervised X server was reaped without session_xorg_stop() */
+    session_group_untrack(proc->xorg.pid);
+    session_xorg_remove_auth(&proc->xorg);
+    session_display_release(&proc->display);
+    session_ready_close(&proc->ready);
+    session_output_close(&proc->output);
+}
+
+int session_start(const session_info_t *session, const char *username,
+                  const char *const *pam_env) {
+    session_proc_t proc;
+    int status;
+
+    if (session_launch(session, username, pam_env, &proc) != KIA_SUCCESS) {
+        return KIA_ERROR_SESSION;
     }
 
-    /* Parent process */
-    logger_log(LOG_INFO, "Session started with PID %d", pid);
-    
     /* Wait for child to prevent zombie processes */
-    pid_t wait_result = waitpid(pid, &status, 0);
+    struct rusage ru;
+    pid_t wait_result = session_wait(&proc, &status, &ru);
+
+    /* Nothing the session started outlives it, nor does the X server */
+    session_group_stop(proc.pid, SESSION_GROUP_STOP_TIMEOUT_MS);
+    session_xorg_stop(&proc.xorg);
+
     if (wait_result < 0) {
         logger_log(LOG_ERROR, "Failed to wait for child process: %s", strerror(errno));
+        session_end(&proc);
         return KIA_ERROR_SESSION;
     }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        session_output_drain(&proc.output);
+        session_output_log_tail(&proc.output, SESSION_OUTPUT_LOG_TAIL);
+    }
+    session_end(&proc);
+
+    session_usage_t usage;
+    session_usage_from_rusage(&usage, &ru);
+    session_usage_log(&usage, session->name, proc.pid);
     
     if (WIFEXITED(status)) {
         int exit_status = WEXITSTATUS(status);
@@ -0,0 +1,191 @@
+#define _GNU_SOURCE
+#include "session_backoff.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+double session_backoff_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void session_backoff_init(session_backoff_t *backoff, const char *path) {
+    if (!backoff) {
+        return;
+    }
+    memset(backoff, 0, sizeof(*backoff));
+    backoff->path = path;
+}
+
+/**
+ * Drop failures that fell out of the window
+ */
+static void expire(session_backoff_t *backoff, double now) {
+    int first = 0;
+    while (first < backoff->count && backoff->failures[first] < now - SESSION_BACKOFF_WINDOW_S) {
+        first++;
+    }
+    if (first > 0) {
+        memmove(backoff->failures, backoff->failures + first,
+                (size_t)(backoff->count - first) * sizeof(backoff->failures[0]));
+        backoff->count -= first;
+    }
+}
+
+int session_backoff_load(session_backoff_t *backoff, double now) {
+    double failure;
+
+    /* Validate input parameters */
+    if (!backoff) {
+        return KIA_ERROR_SESSION;
+    }
+
+    backoff->count = 0;
+    if (!backoff->path) {
+        return KIA_SUCCESS;
+    }
+    FILE *fp = fopen(backoff->path, "re");
+    if (!fp) {
+        return KIA_SUCCESS;
+    }
+
+    /* One failure time per line, oldest first; times well ahead of now are from another boot */
+    while (fscanf(fp, "%lf", &failure) == 1) {
+        if (failure > now + 1) {
+            continue;
+        }
+        if (backoff->count == SESSION_BACKOFF_MAX_FAILURES) {
+            memmove(backoff->failures, backoff->failures + 1,
+                    (size_t)(backoff->count - 1) * sizeof(backoff->failures[0]));
+            backoff->count--;
+        }
+        backoff->failures[backoff->count++] = failure;
+    }
+    fclose(fp);
+
+    expire(backoff, now);
+    return KIA_SUCCESS;
+}
+
+/**
+ * Write the history to its file, replacing it atomically
+ */
+static int save(const session_backoff_t *backoff) {
+    char dir[512], tmp_path[600];
+
+    if (!backoff->path) {
+        return KIA_SUCCESS;
+    }
+
+    const char *slash = strrchr(backoff->path, '/');
+    if (slash && slash != backoff->path && (size_t)(slash - backoff->path) < sizeof(dir)) {
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - backoff->path), backoff->path);
+        if (mkdir(dir, 0711) != 0 && errno != EEXIST) {
+            logger_log(LOG_WARN, "Failed to create %s: %s", dir, strerror(errno));
+            return KIA_ERROR_SESSION;
+        }
+    }
+
+    int len = snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", backoff->path);
+    if (len < 0 || (size_t)len >= sizeof(tmp_path)) {
+        return KIA_ERROR_SESSION;
+    }
+    int fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        logger_log(LOG_WARN, "Failed to create %s: %s", tmp_path, strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+    FILE *fp = fdopen(fd, "w");
+    if (!fp) {
+        close(fd);
+        unlink(tmp_path);
+        return KIA_ERROR_SESSION;
+    }
+    for (int i = 0; i < backoff->count; i++) {
+        fprintf(fp, "%.3f\n", backoff->failures[i]);
+    }
+    if (fclose(fp) != 0 || rename(tmp_path, backoff->path) != 0) {
+        logger_log(LOG_WARN, "Failed to save session failures to %s: %s", backoff->path,
+                   strerror(errno));
+        unlink(tmp_path);
+        return KIA_ERROR_SESSION;
+    }
+    return KIA_SUCCESS;
+}
+
+int session_backoff_record(session_backoff_t *backoff, double now) {
+    /* Validate input parameters */
+    if (!backoff) {
+        return KIA_ERROR_SESSION;
+    }
+
+    expire(backoff, now);
+    if (backoff->count == SESSION_BACKOFF_MAX_FAILURES) {
+        memmove(backoff->failures, backoff->failures + 1,
+                (size_t)(backoff->count - 1) * sizeof(backoff->failures[0]));
+        backoff->count--;
+    }
+    backoff->failures[backoff->count++] = now;
+
+    logger_log(LOG_WARN, "Session failed (%d failure(s) in the last %d s)",
+               backoff->count, SESSION_BACKOFF_WINDOW_S);
+    return save(backoff);
+}
+
+void session_backoff_reset(session_backoff_t *backoff) {
+    if (!backoff || backoff->count == 0) {
+        return;
+    }
+    backoff->count = 0;
+    if (backoff->path && unlink(backoff->path) != 0 && errno != ENOENT) {
+        logger_log(LOG_WARN, "Failed to remove %s: %s", backoff->path, strerror(errno));
+    }
+}
+
+/**
+ * Number of failures within the window
+ */
+static int recent_failures(const session_backoff_t *backoff, double now) {
+    int recent = 0;
+    for (int i = 0; i < backoff->count; i++) {
+        if (backoff->failures[i] >= now - SESSION_BACKOFF_WINDOW_S) {
+            recent++;
+        }
+    }
+    return recent;
+}
+
+bool session_backoff_exhausted(const session_backoff_t *backoff, double now) {
+    if (!backoff) {
+        return false;
+    }
+    return recent_failures(backoff, now) >= SESSION_BACKOFF_MAX_FAILURES;
+}
+
+double session_backoff_remaining(const session_backoff_t *backoff, double now) {
+    if (!backoff) {
+        return 0;
+    }
+    int recent = recent_failures(backoff, now);
+    if (recent == 0) {
+        return 0;
+    }
+
+    double delay = SESSION_BACKOFF_BASE_S;
+    for (int i = 1; i < recent && delay < SESSION_BACKOFF_MAX_S; i++) {
+        delay *= 2;
+    }
+    if (delay > SESSION_BACKOFF_MAX_S) {
+        delay = SESSION_BACKOFF_MAX_S;
+    }
+
+    double remaining = backoff->failures[backoff->count - 1] + delay - now;
+    return remaining > 0 ? remaining : 0;
+}
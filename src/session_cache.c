@@ -0,0 +1,308 @@
+#include "session_cache.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define CACHE_MAGIC 0x5341494bu  /* "KIAS" */
+#define CACHE_VERSION 6
+#define CACHE_MAX_SESSIONS 4096
+#define CACHE_MAX_DIRS 256
+
+/* On-disk header, followed by the directory stamps, session records and string arena */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dir_count;
+    uint32_t session_count;
+    uint32_t record_size;
+    uint32_t arena_len;
+} cache_header_t;
+
+/**
+ * FNV-1a hash of a directory path and its session type
+ */
+static uint32_t hash_dir(const session_dir_t *dir) {
+    uint32_t hash = 2166136261u;
+
+    for (const unsigned char *p = (const unsigned char *)dir->path; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    hash ^= (uint32_t)dir->type;
+    hash *= 16777619u;
+
+    return hash;
+}
+
+/**
+ * Write a buffer completely, retrying on short writes and EINTR
+ */
+static int write_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+
+    while (len > 0) {
+        ssize_t written = write(fd, p, len);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += written;
+        len -= (size_t)written;
+    }
+
+    return 0;
+}
+
+/**
+ * Create the parent directory of the cache file if it does not exist
+ */
+static void ensure_parent_dir(const char *path) {
+    char dir[512];
+
+    if (strlen(path) >= sizeof(dir)) {
+        return;
+    }
+    strcpy(dir, path);
+
+    char *slash = strrchr(dir, '/');
+    if (slash == NULL || slash == dir) {
+        return;
+    }
+    *slash = '\0';
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        logger_log(LOG_DEBUG, "Failed to create cache directory %s: %s", dir, strerror(errno));
+    }
+}
+
+/**
+ * Check that a mapped string lies inside the arena and is terminated
+ */
+static bool string_is_valid(const char *arena, uint32_t arena_len,
+                            uint32_t off, uint16_t len) {
+    if (len == 0 || off >= arena_len || len >= arena_len - off) {
+        return false;
+    }
+    return arena[off + len] == '\0' && memchr(arena + off, '\0', len) == NULL;
+}
+
+/**
+ * Check that a mapped record is well formed before it is handed out
+ */
+static bool record_is_valid(const session_record_t *record, uint32_t dir_count,
+                            const char *arena, uint32_t arena_len) {
+    if (!string_is_valid(arena, arena_len, record->name_off, record->name_len) ||
+        !string_is_valid(arena, arena_len, record->exec_off, record->exec_len)) {
+        return false;
+    }
+
+    /* The desktop file ID follows the exec string and may be empty */
+    uint32_t file_off = record->exec_off + record->exec_len + 1;
+    const char *end = file_off < arena_len ?
+                      memchr(arena + file_off, '\0', arena_len - file_off) : NULL;
+    if (end == NULL) {
+        return false;
+    }
+
+    /* Then the argument count and arguments of the tokenised Exec line */
+    uint32_t off = (uint32_t)(end - arena) + 1;
+    if (off >= arena_len) {
+        return false;
+    }
+    int argc = (unsigned char)arena[off++];
+    for (int i = 0; i <= argc; i++) {
+        /* The last string is the desktop names, which may be empty */
+        end = off < arena_len ? memchr(arena + off, '\0', arena_len - off) : NULL;
+        if (end == NULL) {
+            return false;
+        }
+        off = (uint32_t)(end - arena) + 1;
+    }
+
+    if (record->dir >= dir_count && record->dir != SESSION_DIR_NONE) {
+        return false;
+    }
+    return record->type == SESSION_X11 || record->type == SESSION_WAYLAND;
+}
+
+void session_cache_stamp(const session_dir_t *dirs, int dir_count,
+                         session_dir_stamp_t *stamps) {
+    struct stat st;
+
+    if (dirs == NULL || stamps == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < dir_count; i++) {
+        memset(&stamps[i], 0, sizeof(stamps[i]));
+        stamps[i].path_hash = hash_dir(&dirs[i]);
+
+        if (stat(dirs[i].path, &st) == 0) {
+            stamps[i].dev = (uint64_t)st.st_dev;
+            stamps[i].ino = (uint64_t)st.st_ino;
+            stamps[i].mtime_sec = (int64_t)st.st_mtim.tv_sec;
+            stamps[i].mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+            stamps[i].present = 1;
+        }
+    }
+}
+
+int session_cache_load(const char *path, const session_dir_t *dirs,
+                       int dir_count, session_list_t *list) {
+    struct stat st;
+
+    /* Validate input parameters */
+    if (path == NULL || list == NULL || dirs == NULL ||
+        dir_count <= 0 || dir_count > CACHE_MAX_DIRS) {
+        return KIA_ERROR_SESSION;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        logger_log(LOG_DEBUG, "Session cache not available: %s (%s)", path, strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(cache_header_t)) {
+        close(fd);
+        return KIA_ERROR_SESSION;
+    }
+
+    size_t map_len = (size_t)st.st_size;
+    void *map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        logger_log(LOG_WARN, "Failed to map session cache %s: %s", path, strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+
+    const cache_header_t *header = map;
+    size_t stamps_off = sizeof(cache_header_t);
+    size_t records_off = stamps_off + (size_t)dir_count * sizeof(session_dir_stamp_t);
+    size_t arena_off = records_off + (size_t)header->session_count * sizeof(session_record_t);
+
+    if (header->magic != CACHE_MAGIC || header->version != CACHE_VERSION ||
+        header->record_size != sizeof(session_record_t) ||
+        header->dir_count != (uint32_t)dir_count ||
+        header->session_count == 0 || header->session_count > CACHE_MAX_SESSIONS ||
+        map_len != arena_off + header->arena_len) {
+        logger_log(LOG_DEBUG, "Session cache %s has an incompatible layout", path);
+        munmap(map, map_len);
+        return KIA_ERROR_SESSION;
+    }
+
+    /* Compare stored directory stamps against the directories on disk */
+    session_dir_stamp_t current[CACHE_MAX_DIRS];
+    const session_dir_stamp_t *stored =
+        (const session_dir_stamp_t *)((const char *)map + stamps_off);
+    session_cache_stamp(dirs, dir_count, current);
+
+    for (int i = 0; i < dir_count; i++) {
+        if (stored[i].path_hash != current[i].path_hash ||
+            stored[i].present != current[i].present ||
+            stored[i].dev != current[i].dev ||
+            stored[i].ino != current[i].ino ||
+            stored[i].mtime_sec != current[i].mtime_sec ||
+            stored[i].mtime_nsec != current[i].mtime_nsec) {
+            logger_log(LOG_DEBUG, "Session cache is stale: %s changed", dirs[i].path);
+            munmap(map, map_len);
+            return KIA_ERROR_SESSION;
+        }
+    }
+
+    session_record_t *records = (session_record_t *)((char *)map + records_off);
+    char *arena = (char *)map + arena_off;
+    for (uint32_t i = 0; i < header->session_count; i++) {
+        if (!record_is_valid(&records[i], header->dir_count, arena, header->arena_len)) {
+            logger_log(LOG_WARN, "Session cache %s contains a corrupt record", path);
+            munmap(map, map_len);
+            return KIA_ERROR_SESSION;
+        }
+    }
+
+    list->records = records;
+    list->count = (int)header->session_count;
+    list->capacity = 0;
+    list->arena = arena;
+    list->arena_len = header->arena_len;
+    list->arena_cap = 0;
+    list->mapping = map;
+    list->mapping_len = map_len;
+
+    return KIA_SUCCESS;
+}
+
+int session_cache_store(const char *path, const session_dir_stamp_t *stamps,
+                        int dir_count, const session_list_t *list) {
+    char tmp_path[512];
+
+    /* Validate input parameters */
+    if (path == NULL || stamps == NULL || list == NULL || list->records == NULL ||
+        dir_count <= 0 || dir_count > CACHE_MAX_DIRS ||
+        list->count <= 0 || list->count > CACHE_MAX_SESSIONS ||
+        list->arena_len > UINT32_MAX) {
+        return KIA_ERROR_SESSION;
+    }
+
+    /* Refuse to cache directories whose mtime cannot yet be trusted */
+    time_t now = time(NULL);
+    for (int i = 0; i < dir_count; i++) {
+        if (stamps[i].present && stamps[i].mtime_sec >= (int64_t)now - 1) {
+            logger_log(LOG_DEBUG, "Session directory modified too recently, not caching");
+            return KIA_ERROR_SESSION;
+        }
+    }
+
+    int len = snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", path);
+    if (len < 0 || (size_t)len >= sizeof(tmp_path)) {
+        return KIA_ERROR_SESSION;
+    }
+
+    ensure_parent_dir(path);
+
+    int fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        logger_log(LOG_WARN, "Failed to create session cache %s: %s", tmp_path, strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+
+    cache_header_t header = {
+        .magic = CACHE_MAGIC,
+        .version = CACHE_VERSION,
+        .dir_count = (uint32_t)dir_count,
+        .session_count = (uint32_t)list->count,
+        .record_size = sizeof(session_record_t),
+        .arena_len = (uint32_t)list->arena_len
+    };
+
+    if (fchmod(fd, 0644) != 0 ||
+        write_all(fd, &header, sizeof(header)) != 0 ||
+        write_all(fd, stamps, (size_t)dir_count * sizeof(session_dir_stamp_t)) != 0 ||
+        write_all(fd, list->records, (size_t)list->count * sizeof(session_record_t)) != 0 ||
+        write_all(fd, list->arena, list->arena_len) != 0) {
+        logger_log(LOG_WARN, "Failed to write session cache %s: %s", tmp_path, strerror(errno));
+        close(fd);
+        unlink(tmp_path);
+        return KIA_ERROR_SESSION;
+    }
+
+    if (close(fd) != 0 || rename(tmp_path, path) != 0) {
+        logger_log(LOG_WARN, "Failed to install session cache %s: %s", path, strerror(errno));
+        unlink(tmp_path);
+        return KIA_ERROR_SESSION;
+    }
+
+    logger_log(LOG_DEBUG, "Session cache written: %s (%d session(s))", path, list->count);
+    return KIA_SUCCESS;
+}
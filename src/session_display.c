@@ -0,0 +1,171 @@
+#define _GNU_SOURCE
+#include "session_display.h"
+#include "config.h"
+#include "logger.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+void session_display_init(session_display_t *display) {
+    if (!display) {
+        return;
+    }
+    display->x_display = -1;
+    display->x_lock_fd = -1;
+    display->wayland_display[0] = '\0';
+    display->wayland_lock_fd = -1;
+}
+
+/**
+ * Take Kia's lock on one slot without waiting
+ * @return Descriptor holding the lock, or -1 if another session holds it
+ *         or it cannot be taken
+ */
+static int lock_slot(const char *lock_dir, const char *kind, int n) {
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s/%s-%d.lock", lock_dir, kind, n);
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, 0600);
+    if (fd < 0) {
+        logger_log(LOG_ERROR, "Failed to open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Check whether a live X server holds a display, removing its lock file
+ * if the server that wrote it is gone
+ */
+static bool x_display_in_use(const char *x_lock_dir, int n) {
+    char path[512], buf[16];
+
+    snprintf(path, sizeof(path), "%s/.X%d-lock", x_lock_dir, n);
+    int fd = open(path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd < 0) {
+        return errno != ENOENT;
+    }
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+
+    /* The server writes its PID as ten characters and a newline */
+    long pid = 0;
+    if (len > 0) {
+        buf[len] = '\0';
+        pid = strtol(buf, NULL, 10);
+    }
+    if (pid > 0 && (kill((pid_t)pid, 0) == 0 || errno == EPERM)) {
+        return true;
+    }
+
+    if (unlink(path) != 0 && errno != ENOENT) {
+        logger_log(LOG_WARN, "Failed to remove stale %s: %s", path, strerror(errno));
+        return true;
+    }
+    logger_log(LOG_INFO, "Removed stale %s left by PID %ld", path, pid);
+    return false;
+}
+
+/**
+ * Check whether a running compositor holds a Wayland socket name
+ * Compositors keep an flock on wayland-<n>.lock for as long as they serve
+ * the socket; a shared lock can be taken only when none does
+ */
+static bool wayland_socket_in_use(const char *runtime_dir, int n) {
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s/wayland-%d.lock", runtime_dir, n);
+    int fd = open(path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd < 0) {
+        return errno != ENOENT;
+    }
+    bool in_use = flock(fd, LOCK_SH | LOCK_NB) != 0;
+    close(fd);
+    return in_use;
+}
+
+int session_display_alloc_x(session_display_t *display, const char *lock_dir,
+                            const char *x_lock_dir) {
+    /* Validate input parameters */
+    if (!display || !lock_dir || !x_lock_dir) {
+        return KIA_ERROR_SESSION;
+    }
+
+    if (mkdir(lock_dir, 0711) != 0 && errno != EEXIST) {
+        logger_log(LOG_ERROR, "Failed to create %s: %s", lock_dir, strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+
+    for (int n = 0; n < SESSION_DISPLAY_MAX; n++) {
+        int fd = lock_slot(lock_dir, "x", n);
+        if (fd < 0) {
+            continue;
+        }
+        if (x_display_in_use(x_lock_dir, n)) {
+            close(fd);
+            continue;
+        }
+        display->x_display = n;
+        display->x_lock_fd = fd;
+        logger_log(LOG_DEBUG, "Allocated X display :%d", n);
+        return KIA_SUCCESS;
+    }
+
+    logger_log(LOG_ERROR, "No free X display among the first %d", SESSION_DISPLAY_MAX);
+    return KIA_ERROR_SESSION;
+}
+
+int session_display_alloc_wayland(session_display_t *display, const char *lock_dir,
+                                  const char *runtime_dir) {
+    /* Validate input parameters */
+    if (!display || !lock_dir) {
+        return KIA_ERROR_SESSION;
+    }
+
+    if (mkdir(lock_dir, 0711) != 0 && errno != EEXIST) {
+        logger_log(LOG_ERROR, "Failed to create %s: %s", lock_dir, strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+
+    for (int n = 0; n < SESSION_DISPLAY_MAX; n++) {
+        int fd = lock_slot(lock_dir, "wayland", n);
+        if (fd < 0) {
+            continue;
+        }
+        if (runtime_dir && wayland_socket_in_use(runtime_dir, n)) {
+            close(fd);
+            continue;
+        }
+        snprintf(display->wayland_display, sizeof(display->wayland_display), "wayland-%d", n);
+        display->wayland_lock_fd = fd;
+        logger_log(LOG_DEBUG, "Allocated Wayland socket %s", display->wayland_display);
+        return KIA_SUCCESS;
+    }
+
+    logger_log(LOG_ERROR, "No free Wayland socket among the first %d", SESSION_DISPLAY_MAX);
+    return KIA_ERROR_SESSION;
+}
+
+void session_display_release(session_display_t *display) {
+    if (!display) {
+        return;
+    }
+    if (display->x_lock_fd >= 0) {
+        close(display->x_lock_fd);
+    }
+    if (display->wayland_lock_fd >= 0) {
+        close(display->wayland_lock_fd);
+    }
+    session_display_init(display);
+}
@@ -0,0 +1,107 @@
+#include "session_env.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ENV_INITIAL_VARS 32
+
+/**
+ * Find the slot of a variable by the length-delimited name
+ */
+static int env_find(const session_env_t *env, const char *name, size_t name_len) {
+    for (int i = 0; i < env->count; i++) {
+        if (strncmp(env->vars[i], name, name_len) == 0 && env->vars[i][name_len] == '=') {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Store an owned NAME=value string, replacing any variable of that name
+ */
+static int env_store(session_env_t *env, char *var, size_t name_len) {
+    int idx = env_find(env, var, name_len);
+    if (idx >= 0) {
+        free(env->vars[idx]);
+        env->vars[idx] = var;
+        return KIA_SUCCESS;
+    }
+
+    if (env->count + 2 > env->cap) {
+        int new_cap = env->cap ? env->cap * 2 : ENV_INITIAL_VARS;
+        char **vars = realloc(env->vars, (size_t)new_cap * sizeof(*vars));
+        if (!vars) {
+            free(var);
+            return KIA_ERROR_SESSION;
+        }
+        env->vars = vars;
+        env->cap = new_cap;
+    }
+    env->vars[env->count++] = var;
+    env->vars[env->count] = NULL;
+    return KIA_SUCCESS;
+}
+
+int session_env_set(session_env_t *env, const char *name, const char *value) {
+    if (!env || !name || !value || name[0] == '\0' || strchr(name, '=')) {
+        return KIA_ERROR_SESSION;
+    }
+
+    size_t name_len = strlen(name);
+    size_t len = name_len + strlen(value) + 2;
+    char *var = malloc(len);
+    if (!var) {
+        return KIA_ERROR_SESSION;
+    }
+    snprintf(var, len, "%s=%s", name, value);
+    return env_store(env, var, name_len);
+}
+
+int session_env_put(session_env_t *env, const char *var) {
+    if (!env || !var) {
+        return KIA_ERROR_SESSION;
+    }
+
+    const char *eq = strchr(var, '=');
+    if (!eq || eq == var) {
+        return KIA_ERROR_SESSION;
+    }
+
+    char *copy = strdup(var);
+    if (!copy) {
+        return KIA_ERROR_SESSION;
+    }
+    return env_store(env, copy, (size_t)(eq - var));
+}
+
+const char *session_env_get(const session_env_t *env, const char *name) {
+    if (!env || !name) {
+        return NULL;
+    }
+
+    size_t name_len = strlen(name);
+    int idx = env_find(env, name, name_len);
+    return idx >= 0 ? env->vars[idx] + name_len + 1 : NULL;
+}
+
+char *const *session_env_block(session_env_t *env) {
+    static char *const empty[] = { NULL };
+
+    if (!env || env->count == 0) {
+        return empty;
+    }
+    return env->vars;
+}
+
+void session_env_free(session_env_t *env) {
+    if (!env) {
+        return;
+    }
+    for (int i = 0; i < env->count; i++) {
+        free(env->vars[i]);
+    }
+    free(env->vars);
+    memset(env, 0, sizeof(*env));
+}
@@ -0,0 +1,244 @@
+#define _GNU_SOURCE
+#include "session_group.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+/* Children of this process that belong to no session */
+static pid_t tracked[SESSION_GROUP_MAX_TRACKED];
+static pthread_mutex_t tracked_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int session_group_subreaper(void) {
+    if (prctl(PR_SET_CHILD_SUBREAPER, 1, 0, 0, 0) != 0) {
+        logger_log(LOG_WARN, "Failed to become subreaper: %s", strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+    return KIA_SUCCESS;
+}
+
+int session_group_track(pid_t pid) {
+    int result = KIA_ERROR_SESSION;
+
+    /* Validate input parameters */
+    if (pid <= 1) {
+        return KIA_ERROR_SESSION;
+    }
+
+    pthread_mutex_lock(&tracked_lock);
+    for (int i = 0; i < SESSION_GROUP_MAX_TRACKED; i++) {
+        if (tracked[i] == pid) {
+            result = KIA_SUCCESS;
+            break;
+        }
+        if (tracked[i] == 0 && result != KIA_SUCCESS) {
+            tracked[i] = pid;
+            result = KIA_SUCCESS;
+        }
+    }
+    pthread_mutex_unlock(&tracked_lock);
+
+    if (result != KIA_SUCCESS) {
+        logger_log(LOG_WARN, "Too many tracked processes, PID %d may be stopped with a session",
+                   (int)pid);
+    }
+    return result;
+}
+
+void session_group_untrack(pid_t pid) {
+    pthread_mutex_lock(&tracked_lock);
+    for (int i = 0; i < SESSION_GROUP_MAX_TRACKED; i++) {
+        if (pid > 1 && tracked[i] == pid) {
+            tracked[i] = 0;
+        }
+    }
+    pthread_mutex_unlock(&tracked_lock);
+}
+
+/**
+ * Check whether a child is tracked, i.e. not part of any session
+ */
+static bool is_tracked(pid_t pid) {
+    bool found = false;
+
+    pthread_mutex_lock(&tracked_lock);
+    for (int i = 0; i < SESSION_GROUP_MAX_TRACKED && !found; i++) {
+        found = tracked[i] == pid;
+    }
+    pthread_mutex_unlock(&tracked_lock);
+    return found;
+}
+
+/**
+ * List the children of this process no one tracks: session processes that
+ * left their process group (setsid(), setpgid()) and were re-parented here
+ * once their parent exited, plus any not reaped yet
+ * @return Number of children stored in pids
+ */
+static int list_strays(pid_t *pids, int max) {
+    char path[64];
+    int count = 0;
+
+    /* Each thread has children of its own, as fork() parents them to the caller */
+    DIR *tasks = opendir("/proc/self/task");
+    if (!tasks) {
+        return 0;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(tasks)) != NULL && count < max) {
+        if (!isdigit((unsigned char)entry->d_name[0])) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "/proc/self/task/%.20s/children", entry->d_name);
+        FILE *fp = fopen(path, "re");
+        if (!fp) {
+            continue;
+        }
+        int pid;
+        while (count < max && fscanf(fp, "%d", &pid) == 1) {
+            if (pid > 1 && !is_tracked(pid)) {
+                pids[count++] = pid;
+            }
+        }
+        fclose(fp);
+    }
+    closedir(tasks);
+    return count;
+}
+
+/**
+ * Signal every stray child, along with the process group it leads
+ * @return Number of children signalled
+ */
+static int signal_strays(int sig) {
+    pid_t pids[SESSION_GROUP_MAX_STRAYS];
+    int signalled = 0;
+
+    int count = list_strays(pids, SESSION_GROUP_MAX_STRAYS);
+    for (int i = 0; i < count; i++) {
+        /* A daemon that called setsid() leads the group of whatever it started */
+        if (getpgid(pids[i]) == pids[i] && pids[i] != getpgrp()) {
+            kill(-pids[i], sig);
+        }
+        if (kill(pids[i], sig) == 0) {
+            signalled++;
+        }
+    }
+    return signalled;
+}
+
+int session_group_signal(pid_t pgid, int sig) {
+    int signalled = 0;
+
+    /* Validate input parameters: -1 and 0 would reach far more than a session */
+    if (pgid <= 1) {
+        return KIA_ERROR_SESSION;
+    }
+
+    if (kill(-pgid, sig) == 0) {
+        signalled++;
+    } else if (errno != ESRCH) {
+        logger_log(LOG_WARN, "Failed to signal process group %d: %s", (int)pgid, strerror(errno));
+    }
+    signalled += signal_strays(sig);
+    return signalled > 0 ? KIA_SUCCESS : KIA_ERROR_SESSION;
+}
+
+bool session_group_alive(pid_t pgid) {
+    pid_t stray;
+
+    if (pgid <= 1) {
+        return false;
+    }
+    return kill(-pgid, 0) == 0 || errno == EPERM || list_strays(&stray, 1) > 0;
+}
+
+int session_group_reap(pid_t pgid) {
+    pid_t pids[SESSION_GROUP_MAX_STRAYS];
+    int reaped = 0;
+
+    /* Validate input parameters: waiting for any child would take the helper's and X's */
+    if (pgid <= 1) {
+        return 0;
+    }
+
+    while (waitpid(-pgid, NULL, WNOHANG) > 0) {
+        reaped++;
+    }
+    int count = list_strays(pids, SESSION_GROUP_MAX_STRAYS);
+    for (int i = 0; i < count; i++) {
+        if (waitpid(pids[i], NULL, WNOHANG) > 0) {
+            reaped++;
+        }
+    }
+    return reaped;
+}
+
+/**
+ * Reap the group until nothing is left of it or the time is up
+ * @return true if the session is gone
+ */
+static bool wait_gone(pid_t pgid, int timeout_ms) {
+    struct timespec start, now;
+    struct timespec pause = { 0, SESSION_GROUP_POLL_MS * 1000000L };
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;) {
+        session_group_reap(pgid);
+        if (!session_group_alive(pgid)) {
+            return true;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long waited_ms = (now.tv_sec - start.tv_sec) * 1000 +
+                         (now.tv_nsec - start.tv_nsec) / 1000000;
+        if (waited_ms >= timeout_ms) {
+            return false;
+        }
+        nanosleep(&pause, NULL);
+    }
+}
+
+int session_group_stop(pid_t pgid, int timeout_ms) {
+    struct timespec start, end;
+
+    /* Validate input parameters */
+    if (pgid <= 1) {
+        return KIA_ERROR_SESSION;
+    }
+
+    session_group_reap(pgid);
+    if (!session_group_alive(pgid)) {
+        return KIA_SUCCESS;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    logger_log(LOG_INFO, "Processes of session %d outlived it, sending SIGTERM", (int)pgid);
+    session_group_signal(pgid, SIGTERM);
+    session_group_signal(pgid, SIGCONT);
+
+    if (!wait_gone(pgid, timeout_ms > 0 ? timeout_ms : 0)) {
+        logger_log(LOG_WARN, "Processes of session %d still running after %d ms, killing them",
+                   (int)pgid, timeout_ms);
+        session_group_signal(pgid, SIGKILL);
+        if (!wait_gone(pgid, SESSION_GROUP_KILL_WAIT_MS)) {
+            logger_log(LOG_ERROR, "Processes of session %d survived SIGKILL", (int)pgid);
+            return KIA_ERROR_SESSION;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    logger_log(LOG_INFO, "Session %d torn down in %.1f ms", (int)pgid,
+               (double)(end.tv_sec - start.tv_sec) * 1e3 +
+               (double)(end.tv_nsec - start.tv_nsec) / 1e6);
+    return KIA_SUCCESS;
+}
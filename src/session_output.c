@@ -0,0 +1,295 @@
+#define _GNU_SOURCE
+#include "session_output.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+void session_output_init(session_output_t *output) {
+    if (!output) {
+        return;
+    }
+    memset(output, 0, sizeof(*output));
+    output->fd = -1;
+    output->session_fd = -1;
+    output->file_fd = -1;
+}
+
+/**
+ * Start a fresh output file, keeping the previous one as <path>.old
+ */
+static int open_file(session_output_t *output) {
+    char old_path[sizeof(output->path) + 8];
+
+    snprintf(old_path, sizeof(old_path), "%s.old", output->path);
+    if (rename(output->path, old_path) != 0 && errno != ENOENT) {
+        logger_log(LOG_WARN, "Failed to rotate %s: %s", output->path, strerror(errno));
+    }
+
+    /* Root writes here, so never follow a link planted in its place */
+    output->file_fd = open(output->path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+                           0640);
+    if (output->file_fd < 0) {
+        logger_log(LOG_WARN, "Failed to open %s: %s", output->path, strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+    output->file_size = 0;
+    return KIA_SUCCESS;
+}
+
+int session_output_open(session_output_t *output, const char *path) {
+    int fds[2];
+
+    /* Validate input parameters */
+    if (!output) {
+        return KIA_ERROR_SESSION;
+    }
+    session_output_init(output);
+
+    output->ring = malloc(SESSION_OUTPUT_RING_SIZE);
+    if (!output->ring) {
+        logger_log(LOG_ERROR, "Failed to allocate session output buffer");
+        return KIA_ERROR_SESSION;
+    }
+
+    /* The session blocks on a full pipe rather than losing output or failing writes */
+    if (pipe2(fds, O_CLOEXEC | O_NONBLOCK) != 0 || fcntl(fds[1], F_SETFL, 0) != 0) {
+        logger_log(LOG_ERROR, "Failed to create session output pipe: %s", strerror(errno));
+        free(output->ring);
+        session_output_init(output);
+        return KIA_ERROR_SESSION;
+    }
+    output->fd = fds[0];
+    output->session_fd = fds[1];
+    clock_gettime(CLOCK_MONOTONIC, &output->last_flush);
+
+    if (!path) {
+        return KIA_SUCCESS;
+    }
+    int len = snprintf(output->path, sizeof(output->path), "%s", path);
+    if (len < 0 || (size_t)len >= sizeof(output->path)) {
+        logger_log(LOG_WARN, "Session output path too long, keeping output in memory");
+        output->path[0] = '\0';
+        return KIA_SUCCESS;
+    }
+
+    char dir[sizeof(output->path)];
+    snprintf(dir, sizeof(dir), "%s", output->path);
+    char *slash = strrchr(dir, '/');
+    if (slash && slash != dir) {
+        *slash = '\0';
+        if (mkdir(dir, 0750) != 0 && errno != EEXIST) {
+            logger_log(LOG_WARN, "Failed to create %s: %s", dir, strerror(errno));
+        }
+    }
+    open_file(output);
+    return KIA_SUCCESS;
+}
+
+void session_output_close_session(session_output_t *output) {
+    if (output && output->session_fd >= 0) {
+        close(output->session_fd);
+        output->session_fd = -1;
+    }
+}
+
+/**
+ * Give up on output that was overwritten before it could be written
+ */
+static void account_drops(session_output_t *output) {
+    if (output->total - output->flushed > SESSION_OUTPUT_RING_SIZE) {
+        uint64_t lost = output->total - SESSION_OUTPUT_RING_SIZE - output->flushed;
+        output->dropped += lost;
+        output->flushed += lost;
+    }
+}
+
+int session_output_drain(session_output_t *output) {
+    if (!output || output->fd < 0 || !output->ring) {
+        return -1;
+    }
+
+    /* At most one buffer per call, so a runaway session cannot starve the loop */
+    int result = 0;
+    size_t budget = SESSION_OUTPUT_RING_SIZE;
+    while (budget > 0) {
+        size_t pos = (size_t)(output->total % SESSION_OUTPUT_RING_SIZE);
+        size_t space = SESSION_OUTPUT_RING_SIZE - pos;
+        ssize_t n = read(output->fd, output->ring + pos, space < budget ? space : budget);
+        if (n > 0) {
+            output->total += (uint64_t)n;
+            budget -= (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && errno == EAGAIN) {
+            break;
+        }
+
+        /* End of file: every process holding the write end is gone */
+        close(output->fd);
+        output->fd = -1;
+        result = -1;
+        break;
+    }
+    account_drops(output);
+
+    session_output_flush(output, false);
+    return result;
+}
+
+/**
+ * Milliseconds since the last write to the file
+ */
+static long since_flush_ms(const session_output_t *output) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - output->last_flush.tv_sec) * 1000 +
+           (now.tv_nsec - output->last_flush.tv_nsec) / 1000000;
+}
+
+int session_output_flush_timeout(const session_output_t *output) {
+    if (!output || output->file_fd < 0 || output->flushed == output->total) {
+        return -1;
+    }
+    long remaining = SESSION_OUTPUT_FLUSH_INTERVAL_MS - since_flush_ms(output);
+    return remaining > 0 ? (int)remaining : 0;
+}
+
+void session_output_flush(session_output_t *output, bool force) {
+    if (!output || !output->ring) {
+        return;
+    }
+    account_drops(output);
+    if (output->flushed == output->total) {
+        return;
+    }
+
+    /* Without a file the ring is all there is */
+    if (output->file_fd < 0) {
+        output->flushed = output->total;
+        return;
+    }
+    if (!force && since_flush_ms(output) < SESSION_OUTPUT_FLUSH_INTERVAL_MS) {
+        return;
+    }
+
+    size_t len = (size_t)(output->total - output->flushed);
+    if (output->file_size + len > SESSION_OUTPUT_MAX_FILE_SIZE) {
+        close(output->file_fd);
+        output->file_fd = -1;
+        if (open_file(output) != KIA_SUCCESS) {
+            output->flushed = output->total;
+            return;
+        }
+    }
+
+    char note[96];
+    struct iovec iov[3];
+    int iov_count = 0;
+    if (output->dropped > output->dropped_noted) {
+        int note_len = snprintf(note, sizeof(note), "[kia: %llu bytes of output dropped]\n",
+                                (unsigned long long)(output->dropped - output->dropped_noted));
+        iov[iov_count++] = (struct iovec){ note, (size_t)note_len };
+        output->dropped_noted = output->dropped;
+    }
+    size_t start = (size_t)(output->flushed % SESSION_OUTPUT_RING_SIZE);
+    size_t first = SESSION_OUTPUT_RING_SIZE - start < len ? SESSION_OUTPUT_RING_SIZE - start : len;
+    iov[iov_count++] = (struct iovec){ output->ring + start, first };
+    if (first < len) {
+        iov[iov_count++] = (struct iovec){ output->ring, len - first };
+    }
+
+    ssize_t written = writev(output->file_fd, iov, iov_count);
+    if (written < 0) {
+        logger_log(LOG_WARN, "Failed to write %s: %s, keeping session output in memory",
+                   output->path, strerror(errno));
+        close(output->file_fd);
+        output->file_fd = -1;
+    } else {
+        output->file_size += (uint64_t)written;
+    }
+    output->flushed = output->total;
+    clock_gettime(CLOCK_MONOTONIC, &output->last_flush);
+}
+
+size_t session_output_tail(const session_output_t *output, char *buf, size_t len) {
+    if (!buf || len == 0) {
+        return 0;
+    }
+    buf[0] = '\0';
+    if (!output || !output->ring) {
+        return 0;
+    }
+
+    uint64_t kept = output->total < SESSION_OUTPUT_RING_SIZE ? output->total
+                                                             : SESSION_OUTPUT_RING_SIZE;
+    size_t n = kept < len - 1 ? (size_t)kept : len - 1;
+    for (size_t i = 0; i < n; i++) {
+        buf[i] = output->ring[(output->total - n + i) % SESSION_OUTPUT_RING_SIZE];
+    }
+    buf[n] = '\0';
+
+    /* Drop the partial first line unless the tail holds the whole output */
+    if (n < output->total) {
+        char *newline = memchr(buf, '\n', n);
+        if (newline && (size_t)(newline + 1 - buf) < n) {
+            size_t skip = (size_t)(newline + 1 - buf);
+            memmove(buf, buf + skip, n - skip + 1);
+            n -= skip;
+        }
+    }
+    return n;
+}
+
+void session_output_log_tail(const session_output_t *output, size_t max_bytes) {
+    if (!output || !output->ring || output->total == 0 || max_bytes == 0) {
+        return;
+    }
+
+    char *tail = malloc(max_bytes + 1);
+    if (!tail) {
+        return;
+    }
+    session_output_tail(output, tail, max_bytes + 1);
+    logger_log(LOG_WARN, "Last output of the session:");
+    char *save = NULL;
+    for (char *line = strtok_r(tail, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        logger_log(LOG_WARN, "  | %s", line);
+    }
+    free(tail);
+}
+
+void session_output_close(session_output_t *output) {
+    if (!output) {
+        return;
+    }
+
+    /* Descendants may still hold the pipe; take what is there without waiting */
+    if (output->fd >= 0) {
+        session_output_drain(output);
+        if (output->fd >= 0) {
+            close(output->fd);
+        }
+    }
+    session_output_flush(output, true);
+    if (output->dropped > 0) {
+        logger_log(LOG_WARN, "Dropped %llu bytes of session output",
+                   (unsigned long long)output->dropped);
+    }
+
+    session_output_close_session(output);
+    if (output->file_fd >= 0) {
+        close(output->file_fd);
+    }
+    free(output->ring);
+    session_output_init(output);
+}
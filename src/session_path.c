@@ -0,0 +1,270 @@
+#include "session_path.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define PATH_INITIAL_ENTRIES 64
+#define PATH_INITIAL_POOL 1024
+
+/**
+ * FNV-1a hash of a directory index and command name
+ */
+static uint32_t hash_command(int dir, const char *name) {
+    uint32_t hash = 2166136261u;
+
+    hash ^= (uint32_t)dir;
+    hash *= 16777619u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * Check that a path names an executable regular file
+ */
+static bool is_executable(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode) && (st.st_mode & 0111) != 0;
+}
+
+/**
+ * Rehash the memo table into twice as many slots
+ */
+static int entries_grow(session_path_t *cache) {
+    uint32_t capacity = cache->capacity ? cache->capacity * 2 : PATH_INITIAL_ENTRIES;
+    session_path_entry_t *entries = calloc(capacity, sizeof(*entries));
+    if (!entries) {
+        return KIA_ERROR_SESSION;
+    }
+
+    for (uint32_t i = 0; i < cache->capacity; i++) {
+        if (cache->entries[i].name_off == 0) {
+            continue;
+        }
+        uint32_t pos = cache->entries[i].hash & (capacity - 1);
+        while (entries[pos].name_off != 0) {
+            pos = (pos + 1) & (capacity - 1);
+        }
+        entries[pos] = cache->entries[i];
+    }
+
+    free(cache->entries);
+    cache->entries = entries;
+    cache->capacity = capacity;
+    return KIA_SUCCESS;
+}
+
+/**
+ * Find the memo slot for a command in a directory, adding it if needed
+ * @return Slot, or NULL if memory ran out
+ */
+static session_path_entry_t *entry_get(session_path_t *cache, int dir, const char *name) {
+    if (cache->count * 2 >= cache->capacity && entries_grow(cache) != KIA_SUCCESS) {
+        return NULL;
+    }
+
+    uint32_t hash = hash_command(dir, name);
+    uint32_t pos = hash & (cache->capacity - 1);
+    while (cache->entries[pos].name_off != 0) {
+        session_path_entry_t *entry = &cache->entries[pos];
+        if (entry->hash == hash && entry->dir == dir &&
+            strcmp(cache->pool + entry->name_off - 1, name) == 0) {
+            return entry;
+        }
+        pos = (pos + 1) & (cache->capacity - 1);
+    }
+
+    size_t len = strlen(name);
+    if (cache->pool_len + len + 1 > cache->pool_cap) {
+        size_t new_cap = cache->pool_cap ? cache->pool_cap * 2 : PATH_INITIAL_POOL;
+        while (new_cap < cache->pool_len + len + 1) {
+            new_cap *= 2;
+        }
+        if (new_cap > UINT32_MAX) {
+            return NULL;
+        }
+        char *pool = realloc(cache->pool, new_cap);
+        if (!pool) {
+            return NULL;
+        }
+        cache->pool = pool;
+        cache->pool_cap = new_cap;
+    }
+
+    memcpy(cache->pool + cache->pool_len, name, len + 1);
+
+    session_path_entry_t *entry = &cache->entries[pos];
+    entry->hash = hash;
+    entry->name_off = (uint32_t)cache->pool_len + 1;
+    entry->dir = (uint16_t)dir;
+    /* Never matches a directory generation, so the first lookup probes */
+    entry->generation = cache->dirs[dir].generation - 1;
+    entry->found = 0;
+    cache->pool_len += len + 1;
+    cache->count++;
+    return entry;
+}
+
+int session_path_init(session_path_t *cache, const char *search_path) {
+    if (!cache) {
+        return KIA_ERROR_SESSION;
+    }
+
+    memset(cache, 0, sizeof(*cache));
+
+    if (!search_path || search_path[0] == '\0') {
+        search_path = SESSION_PATH_DEFAULT;
+    }
+
+    cache->dirs = calloc(SESSION_PATH_MAX_DIRS, sizeof(*cache->dirs));
+    if (!cache->dirs) {
+        return KIA_ERROR_SESSION;
+    }
+
+    for (const char *p = search_path; *p && cache->dir_count < SESSION_PATH_MAX_DIRS; ) {
+        size_t len = strcspn(p, ":");
+        const char *next = p[len] ? p + len + 1 : p + len;
+
+        /* Relative entries depend on the working directory of the session */
+        while (len > 1 && p[len - 1] == '/') {
+            len--;
+        }
+        if (len == 0 || p[0] != '/') {
+            p = next;
+            continue;
+        }
+
+        bool repeated = false;
+        for (int i = 0; i < cache->dir_count && !repeated; i++) {
+            repeated = strlen(cache->dirs[i].path) == len &&
+                       memcmp(cache->dirs[i].path, p, len) == 0;
+        }
+
+        char *path = repeated ? NULL : strndup(p, len);
+        if (path) {
+            cache->dirs[cache->dir_count++].path = path;
+        }
+        p = next;
+    }
+
+    session_path_refresh(cache);
+    logger_log(LOG_DEBUG, "Resolving session commands over %d PATH director%s",
+               cache->dir_count, cache->dir_count == 1 ? "y" : "ies");
+    return KIA_SUCCESS;
+}
+
+int session_path_refresh(session_path_t *cache) {
+    struct stat st;
+    int changed = 0;
+
+    if (!cache) {
+        return 0;
+    }
+
+    for (int i = 0; i < cache->dir_count; i++) {
+        session_path_dir_t *dir = &cache->dirs[i];
+        bool present = stat(dir->path, &st) == 0;
+
+        if (present == dir->present && (!present ||
+            (dir->dev == (uint64_t)st.st_dev && dir->ino == (uint64_t)st.st_ino &&
+             dir->mtime_sec == (int64_t)st.st_mtim.tv_sec &&
+             dir->mtime_nsec == (int64_t)st.st_mtim.tv_nsec))) {
+            continue;
+        }
+
+        dir->present = present;
+        dir->dev = present ? (uint64_t)st.st_dev : 0;
+        dir->ino = present ? (uint64_t)st.st_ino : 0;
+        dir->mtime_sec = present ? (int64_t)st.st_mtim.tv_sec : 0;
+        dir->mtime_nsec = present ? (int64_t)st.st_mtim.tv_nsec : 0;
+        dir->generation++;
+        changed++;
+    }
+
+    return changed;
+}
+
+int session_path_find(session_path_t *cache, const char *name, char *resolved, size_t size) {
+    char path[512];
+
+    /* Validate input parameters */
+    if (!cache || !name || name[0] == '\0' || (resolved && size == 0)) {
+        return KIA_ERROR_SESSION;
+    }
+
+    if (strchr(name, '/') != NULL) {
+        if (!is_executable(name)) {
+            return KIA_ERROR_SESSION;
+        }
+        if (resolved && snprintf(resolved, size, "%s", name) >= (int)size) {
+            return KIA_ERROR_SESSION;
+        }
+        return KIA_SUCCESS;
+    }
+
+    for (int i = 0; i < cache->dir_count; i++) {
+        session_path_dir_t *dir = &cache->dirs[i];
+        if (!dir->present) {
+            continue;
+        }
+
+        int len = snprintf(path, sizeof(path), "%s/%s", dir->path, name);
+        if (len < 0 || (size_t)len >= sizeof(path)) {
+            continue;
+        }
+
+        bool found;
+        session_path_entry_t *entry = entry_get(cache, i, name);
+        if (entry && entry->generation == dir->generation) {
+            cache->hits++;
+            found = entry->found;
+        } else {
+            cache->probes++;
+            found = is_executable(path);
+            if (entry) {
+                entry->found = found;
+                entry->generation = dir->generation;
+            }
+        }
+
+        if (found) {
+            if (resolved && snprintf(resolved, size, "%s", path) >= (int)size) {
+                return KIA_ERROR_SESSION;
+            }
+            return KIA_SUCCESS;
+        }
+    }
+
+    return KIA_ERROR_SESSION;
+}
+
+int session_path_dirs(const session_path_t *cache, session_dir_t *dirs) {
+    if (!cache || !dirs) {
+        return 0;
+    }
+
+    for (int i = 0; i < cache->dir_count; i++) {
+        dirs[i].path = cache->dirs[i].path;
+        dirs[i].type = SESSION_X11;
+    }
+    return cache->dir_count;
+}
+
+void session_path_free(session_path_t *cache) {
+    if (!cache) {
+        return;
+    }
+
+    for (int i = 0; i < cache->dir_count; i++) {
+        free(cache->dirs[i].path);
+    }
+    free(cache->dirs);
+    free(cache->entries);
+    free(cache->pool);
+    memset(cache, 0, sizeof(*cache));
+}
@@ -0,0 +1,195 @@
+#define _GNU_SOURCE
+#include "session_ready.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+void session_ready_init(session_ready_t *ready) {
+    if (!ready) {
+        return;
+    }
+    ready->fd = -1;
+    ready->session_fd = -1;
+}
+
+int session_ready_open(session_ready_t *ready) {
+    int fds[2];
+
+    /* Validate input parameters */
+    if (!ready) {
+        return KIA_ERROR_SESSION;
+    }
+
+    /* Only the write end reaches the session; the read end never blocks Kia */
+    if (pipe2(fds, O_CLOEXEC | O_NONBLOCK) != 0) {
+        logger_log(LOG_ERROR, "Failed to create readiness pipe: %s", strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+    if (fcntl(fds[1], F_SETFD, 0) != 0 || fcntl(fds[1], F_SETFL, 0) != 0) {
+        logger_log(LOG_ERROR, "Failed to set up readiness pipe: %s", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return KIA_ERROR_SESSION;
+    }
+
+    ready->fd = fds[0];
+    ready->session_fd = fds[1];
+    return KIA_SUCCESS;
+}
+
+void session_ready_close_session(session_ready_t *ready) {
+    if (ready && ready->session_fd >= 0) {
+        close(ready->session_fd);
+        ready->session_fd = -1;
+    }
+}
+
+int session_ready_check(session_ready_t *ready) {
+    char buf[64];
+
+    if (!ready || ready->fd < 0) {
+        return -1;
+    }
+
+    ssize_t n;
+    do {
+        n = read(ready->fd, buf, sizeof(buf));
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0 && errno == EAGAIN) {
+        return 0;
+    }
+    close(ready->fd);
+    ready->fd = -1;
+    return n > 0 ? 1 : -1;
+}
+
+void session_ready_close(session_ready_t *ready) {
+    if (!ready) {
+        return;
+    }
+    if (ready->fd >= 0) {
+        close(ready->fd);
+    }
+    session_ready_close_session(ready);
+    session_ready_init(ready);
+}
+
+/**
+ * Milliseconds between two phase timestamps, or -1 if either is missing
+ */
+static double phase_ms(const struct timespec *from, const struct timespec *to) {
+    if ((from->tv_sec == 0 && from->tv_nsec == 0) || (to->tv_sec == 0 && to->tv_nsec == 0)) {
+        return -1;
+    }
+    return (double)(to->tv_sec - from->tv_sec) * 1e3 +
+           (double)(to->tv_nsec - from->tv_nsec) / 1e6;
+}
+
+/**
+ * Append a JSON string, escaping quotes, backslashes and control characters
+ */
+static void append_json_string(char *buf, size_t size, size_t *pos, const char *value) {
+    *pos += (size_t)snprintf(buf + *pos, *pos < size ? size - *pos : 0, "\"");
+    for (const unsigned char *c = (const unsigned char *)value; *c; c++) {
+        if (*pos + 8 >= size) {
+            break;
+        }
+        if (*c == '"' || *c == '\\') {
+            buf[(*pos)++] = '\\';
+            buf[(*pos)++] = (char)*c;
+        } else if (*c < 0x20) {
+            *pos += (size_t)snprintf(buf + *pos, size - *pos, "\\u%04x", *c);
+        } else {
+            buf[(*pos)++] = (char)*c;
+        }
+    }
+    *pos += (size_t)snprintf(buf + *pos, *pos < size ? size - *pos : 0, "\"");
+}
+
+/**
+ * Append a phase duration as a JSON member, null if it did not happen
+ */
+static void append_json_phase(char *buf, size_t size, size_t *pos, const char *name, double ms) {
+    if (ms < 0) {
+        *pos += (size_t)snprintf(buf + *pos, *pos < size ? size - *pos : 0, ",\"%s\":null", name);
+    } else {
+        *pos += (size_t)snprintf(buf + *pos, *pos < size ? size - *pos : 0,
+                                 ",\"%s\":%.3f", name, ms);
+    }
+}
+
+int session_latency_report(const session_latency_t *latency, const char *username,
+                           const char *session, const char *stats_path) {
+    /* Validate input parameters */
+    if (!latency || !username || !session) {
+        return KIA_ERROR_SESSION;
+    }
+
+    const session_latency_t *l = latency;
+    struct {
+        const char *name;
+        double ms;
+    } phases[] = {
+        { "select_ms", phase_ms(&l->submitted, &l->auth_start) },
+        { "auth_ms",   phase_ms(&l->auth_start, &l->auth_done) },
+        { "spawn_ms",  phase_ms(&l->launch_start, &l->spawn_start) },
+        { "exec_ms",   phase_ms(&l->spawn_start, &l->exec_done) },
+        { "ready_ms",  phase_ms(&l->exec_done, &l->ready) },
+        { "total_ms",  phase_ms(&l->submitted, &l->ready) },
+    };
+    int phase_count = (int)(sizeof(phases) / sizeof(phases[0]));
+
+    char text[256];
+    size_t text_len = 0;
+    for (int i = 0; i < phase_count && text_len < sizeof(text); i++) {
+        int name_len = (int)(strchr(phases[i].name, '_') - phases[i].name);
+        if (phases[i].ms < 0) {
+            text_len += (size_t)snprintf(text + text_len, sizeof(text) - text_len, "%s%.*s -",
+                                         i ? ", " : "", name_len, phases[i].name);
+        } else {
+            text_len += (size_t)snprintf(text + text_len, sizeof(text) - text_len, "%s%.*s %.1f ms",
+                                         i ? ", " : "", name_len, phases[i].name, phases[i].ms);
+        }
+    }
+    logger_log(LOG_INFO, "Login latency for '%s' (%s): %s", username, session, text);
+
+    if (!stats_path) {
+        return KIA_SUCCESS;
+    }
+
+    /* One write per record keeps concurrent appends whole */
+    char line[1024];
+    size_t pos = 0;
+    pos += (size_t)snprintf(line, sizeof(line), "{\"time\":%lld,\"user\":", (long long)time(NULL));
+    append_json_string(line, sizeof(line), &pos, username);
+    pos += (size_t)snprintf(line + pos, pos < sizeof(line) ? sizeof(line) - pos : 0,
+                            ",\"session\":");
+    append_json_string(line, sizeof(line), &pos, session);
+    for (int i = 0; i < phase_count; i++) {
+        append_json_phase(line, sizeof(line), &pos, phases[i].name, phases[i].ms);
+    }
+    pos += (size_t)snprintf(line + pos, pos < sizeof(line) ? sizeof(line) - pos : 0, "}\n");
+    if (pos >= sizeof(line)) {
+        logger_log(LOG_WARN, "Login latency record too long, not written");
+        return KIA_ERROR_SESSION;
+    }
+
+    int fd = open(stats_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        logger_log(LOG_WARN, "Failed to open %s: %s", stats_path, strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+    ssize_t written = write(fd, line, pos);
+    close(fd);
+    if (written != (ssize_t)pos) {
+        logger_log(LOG_WARN, "Failed to write %s", stats_path);
+        return KIA_ERROR_SESSION;
+    }
+    return KIA_SUCCESS;
+}
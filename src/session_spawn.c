@@ -0,0 +1,245 @@
+#define _GNU_SOURCE
+#include "session_spawn.h"
+#include "session_path.h"
+#include "config.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <limits.h>
+
+/* Step of the trampoline that failed */
+typedef enum {
+    SPAWN_STAGE_NONE,
+    SPAWN_STAGE_GROUP,
+    SPAWN_STAGE_OUTPUT,
+    SPAWN_STAGE_CHDIR,
+    SPAWN_STAGE_SETGROUPS,
+    SPAWN_STAGE_SETGID,
+    SPAWN_STAGE_SETUID,
+    SPAWN_STAGE_VERIFY,
+    SPAWN_STAGE_EXEC
+} spawn_stage_t;
+
+/* Shared between parent and child; the child reports failures through it */
+typedef struct {
+    const session_spawn_t *spawn;
+    const char *search_path;                        /* PATH of envp, for execs without a path */
+    sigset_t mask;                                  /* Signal mask to restore before exec */
+    spawn_stage_t stage;
+    int error;
+    int exec_errors[SESSION_SPAWN_MAX_EXECS];
+} spawn_state_t;
+
+/**
+ * Record a failed step and leave the child
+ */
+static int child_fail(spawn_state_t *state, spawn_stage_t stage, int error) {
+    state->stage = stage;
+    state->error = error;
+    _exit(127);
+}
+
+/**
+ * Execute a command found on a search path the way execvp() does, but on
+ * the new program's PATH rather than the greeter's; only makes system calls
+ * @return errno of the attempt that got furthest
+ */
+static int exec_search(const char *search_path, const char *name, char *const *argv,
+                       char *const *envp) {
+    char path[PATH_MAX];
+    size_t name_len = strlen(name);
+    int error = ENOENT;
+
+    if (strchr(name, '/') != NULL) {
+        execve(name, argv, envp);
+        return errno;
+    }
+
+    const char *p = search_path;
+    for (;;) {
+        const char *end = strchr(p, ':');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+
+        /* An empty entry is the current directory */
+        if (len + 1 + name_len < sizeof(path)) {
+            size_t pos = 0;
+            if (len > 0) {
+                memcpy(path, p, len);
+                path[len] = '/';
+                pos = len + 1;
+            }
+            memcpy(path + pos, name, name_len + 1);
+            execve(path, argv, envp);
+            if (errno == EACCES) {
+                error = EACCES;
+            } else if (errno != ENOENT && errno != ENOTDIR && error != EACCES) {
+                error = errno;
+            }
+        }
+
+        if (!end) {
+            return error;
+        }
+        p = end + 1;
+    }
+}
+
+/**
+ * Pre-exec trampoline run on a private stack in the parent's memory
+ * Only system calls are made here: libc wrappers that take locks or talk
+ * to other threads, like setuid(), would act on the suspended parent
+ */
+static int spawn_child(void *arg) {
+    spawn_state_t *state = arg;
+    const session_spawn_t *spawn = state->spawn;
+
+    /* Handlers belong to the greeter and would run on this stack */
+    for (int sig = 1; sig < _NSIG; sig++) {
+        struct sigaction sa;
+        if (sigaction(sig, NULL, &sa) == 0 && sa.sa_handler != SIG_IGN &&
+            sa.sa_handler != SIG_DFL) {
+            memset(&sa, 0, sizeof(sa));
+            sa.sa_handler = SIG_DFL;
+            sigaction(sig, &sa, NULL);
+        }
+    }
+    sigprocmask(SIG_SETMASK, &state->mask, NULL);
+
+    if (spawn->new_group && setpgid(0, 0) != 0) {
+        return child_fail(state, SPAWN_STAGE_GROUP, errno);
+    }
+
+    if (spawn->redirect_output &&
+        (dup2(spawn->output_fd, STDOUT_FILENO) < 0 || dup2(spawn->output_fd, STDERR_FILENO) < 0)) {
+        return child_fail(state, SPAWN_STAGE_OUTPUT, errno);
+    }
+
+    if (spawn->dir && chdir(spawn->dir) != 0) {
+        return child_fail(state, SPAWN_STAGE_CHDIR, errno);
+    }
+
+    if (spawn->set_ids) {
+        if (syscall(SYS_setgroups, (size_t)spawn->group_count, spawn->groups) != 0) {
+            return child_fail(state, SPAWN_STAGE_SETGROUPS, errno);
+        }
+        if (syscall(SYS_setresgid, spawn->gid, spawn->gid, spawn->gid) != 0) {
+            return child_fail(state, SPAWN_STAGE_SETGID, errno);
+        }
+        if (syscall(SYS_setresuid, spawn->uid, spawn->uid, spawn->uid) != 0) {
+            return child_fail(state, SPAWN_STAGE_SETUID, errno);
+        }
+
+        /* Verify privilege drop - critical security check */
+        uid_t ruid, euid, suid;
+        gid_t rgid, egid, sgid;
+        if (syscall(SYS_getresuid, &ruid, &euid, &suid) != 0 ||
+            syscall(SYS_getresgid, &rgid, &egid, &sgid) != 0 ||
+            ruid != spawn->uid || euid != spawn->uid || suid != spawn->uid ||
+            rgid != spawn->gid || egid != spawn->gid || sgid != spawn->gid) {
+            return child_fail(state, SPAWN_STAGE_VERIFY, EPERM);
+        }
+    }
+
+    for (int i = 0; i < spawn->exec_count; i++) {
+        const session_spawn_exec_t *exec = &spawn->execs[i];
+        if (exec->path) {
+            execve(exec->path, (char *const *)exec->argv, spawn->envp);
+            state->exec_errors[i] = errno;
+        } else {
+            state->exec_errors[i] = exec_search(state->search_path, exec->argv[0],
+                                                (char *const *)exec->argv, spawn->envp);
+        }
+    }
+
+    return child_fail(state, SPAWN_STAGE_EXEC, errno);
+}
+
+/**
+ * Describe a failed trampoline step for the log
+ */
+static const char *stage_name(spawn_stage_t stage) {
+    switch (stage) {
+        case SPAWN_STAGE_GROUP:     return "create process group";
+        case SPAWN_STAGE_OUTPUT:    return "redirect output";
+        case SPAWN_STAGE_CHDIR:     return "change directory";
+        case SPAWN_STAGE_SETGROUPS: return "set supplementary groups";
+        case SPAWN_STAGE_SETGID:    return "set group ID";
+        case SPAWN_STAGE_SETUID:    return "set user ID";
+        case SPAWN_STAGE_VERIFY:    return "verify privilege drop";
+        default:                    return "execute session";
+    }
+}
+
+int session_spawn(const session_spawn_t *spawn, pid_t *pid) {
+    spawn_state_t state;
+    sigset_t all;
+
+    /* Validate input parameters */
+    if (!spawn || !pid || !spawn->envp || spawn->exec_count <= 0 ||
+        spawn->exec_count > SESSION_SPAWN_MAX_EXECS || spawn->group_count < 0 ||
+        (spawn->group_count > 0 && !spawn->groups)) {
+        return KIA_ERROR_SESSION;
+    }
+    for (int i = 0; i < spawn->exec_count; i++) {
+        if (!spawn->execs[i].argv || !spawn->execs[i].argv[0]) {
+            return KIA_ERROR_SESSION;
+        }
+    }
+
+    memset(&state, 0, sizeof(state));
+    state.spawn = spawn;
+    state.search_path = SESSION_PATH_DEFAULT;
+    for (char *const *var = spawn->envp; *var; var++) {
+        if (strncmp(*var, "PATH=", 5) == 0) {
+            state.search_path = *var + 5;
+            break;
+        }
+    }
+
+    void *stack = mmap(NULL, SESSION_SPAWN_STACK_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (stack == MAP_FAILED) {
+        logger_log(LOG_ERROR, "Failed to allocate spawn stack: %s", strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+
+    /* No handler may run in the child before it resets them */
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &state.mask);
+
+    /* The stack grows down on every architecture Kia runs on */
+    pid_t child = clone(spawn_child, (char *)stack + SESSION_SPAWN_STACK_SIZE,
+                        CLONE_VM | CLONE_VFORK | SIGCHLD, &state);
+    int clone_errno = errno;
+
+    pthread_sigmask(SIG_SETMASK, &state.mask, NULL);
+    munmap(stack, SESSION_SPAWN_STACK_SIZE);
+
+    if (child < 0) {
+        logger_log(LOG_ERROR, "Failed to spawn session: %s", strerror(clone_errno));
+        return KIA_ERROR_SESSION;
+    }
+
+    /* The child is gone or has exec'd; anything it recorded is final */
+    if (state.stage != SPAWN_STAGE_NONE) {
+        for (int i = 0; state.stage == SPAWN_STAGE_EXEC && i < spawn->exec_count; i++) {
+            const session_spawn_exec_t *exec = &spawn->execs[i];
+            logger_log(LOG_WARN, "Failed to execute %s: %s",
+                       exec->path ? exec->path : exec->argv[0], strerror(state.exec_errors[i]));
+        }
+        logger_log(LOG_ERROR, "Failed to %s: %s", stage_name(state.stage), strerror(state.error));
+        waitpid(child, NULL, 0);
+        return KIA_ERROR_SESSION;
+    }
+
+    *pid = child;
+    return KIA_SUCCESS;
+}
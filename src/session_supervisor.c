@@ -0,0 +1,216 @@
+#define _GNU_SOURCE
+#include "session_supervisor.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+static double elapsed_ms(const struct timespec *start, const struct timespec *end) {
+    return (double)(end->tv_sec - start->tv_sec) * 1e3 +
+           (double)(end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/**
+ * Stop tracking the child in a slot, keeping the array dense
+ */
+static void remove_child(session_supervisor_t *sup, int idx) {
+    epoll_ctl(sup->fd, EPOLL_CTL_DEL, sup->children[idx].pidfd, NULL);
+    close(sup->children[idx].pidfd);
+
+    sup->count--;
+    if (idx != sup->count) {
+        sup->children[idx] = sup->children[sup->count];
+    }
+    memset(&sup->children[sup->count], 0, sizeof(sup->children[sup->count]));
+}
+
+/**
+ * Reap one child if it has exited
+ * @return 1 if reaped, 0 if still running, KIA_ERROR_SESSION on error
+ */
+static int reap_child(session_child_t *child) {
+    siginfo_t info;
+    struct rusage ru;
+
+    /* The raw system call also returns the rusage glibc's waitid() drops */
+    memset(&info, 0, sizeof(info));
+    memset(&ru, 0, sizeof(ru));
+    if (syscall(SYS_waitid, P_PIDFD, child->pidfd, &info, WEXITED | WNOHANG, &ru) != 0) {
+        logger_log(LOG_ERROR, "Failed to wait for %s (PID %d): %s",
+                   child->name, child->pid, strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+    if (info.si_pid == 0) {
+        return 0;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    child->runtime_ms = elapsed_ms(&child->started, &now);
+
+    if (info.si_code == CLD_EXITED) {
+        child->exit_status = info.si_status;
+        child->term_signal = 0;
+        logger_log(LOG_INFO, "%s (PID %d) exited with status %d after %.0f ms",
+                   child->name, child->pid, child->exit_status, child->runtime_ms);
+    } else {
+        child->exit_status = 0;
+        child->term_signal = info.si_status;
+        logger_log(LOG_WARN, "%s (PID %d) terminated by signal %d after %.0f ms",
+                   child->name, child->pid, child->term_signal, child->runtime_ms);
+    }
+
+    session_usage_from_rusage(&child->usage, &ru);
+    session_usage_log(&child->usage, child->name, child->pid);
+    return 1;
+}
+
+int session_supervisor_init(session_supervisor_t *sup) {
+    if (!sup) {
+        return KIA_ERROR_SESSION;
+    }
+
+    memset(sup, 0, sizeof(*sup));
+    sup->fd = epoll_create1(EPOLL_CLOEXEC);
+    if (sup->fd < 0) {
+        logger_log(LOG_ERROR, "Failed to create session supervisor: %s", strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+    return KIA_SUCCESS;
+}
+
+int session_supervisor_fd(const session_supervisor_t *sup) {
+    return sup ? sup->fd : -1;
+}
+
+int session_supervisor_add(session_supervisor_t *sup, pid_t pid, const char *name) {
+    if (!sup || sup->fd < 0 || pid <= 0 || !name) {
+        return KIA_ERROR_SESSION;
+    }
+    if (sup->count >= SESSION_SUPERVISOR_MAX_CHILDREN) {
+        logger_log(LOG_ERROR, "Too many session processes to supervise");
+        return KIA_ERROR_SESSION;
+    }
+
+    int pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (pidfd < 0) {
+        logger_log(LOG_ERROR, "Failed to open pidfd for PID %d: %s", pid, strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+
+    session_child_t *child = &sup->children[sup->count];
+    memset(child, 0, sizeof(*child));
+    child->pid = pid;
+    child->pidfd = pidfd;
+    snprintf(child->name, sizeof(child->name), "%s", name);
+    clock_gettime(CLOCK_MONOTONIC, &child->started);
+
+    /* pidfds are close-on-exec, so sessions launched later never inherit them */
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = pidfd };
+    if (epoll_ctl(sup->fd, EPOLL_CTL_ADD, pidfd, &ev) != 0) {
+        logger_log(LOG_ERROR, "Failed to watch PID %d: %s", pid, strerror(errno));
+        close(pidfd);
+        memset(child, 0, sizeof(*child));
+        return KIA_ERROR_SESSION;
+    }
+
+    sup->count++;
+    return KIA_SUCCESS;
+}
+
+int session_supervisor_wait(session_supervisor_t *sup, int timeout_ms, const sigset_t *sigmask) {
+    struct epoll_event event;
+
+    if (!sup || sup->fd < 0) {
+        return KIA_ERROR_SESSION;
+    }
+
+    int ready = epoll_pwait(sup->fd, &event, 1, timeout_ms, sigmask);
+    if (ready < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        logger_log(LOG_ERROR, "Failed to wait for session processes: %s", strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+    return ready > 0 ? 1 : 0;
+}
+
+int session_supervisor_process(session_supervisor_t *sup, session_child_t *exited, int max) {
+    if (!sup || sup->fd < 0 || max < 0 || (max > 0 && !exited)) {
+        return KIA_ERROR_SESSION;
+    }
+
+    /* Events only wake the caller; with a handful of children, checking each is simplest */
+    struct epoll_event events[SESSION_SUPERVISOR_MAX_CHILDREN];
+    if (epoll_wait(sup->fd, events, SESSION_SUPERVISOR_MAX_CHILDREN, 0) <= 0) {
+        return 0;
+    }
+
+    int reaped = 0;
+    for (int i = 0; i < sup->count && reaped < max; ) {
+        int result = reap_child(&sup->children[i]);
+        if (result < 0) {
+            return KIA_ERROR_SESSION;
+        }
+        if (result == 0) {
+            i++;
+            continue;
+        }
+        exited[reaped++] = sup->children[i];
+        remove_child(sup, i);
+    }
+    return reaped;
+}
+
+int session_supervisor_signal(session_supervisor_t *sup, int sig) {
+    int signalled = 0;
+
+    if (!sup) {
+        return 0;
+    }
+    for (int i = 0; i < sup->count; i++) {
+        session_child_t *child = &sup->children[i];
+        if (syscall(SYS_pidfd_send_signal, child->pidfd, sig, NULL, 0) == 0) {
+            signalled++;
+        } else if (errno != ESRCH) {
+            logger_log(LOG_WARN, "Failed to signal %s (PID %d): %s",
+                       child->name, child->pid, strerror(errno));
+        }
+    }
+    return signalled;
+}
+
+int session_supervisor_count(const session_supervisor_t *sup) {
+    return sup ? sup->count : 0;
+}
+
+void session_supervisor_free(session_supervisor_t *sup) {
+    if (!sup) {
+        return;
+    }
+    for (int i = 0; i < sup->count; i++) {
+        close(sup->children[i].pidfd);
+    }
+    if (sup->fd >= 0) {
+        close(sup->fd);
+    }
+    memset(sup, 0, sizeof(*sup));
+    sup->fd = -1;
+}
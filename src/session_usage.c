@@ -0,0 +1,39 @@
+#define _GNU_SOURCE
+#include "session_usage.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static double timeval_ms(const struct timeval *tv) {
+    return (double)tv->tv_sec * 1e3 + (double)tv->tv_usec / 1e3;
+}
+
+void session_usage_from_rusage(session_usage_t *usage, const struct rusage *ru) {
+    if (!usage || !ru) {
+        return;
+    }
+
+    memset(usage, 0, sizeof(*usage));
+    usage->user_ms = timeval_ms(&ru->ru_utime);
+    usage->system_ms = timeval_ms(&ru->ru_stime);
+    usage->max_rss_kb = ru->ru_maxrss;
+    usage->minor_faults = ru->ru_minflt;
+    usage->major_faults = ru->ru_majflt;
+    usage->voluntary_switches = ru->ru_nvcsw;
+    usage->involuntary_switches = ru->ru_nivcsw;
+}
+
+void session_usage_log(const session_usage_t *usage, const char *name, pid_t pid) {
+    if (!usage || !name) {
+        return;
+    }
+
+    logger_log(LOG_INFO, "Session usage: name=\"%s\" pid=%d user_ms=%.0f system_ms=%.0f "
+               "max_rss_kb=%ld minor_faults=%ld major_faults=%ld voluntary_switches=%ld "
+               "involuntary_switches=%ld",
+               name, (int)pid, usage->user_ms, usage->system_ms, usage->max_rss_kb,
+               usage->minor_faults, usage->major_faults, usage->voluntary_switches,
+               usage->involuntary_switches);
+}
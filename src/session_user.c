@@ -0,0 +1,431 @@
+#define _GNU_SOURCE
+#include "session_user.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <sys/fsuid.h>
+
+/* One background scan; it owns copies of all it uses, so it can be abandoned */
+struct session_user_scan {
+    pthread_t thread;
+    pthread_mutex_t lock;    /* Guards done and abandoned */
+    bool done;
+    bool abandoned;          /* Given up on; the thread frees the scan */
+    int entry;               /* Entry the results are for */
+    uid_t uid;
+    gid_t gid;
+    session_dir_t dirs[2];   /* Present directories, paths owned */
+    int dir_count;
+    session_list_t list;
+    int fd;                  /* Duplicate of the scanner's eventfd */
+};
+
+/**
+ * Tell whoever polls the scanner that results are ready
+ */
+static void signal_ready(int fd) {
+    uint64_t one = 1;
+
+    if (fd >= 0 && write(fd, &one, sizeof(one)) != (ssize_t)sizeof(one)) {
+        logger_log(LOG_WARN, "Failed to signal user session scan: %s", strerror(errno));
+    }
+}
+
+/**
+ * Check whether two sets of directory stamps describe the same state
+ */
+static bool stamps_equal(const session_dir_stamp_t *a, const session_dir_stamp_t *b) {
+    for (int i = 0; i < 2; i++) {
+        if (a[i].present != b[i].present || a[i].dev != b[i].dev || a[i].ino != b[i].ino ||
+            a[i].mtime_sec != b[i].mtime_sec || a[i].mtime_nsec != b[i].mtime_nsec) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Free a scan and everything it owns
+ */
+static void scan_free(struct session_user_scan *scan) {
+    for (int i = 0; i < scan->dir_count; i++) {
+        free((char *)scan->dirs[i].path);
+    }
+    session_list_free(&scan->list);
+    if (scan->fd >= 0) {
+        close(scan->fd);
+    }
+    pthread_mutex_destroy(&scan->lock);
+    free(scan);
+}
+
+/**
+ * Find the sessions in the data home of a user
+ */
+static void scan_run(struct session_user_scan *scan) {
+    uid_t old_uid = 0;
+    gid_t old_gid = 0;
+
+    /* Read as the user, so nothing they could not read themselves is opened as root */
+    bool as_user = geteuid() == 0;
+    if (as_user) {
+        old_gid = (gid_t)setfsgid(scan->gid);
+        old_uid = (uid_t)setfsuid(scan->uid);
+    }
+
+    /* The user's own directories are not worth a cache file */
+    if (session_discover_in(&scan->list, scan->dirs, scan->dir_count, NULL) != KIA_SUCCESS) {
+        logger_log(LOG_DEBUG, "No sessions found for user %d", (int)scan->uid);
+    }
+
+    if (as_user) {
+        setfsuid(old_uid);
+        setfsgid(old_gid);
+    }
+}
+
+/**
+ * Scan thread: scan, then signal the results or discard them
+ */
+static void *scan_main(void *arg) {
+    struct session_user_scan *scan = arg;
+
+    scan_run(scan);
+
+    pthread_mutex_lock(&scan->lock);
+    scan->done = true;
+    bool abandoned = scan->abandoned;
+    pthread_mutex_unlock(&scan->lock);
+
+    if (abandoned) {
+        logger_log(LOG_INFO, "Abandoned session scan of user %d finished, results discarded",
+                   (int)scan->uid);
+        scan_free(scan);
+        return NULL;
+    }
+    signal_ready(scan->fd);
+    return NULL;
+}
+
+/**
+ * Wait for the scan, if one is running, and hand its results to its entry
+ * A scan that is not done within SESSION_USER_SCAN_TIMEOUT_MS is left to
+ * finish on its own; its user gets no sessions and is rescanned next time
+ */
+static void join_scan(session_user_t *users) {
+    struct session_user_scan *scan = users->scan;
+    struct timespec deadline;
+
+    if (!scan) {
+        return;
+    }
+    users->scan = NULL;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += SESSION_USER_SCAN_TIMEOUT_MS / 1000;
+    deadline.tv_nsec += (long)(SESSION_USER_SCAN_TIMEOUT_MS % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    session_user_entry_t *entry = &users->entries[scan->entry];
+    if (pthread_timedjoin_np(scan->thread, NULL, &deadline) != 0) {
+        pthread_mutex_lock(&scan->lock);
+        bool abandon = !scan->done;
+        scan->abandoned = abandon;
+        pthread_mutex_unlock(&scan->lock);
+
+        if (abandon) {
+            pthread_detach(scan->thread);
+            logger_log(LOG_WARN, "Session scan of user '%s' still running after %d ms, giving up",
+                       entry->username, SESSION_USER_SCAN_TIMEOUT_MS);
+            users->abandoned++;
+            session_list_free(&entry->list);
+            memset(entry->stamps, 0, sizeof(entry->stamps));
+            entry->generation++;
+            return;
+        }
+        pthread_join(scan->thread, NULL);
+    }
+
+    session_list_free(&entry->list);
+    entry->list = scan->list;
+    memset(&scan->list, 0, sizeof(scan->list));
+    scan_free(scan);
+}
+
+/**
+ * Set up a scan of the present directories of an entry
+ */
+static struct session_user_scan *scan_new(session_user_t *users, int idx) {
+    const session_user_entry_t *entry = &users->entries[idx];
+
+    struct session_user_scan *scan = calloc(1, sizeof(*scan));
+    if (!scan) {
+        return NULL;
+    }
+    pthread_mutex_init(&scan->lock, NULL);
+    scan->entry = idx;
+    scan->uid = entry->uid;
+    scan->gid = entry->gid;
+    scan->fd = users->fd >= 0 ? fcntl(users->fd, F_DUPFD_CLOEXEC, 0) : -1;
+    for (int i = 0; i < 2; i++) {
+        if (!entry->stamps[i].present) {
+            continue;
+        }
+        scan->dirs[scan->dir_count].type = entry->dirs[i].type;
+        scan->dirs[scan->dir_count].path = strdup(entry->dirs[i].path);
+        if (!scan->dirs[scan->dir_count++].path) {
+            scan_free(scan);
+            return NULL;
+        }
+    }
+    return scan;
+}
+
+/**
+ * Free one remembered user
+ */
+static void entry_free(session_user_entry_t *entry) {
+    free(entry->username);
+    free((char *)entry->dirs[0].path);
+    free((char *)entry->dirs[1].path);
+    session_list_free(&entry->list);
+    memset(entry, 0, sizeof(*entry));
+}
+
+/**
+ * Set up a remembered user with the session directories under a home directory
+ */
+static int entry_init(session_user_entry_t *entry, const struct passwd *pwd) {
+    char path[512];
+    const char *home = pwd->pw_dir;
+
+    entry->username = strdup(pwd->pw_name);
+    entry->uid = pwd->pw_uid;
+    entry->gid = pwd->pw_gid;
+
+    int len = snprintf(path, sizeof(path), "%s/" SESSION_USER_DATA_HOME "/xsessions", home);
+    entry->dirs[0].path = len > 0 && (size_t)len < sizeof(path) ? strdup(path) : NULL;
+    entry->dirs[0].type = SESSION_X11;
+
+    len = snprintf(path, sizeof(path), "%s/" SESSION_USER_DATA_HOME "/wayland-sessions", home);
+    entry->dirs[1].path = len > 0 && (size_t)len < sizeof(path) ? strdup(path) : NULL;
+    entry->dirs[1].type = SESSION_WAYLAND;
+
+    if (!entry->username || !entry->dirs[0].path || !entry->dirs[1].path) {
+        entry_free(entry);
+        return KIA_ERROR_SESSION;
+    }
+    return KIA_SUCCESS;
+}
+
+/**
+ * Find the entry of a user, making room for it if it is not remembered
+ * @return Entry index, or -1 if the user is unknown or memory ran out
+ */
+static int entry_get(session_user_t *users, const char *username) {
+    for (int i = 0; i < users->count; i++) {
+        if (strcmp(users->entries[i].username, username) == 0) {
+            return i;
+        }
+    }
+
+    errno = 0;
+    struct passwd *pwd = getpwnam(username);
+    if (!pwd || !pwd->pw_dir || pwd->pw_dir[0] != '/') {
+        return -1;
+    }
+
+    int idx = users->count;
+    if (idx == SESSION_USER_MAX) {
+        /* Forget the user seen longest ago */
+        idx = 0;
+        for (int i = 1; i < users->count; i++) {
+            if (users->entries[i].last_used < users->entries[idx].last_used) {
+                idx = i;
+            }
+        }
+        if (users->merged == idx) {
+            users->merged = -1;  /* Its sessions are dropped on the next merge */
+        }
+        entry_free(&users->entries[idx]);
+    }
+
+    if (entry_init(&users->entries[idx], pwd) != KIA_SUCCESS) {
+        if (idx < users->count) {
+            /* Keep the table dense */
+            users->entries[idx] = users->entries[--users->count];
+            memset(&users->entries[users->count], 0, sizeof(users->entries[0]));
+        }
+        return -1;
+    }
+    if (idx == users->count) {
+        users->count++;
+    }
+    return idx;
+}
+
+int session_user_init(session_user_t *users) {
+    if (!users) {
+        return KIA_ERROR_SESSION;
+    }
+
+    memset(users, 0, sizeof(*users));
+    users->current = -1;
+    users->merged = -1;
+
+    users->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (users->fd < 0) {
+        logger_log(LOG_WARN, "Failed to create user session scan eventfd: %s", strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+
+    return KIA_SUCCESS;
+}
+
+int session_user_start(session_user_t *users, const char *username) {
+    session_dir_stamp_t stamps[2];
+
+    /* Validate input parameters */
+    if (!users || !username || username[0] == '\0') {
+        return KIA_ERROR_SESSION;
+    }
+
+    /* Entries belong to the scan thread while it runs */
+    join_scan(users);
+
+    users->current = entry_get(users, username);
+    if (users->current < 0) {
+        logger_log(LOG_DEBUG, "Not looking for sessions of unknown user '%s'", username);
+        return KIA_ERROR_SESSION;
+    }
+
+    session_user_entry_t *entry = &users->entries[users->current];
+    entry->last_used = ++users->clock;
+
+    /* Stamp before scanning so changes made during the scan force a rescan */
+    session_cache_stamp(entry->dirs, 2, stamps);
+    if (entry->generation > 0 && stamps_equal(stamps, entry->stamps)) {
+        users->hits++;
+        logger_log(LOG_DEBUG, "Reusing %d session(s) found for user '%s'", entry->list.count,
+                   username);
+        signal_ready(users->fd);
+        return KIA_SUCCESS;
+    }
+
+    memcpy(entry->stamps, stamps, sizeof(stamps));
+    entry->generation++;
+
+    if (!stamps[0].present && !stamps[1].present) {
+        session_list_free(&entry->list);
+        signal_ready(users->fd);
+        return KIA_SUCCESS;
+    }
+
+    struct session_user_scan *scan = scan_new(users, users->current);
+    if (!scan) {
+        logger_log(LOG_ERROR, "Failed to allocate session scan of user '%s'", username);
+        return KIA_ERROR_SESSION;
+    }
+    users->scans++;
+    int err = pthread_create(&scan->thread, NULL, scan_main, scan);
+    if (err != 0) {
+        logger_log(LOG_WARN, "Failed to start user session scan: %s, scanning inline",
+                   strerror(err));
+        scan_run(scan);
+        session_list_free(&entry->list);
+        entry->list = scan->list;
+        memset(&scan->list, 0, sizeof(scan->list));
+        scan_free(scan);
+        signal_ready(users->fd);
+        return KIA_SUCCESS;
+    }
+    users->scan = scan;
+
+    return KIA_SUCCESS;
+}
+
+int session_user_fd(const session_user_t *users) {
+    return users && users->current >= 0 ? users->fd : -1;
+}
+
+int session_user_merge(session_user_t *users, session_list_t *list,
+                       const session_dir_t *dirs, int dir_count) {
+    uint64_t value;
+
+    /* Validate input parameters */
+    if (!users || !list) {
+        return KIA_ERROR_SESSION;
+    }
+
+    join_scan(users);
+    if (users->fd >= 0 && read(users->fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        logger_log(LOG_WARN, "Failed to clear user session scan eventfd: %s", strerror(errno));
+    }
+
+    int target = users->current;
+    if (target == users->merged &&
+        (target < 0 || users->entries[target].generation == users->merged_generation)) {
+        return 0;  /* Already merged */
+    }
+
+    int changed = session_list_drop_overlay(list, dirs, dir_count);
+    users->merged = -1;
+    if (target < 0) {
+        return changed;
+    }
+
+    session_user_entry_t *entry = &users->entries[target];
+    int merged = entry->list.count > 0 ? session_list_merge(list, &entry->list, dir_count) : 0;
+    if (merged < 0) {
+        logger_log(LOG_ERROR, "Failed to merge sessions of user '%s'", entry->username);
+        return KIA_ERROR_SESSION;
+    }
+
+    users->merged = target;
+    users->merged_generation = entry->generation;
+    if (merged > 0) {
+        logger_log(LOG_INFO, "Merged %d session(s) of user '%s'", merged, entry->username);
+    }
+    return changed + merged;
+}
+
+int session_user_drop_stale(session_user_t *users, session_list_t *list,
+                            const session_dir_t *dirs, int dir_count) {
+    if (!users || !list || users->merged < 0 || users->merged == users->current) {
+        return 0;
+    }
+
+    users->merged = -1;
+    return session_list_drop_overlay(list, dirs, dir_count);
+}
+
+void session_user_free(session_user_t *users) {
+    if (!users) {
+        return;
+    }
+
+    join_scan(users);
+    for (int i = 0; i < users->count; i++) {
+        entry_free(&users->entries[i]);
+    }
+    if (users->fd >= 0) {
+        close(users->fd);
+    }
+
+    memset(users, 0, sizeof(*users));
+    users->current = -1;
+    users->merged = -1;
+    users->fd = -1;
+}
@@ -0,0 +1,387 @@
+#include "session_watch.h"
+#include "desktop.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/inotify.h>
+#include <sys/epoll.h>
+
+/* Desktop files are picked up once fully written or renamed into place */
+#define WATCH_DIR_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | \
+                        IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+#define WATCH_PARENT_MASK (IN_CREATE | IN_MOVED_TO | IN_ONLYDIR)
+
+/**
+ * Get the last path component of a directory path
+ */
+static const char *dir_basename(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+/**
+ * Watch a directory, or its parent while the directory does not exist
+ */
+static void arm_dir(session_watch_t *watch, int idx) {
+    session_watch_dir_t *dir = &watch->dirs[idx];
+    char parent[512];
+
+    dir->wd = inotify_add_watch(watch->inotify_fd, dir->path, WATCH_DIR_MASK);
+    if (dir->wd >= 0) {
+        /* Drop the parent watch unless another missing directory still needs it */
+        int parent_wd = dir->parent_wd;
+        dir->parent_wd = -1;
+        if (parent_wd >= 0) {
+            bool shared = false;
+            for (int i = 0; i < watch->dir_count; i++) {
+                shared = shared || watch->dirs[i].parent_wd == parent_wd;
+            }
+            if (!shared) {
+                inotify_rm_watch(watch->inotify_fd, parent_wd);
+            }
+        }
+        return;
+    }
+
+    if (errno != ENOENT) {
+        logger_log(LOG_WARN, "Failed to watch session directory %s: %s", dir->path,
+                   strerror(errno));
+        return;
+    }
+
+    const char *slash = strrchr(dir->path, '/');
+    size_t parent_len = slash ? (size_t)(slash - dir->path) : 0;
+    if (parent_len >= sizeof(parent)) {
+        return;
+    }
+    if (parent_len == 0) {
+        strcpy(parent, "/");
+    } else {
+        memcpy(parent, dir->path, parent_len);
+        parent[parent_len] = '\0';
+    }
+
+    dir->parent_wd = inotify_add_watch(watch->inotify_fd, parent, WATCH_PARENT_MASK);
+    if (dir->parent_wd < 0) {
+        logger_log(LOG_DEBUG, "Cannot watch for session directory %s: %s", dir->path,
+                   strerror(errno));
+    }
+}
+
+/**
+ * Re-resolve a desktop file ID across the watched directories of its type
+ */
+static void resolve_file(session_watch_t *watch, session_list_t *list,
+                         session_type_t type, const char *file_id) {
+    session_list_resolve_file(list, watch->dir_list, watch->dir_count, type, file_id);
+}
+
+/**
+ * Re-resolve every session read from a directory that went away
+ */
+static int drop_dir(session_watch_t *watch, session_list_t *list, int idx) {
+    char file_id[256];
+    int applied = 0;
+
+    /* Each pass moves one session to another directory or removes it */
+    for (int i = 0; i < list->count; ) {
+        if (list->records[i].dir != idx) {
+            i++;
+            continue;
+        }
+        strncpy(file_id, session_list_file(list, i), sizeof(file_id) - 1);
+        file_id[sizeof(file_id) - 1] = '\0';
+        resolve_file(watch, list, watch->dirs[idx].type, file_id);
+        if (i < list->count && list->records[i].dir == idx) {
+            session_list_remove(list, i);  /* Could not be re-resolved */
+        }
+        applied++;
+    }
+
+    return applied;
+}
+
+/**
+ * Resolve every desktop file of a directory against the list
+ */
+static int scan_dir(session_watch_t *watch, session_list_t *list, int idx) {
+    struct dirent *entry;
+    int applied = 0;
+
+    DIR *dir = opendir(watch->dirs[idx].path);
+    if (!dir) {
+        return 0;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (desktop_is_file_id(entry->d_name)) {
+            resolve_file(watch, list, watch->dirs[idx].type, entry->d_name);
+            applied++;
+        }
+    }
+
+    closedir(dir);
+    return applied;
+}
+
+/**
+ * Apply one inotify event to the list
+ */
+static int handle_event(session_watch_t *watch, session_list_t *list,
+                        const struct inotify_event *event) {
+    int applied = 0;
+
+    if (event->mask & IN_Q_OVERFLOW) {
+        /* Events were lost, rebuild every directory from scratch */
+        logger_log(LOG_WARN, "Session watch queue overflowed, rescanning session directories");
+        for (int i = list->count - 1; i >= 0; i--) {
+            if (list->records[i].dir < watch->dir_count) {
+                session_list_remove(list, i);
+                applied++;
+            }
+        }
+        for (int i = 0; i < watch->dir_count; i++) {
+            applied += scan_dir(watch, list, i);
+        }
+        return applied;
+    }
+
+    for (int i = 0; i < watch->dir_count; i++) {
+        session_watch_dir_t *dir = &watch->dirs[i];
+
+        if (event->wd == dir->wd) {
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                logger_log(LOG_INFO, "Session directory removed: %s", dir->path);
+                if (!(event->mask & IN_IGNORED)) {
+                    inotify_rm_watch(watch->inotify_fd, dir->wd);
+                }
+                dir->wd = -1;
+                applied += drop_dir(watch, list, i);
+                arm_dir(watch, i);
+                if (dir->wd >= 0) {
+                    applied += scan_dir(watch, list, i);
+                }
+            } else if (event->len > 0 && desktop_is_file_id(event->name)) {
+                /* The change may expose or hide the same ID in another directory */
+                resolve_file(watch, list, dir->type, event->name);
+                applied++;
+            }
+        } else if (event->wd == dir->parent_wd && event->len > 0 &&
+                   strcmp(event->name, dir_basename(dir->path)) == 0) {
+            logger_log(LOG_INFO, "Session directory created: %s", dir->path);
+            arm_dir(watch, i);
+            if (dir->wd >= 0) {
+                applied += scan_dir(watch, list, i);
+            }
+        }
+    }
+
+    return applied;
+}
+
+int session_watch_init(session_watch_t *watch, const session_dir_t *dirs, int dir_count) {
+    if (!watch) {
+        return KIA_ERROR_SESSION;
+    }
+
+    memset(watch, 0, sizeof(*watch));
+    watch->fd = -1;
+    watch->inotify_fd = -1;
+
+    /* Validate input parameters */
+    if (!dirs || dir_count <= 0 || dir_count >= SESSION_DIR_NONE) {
+        return KIA_ERROR_SESSION;
+    }
+
+    watch->dirs = calloc((size_t)dir_count, sizeof(*watch->dirs));
+    watch->dir_list = calloc((size_t)dir_count, sizeof(*watch->dir_list));
+    if (!watch->dirs || !watch->dir_list) {
+        session_watch_close(watch);
+        return KIA_ERROR_SESSION;
+    }
+
+    for (int i = 0; i < dir_count; i++) {
+        watch->dirs[i].path = strdup(dirs[i].path);
+        watch->dirs[i].type = dirs[i].type;
+        watch->dirs[i].wd = -1;
+        watch->dirs[i].parent_wd = -1;
+        watch->dir_count = i + 1;
+        if (!watch->dirs[i].path) {
+            session_watch_close(watch);
+            return KIA_ERROR_SESSION;
+        }
+        watch->dir_list[i].path = watch->dirs[i].path;
+        watch->dir_list[i].type = dirs[i].type;
+    }
+
+    watch->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch->inotify_fd < 0) {
+        logger_log(LOG_WARN, "Failed to initialize inotify: %s", strerror(errno));
+        session_watch_close(watch);
+        return KIA_ERROR_SESSION;
+    }
+
+    struct epoll_event event = { .events = EPOLLIN, .data.fd = watch->inotify_fd };
+    watch->fd = epoll_create1(EPOLL_CLOEXEC);
+    if (watch->fd < 0 || epoll_ctl(watch->fd, EPOLL_CTL_ADD, watch->inotify_fd, &event) != 0) {
+        logger_log(LOG_WARN, "Failed to set up session watch polling: %s", strerror(errno));
+        session_watch_close(watch);
+        return KIA_ERROR_SESSION;
+    }
+
+    for (int i = 0; i < dir_count; i++) {
+        arm_dir(watch, i);
+    }
+
+    logger_log(LOG_DEBUG, "Watching %d session director%s", dir_count,
+               dir_count == 1 ? "y" : "ies");
+    return KIA_SUCCESS;
+}
+
+int session_watch_fd(const session_watch_t *watch) {
+    return watch ? watch->fd : -1;
+}
+
+int session_watch_add_source(session_watch_t *watch, int fd, session_watch_source_fn fn,
+                             void *data) {
+    /* Validate input parameters */
+    if (!watch || watch->fd < 0 || fd < 0 || !fn ||
+        watch->source_count >= SESSION_WATCH_MAX_SOURCES) {
+        return KIA_ERROR_SESSION;
+    }
+
+    struct epoll_event event = { .events = EPOLLIN, .data.fd = fd };
+    if (epoll_ctl(watch->fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        logger_log(LOG_WARN, "Failed to add session watch source: %s", strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+
+    session_watch_source_t *source = &watch->sources[watch->source_count++];
+    source->fd = fd;
+    source->fn = fn;
+    source->data = data;
+    return KIA_SUCCESS;
+}
+
+int session_watch_remove_source(session_watch_t *watch, int fd) {
+    if (!watch) {
+        return KIA_ERROR_SESSION;
+    }
+
+    for (int i = 0; i < watch->source_count; i++) {
+        if (watch->sources[i].fd == fd) {
+            epoll_ctl(watch->fd, EPOLL_CTL_DEL, fd, NULL);
+            watch->sources[i] = watch->sources[--watch->source_count];
+            return KIA_SUCCESS;
+        }
+    }
+
+    return KIA_ERROR_SESSION;
+}
+
+/**
+ * Apply every queued inotify event to the list
+ */
+static int read_events(session_watch_t *watch, session_list_t *list) {
+    _Alignas(struct inotify_event) char buf[4096];
+    int applied = 0;
+
+    while (1) {
+        ssize_t len = read(watch->inotify_fd, buf, sizeof(buf));
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            logger_log(LOG_ERROR, "Failed to read session watch events: %s", strerror(errno));
+            return KIA_ERROR_SESSION;
+        }
+
+        for (char *p = buf; p < buf + len; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            applied += handle_event(watch, list, event);
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    return applied;
+}
+
+/**
+ * Run the callback of a readable source and drop it
+ */
+static int fire_source(session_watch_t *watch, session_list_t *list, int fd) {
+    for (int i = 0; i < watch->source_count; i++) {
+        if (watch->sources[i].fd != fd) {
+            continue;
+        }
+        session_watch_source_t source = watch->sources[i];
+        session_watch_remove_source(watch, fd);
+        int changed = source.fn(list, source.data);
+        return changed > 0 ? changed : 0;
+    }
+
+    return 0;
+}
+
+int session_watch_process(session_watch_t *watch, session_list_t *list) {
+    struct epoll_event events[SESSION_WATCH_MAX_SOURCES + 1];
+    int applied = 0;
+
+    /* Validate input parameters */
+    if (!watch || watch->fd < 0 || !list) {
+        return KIA_ERROR_SESSION;
+    }
+
+    int ready = epoll_wait(watch->fd, events, SESSION_WATCH_MAX_SOURCES + 1, 0);
+    if (ready < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        logger_log(LOG_ERROR, "Failed to poll session watch: %s", strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+
+    for (int i = 0; i < ready; i++) {
+        if (events[i].data.fd != watch->inotify_fd) {
+            applied += fire_source(watch, list, events[i].data.fd);
+            continue;
+        }
+        int result = read_events(watch, list);
+        if (result < 0) {
+            return KIA_ERROR_SESSION;
+        }
+        applied += result;
+    }
+
+    return applied;
+}
+
+void session_watch_close(session_watch_t *watch) {
+    if (!watch) {
+        return;
+    }
+
+    if (watch->fd >= 0) {
+        close(watch->fd);
+    }
+    if (watch->inotify_fd >= 0) {
+        close(watch->inotify_fd);
+    }
+    for (int i = 0; i < watch->dir_count; i++) {
+        free(watch->dirs[i].path);
+    }
+    free(watch->dirs);
+    free(watch->dir_list);
+
+    memset(watch, 0, sizeof(*watch));
+    watch->fd = -1;
+    watch->inotify_fd = -1;
+}
@@ -0,0 +1,345 @@
+#define _GNU_SOURCE
+#include "session_xorg.h"
+#include "session_spawn.h"
+#include "session_group.h"
+#include "session_path.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+/* X authority entry fields */
+#define XAUTH_FAMILY_WILD 0xffff
+#define XAUTH_COOKIE_NAME "MIT-MAGIC-COOKIE-1"
+
+/* Time a server gets to exit after SIGTERM when Kia stops it itself */
+#define XORG_STOP_TIMEOUT_MS 2000
+
+static double elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) * 1e3 +
+           (double)(now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/**
+ * Append a 16-bit big-endian length and the bytes it counts
+ */
+static void put_counted(unsigned char *buf, size_t *pos, const void *data, size_t len) {
+    buf[(*pos)++] = (unsigned char)(len >> 8);
+    buf[(*pos)++] = (unsigned char)len;
+    memcpy(buf + *pos, data, len);
+    *pos += len;
+}
+
+int session_xorg_write_auth(int fd, const unsigned char *cookie, int display) {
+    unsigned char buf[128];
+    char number[16] = "";
+    size_t pos = 0;
+
+    if (fd < 0 || !cookie) {
+        return KIA_ERROR_SESSION;
+    }
+    if (display >= 0) {
+        snprintf(number, sizeof(number), "%d", display);
+    }
+
+    buf[pos++] = (unsigned char)(XAUTH_FAMILY_WILD >> 8);
+    buf[pos++] = (unsigned char)XAUTH_FAMILY_WILD;
+    put_counted(buf, &pos, "", 0);
+    put_counted(buf, &pos, number, strlen(number));
+    put_counted(buf, &pos, XAUTH_COOKIE_NAME, strlen(XAUTH_COOKIE_NAME));
+    put_counted(buf, &pos, cookie, SESSION_XORG_COOKIE_LEN);
+
+    if (ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0) {
+        return KIA_ERROR_SESSION;
+    }
+    for (size_t done = 0; done < pos; ) {
+        ssize_t n = write(fd, buf + done, pos - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return KIA_ERROR_SESSION;
+        }
+        done += (size_t)n;
+    }
+    return KIA_SUCCESS;
+}
+
+/**
+ * Fill a buffer with random bytes from the kernel
+ */
+static int random_bytes(unsigned char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = getrandom(buf, len, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return KIA_ERROR_SESSION;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return KIA_SUCCESS;
+}
+
+/**
+ * Create an authority file from a mkstemp() template
+ * @return Open descriptor, or -1 on error
+ */
+static int create_auth_file(char *path, size_t path_len, const char *dir, const char *kind) {
+    int len = snprintf(path, path_len, "%s/xauth-%s-XXXXXX", dir, kind);
+    if (len < 0 || (size_t)len >= path_len) {
+        logger_log(LOG_ERROR, "X authority directory path too long: %s", dir);
+        path[0] = '\0';
+        return -1;
+    }
+    int fd = mkostemp(path, O_CLOEXEC);
+    if (fd < 0) {
+        logger_log(LOG_ERROR, "Failed to create X authority file in %s: %s", dir, strerror(errno));
+        path[0] = '\0';
+    }
+    return fd;
+}
+
+/**
+ * Get the virtual console Kia runs on
+ * @return Console number, or 0 if stdin is not a virtual console
+ */
+static int current_vt(void) {
+    const char *tty = ttyname(STDIN_FILENO);
+    int vt;
+
+    if (tty && sscanf(tty, "/dev/tty%d", &vt) == 1 && vt > 0) {
+        return vt;
+    }
+    return 0;
+}
+
+/**
+ * Read the display number the server writes to -displayfd
+ * @return Display number, or -1 on timeout, early exit or garbage
+ */
+static int wait_ready(int fd, int timeout_ms) {
+    struct timespec start;
+    char buf[32];
+    size_t len = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (len < sizeof(buf) - 1 && !memchr(buf, '\n', len)) {
+        int remaining = timeout_ms - (int)elapsed_ms(&start);
+        if (remaining <= 0) {
+            logger_log(LOG_ERROR, "X server not ready after %d ms", timeout_ms);
+            return -1;
+        }
+
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, remaining);
+        if (ready < 0 && errno != EINTR) {
+            return -1;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+
+        ssize_t n = read(fd, buf + len, sizeof(buf) - 1 - len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            /* The server exited, or closed the pipe without reporting */
+            break;
+        }
+        len += (size_t)n;
+    }
+    buf[len] = '\0';
+
+    char *end;
+    long display = strtol(buf, &end, 10);
+    if (end == buf || (*end != '\n' && *end != '\0') || display < 0 || display > 65535) {
+        logger_log(LOG_ERROR, "X server exited without reporting a display");
+        return -1;
+    }
+    return (int)display;
+}
+
+int session_xorg_start(session_xorg_t *xorg, const char *server, const char *auth_dir,
+                       int display, int timeout_ms) {
+    struct timespec start;
+    int fds[2];
+
+    /* Validate input parameters */
+    if (!xorg || !server || server[0] == '\0' || !auth_dir || timeout_ms <= 0) {
+        return KIA_ERROR_SESSION;
+    }
+
+    memset(xorg, 0, sizeof(*xorg));
+    xorg->display = -1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (mkdir(auth_dir, 0711) != 0 && errno != EEXIST) {
+        logger_log(LOG_ERROR, "Failed to create %s: %s", auth_dir, strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+    if (random_bytes(xorg->cookie, sizeof(xorg->cookie)) != KIA_SUCCESS) {
+        logger_log(LOG_ERROR, "Failed to generate X authority cookie: %s", strerror(errno));
+        return KIA_ERROR_SESSION;
+    }
+
+    int auth_fd = create_auth_file(xorg->server_auth, sizeof(xorg->server_auth), auth_dir,
+                                   "server");
+    if (auth_fd < 0) {
+        return KIA_ERROR_SESSION;
+    }
+    int result = session_xorg_write_auth(auth_fd, xorg->cookie, -1);
+    close(auth_fd);
+    if (result != KIA_SUCCESS) {
+        logger_log(LOG_ERROR, "Failed to write %s", xorg->server_auth);
+        session_xorg_remove_auth(xorg);
+        return KIA_ERROR_SESSION;
+    }
+
+    /* Only the write end reaches the server */
+    if (pipe2(fds, O_CLOEXEC) != 0 || fcntl(fds[1], F_SETFD, 0) != 0) {
+        logger_log(LOG_ERROR, "Failed to create display pipe: %s", strerror(errno));
+        session_xorg_remove_auth(xorg);
+        return KIA_ERROR_SESSION;
+    }
+
+    char number[16], displayfd[16], vt[16];
+    const char *argv[12];
+    int argc = 0;
+    snprintf(displayfd, sizeof(displayfd), "%d", fds[1]);
+    argv[argc++] = server;
+    if (display >= 0) {
+        snprintf(number, sizeof(number), ":%d", display);
+        argv[argc++] = number;
+    }
+    argv[argc++] = "-displayfd";
+    argv[argc++] = displayfd;
+    argv[argc++] = "-auth";
+    argv[argc++] = xorg->server_auth;
+    argv[argc++] = "-nolisten";
+    argv[argc++] = "tcp";
+    int vt_num = current_vt();
+    if (vt_num > 0) {
+        snprintf(vt, sizeof(vt), "vt%d", vt_num);
+        argv[argc++] = vt;
+    }
+    argv[argc] = NULL;
+
+    const char *search_path = getenv("PATH");
+    char path_var[1024];
+    snprintf(path_var, sizeof(path_var), "PATH=%s",
+             search_path && search_path[0] ? search_path : SESSION_PATH_DEFAULT);
+    char *envp[] = { path_var, NULL };
+
+    session_spawn_t spawn = { .exec_count = 1, .envp = envp };
+    spawn.execs[0] = (session_spawn_exec_t){ strchr(server, '/') ? server : NULL, argv };
+    result = session_spawn(&spawn, &xorg->pid);
+    close(fds[1]);
+    if (result != KIA_SUCCESS) {
+        close(fds[0]);
+        xorg->pid = 0;
+        session_xorg_remove_auth(xorg);
+        return KIA_ERROR_SESSION;
+    }
+    session_group_track(xorg->pid);
+
+    xorg->display = wait_ready(fds[0], timeout_ms);
+    close(fds[0]);
+    if (xorg->display < 0) {
+        session_xorg_stop(xorg);
+        session_xorg_remove_auth(xorg);
+        return KIA_ERROR_SESSION;
+    }
+
+    logger_log(LOG_INFO, "X server (PID %d) ready on :%d after %.0f ms",
+               xorg->pid, xorg->display, elapsed_ms(&start));
+    return KIA_SUCCESS;
+}
+
+int session_xorg_grant(session_xorg_t *xorg, uid_t uid, gid_t gid) {
+    if (!xorg || xorg->display < 0 || xorg->server_auth[0] == '\0') {
+        return KIA_ERROR_SESSION;
+    }
+
+    /* The client file sits next to the server's */
+    char dir[sizeof(xorg->server_auth)];
+    snprintf(dir, sizeof(dir), "%s", xorg->server_auth);
+    char *slash = strrchr(dir, '/');
+    if (!slash) {
+        return KIA_ERROR_SESSION;
+    }
+    *slash = '\0';
+
+    int fd = create_auth_file(xorg->client_auth, sizeof(xorg->client_auth), dir, "client");
+    if (fd < 0) {
+        return KIA_ERROR_SESSION;
+    }
+    int result = KIA_SUCCESS;
+    if (fchown(fd, uid, gid) != 0 ||
+        session_xorg_write_auth(fd, xorg->cookie, xorg->display) != KIA_SUCCESS) {
+        logger_log(LOG_ERROR, "Failed to write %s: %s", xorg->client_auth, strerror(errno));
+        result = KIA_ERROR_SESSION;
+    }
+    close(fd);
+
+    if (result != KIA_SUCCESS) {
+        unlink(xorg->client_auth);
+        xorg->client_auth[0] = '\0';
+    }
+    return result;
+}
+
+void session_xorg_stop(session_xorg_t *xorg) {
+    struct timespec start;
+
+    if (!xorg || xorg->pid <= 0) {
+        return;
+    }
+
+    kill(xorg->pid, SIGTERM);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (waitpid(xorg->pid, NULL, WNOHANG) == 0) {
+        if (elapsed_ms(&start) >= XORG_STOP_TIMEOUT_MS) {
+            logger_log(LOG_WARN, "X server (PID %d) ignored SIGTERM, killing it", xorg->pid);
+            kill(xorg->pid, SIGKILL);
+            waitpid(xorg->pid, NULL, 0);
+            break;
+        }
+        struct timespec pause = { 0, 10 * 1000 * 1000 };
+        nanosleep(&pause, NULL);
+    }
+    session_group_untrack(xorg->pid);
+    xorg->pid = 0;
+}
+
+void session_xorg_remove_auth(session_xorg_t *xorg) {
+    if (!xorg) {
+        return;
+    }
+    if (xorg->server_auth[0] != '\0') {
+        unlink(xorg->server_auth);
+        xorg->server_auth[0] = '\0';
+    }
+    if (xorg->client_auth[0] != '\0') {
+        unlink(xorg->client_auth);
+        xorg->client_auth[0] = '\0';
+    }
+}
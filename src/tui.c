@@ -1,8 +1,11 @@
 #include "tui.h"
 #include "config.h"
 #include <ncurses.h>
+#include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <poll.h>
+#include <errno.h>
 
 /**
  * Secure memory clearing function
@@ -28,16 +31,65 @@ static void secure_memzero(void *ptr, size_t len) {
 #define FIELD_USERNAME 0
 #define FIELD_PASSWORD 1
 
+/* Terminal the TUI draws on, NULL until initialised or once released */
+static SCREEN *screen = NULL;
+
+/* Curses mode left while a session owns the terminal */
+static bool suspended = false;
+
+/* Pseudo key returned when the session list changed while waiting for input */
+#define KEY_SESSIONS_CHANGED (KEY_MAX + 1)
+
+/**
+ * Wait for a key press while applying session directory changes
+ * Pending keys are drained before blocking so input buffered by ncurses
+ * is never stranded behind poll()
+ */
+static int wait_for_key(session_list_t *sessions, session_watch_t *watch) {
+    int watch_fd = session_watch_fd(watch);
+
+    if (watch_fd < 0) {
+        return getch();
+    }
+
+    while (1) {
+        nodelay(stdscr, TRUE);
+        int ch = getch();
+        nodelay(stdscr, FALSE);
+        if (ch != ERR) {
+            return ch;
+        }
+
+        struct pollfd fds[2] = {
+            { .fd = STDIN_FILENO, .events = POLLIN },
+            { .fd = watch_fd, .events = POLLIN }
+        };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return ERR;
+        }
+
+        if ((fds[1].revents & POLLIN) && session_watch_process(watch, sessions) > 0) {
+            return KEY_SESSIONS_CHANGED;
+        }
+    }
+}
+
 int tui_init(void) {
-    /* Initialize ncurses */
-    if (initscr() == NULL) {
+    /* Initialize ncurses, keeping the screen so it can be freed again */
+    screen = newterm(NULL, stdout, stdin);
+    if (screen == NULL) {
         return KIA_ERROR_SYSTEM;
     }
+    set_term(screen);
 
     /* Set up ncurses modes */
     cbreak();              /* Disable line buffering */
     noecho();              /* Don't echo input */
     keypad(stdscr, TRUE);  /* Enable function keys and arrow keys */
+    set_escdelay(25);      /* Escape cancels without a noticeable wait */
     curs_set(1);           /* Show cursor */
 
     /* Initialize colors if supported */
@@ -53,7 +105,49 @@ int tui_init(void) {
 }
 
 void tui_cleanup(void) {
+    if (screen == NULL) {
+        return;
+    }
+    endwin();
+    delscreen(screen);
+    screen = NULL;
+    suspended = false;
+}
+
+void tui_suspend(void) {
+    if (screen == NULL || suspended) {
+        return;
+    }
+    def_prog_mode();
     endwin();
+    suspended = true;
+}
+
+void tui_release(void) {
+    if (screen == NULL || !suspended) {
+        return;
+    }
+    delscreen(screen);
+    screen = NULL;
+}
+
+void tui_resume(void) {
+    if (!suspended) {
+        return;
+    }
+    suspended = false;
+
+    /* A released screen is set up from scratch */
+    if (screen == NULL) {
+        if (tui_init() == KIA_SUCCESS) {
+            clear();
+            refresh();
+        }
+        return;
+    }
+    reset_prog_mode();
+    clear();
+    refresh();
 }
 
 void tui_draw_login_screen(const char *hostname, const char *version) {
@@ -254,7 +348,7 @@ int tui_get_credentials(char *username, size_t user_len,
     return KIA_SUCCESS;
 }
 
-int tui_select_session(const session_list_t *sessions, int default_idx) {
+int tui_select_session(session_list_t *sessions, session_watch_t *watch, int default_idx) {
     int max_y, max_x;
     int selected;
     int start_row;
@@ -264,7 +358,7 @@ int tui_select_session(const session_list_t *sessions, int default_idx) {
         return -1;
     }
     
-    if (sessions->sessions == NULL) {
+    if (sessions->records == NULL) {
         return -1;
     }
     
@@ -286,15 +380,15 @@ int tui_select_session(const session_list_t *sessions, int default_idx) {
     } else {
         selected = 0;
     }
-    
-    start_row = max_y / 3;
-    
-    /* Ensure we have room for all sessions */
-    if (start_row + sessions->count + 4 > max_y) {
-        start_row = 2;
-    }
 
     while (1) {
+        start_row = max_y / 3;
+        
+        /* Ensure we have room for all sessions */
+        if (start_row + sessions->count + 4 > max_y) {
+            start_row = 2;
+        }
+
         if (clear() == ERR) {
             return -1;
         }
@@ -315,7 +409,8 @@ int tui_select_session(const session_list_t *sessions, int default_idx) {
             }
             
             /* Validate session name is not empty */
-            if (sessions->sessions[i].name[0] == '\0') {
+            const char *name = session_list_name(sessions, i);
+            if (name == NULL || name[0] == '\0') {
                 continue;
             }
             
@@ -326,27 +421,35 @@ int tui_select_session(const session_list_t *sessions, int default_idx) {
                 if (has_colors()) {
                     attron(COLOR_PAIR(COLOR_HIGHLIGHT));
                 }
-                mvprintw(row, col, "> %-38s", sessions->sessions[i].name);
+                mvprintw(row, col, "> %-38s", name);
                 if (has_colors()) {
                     attroff(COLOR_PAIR(COLOR_HIGHLIGHT));
                 }
             } else {
-                mvprintw(row, col, "  %-38s", sessions->sessions[i].name);
+                mvprintw(row, col, "  %-38s", name);
             }
 
             /* Show session type */
-            const char *type_str = (sessions->sessions[i].type == SESSION_X11) ? "[X11]" : "[Wayland]";
+            const char *type_str =
+                (session_list_type(sessions, i) == SESSION_X11) ? "[X11]" : "[Wayland]";
             int type_col = max_x / 2 + 20;
             if (type_col < max_x - 10) {
                 mvprintw(row, type_col, "%s", type_str);
             }
         }
 
+        if (sessions->count == 0) {
+            const char *empty = "No sessions available";
+            int empty_col = (max_x - strlen(empty)) / 2;
+            if (empty_col < 0) empty_col = 0;
+            mvprintw(start_row, empty_col, "%s", empty);
+        }
+
         /* Draw instructions */
         const char *instruction = "Use arrow keys to navigate, Enter to select";
         int instr_col = (max_x - strlen(instruction)) / 2;
         if (instr_col < 0) instr_col = 0;
-        int instr_row = start_row + sessions->count + 2;
+        int instr_row = start_row + (sessions->count > 0 ? sessions->count : 1) + 2;
         if (instr_row < max_y) {
             mvprintw(instr_row, instr_col, "%s", instruction);
         }
@@ -355,8 +458,17 @@ int tui_select_session(const session_list_t *sessions, int default_idx) {
             return -1;
         }
 
+        /* Remember the highlighted session so it survives list updates */
+        const char *selected_file = session_list_file(sessions, selected);
+        session_type_t selected_type = selected < sessions->count ?
+                                       session_list_type(sessions, selected) : SESSION_X11;
+        char file_id[256] = "";
+        if (selected_file != NULL) {
+            strncpy(file_id, selected_file, sizeof(file_id) - 1);
+        }
+
         /* Get input */
-        int ch = getch();
+        int ch = wait_for_key(sessions, watch);
         
         /* Check for input error */
         if (ch == ERR) {
@@ -364,12 +476,27 @@ int tui_select_session(const session_list_t *sessions, int default_idx) {
         }
 
         switch (ch) {
+            case KEY_SESSIONS_CHANGED: {
+                /* Follow the highlighted session to its new position */
+                int idx = file_id[0] ? session_list_find_file(sessions, selected_type, file_id)
+                                     : -1;
+                if (idx >= 0) {
+                    selected = idx;
+                } else if (selected >= sessions->count) {
+                    selected = sessions->count > 0 ? sessions->count - 1 : 0;
+                }
+                break;
+            }
+
             case '\n':  /* Enter key */
             case KEY_ENTER:
                 /* Validate selection before returning */
                 if (selected >= 0 && selected < sessions->count) {
                     return selected;
                 }
+                if (sessions->count == 0) {
+                    break;  /* Wait for a session to be installed */
+                }
                 return -1;
 
             case KEY_UP:
@@ -533,4 +660,59 @@ void tui_show_message(const char *message) {
 
     /* Wait for user to see the message */
     napms(1500);  /* 1.5 seconds */
-}
\ No newline at end of file
+}
+
+tui_wait_t tui_wait_progress(const char *message, int frame, int fd, int tick_ms) {
+    static const char spinner[] = "|/-\\";
+    int max_y, max_x;
+
+    /* Validate input */
+    if (message == NULL || fd < 0) {
+        return TUI_WAIT_ERROR;
+    }
+
+    bool interactive = stdscr != NULL && !suspended;
+    if (interactive) {
+        getmaxyx(stdscr, max_y, max_x);
+        if (max_y >= 3 && max_x >= 10) {
+            char line[256];
+            snprintf(line, sizeof(line), "%s %c  (Esc to cancel)", message,
+                     spinner[(frame < 0 ? -frame : frame) % 4]);
+            int col = (max_x - (int)strlen(line)) / 2;
+            move(max_y - 3, 0);
+            clrtoeol();
+            if (has_colors()) {
+                attron(COLOR_PAIR(COLOR_MESSAGE));
+            }
+            mvprintw(max_y - 3, col < 0 ? 0 : col, "%.*s", max_x, line);
+            if (has_colors()) {
+                attroff(COLOR_PAIR(COLOR_MESSAGE));
+            }
+            refresh();
+        }
+    }
+
+    struct pollfd fds[2] = {
+        { .fd = fd, .events = POLLIN },
+        { .fd = interactive ? STDIN_FILENO : -1, .events = POLLIN }
+    };
+    if (poll(fds, 2, tick_ms) < 0) {
+        return errno == EINTR ? TUI_WAIT_TICK : TUI_WAIT_ERROR;
+    }
+    if (fds[0].revents) {
+        return TUI_WAIT_READY;
+    }
+
+    if (fds[1].revents) {
+        nodelay(stdscr, TRUE);
+        int ch;
+        while ((ch = getch()) != ERR) {
+            if (ch == 27) {  /* Escape key */
+                nodelay(stdscr, FALSE);
+                return TUI_WAIT_CANCEL;
+            }
+        }
+        nodelay(stdscr, FALSE);
+    }
+    return TUI_WAIT_TICK;
+}
@@ -0,0 +1,97 @@
+/**
+ * Authentication throughput microbenchmark
+ *
+ * Compares PAM transactions run in the greeter, each loading and unloading
+ * the service's module stack, against the same transactions answered by
+ * the warm PAM helper, and times a new helper's first answer. Needs an
+ * account it may authenticate as; without one it is skipped. Lockout is
+ * reset between attempts, so a wrong password measures the failure path,
+ * including any pam_faildelay the stack imposes.
+ * Usage: bench_auth [user] [password] [rounds]
+ *        (or KIA_BENCH_USER and KIA_BENCH_PASSWORD in the environment)
+ */
+
+#include "auth.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_ROUNDS 200
+#define HELPER_STARTS 20
+
+static double elapsed_us(const struct timespec *start, const struct timespec *end) {
+    return (double)(end->tv_sec - start->tv_sec) * 1e6 +
+           (double)(end->tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/**
+ * Authenticate rounds times through whichever path auth.c has
+ * @return Total time in microseconds
+ */
+static double run(const char *user, const char *password, int rounds,
+                  const kia_config_t *config, int *ok) {
+    struct timespec start, end;
+    auth_state_t state;
+
+    *ok = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < rounds; r++) {
+        memset(&state, 0, sizeof(state));
+        *ok += auth_authenticate(user, password, config, &state) == KIA_SUCCESS;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return elapsed_us(&start, &end);
+}
+
+int main(int argc, char *argv[]) {
+    const char *user = argc > 1 ? argv[1] : getenv("KIA_BENCH_USER");
+    const char *password = argc > 2 ? argv[2] : getenv("KIA_BENCH_PASSWORD");
+    int rounds = argc > 3 ? atoi(argv[3]) : DEFAULT_ROUNDS;
+    kia_config_t config = { .max_attempts = 1 << 30, .lockout_duration = 1 };
+    struct timespec start, end;
+    int inline_ok, helper_ok;
+
+    if (!user || !password) {
+        printf("bench_auth: no account given (KIA_BENCH_USER, KIA_BENCH_PASSWORD), skipped\n");
+        return 0;
+    }
+    if (rounds <= 0) {
+        fprintf(stderr, "usage: bench_auth [user] [password] [rounds]\n");
+        return 1;
+    }
+    logger_init("/tmp/kia_bench_auth.log", false);
+
+    /* Before auth_init() there is no helper, PAM runs in this process */
+    double inline_us = run(user, password, rounds, &config, &inline_ok);
+
+    /* The helper loads its modules after the fork, so time up to its first answer */
+    double start_us = 0;
+    for (int i = 0; i < HELPER_STARTS; i++) {
+        auth_state_t state = { .failed_attempts = 0 };
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        auth_init();
+        auth_authenticate(user, password, &config, &state);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        start_us += elapsed_us(&start, &end);
+        auth_cleanup();
+    }
+
+    auth_init();
+    double helper_us = run(user, password, rounds, &config, &helper_ok);
+    auth_cleanup();
+
+    printf("authentication: user '%s' x %d rounds\n", user, rounds);
+    printf("  in greeter:     %8.1f us/attempt  %8.1f attempts/s  (%d ok)\n",
+           inline_us / rounds, rounds * 1e6 / inline_us, inline_ok);
+    printf("  warm helper:    %8.1f us/attempt  %8.1f attempts/s  (%d ok)\n",
+           helper_us / rounds, rounds * 1e6 / helper_us, helper_ok);
+    printf("  speedup:        %8.2fx\n", helper_us > 0 ? inline_us / helper_us : 0.0);
+    printf("  helper start:   %8.1f us to first answer  (mean of %d)\n",
+           start_us / HELPER_STARTS, HELPER_STARTS);
+
+    logger_close();
+    return inline_ok == helper_ok ? 0 : 1;
+}
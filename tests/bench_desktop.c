@@ -0,0 +1,236 @@
+/**
+ * Desktop entry parser microbenchmark
+ *
+ * Compares the single-pass parser in src/desktop.c against the previous
+ * stdio fgets/strncpy loop on a directory of synthetic session entries,
+ * then batched reads through io_uring against plain openat()/read().
+ * Usage: bench_desktop [entries] [rounds]
+ */
+
+#include "desktop.h"
+#include "desktop_batch.h"
+#include "session.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define DEFAULT_ENTRIES 5000
+#define DEFAULT_ROUNDS 5
+#define LEGACY_LINE_LENGTH 1024
+
+/* Fixed-size session record used before the string arena */
+typedef struct {
+    char name[256];
+    char exec[512];
+} legacy_session_t;
+
+/**
+ * Previous parse_desktop_file() implementation, kept as the baseline
+ */
+static int legacy_parse(const char *filepath, legacy_session_t *session) {
+    char line[LEGACY_LINE_LENGTH];
+    int found_name = 0, found_exec = 0;
+
+    FILE *fp = fopen(filepath, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    memset(session->name, 0, sizeof(session->name));
+    memset(session->exec, 0, sizeof(session->exec));
+
+    while (fgets(line, sizeof(line), fp)) {
+        size_t len = strlen(line);
+        if (len > 0 && line[len - 1] != '\n' && !feof(fp)) {
+            int ch;
+            while ((ch = fgetc(fp)) != EOF && ch != '\n') {
+            }
+            continue;
+        }
+        line[strcspn(line, "\n")] = '\0';
+
+        if (strncmp(line, "Name=", 5) == 0 && !found_name) {
+            size_t name_len = strlen(line + 5);
+            if (name_len > 0 && name_len < sizeof(session->name)) {
+                strncpy(session->name, line + 5, sizeof(session->name) - 1);
+                found_name = 1;
+            }
+        } else if (strncmp(line, "Exec=", 5) == 0 && !found_exec) {
+            size_t exec_len = strlen(line + 5);
+            if (exec_len > 0 && exec_len < sizeof(session->exec)) {
+                strncpy(session->exec, line + 5, sizeof(session->exec) - 1);
+                found_exec = 1;
+            }
+        }
+        if (found_name && found_exec) {
+            break;
+        }
+    }
+
+    fclose(fp);
+    return (found_name && found_exec) ? 0 : -1;
+}
+
+/**
+ * Current implementation: one read, one pass, copy only the used keys
+ */
+static int single_pass_parse(const char *filepath, desktop_buf_t *buf, legacy_session_t *session) {
+    desktop_entry_t entry;
+
+    if (desktop_buf_read(buf, filepath) != KIA_SUCCESS ||
+        desktop_entry_parse(buf->data, buf->len, &entry) != KIA_SUCCESS) {
+        return -1;
+    }
+    if (desktop_span_copy(&entry.name, session->name, sizeof(session->name)) <= 0 ||
+        desktop_span_copy(&entry.exec, session->exec, sizeof(session->exec)) <= 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Read every entry of the directory through a batch
+ * @return Number of files read, or -1 on error
+ */
+static int batch_read_all(desktop_batch_t *batch, int dirfd, int entries) {
+    char name[64];
+
+    desktop_batch_clear(batch);
+    for (int i = 0; i < entries; i++) {
+        snprintf(name, sizeof(name), "session-%05d.desktop", i);
+        if (desktop_batch_add(batch, name) < 0) {
+            return -1;
+        }
+    }
+    return desktop_batch_read(batch, dirfd);
+}
+
+static double elapsed_ms(const struct timespec *start, const struct timespec *end) {
+    return (double)(end->tv_sec - start->tv_sec) * 1e3 +
+           (double)(end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/**
+ * Write a synthetic entry shaped like real session files: localised
+ * names and comments precede the keys Kia needs
+ */
+static int write_entry(const char *dir, int idx) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/session-%05d.desktop", dir, idx);
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        return -1;
+    }
+    fprintf(fp, "[Desktop Entry]\n");
+    fprintf(fp, "Type=Application\n");
+    for (int i = 0; i < 12; i++) {
+        fprintf(fp, "Name[l%02d]=Synthetic session %d (locale %d)\n", i, idx, i);
+        fprintf(fp, "Comment[l%02d]=A synthetic desktop session used for benchmarking\n", i);
+    }
+    fprintf(fp, "Comment=A synthetic desktop session used for benchmarking\n");
+    fprintf(fp, "TryExec=synthetic-session-%d\n", idx);
+    fprintf(fp, "DesktopNames=Synthetic;Bench\n");
+    fprintf(fp, "Name=Synthetic %d\n", idx);
+    fprintf(fp, "Exec=synthetic-session-%d --flag\n", idx);
+    fclose(fp);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int entries = argc > 1 ? atoi(argv[1]) : DEFAULT_ENTRIES;
+    int rounds = argc > 2 ? atoi(argv[2]) : DEFAULT_ROUNDS;
+    char dir[] = "/tmp/kia_bench_desktop_XXXXXX";
+    char path[512];
+    legacy_session_t session;
+    desktop_buf_t buf = {0};
+    struct timespec start, end;
+    double legacy_ms = 0, single_ms = 0;
+    int legacy_ok = 0, single_ok = 0;
+
+    if (entries <= 0 || rounds <= 0 || mkdtemp(dir) == NULL) {
+        fprintf(stderr, "usage: bench_desktop [entries] [rounds]\n");
+        return 1;
+    }
+
+    for (int i = 0; i < entries; i++) {
+        if (write_entry(dir, i) != 0) {
+            fprintf(stderr, "failed to create entries in %s\n", dir);
+            return 1;
+        }
+    }
+
+    for (int r = 0; r < rounds; r++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < entries; i++) {
+            snprintf(path, sizeof(path), "%s/session-%05d.desktop", dir, i);
+            legacy_ok += legacy_parse(path, &session) == 0;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        legacy_ms += elapsed_ms(&start, &end);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < entries; i++) {
+            snprintf(path, sizeof(path), "%s/session-%05d.desktop", dir, i);
+            single_ok += single_pass_parse(path, &buf, &session) == 0;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        single_ms += elapsed_ms(&start, &end);
+    }
+
+    printf("desktop entry parse: %d entries x %d rounds (warm page cache)\n", entries, rounds);
+    printf("  fgets loop:   %8.2f ms/round  %7.0f ns/entry  (%d parsed)\n",
+           legacy_ms / rounds, legacy_ms * 1e6 / ((double)entries * rounds), legacy_ok / rounds);
+    printf("  single pass:  %8.2f ms/round  %7.0f ns/entry  (%d parsed)\n",
+           single_ms / rounds, single_ms * 1e6 / ((double)entries * rounds), single_ok / rounds);
+    printf("  speedup:      %8.2fx\n", single_ms > 0 ? legacy_ms / single_ms : 0.0);
+
+    /* Reads only: one submission per phase against one syscall per step */
+    desktop_batch_t ring_batch, plain_batch;
+    double ring_ms = 0, plain_ms = 0;
+    int ring_ok = 0, plain_ok = 0;
+    int dirfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    desktop_batch_init(&ring_batch, true);
+    desktop_batch_init(&plain_batch, false);
+
+    for (int r = 0; dirfd >= 0 && r < rounds; r++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        plain_ok += batch_read_all(&plain_batch, dirfd, entries);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        plain_ms += elapsed_ms(&start, &end);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        ring_ok += batch_read_all(&ring_batch, dirfd, entries);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ring_ms += elapsed_ms(&start, &end);
+    }
+
+    printf("desktop file reads: %d entries x %d rounds (warm page cache)\n", entries, rounds);
+    printf("  plain calls:  %8.2f ms/round  %7.0f ns/entry  (%d read)\n",
+           plain_ms / rounds, plain_ms * 1e6 / ((double)entries * rounds), plain_ok / rounds);
+    if (desktop_batch_uses_ring(&ring_batch)) {
+        printf("  io_uring:     %8.2f ms/round  %7.0f ns/entry  (%d read, %lu submits)\n",
+               ring_ms / rounds, ring_ms * 1e6 / ((double)entries * rounds), ring_ok / rounds,
+               ring_batch.submits / (unsigned long)rounds);
+    } else {
+        printf("  io_uring:     unavailable, batch used plain calls\n");
+    }
+    if (dirfd >= 0) {
+        close(dirfd);
+    }
+    desktop_batch_free(&ring_batch);
+    desktop_batch_free(&plain_batch);
+
+    desktop_buf_free(&buf);
+    for (int i = 0; i < entries; i++) {
+        snprintf(path, sizeof(path), "%s/session-%05d.desktop", dir, i);
+        unlink(path);
+    }
+    rmdir(dir);
+
+    return (legacy_ok == single_ok && ring_ok == plain_ok) ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+/**
+ * Session launch microbenchmark
+ *
+ * Compares fork()+execve() against session_spawn() for starting /bin/true
+ * from a process whose heap has been grown and touched to a given size,
+ * standing in for a greeter with ncurses, PAM and the session list loaded.
+ * Each sample is the time from the call until waitpid() reaps the child.
+ * Usage: bench_spawn [heap_mb] [rounds]
+ */
+
+#define _GNU_SOURCE
+#include "session_spawn.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define DEFAULT_HEAP_MB 256
+#define DEFAULT_ROUNDS 200
+
+static double elapsed_us(const struct timespec *start, const struct timespec *end) {
+    return (double)(end->tv_sec - start->tv_sec) * 1e6 +
+           (double)(end->tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/**
+ * Previous launch path: copy the address space, exec in the copy
+ */
+static int fork_exec(const char *const argv[]) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        execve("/bin/true", (char *const *)argv, environ);
+        _exit(127);
+    }
+    int status;
+    return waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+           WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+/**
+ * Current launch path
+ */
+static int spawn_exec(const session_spawn_t *spawn) {
+    pid_t pid;
+    int status;
+    if (session_spawn(spawn, &pid) != KIA_SUCCESS) {
+        return -1;
+    }
+    return waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+           WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    int heap_mb = argc > 1 ? atoi(argv[1]) : DEFAULT_HEAP_MB;
+    int rounds = argc > 2 ? atoi(argv[2]) : DEFAULT_ROUNDS;
+    const char *true_argv[] = { "true", NULL };
+    session_spawn_t spawn = { .exec_count = 1, .envp = environ };
+    struct timespec start, end;
+
+    if (heap_mb < 0 || rounds <= 0) {
+        fprintf(stderr, "usage: bench_spawn [heap_mb] [rounds]\n");
+        return 1;
+    }
+    spawn.execs[0] = (session_spawn_exec_t){ "/bin/true", true_argv };
+
+    /* Touch every page so fork() has page tables to copy */
+    size_t heap_len = (size_t)heap_mb << 20;
+    char *heap = heap_len ? malloc(heap_len) : NULL;
+    if (heap_len && !heap) {
+        fprintf(stderr, "failed to allocate %d MiB\n", heap_mb);
+        return 1;
+    }
+    if (heap) {
+        memset(heap, 0x5a, heap_len);
+    }
+
+    double fork_us = 0, spawn_us = 0;
+    int fork_ok = 0, spawn_ok = 0;
+
+    for (int r = 0; r < rounds; r++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        fork_ok += fork_exec(true_argv) == 0;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        fork_us += elapsed_us(&start, &end);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        spawn_ok += spawn_exec(&spawn) == 0;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        spawn_us += elapsed_us(&start, &end);
+    }
+
+    printf("session launch: /bin/true x %d rounds, %d MiB touched heap\n", rounds, heap_mb);
+    printf("  fork+execve:    %8.1f us/launch  (%d ok)\n", fork_us / rounds, fork_ok);
+    printf("  session_spawn:  %8.1f us/launch  (%d ok)\n", spawn_us / rounds, spawn_ok);
+    printf("  speedup:        %8.2fx\n", spawn_us > 0 ? fork_us / spawn_us : 0.0);
+
+    free(heap);
+    return (fork_ok == rounds && spawn_ok == rounds) ? 0 : 1;
+}
@@ -5,6 +5,7 @@
 #include <string.h>
 #include <assert.h>
 #include <unistd.h>
+#include <poll.h>
 
 /* Test counter */
 static int tests_passed = 0;
@@ -269,6 +270,73 @@ TEST(test_multiple_cleanup_calls) {
     auth_cleanup();  /* Should not crash */
 }
 
+/* Test: No PAM environment is kept without a successful authentication */
+TEST(test_env_cleared) {
+    auth_state_t state = {0};
+    kia_config_t config = {
+        .max_attempts = 3,
+        .lockout_duration = 60
+    };
+
+    auth_init();
+    ASSERT_TRUE(auth_get_env() == NULL);
+
+    auth_authenticate("nonexistent_user_12345", "wrong", &config, &state);
+    ASSERT_TRUE(auth_get_env() == NULL);
+
+    auth_cleanup();
+    ASSERT_TRUE(auth_get_env() == NULL);
+}
+
+/* Test: A background authentication reports its result through its descriptor */
+TEST(test_async_auth) {
+    auth_state_t state = {0};
+    kia_config_t config = {
+        .max_attempts = 3,
+        .lockout_duration = 60
+    };
+    char password[] = "wrong";
+
+    ASSERT_TRUE(auth_start(NULL, "wrong", &config, &state) == NULL);
+    ASSERT_TRUE(auth_start("testuser", NULL, &config, &state) == NULL);
+    ASSERT_EQ(auth_request_fd(NULL), -1);
+    ASSERT_EQ(auth_finish(NULL, &state), KIA_ERROR_AUTH);
+    auth_cancel(NULL);
+
+    auth_request_t *req = auth_start("nonexistent_user_12345", password, &config, &state);
+    ASSERT_TRUE(req != NULL);
+    memset(password, 0, sizeof(password));
+
+    /* The caller's state is only updated when the result is collected */
+    struct pollfd pfd = { .fd = auth_request_fd(req), .events = POLLIN };
+    ASSERT_EQ(poll(&pfd, 1, 30000), 1);
+    ASSERT_EQ(state.failed_attempts, 0);
+    ASSERT_EQ(auth_finish(req, &state), KIA_ERROR_AUTH);
+    ASSERT_EQ(state.failed_attempts, 1);
+    ASSERT_STR_EQ(state.username, "nonexistent_user_12345");
+    ASSERT_TRUE(auth_get_env() == NULL);
+}
+
+/* Test: A cancelled authentication neither counts nor blocks the next one */
+TEST(test_async_auth_cancel) {
+    auth_state_t state = {0};
+    kia_config_t config = {
+        .max_attempts = 3,
+        .lockout_duration = 60
+    };
+
+    auth_request_t *req = auth_start("nonexistent_user_12345", "wrong", &config, &state);
+    ASSERT_TRUE(req != NULL);
+    auth_cancel(req);
+    ASSERT_EQ(state.failed_attempts, 0);
+
+    req = auth_start("nonexistent_user_12345", "wrong", &config, &state);
+    ASSERT_TRUE(req != NULL);
+    ASSERT_EQ(auth_finish(req, &state), KIA_ERROR_AUTH);
+    ASSERT_EQ(state.failed_attempts, 1);
+    ASSERT_TRUE(auth_get_env() == NULL);
+}
+
 /* Main test runner */
 int main(void) {
     printf("Running authentication module tests...\n\n");
@@ -286,6 +354,9 @@ int main(void) {
     test_is_locked_out_null_state_wrapper();
     test_reset_attempts_null_state_wrapper();
     test_multiple_cleanup_calls_wrapper();
+    test_env_cleared_wrapper();
+    test_async_auth_wrapper();
+    test_async_auth_cancel_wrapper();
     
     printf("\n");
     printf("Tests passed: %d\n", tests_passed);
@@ -0,0 +1,306 @@
+#define _GNU_SOURCE
+#include "auth_helper.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_STR_EQ(a, b) ASSERT(strcmp((a), (b)) == 0)
+
+/* Set by prepare_helper(), which only runs in the helper */
+static int prepared = 0;
+
+static void prepare_helper(void) {
+    prepared = 1;
+}
+
+/* Stand-in for PAM: "good" passes, user "crash" takes the helper down, "hang" never returns */
+static int fake_authenticate(const char *username, const char *password, char ***env) {
+    if (strcmp(username, "crash") == 0) {
+        kill(getpid(), SIGKILL);
+    }
+    while (strcmp(username, "hang") == 0) {
+        pause();
+    }
+    if (strcmp(password, "good") != 0) {
+        return KIA_ERROR_AUTH;
+    }
+
+    char user_var[300];
+    snprintf(user_var, sizeof(user_var), "HELPER_USER=%s", username);
+    char **list = calloc(4, sizeof(char *));
+    list[0] = strdup(prepared ? "PREPARED=1" : "PREPARED=0");
+    list[1] = strdup(user_var);
+    list[2] = strdup("EMPTY=");
+    *env = list;
+    return KIA_SUCCESS;
+}
+
+/* Helper function to read the parent of a process from /proc */
+static pid_t parent_of(pid_t pid) {
+    char path[64];
+    int ppid = -1;
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE *fp = fopen(path, "r");
+    if (fp) {
+        if (fscanf(fp, "%*d (%*[^)]) %*c %d", &ppid) != 1) {
+            ppid = -1;
+        }
+        fclose(fp);
+    }
+    return ppid;
+}
+
+/* Helper function to free an environment list */
+static void free_env(char **env) {
+    if (env) {
+        for (char **var = env; *var; var++) {
+            free(*var);
+        }
+        free(env);
+    }
+}
+
+TEST(test_helper_roundtrip) {
+    auth_helper_t helper = AUTH_HELPER_INIT;
+    char **env = NULL;
+
+    ASSERT_EQ(auth_helper_start(&helper, fake_authenticate, prepare_helper), KIA_SUCCESS);
+    ASSERT(auth_helper_running(&helper));
+    ASSERT(helper.pid != getpid());
+
+    /* Helpers come from the spawner, never from a fork of the caller */
+    ASSERT(helper.spawner_pid > 0);
+    ASSERT_EQ(parent_of(helper.pid), helper.spawner_pid);
+    ASSERT_EQ(parent_of(helper.spawner_pid), getpid());
+
+    /* Starting a running helper keeps it */
+    pid_t pid = helper.pid;
+    ASSERT_EQ(auth_helper_start(&helper, fake_authenticate, prepare_helper), KIA_SUCCESS);
+    ASSERT_EQ(helper.pid, pid);
+
+    ASSERT_EQ(auth_helper_authenticate(&helper, "alice", "good", &env), KIA_SUCCESS);
+    ASSERT(env != NULL);
+    ASSERT_STR_EQ(env[0], "PREPARED=1");
+    ASSERT_STR_EQ(env[1], "HELPER_USER=alice");
+    ASSERT_STR_EQ(env[2], "EMPTY=");
+    ASSERT(env[3] == NULL);
+    free_env(env);
+
+    /* prepare ran in the helper, not here */
+    ASSERT_EQ(prepared, 0);
+
+    ASSERT_EQ(auth_helper_authenticate(&helper, "alice", "bad", &env), KIA_ERROR_AUTH);
+    ASSERT(env == NULL);
+    ASSERT_EQ(helper.restarts, 0);
+
+    pid_t spawner = helper.spawner_pid;
+    auth_helper_stop(&helper);
+    ASSERT(!auth_helper_running(&helper));
+    ASSERT_EQ(helper.fd, -1);
+    ASSERT_EQ(helper.spawner_pid, -1);
+    ASSERT_EQ(waitpid(spawner, NULL, WNOHANG), -1);
+    ASSERT(kill(pid, 0) == -1 && errno == ESRCH);
+}
+
+TEST(test_helper_crash) {
+    auth_helper_t helper = AUTH_HELPER_INIT;
+    char **env = NULL;
+
+    ASSERT_EQ(auth_helper_start(&helper, fake_authenticate, NULL), KIA_SUCCESS);
+    pid_t pid = helper.pid;
+
+    /* The attempt that crashed the helper fails, a new helper takes over */
+    ASSERT_EQ(auth_helper_authenticate(&helper, "crash", "good", &env), KIA_ERROR_PAM);
+    ASSERT(env == NULL);
+    ASSERT(auth_helper_running(&helper));
+    ASSERT(helper.pid != pid);
+    ASSERT_EQ(helper.restarts, 1);
+    ASSERT_EQ(parent_of(helper.pid), helper.spawner_pid);
+
+    ASSERT_EQ(auth_helper_authenticate(&helper, "bob", "good", &env), KIA_SUCCESS);
+    ASSERT(env != NULL);
+    ASSERT_STR_EQ(env[0], "PREPARED=0");
+    free_env(env);
+
+    auth_helper_stop(&helper);
+}
+
+TEST(test_helper_died_idle) {
+    auth_helper_t helper = AUTH_HELPER_INIT;
+    char **env = NULL;
+
+    ASSERT_EQ(auth_helper_start(&helper, fake_authenticate, NULL), KIA_SUCCESS);
+    pid_t pid = helper.pid;
+    char byte;
+    kill(pid, SIGKILL);
+    ASSERT_EQ(recv(helper.fd, &byte, 1, 0), 0);
+
+    /* Nothing was asked of the dead helper, so the request is retried */
+    ASSERT_EQ(auth_helper_authenticate(&helper, "carol", "good", &env), KIA_SUCCESS);
+    ASSERT(env != NULL);
+    ASSERT_STR_EQ(env[1], "HELPER_USER=carol");
+    free_env(env);
+    ASSERT(helper.pid != pid);
+    ASSERT_EQ(helper.restarts, 1);
+
+    auth_helper_stop(&helper);
+}
+
+/* Helper thread: an authentication that hangs inside the helper */
+static void *authenticate_hang(void *arg) {
+    auth_helper_t *helper = arg;
+    char **env = NULL;
+    return (void *)(intptr_t)auth_helper_authenticate(helper, "hang", "good", &env);
+}
+
+TEST(test_helper_interrupt) {
+    auth_helper_t helper = AUTH_HELPER_INIT;
+    struct timespec pause_ts = { 0, 50 * 1000 * 1000 };
+    pthread_t thread;
+    void *result;
+    char **env = NULL;
+
+    ASSERT_EQ(auth_helper_interrupt(&helper), KIA_ERROR_PAM);
+    ASSERT_EQ(auth_helper_start(&helper, fake_authenticate, NULL), KIA_SUCCESS);
+    pid_t pid = helper.pid;
+
+    /* The stuck request returns once interrupted, and a new helper takes over */
+    ASSERT_EQ(pthread_create(&thread, NULL, authenticate_hang, &helper), 0);
+    nanosleep(&pause_ts, NULL);
+    ASSERT_EQ(auth_helper_interrupt(&helper), KIA_SUCCESS);
+    ASSERT_EQ(pthread_join(thread, &result), 0);
+    ASSERT_EQ((int)(intptr_t)result, KIA_ERROR_PAM);
+    ASSERT(auth_helper_running(&helper));
+    ASSERT(helper.pid != pid);
+    ASSERT_EQ(helper.restarts, 1);
+
+    ASSERT_EQ(auth_helper_authenticate(&helper, "dave", "good", &env), KIA_SUCCESS);
+    ASSERT(env != NULL);
+    free_env(env);
+
+    /* An idle helper is replaced by the next request, which still succeeds */
+    pid = helper.pid;
+    ASSERT_EQ(auth_helper_interrupt(&helper), KIA_SUCCESS);
+    ASSERT_EQ(auth_helper_authenticate(&helper, "dave", "good", &env), KIA_SUCCESS);
+    free_env(env);
+    ASSERT(helper.pid != pid);
+
+    auth_helper_stop(&helper);
+}
+
+/* Helper thread: keep interrupting until told to stop */
+static volatile int interrupting;
+
+static void *interrupt_loop(void *arg) {
+    struct timespec pause_ts = { 0, 200 * 1000 };
+    while (interrupting) {
+        auth_helper_interrupt(arg);
+        nanosleep(&pause_ts, NULL);
+    }
+    return NULL;
+}
+
+TEST(test_helper_interrupt_restarts) {
+    auth_helper_t helper = AUTH_HELPER_INIT;
+    pthread_t thread;
+    char **env = NULL;
+
+    ASSERT_EQ(auth_helper_start(&helper, fake_authenticate, NULL), KIA_SUCCESS);
+
+    /* Interrupts land while the helper is replaced, never on a stale descriptor */
+    interrupting = 1;
+    ASSERT_EQ(pthread_create(&thread, NULL, interrupt_loop, &helper), 0);
+    for (int i = 0; i < 100; i++) {
+        int result = auth_helper_authenticate(&helper, "erin", "good", &env);
+        ASSERT(result == KIA_SUCCESS || result == KIA_ERROR_PAM);
+        free_env(env);
+        env = NULL;
+    }
+    interrupting = 0;
+    ASSERT_EQ(pthread_join(thread, NULL), 0);
+    ASSERT(helper.restarts > 0);
+
+    ASSERT_EQ(auth_helper_authenticate(&helper, "erin", "good", &env), KIA_SUCCESS);
+    free_env(env);
+    auth_helper_stop(&helper);
+}
+
+TEST(test_helper_invalid_params) {
+    auth_helper_t helper = AUTH_HELPER_INIT;
+    char **env = (char **)&helper;
+    char long_name[AUTH_HELPER_FIELD_LEN + 1];
+
+    ASSERT_EQ(auth_helper_start(NULL, fake_authenticate, NULL), KIA_ERROR_SYSTEM);
+    ASSERT_EQ(auth_helper_start(&helper, NULL, NULL), KIA_ERROR_SYSTEM);
+    ASSERT_EQ(auth_helper_authenticate(&helper, "alice", "good", &env), KIA_ERROR_PAM);
+    ASSERT(env == NULL);
+    auth_helper_stop(&helper);
+    auth_helper_stop(NULL);
+
+    ASSERT_EQ(auth_helper_start(&helper, fake_authenticate, NULL), KIA_SUCCESS);
+    memset(long_name, 'a', sizeof(long_name) - 1);
+    long_name[sizeof(long_name) - 1] = '\0';
+    ASSERT_EQ(auth_helper_authenticate(&helper, long_name, "good", &env), KIA_ERROR_PAM);
+    ASSERT_EQ(auth_helper_authenticate(&helper, NULL, "good", &env), KIA_ERROR_PAM);
+    ASSERT_EQ(auth_helper_authenticate(&helper, "alice", NULL, &env), KIA_ERROR_PAM);
+    ASSERT_EQ(helper.restarts, 0);
+    auth_helper_stop(&helper);
+}
+
+/* Main test runner */
+int main(void) {
+    logger_init("/tmp/kia_auth_helper_test.log", true);
+
+    printf("Running PAM helper tests...\n\n");
+
+    test_helper_roundtrip_wrapper();
+    test_helper_crash_wrapper();
+    test_helper_died_idle_wrapper();
+    test_helper_interrupt_wrapper();
+    test_helper_interrupt_restarts_wrapper();
+    test_helper_invalid_params_wrapper();
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    logger_close();
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -60,10 +60,13 @@ TEST(test_valid_config_parsing) {
     const char *content = 
         "autologin_enabled=true\n"
         "autologin_user=testuser\n"
+        "kiosk_mode=yes\n"
         "default_session=gnome\n"
         "max_attempts=5\n"
         "enable_logs=false\n"
-        "lockout_duration=120\n";
+        "lockout_duration=120\n"
+        "auth_timeout=90\n"
+        "session_stop_timeout=10\n";
     
     char *filename = create_temp_config(content);
     ASSERT(filename != NULL);
@@ -73,10 +76,13 @@ TEST(test_valid_config_parsing) {
     
     ASSERT_TRUE(config.autologin_enabled);
     ASSERT_STR_EQ(config.autologin_user, "testuser");
+    ASSERT_TRUE(config.kiosk_mode);
     ASSERT_STR_EQ(config.default_session, "gnome");
     ASSERT_EQ(config.max_attempts, 5);
     ASSERT_FALSE(config.enable_logs);
     ASSERT_EQ(config.lockout_duration, 120);
+    ASSERT_EQ(config.auth_timeout, 90);
+    ASSERT_EQ(config.session_stop_timeout, 10);
     
     config_free(&config);
     unlink(filename);
@@ -93,10 +99,13 @@ TEST(test_missing_file_defaults) {
     /* Should have default values */
     ASSERT_FALSE(config.autologin_enabled);
     ASSERT_STR_EQ(config.autologin_user, "");
+    ASSERT_FALSE(config.kiosk_mode);
     ASSERT_STR_EQ(config.default_session, "xfce");
     ASSERT_EQ(config.max_attempts, 3);
     ASSERT_TRUE(config.enable_logs);
     ASSERT_EQ(config.lockout_duration, 60);
+    ASSERT_EQ(config.auth_timeout, 30);
+    ASSERT_EQ(config.session_stop_timeout, 5);
     
     config_free(&config);
 }
@@ -188,6 +197,38 @@ TEST(test_max_attempts_boundary_invalid) {
     free(filename2);
 }
 
+/* Test: Out-of-range timeouts are rejected line by line */
+TEST(test_timeout_boundary_invalid) {
+    kia_config_t config;
+    
+    /* Seconds that would overflow once converted to milliseconds */
+    const char *content =
+        "max_attempts=5\n"
+        "auth_timeout=2147484\n"
+        "session_stop_timeout=61\n";
+    char *filename = create_temp_config(content);
+    ASSERT(filename != NULL);
+    
+    int result = config_load(filename, &config);
+    ASSERT_EQ(result, KIA_ERROR_CONFIG);
+    
+    /* Only the bad lines fall back to defaults */
+    ASSERT_EQ(config.max_attempts, 5);
+    ASSERT_EQ(config.auth_timeout, 30);
+    ASSERT_EQ(config.session_stop_timeout, 5);
+    ASSERT_EQ(config_validate(&config), KIA_SUCCESS);
+    
+    config_free(&config);
+    unlink(filename);
+    free(filename);
+    
+    /* Resetting restores a configuration that validates */
+    config.auth_timeout = -1;
+    config_set_defaults(&config);
+    ASSERT_EQ(config.auth_timeout, 30);
+    ASSERT_EQ(config_validate(&config), KIA_SUCCESS);
+}
+
 /* Test: Comments and empty lines */
 TEST(test_comments_and_empty_lines) {
     kia_config_t config;
@@ -287,6 +328,8 @@ TEST(test_config_validate) {
     /* Valid configuration */
     config.max_attempts = 5;
     config.lockout_duration = 60;
+    config.auth_timeout = 30;
+    config.session_stop_timeout = 5;
     ASSERT_EQ(config_validate(&config), KIA_SUCCESS);
     
     /* Invalid max_attempts (too low) */
@@ -302,6 +345,20 @@ TEST(test_config_validate) {
     config.lockout_duration = -1;
     ASSERT_EQ(config_validate(&config), KIA_ERROR_CONFIG);
     
+    /* Invalid auth_timeout (out of range) */
+    config.lockout_duration = 60;
+    config.auth_timeout = 0;
+    ASSERT_EQ(config_validate(&config), KIA_ERROR_CONFIG);
+    config.auth_timeout = 301;
+    ASSERT_EQ(config_validate(&config), KIA_ERROR_CONFIG);
+    
+    /* Invalid session_stop_timeout (out of range) */
+    config.auth_timeout = 30;
+    config.session_stop_timeout = 0;
+    ASSERT_EQ(config_validate(&config), KIA_ERROR_CONFIG);
+    config.session_stop_timeout = 61;
+    ASSERT_EQ(config_validate(&config), KIA_ERROR_CONFIG);
+    
     /* NULL pointer */
     ASSERT_EQ(config_validate(NULL), KIA_ERROR_CONFIG);
 }
@@ -315,6 +372,7 @@ int main(void) {
     test_invalid_syntax_wrapper();
     test_max_attempts_boundary_valid_wrapper();
     test_max_attempts_boundary_invalid_wrapper();
+    test_timeout_boundary_invalid_wrapper();
     test_comments_and_empty_lines_wrapper();
     test_whitespace_handling_wrapper();
     test_boolean_parsing_wrapper();
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include "controller.h"
 #include "config.h"
 #include "logger.h"
@@ -9,6 +10,13 @@
 #include <string.h>
 #include <assert.h>
 #include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
 
 /* Test counter */
 static int tests_passed = 0;
@@ -56,6 +64,8 @@ TEST(test_controller_init) {
     ASSERT_EQ(ctx.password[0], '\0');
     ASSERT_EQ(ctx.auth_state.failed_attempts, 0);
     ASSERT_EQ(ctx.sessions.count, 0);
+    ASSERT_EQ(ctx.session_watch.fd, -1);
+    ASSERT_FALSE(ctx.discovery_pending);
 }
 
 /* Test: Controller initialization with NULL context */
@@ -172,7 +182,7 @@ TEST(test_session_list_integration) {
     
     /* Verify session list is initialized */
     ASSERT_EQ(ctx.sessions.count, 0);
-    ASSERT_EQ(ctx.sessions.sessions, NULL);
+    ASSERT_EQ(ctx.sessions.records, NULL);
     
     /* Simulate session discovery */
     ctx.sessions.count = 2;
@@ -237,7 +247,8 @@ TEST(test_state_enumeration) {
     ASSERT_NEQ(STATE_SHOW_LOGIN, STATE_GET_CREDENTIALS);
     ASSERT_NEQ(STATE_GET_CREDENTIALS, STATE_SELECT_SESSION);
     ASSERT_NEQ(STATE_SELECT_SESSION, STATE_AUTHENTICATE);
-    ASSERT_NEQ(STATE_AUTHENTICATE, STATE_START_SESSION);
+    ASSERT_NEQ(STATE_AUTHENTICATE, STATE_AUTHENTICATING);
+    ASSERT_NEQ(STATE_AUTHENTICATING, STATE_START_SESSION);
     ASSERT_NEQ(STATE_START_SESSION, STATE_EXIT);
 }
 
@@ -286,6 +297,453 @@ TEST(test_multiple_init_cleanup_cycles) {
     controller_cleanup(&ctx);
 }
 
+/* Helper function to fork a child that sleeps for the given seconds */
+static pid_t fork_sleeper(int seconds) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        sleep((unsigned)seconds);
+        _exit(0);
+    }
+    return pid;
+}
+
+/* Test: A running session is supervised until it exits, then login resumes */
+TEST(test_session_running_until_exit) {
+    app_context_t ctx;
+
+    ASSERT_EQ(controller_init(&ctx), KIA_SUCCESS);
+    pid_t pid = fork_sleeper(0);
+    ASSERT(pid > 0);
+    ASSERT_EQ(session_supervisor_add(&ctx.supervisor, pid, "Sleeper"), KIA_SUCCESS);
+
+    /* Per-login state of the session that is running */
+    strcpy(ctx.username, "testuser");
+    strcpy(ctx.password, "secret");
+    ctx.auth_state.failed_attempts = 2;
+    ctx.selected_session = 0;
+    ctx.config.max_attempts = 7;
+
+    ctx.state = STATE_SESSION_RUNNING;
+    while (ctx.state == STATE_SESSION_RUNNING) {
+        ASSERT_EQ(controller_step(&ctx), KIA_SUCCESS);
+    }
+    ASSERT_EQ(ctx.state, STATE_SHOW_LOGIN);
+    ASSERT_EQ(session_supervisor_count(&ctx.supervisor), 0);
+    ASSERT_EQ(waitpid(pid, NULL, WNOHANG), -1);
+
+    /* Only per-login state is reset */
+    ASSERT_EQ(ctx.username[0], '\0');
+    ASSERT_EQ(ctx.password[0], '\0');
+    ASSERT_EQ(ctx.auth_state.failed_attempts, 0);
+    ASSERT_EQ(ctx.selected_session, -1);
+    ASSERT_EQ(ctx.config.max_attempts, 7);
+    ASSERT_TRUE(ctx.returning);
+
+    controller_cleanup(&ctx);
+}
+
+/* Test: A shutdown request stops the running session */
+TEST(test_shutdown_stops_session) {
+    app_context_t ctx;
+    struct timespec start, end;
+
+    ASSERT_EQ(controller_init(&ctx), KIA_SUCCESS);
+    pid_t pid = fork_sleeper(30);
+    ASSERT(pid > 0);
+    ASSERT_EQ(session_supervisor_add(&ctx.supervisor, pid, "Sleeper"), KIA_SUCCESS);
+
+    ctx.state = STATE_SESSION_RUNNING;
+    controller_request_shutdown(&ctx);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ASSERT_EQ(controller_run(&ctx), KIA_SUCCESS);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    ASSERT_EQ(ctx.state, STATE_EXIT);
+    ASSERT_EQ(session_supervisor_count(&ctx.supervisor), 0);
+    ASSERT(end.tv_sec - start.tv_sec < CONTROLLER_SESSION_STOP_TIMEOUT_MS / 1000);
+    ASSERT_EQ(kill(pid, 0), -1);
+    ASSERT_EQ(errno, ESRCH);
+
+    controller_cleanup(&ctx);
+}
+
+/* Test: A shutdown request ends the login flow */
+TEST(test_shutdown_leaves_login) {
+    app_context_t ctx;
+
+    ASSERT_EQ(controller_init(&ctx), KIA_SUCCESS);
+    ctx.state = STATE_SHOW_LOGIN;
+    controller_request_shutdown(&ctx);
+    ASSERT_EQ(controller_run(&ctx), KIA_SUCCESS);
+    ASSERT_EQ(ctx.state, STATE_EXIT);
+
+    controller_request_shutdown(NULL);
+    ASSERT_EQ(controller_step(NULL), KIA_ERROR_SYSTEM);
+    controller_cleanup(&ctx);
+}
+
+/* Test: The readiness signal of a running session completes its latency record */
+TEST(test_session_ready_latency) {
+    app_context_t ctx;
+    char stats_path[] = "/tmp/kia_controller_stats_XXXXXX";
+    char line[512] = "";
+
+    int stats_fd = mkstemp(stats_path);
+    ASSERT(stats_fd >= 0);
+    close(stats_fd);
+
+    ASSERT_EQ(controller_init(&ctx), KIA_SUCCESS);
+    ctx.stats_path = stats_path;
+    ctx.backoff.path = NULL;
+    strcpy(ctx.username, "testuser");
+
+    /* A session that signals readiness, then keeps running a little */
+    ASSERT_EQ(session_ready_open(&ctx.session_proc.ready), KIA_SUCCESS);
+    clock_gettime(CLOCK_MONOTONIC, &ctx.latency.submitted);
+    ctx.latency.auth_start = ctx.latency.auth_done = ctx.latency.submitted;
+    ctx.latency.launch_start = ctx.latency.submitted;
+    ctx.latency.spawn_start = ctx.latency.submitted;
+    pid_t pid = fork();
+    if (pid == 0) {
+        struct timespec pause = { 0, 20 * 1000 * 1000 };
+        nanosleep(&pause, NULL);
+        if (write(ctx.session_proc.ready.session_fd, "1", 1) != 1) {
+            _exit(1);
+        }
+        pause.tv_nsec = 100 * 1000 * 1000;
+        nanosleep(&pause, NULL);
+        _exit(0);
+    }
+    ASSERT(pid > 0);
+    clock_gettime(CLOCK_MONOTONIC, &ctx.latency.exec_done);
+    session_ready_close_session(&ctx.session_proc.ready);
+    ctx.latency_pending = true;
+    ASSERT_EQ(session_supervisor_add(&ctx.supervisor, pid, "Ready"), KIA_SUCCESS);
+
+    ctx.state = STATE_SESSION_RUNNING;
+    while (ctx.state == STATE_SESSION_RUNNING) {
+        ASSERT_EQ(controller_step(&ctx), KIA_SUCCESS);
+    }
+    ASSERT_EQ(ctx.state, STATE_SHOW_LOGIN);
+    ASSERT(!ctx.latency_pending);
+    ASSERT_EQ(ctx.session_proc.ready.fd, -1);
+
+    /* Exactly one record, with a measured ready phase */
+    FILE *fp = fopen(stats_path, "r");
+    ASSERT(fp != NULL);
+    ASSERT(fgets(line, sizeof(line), fp) != NULL);
+    ASSERT(fgetc(fp) == EOF);
+    fclose(fp);
+    unlink(stats_path);
+    ASSERT(strstr(line, "\"user\":\"testuser\"") != NULL);
+    ASSERT(strstr(line, "\"ready_ms\":null") == NULL);
+    ASSERT(strstr(line, "\"ready_ms\":") != NULL);
+    ASSERT(atof(strstr(line, "\"ready_ms\":") + 11) >= 15.0);
+
+    controller_cleanup(&ctx);
+}
+
+/* Test: Sessions that end right after launch hold autologin back */
+TEST(test_session_crash_backoff) {
+    app_context_t ctx;
+    char history_path[] = "/tmp/kia_controller_failures_XXXXXX";
+    struct stat st;
+
+    int fd = mkstemp(history_path);
+    ASSERT(fd >= 0);
+    close(fd);
+
+    ASSERT_EQ(controller_init(&ctx), KIA_SUCCESS);
+    ctx.stats_path = NULL;
+    session_backoff_init(&ctx.backoff, history_path);
+    ASSERT_EQ(session_backoff_load(&ctx.backoff, session_backoff_now()), KIA_SUCCESS);
+    for (int i = 1; i < SESSION_BACKOFF_MAX_FAILURES; i++) {
+        ASSERT_EQ(session_backoff_record(&ctx.backoff, session_backoff_now()), KIA_SUCCESS);
+    }
+
+    /* A session crashing at once is the last failure allowed */
+    clock_gettime(CLOCK_MONOTONIC, &ctx.latency.launch_start);
+    pid_t pid = fork_sleeper(0);
+    ASSERT(pid > 0);
+    ASSERT_EQ(session_supervisor_add(&ctx.supervisor, pid, "Crasher"), KIA_SUCCESS);
+    ctx.state = STATE_SESSION_RUNNING;
+    while (ctx.state == STATE_SESSION_RUNNING) {
+        ASSERT_EQ(controller_step(&ctx), KIA_SUCCESS);
+    }
+    ASSERT_EQ(ctx.backoff.count, SESSION_BACKOFF_MAX_FAILURES);
+
+    /* A restarted Kia does not log in automatically anymore */
+    session_backoff_init(&ctx.backoff, history_path);
+    ASSERT_EQ(session_backoff_load(&ctx.backoff, session_backoff_now()), KIA_SUCCESS);
+    ASSERT_EQ(ctx.backoff.count, SESSION_BACKOFF_MAX_FAILURES);
+    ctx.config.autologin_enabled = true;
+    strcpy(ctx.config.autologin_user, "root");
+    ctx.state = STATE_CHECK_AUTOLOGIN;
+    ASSERT_EQ(controller_step(&ctx), KIA_SUCCESS);
+    ASSERT_EQ(ctx.state, STATE_SHOW_LOGIN);
+    ASSERT_EQ(ctx.username[0], '\0');
+
+    /* A session that ran properly clears the history */
+    clock_gettime(CLOCK_MONOTONIC, &ctx.latency.launch_start);
+    ctx.latency.launch_start.tv_sec -= SESSION_BACKOFF_MIN_RUNTIME_S + 1;
+    pid = fork_sleeper(0);
+    ASSERT(pid > 0);
+    ASSERT_EQ(session_supervisor_add(&ctx.supervisor, pid, "Session"), KIA_SUCCESS);
+    ctx.state = STATE_SESSION_RUNNING;
+    while (ctx.state == STATE_SESSION_RUNNING) {
+        ASSERT_EQ(controller_step(&ctx), KIA_SUCCESS);
+    }
+    ASSERT_EQ(ctx.backoff.count, 0);
+    ASSERT_EQ(stat(history_path, &st), -1);
+
+    controller_cleanup(&ctx);
+}
+
+/* Test: Authentication runs in the background and its result moves the login on */
+TEST(test_authentication_event) {
+    app_context_t ctx;
+
+    ASSERT_EQ(controller_init(&ctx), KIA_SUCCESS);
+    ctx.config.max_attempts = 3;
+    ctx.config.lockout_duration = 60;
+    strcpy(ctx.username, "nonexistent_user_12345");
+    strcpy(ctx.password, "wrong");
+
+    /* The password is gone as soon as the worker has its copy */
+    ctx.state = STATE_AUTHENTICATE;
+    ASSERT_EQ(controller_step(&ctx), KIA_SUCCESS);
+    ASSERT_EQ(ctx.state, STATE_AUTHENTICATING);
+    ASSERT(ctx.auth_request != NULL);
+    ASSERT_EQ(ctx.password[0], '\0');
+    while (ctx.state == STATE_AUTHENTICATING) {
+        ASSERT_EQ(controller_step(&ctx), KIA_SUCCESS);
+    }
+    ASSERT_EQ(ctx.state, STATE_SHOW_LOGIN);
+    ASSERT(ctx.auth_request == NULL);
+    ASSERT_EQ(ctx.auth_state.failed_attempts, 1);
+    ASSERT(ctx.latency.auth_done.tv_sec != 0 || ctx.latency.auth_done.tv_nsec != 0);
+
+    /* One that outlives the timeout is given up without counting */
+    strcpy(ctx.password, "wrong");
+    ctx.config.auth_timeout = 1;
+    ctx.state = STATE_AUTHENTICATE;
+    ASSERT_EQ(controller_step(&ctx), KIA_SUCCESS);
+    ASSERT_EQ(ctx.state, STATE_AUTHENTICATING);
+    ctx.latency.auth_start.tv_sec -= 2;
+    ASSERT_EQ(controller_step(&ctx), KIA_SUCCESS);
+    ASSERT_EQ(ctx.state, STATE_SHOW_LOGIN);
+    ASSERT(ctx.auth_request == NULL);
+    ASSERT_EQ(ctx.auth_state.failed_attempts, 1);
+
+    /* Shutting down with an authentication under way leaves it behind */
+    strcpy(ctx.password, "wrong");
+    ctx.state = STATE_AUTHENTICATE;
+    ASSERT_EQ(controller_step(&ctx), KIA_SUCCESS);
+    controller_request_shutdown(&ctx);
+    ASSERT_EQ(controller_run(&ctx), KIA_SUCCESS);
+    ASSERT_EQ(ctx.state, STATE_EXIT);
+    controller_cleanup(&ctx);
+    ASSERT(ctx.auth_request == NULL);
+}
+
+/* Test: A kiosk session is relaunched from its plan until it keeps failing */
+TEST(test_kiosk_restart) {
+    app_context_t ctx;
+    char stats_path[] = "/tmp/kia_controller_kiosk_XXXXXX";
+    char line[512] = "", last[512] = "";
+    int records = 0;
+
+    if (geteuid() != 0) {
+        return;
+    }
+    int stats_fd = mkstemp(stats_path);
+    ASSERT(stats_fd >= 0);
+    close(stats_fd);
+
+    ASSERT_EQ(controller_init(&ctx), KIA_SUCCESS);
+    ctx.stats_path = stats_path;
+    ctx.backoff.path = NULL;
+    ctx.config.session_stop_timeout = 1;
+    ASSERT_EQ(session_list_add(&ctx.sessions, "Kiosk", "echo ready > /proc/self/fd/$KIA_READY_FD",
+                               SESSION_WAYLAND), KIA_SUCCESS);
+    strcpy(ctx.username, "root");
+    ctx.selected_session = 0;
+    ctx.kiosk = true;
+
+    /* Two instances that ran long enough, the second from the plan alone */
+    ctx.state = STATE_START_SESSION;
+    for (int run = 0; run < 2; run++) {
+        ASSERT_EQ(ctx.state, STATE_START_SESSION);
+        ASSERT_EQ(controller_step(&ctx), KIA_SUCCESS);
+        ASSERT_EQ(ctx.state, STATE_SESSION_RUNNING);
+        ASSERT(ctx.kiosk_plan.strings != NULL);
+        ctx.latency.launch_start.tv_sec -= SESSION_BACKOFF_MIN_RUNTIME_S + 1;
+        session_list_free(&ctx.sessions);
+        while (ctx.state == STATE_SESSION_RUNNING) {
+            ASSERT_EQ(controller_step(&ctx), KIA_SUCCESS);
+        }
+        ASSERT_EQ(ctx.kiosk_restarts, run + 1);
+    }
+    ASSERT_STR_EQ(ctx.username, "root");
+    ASSERT_EQ(ctx.backoff.count, 0);
+
+    /* An instance failing once too often hands over to the login screen */
+    for (int i = 1; i < SESSION_BACKOFF_MAX_FAILURES; i++) {
+        ASSERT_EQ(session_backoff_record(&ctx.backoff, session_backoff_now()), KIA_SUCCESS);
+    }
+    ASSERT_EQ(controller_step(&ctx), KIA_SUCCESS);
+    while (ctx.state == STATE_SESSION_RUNNING) {
+        ASSERT_EQ(controller_step(&ctx), KIA_SUCCESS);
+    }
+    ASSERT_EQ(ctx.state, STATE_SHOW_LOGIN);
+    ASSERT_FALSE(ctx.kiosk);
+    ASSERT(ctx.kiosk_plan.strings == NULL);
+    ASSERT_EQ(ctx.kiosk_restarts, 0);
+
+    /* Restarts are recorded from the exit of the previous instance to readiness */
+    FILE *fp = fopen(stats_path, "r");
+    ASSERT(fp != NULL);
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        records++;
+        strcpy(last, line);
+    }
+    fclose(fp);
+    unlink(stats_path);
+    ASSERT_EQ(records, 3);
+    ASSERT(strstr(last, "\"session\":\"Kiosk\"") != NULL);
+    ASSERT(strstr(last, "\"total_ms\":null") == NULL);
+    ASSERT(atof(strstr(last, "\"total_ms\":") + 11) > 0);
+
+    controller_cleanup(&ctx);
+}
+
+/* Helper function to read the resident set size in KiB */
+static long resident_kb(void) {
+    long total, resident;
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (!fp) {
+        return -1;
+    }
+    int fields = fscanf(fp, "%ld %ld", &total, &resident);
+    fclose(fp);
+    return fields == 2 ? resident * (sysconf(_SC_PAGESIZE) / 1024) : -1;
+}
+
+/* Sessions the login flow discovers, so it allocates as it would on a desktop */
+#define RSS_SESSIONS 256
+
+/* Least the release has to give back: discovery's buffers and the curses screen */
+#define RSS_MIN_RELEASED_KB 32
+
+/* Helper function to drain what the TUI wrote to the terminal */
+static void drain_pty(int master) {
+    char buf[4096];
+    while (read(master, buf, sizeof(buf)) > 0) {
+    }
+}
+
+/* Test: Memory the login flow used is given back once the session runs */
+TEST(test_release_memory_rss) {
+    app_context_t ctx;
+    char data_dir[] = "/tmp/kia_controller_rss_XXXXXX";
+    char path[512];
+    struct winsize size = { .ws_row = 24, .ws_col = 80 };
+
+    /* Session files for discovery; XDG_DATA_DIRS is read on first use */
+    ASSERT(mkdtemp(data_dir) != NULL);
+    snprintf(path, sizeof(path), "%s/xsessions", data_dir);
+    ASSERT_EQ(mkdir(path, 0755), 0);
+    for (int i = 0; i < RSS_SESSIONS; i++) {
+        snprintf(path, sizeof(path), "%s/xsessions/session-%03d.desktop", data_dir, i);
+        FILE *fp = fopen(path, "w");
+        ASSERT(fp != NULL);
+        fprintf(fp, "[Desktop Entry]\nName=Session %d\nComment=Desktop number %d\nExec=sh\n", i, i);
+        fclose(fp);
+    }
+    setenv("XDG_DATA_DIRS", data_dir, 1);
+
+    /* The TUI runs on a pseudo-terminal standing in for the VT */
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    ASSERT(master >= 0);
+    ASSERT(grantpt(master) == 0 && unlockpt(master) == 0);
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    ASSERT(slave >= 0);
+    ASSERT_EQ(ioctl(slave, TIOCSWINSZ, &size), 0);
+    char *term = getenv("TERM") ? strdup(getenv("TERM")) : NULL;
+    setenv("TERM", "vt100", 1);
+    fflush(stdout);
+    int saved_in = dup(STDIN_FILENO);
+    int saved_out = dup(STDOUT_FILENO);
+    dup2(slave, STDIN_FILENO);
+    dup2(slave, STDOUT_FILENO);
+
+    /* Init, discovery and the login screen, up to the session choice */
+    ASSERT_EQ(controller_init(&ctx), KIA_SUCCESS);
+    ctx.backoff.path = NULL;
+    ctx.stats_path = NULL;
+    int steps = 0;
+    while (ctx.state != STATE_AUTHENTICATE && ctx.state != STATE_EXIT && steps++ < 16) {
+        if (ctx.state == STATE_GET_CREDENTIALS &&
+            write(master, "testuser\tsecret\n", 16) != 16) {
+            break;
+        }
+        if (ctx.state == STATE_SELECT_SESSION && write(master, "\n", 1) != 1) {
+            break;
+        }
+        controller_step(&ctx);
+        drain_pty(master);
+    }
+    int state = ctx.state;
+    int session_count = ctx.sessions.count;
+
+    /* Then the TUI leaves the terminal to the session, as when it launches */
+    tui_suspend();
+    long before = resident_kb();
+    controller_release_memory(&ctx);
+    long after = resident_kb();
+    bool password_cleared = ctx.password[0] == '\0';
+
+    /* The freed screen is set up again when the session ends */
+    char buf[64];
+    drain_pty(master);
+    tui_resume();
+    bool redrawn = read(master, buf, sizeof(buf)) > 0;
+
+    controller_cleanup(&ctx);
+    drain_pty(master);
+    dup2(saved_in, STDIN_FILENO);
+    dup2(saved_out, STDOUT_FILENO);
+    close(saved_in);
+    close(saved_out);
+    close(slave);
+    close(master);
+    if (term) {
+        setenv("TERM", term, 1);
+        free(term);
+    }
+    for (int i = 0; i < RSS_SESSIONS; i++) {
+        snprintf(path, sizeof(path), "%s/xsessions/session-%03d.desktop", data_dir, i);
+        unlink(path);
+    }
+    snprintf(path, sizeof(path), "%s/xsessions", data_dir);
+    rmdir(path);
+    rmdir(data_dir);
+    printf(" (RSS %ld KiB -> %ld KiB)", before, after);
+
+    ASSERT_EQ(state, STATE_AUTHENTICATE);
+    ASSERT_EQ(session_count, RSS_SESSIONS);
+    ASSERT(password_cleared);
+    ASSERT(redrawn);
+    ASSERT(before > 0 && after > 0);
+#ifdef __GLIBC__
+    /* Discovery's freed buffers are trimmed, e.g. in the arena of its thread */
+    ASSERT(after <= before - RSS_MIN_RELEASED_KB);
+#else
+    ASSERT(after <= before);
+#endif
+    controller_release_memory(NULL);
+}
+
 /* Main test runner */
 int main(void) {
     printf("Running controller integration tests...\n\n");
@@ -306,6 +764,14 @@ int main(void) {
     test_state_enumeration_wrapper();
     test_buffer_overflow_protection_wrapper();
     test_multiple_init_cleanup_cycles_wrapper();
+    test_session_running_until_exit_wrapper();
+    test_shutdown_stops_session_wrapper();
+    test_shutdown_leaves_login_wrapper();
+    test_session_ready_latency_wrapper();
+    test_session_crash_backoff_wrapper();
+    test_authentication_event_wrapper();
+    test_kiosk_restart_wrapper();
+    test_release_memory_rss_wrapper();
     
     printf("\n");
     printf("Tests passed: %d\n", tests_passed);
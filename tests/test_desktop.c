@@ -0,0 +1,298 @@
+#include "desktop.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_STR_EQ(a, b) ASSERT(strcmp((a), (b)) == 0)
+#define ASSERT_TRUE(x) ASSERT((x) == true)
+#define ASSERT_FALSE(x) ASSERT((x) == false)
+#define ASSERT_NULL(x) ASSERT((x) == NULL)
+
+/* Helper macro to check a span against a literal */
+#define ASSERT_SPAN_EQ(span, literal) \
+    ASSERT((span).len == strlen(literal) && memcmp((span).ptr, (literal), (span).len) == 0)
+
+/* Helper function to parse a literal buffer */
+static int parse(const char *text, desktop_entry_t *entry) {
+    return desktop_entry_parse(text, strlen(text), entry);
+}
+
+/* Test: Basic keys are picked up */
+TEST(test_parse_basic_entry) {
+    desktop_entry_t entry;
+    const char *text =
+        "[Desktop Entry]\n"
+        "Name=Sway\n"
+        "Comment=An i3-compatible Wayland compositor\n"
+        "Exec=sway --unsupported-gpu\n"
+        "TryExec=sway\n"
+        "DesktopNames=sway;wlroots\n"
+        "Type=Application\n";
+
+    ASSERT_EQ(parse(text, &entry), KIA_SUCCESS);
+    ASSERT_SPAN_EQ(entry.name, "Sway");
+    ASSERT_SPAN_EQ(entry.exec, "sway --unsupported-gpu");
+    ASSERT_SPAN_EQ(entry.try_exec, "sway");
+    ASSERT_SPAN_EQ(entry.desktop_names, "sway;wlroots");
+    ASSERT_FALSE(entry.hidden);
+    ASSERT_FALSE(entry.no_display);
+}
+
+/* Test: Hidden and NoDisplay booleans */
+TEST(test_parse_booleans) {
+    desktop_entry_t entry;
+
+    ASSERT_EQ(parse("[Desktop Entry]\nHidden=true\nNoDisplay=false\n", &entry), KIA_SUCCESS);
+    ASSERT_TRUE(entry.hidden);
+    ASSERT_FALSE(entry.no_display);
+
+    ASSERT_EQ(parse("[Desktop Entry]\nHidden=false\nNoDisplay=true\n", &entry), KIA_SUCCESS);
+    ASSERT_FALSE(entry.hidden);
+    ASSERT_TRUE(entry.no_display);
+}
+
+/* Test: Keys outside [Desktop Entry] are ignored */
+TEST(test_parse_group_boundaries) {
+    desktop_entry_t entry;
+    const char *text =
+        "Name=Before any group\n"
+        "[Desktop Entry]\n"
+        "Name=GNOME\n"
+        "[Desktop Action Wayland]\n"
+        "Exec=gnome-session --wayland\n";
+
+    ASSERT_EQ(parse(text, &entry), KIA_SUCCESS);
+    ASSERT_SPAN_EQ(entry.name, "GNOME");
+    ASSERT_NULL(entry.exec.ptr);
+
+    ASSERT_EQ(parse("[Other Group]\nName=X\nExec=x\n", &entry), KIA_ERROR_SESSION);
+    ASSERT_EQ(parse("", &entry), KIA_ERROR_SESSION);
+}
+
+/* Test: Localised keys, comments, whitespace and CRLF */
+TEST(test_parse_key_forms) {
+    desktop_entry_t entry;
+    const char *text =
+        "# comment\r\n"
+        "[Desktop Entry]\r\n"
+        "Name[de]=Sitzung\r\n"
+        "\r\n"
+        "Name = Plasma\r\n"
+        "Name=Second\r\n"
+        "Exec\t=\tstartplasma-x11\r\n";
+
+    ASSERT_EQ(parse(text, &entry), KIA_SUCCESS);
+    ASSERT_SPAN_EQ(entry.name, "Plasma");
+    ASSERT_SPAN_EQ(entry.exec, "startplasma-x11");
+}
+
+/* Test: Lines longer than the old 1024-byte buffer are parsed */
+TEST(test_parse_long_line) {
+    desktop_entry_t entry;
+    size_t exec_len = 3000;
+    char *text = malloc(exec_len + 64);
+    ASSERT(text != NULL);
+
+    strcpy(text, "[Desktop Entry]\nExec=");
+    size_t off = strlen(text);
+    memset(text + off, 'a', exec_len);
+    strcpy(text + off + exec_len, "\nName=Long\n");
+
+    int result = parse(text, &entry);
+    free(text);
+    ASSERT_EQ(result, KIA_SUCCESS);
+    ASSERT_EQ(entry.exec.len, exec_len);
+    ASSERT_SPAN_EQ(entry.name, "Long");
+}
+
+/* Test: Missing trailing newline */
+TEST(test_parse_no_trailing_newline) {
+    desktop_entry_t entry;
+
+    ASSERT_EQ(parse("[Desktop Entry]\nName=i3\nExec=i3", &entry), KIA_SUCCESS);
+    ASSERT_SPAN_EQ(entry.exec, "i3");
+}
+
+/* Test: Span copy resolves escapes and bounds the output */
+TEST(test_span_copy) {
+    char out[16];
+    desktop_span_t span = { "a\\sb\\\\c\\td", 10 };
+
+    ASSERT_EQ(desktop_span_copy(&span, out, sizeof(out)), 7);
+    ASSERT_STR_EQ(out, "a b\\c\td");
+
+    /* Unknown escapes are preserved for Exec quoting */
+    desktop_span_t quoted = { "\\\"x\\\"", 5 };
+    ASSERT_EQ(desktop_span_copy(&quoted, out, sizeof(out)), 5);
+    ASSERT_STR_EQ(out, "\\\"x\\\"");
+
+    desktop_span_t long_span = { "0123456789abcdef", 16 };
+    ASSERT_EQ(desktop_span_copy(&long_span, out, sizeof(out)), -1);
+
+    desktop_span_t empty = { NULL, 0 };
+    ASSERT_EQ(desktop_span_copy(&empty, out, sizeof(out)), -1);
+}
+
+/* Helper function to split an Exec line and join the arguments with | */
+static int split(const char *exec, char *joined, size_t size) {
+    char out[256];
+    size_t len = 0;
+    int argc = desktop_exec_split(exec, out, sizeof(out), &len);
+
+    joined[0] = '\0';
+    for (size_t i = 0; i < len; i++) {
+        snprintf(joined + strlen(joined), size - strlen(joined), "%c", out[i] ? out[i] : '|');
+    }
+    return argc;
+}
+
+/* Test: Exec lines are split per the desktop entry quoting rules */
+TEST(test_exec_split) {
+    char joined[256];
+
+    ASSERT_EQ(split("startxfce4", joined, sizeof(joined)), 1);
+    ASSERT_STR_EQ(joined, "startxfce4|");
+
+    ASSERT_EQ(split("  sway \t--unsupported-gpu  ", joined, sizeof(joined)), 2);
+    ASSERT_STR_EQ(joined, "sway|--unsupported-gpu|");
+
+    /* Quoting, escapes inside quotes and empty quoted arguments */
+    ASSERT_EQ(split("/usr/bin/env \"a b\" \"q\\\"x\\$y\\\\\" \"\"", joined, sizeof(joined)), 4);
+    ASSERT_STR_EQ(joined, "/usr/bin/env|a b|q\"x$y\\||");
+    ASSERT_EQ(split("sh -c \"exec startplasma-x11 | cat\"", joined, sizeof(joined)), 3);
+    ASSERT_STR_EQ(joined, "sh|-c|exec startplasma-x11 | cat|");
+
+    /* Field codes are stripped, %% is a literal percent */
+    ASSERT_EQ(split("gnome-session %U --opt=%f 100%%", joined, sizeof(joined)), 3);
+    ASSERT_STR_EQ(joined, "gnome-session|--opt=|100%|");
+    ASSERT_EQ(split("run \"%U\"", joined, sizeof(joined)), 2);
+    ASSERT_STR_EQ(joined, "run|%U|");
+
+    /* Shell syntax and malformed lines are left to the shell */
+    ASSERT_EQ(split("startkde; logout", joined, sizeof(joined)), 0);
+    ASSERT_EQ(split("dbus-run-session $HOME/bin/wm", joined, sizeof(joined)), 0);
+    ASSERT_EQ(split("wm > /tmp/log", joined, sizeof(joined)), 0);
+    ASSERT_EQ(split("'quoted wm'", joined, sizeof(joined)), 0);
+    ASSERT_EQ(split("XDG_CURRENT_DESKTOP=sway sway", joined, sizeof(joined)), 0);
+    ASSERT_EQ(split("\"unterminated", joined, sizeof(joined)), 0);
+    ASSERT_EQ(split("wm %z", joined, sizeof(joined)), 0);
+    ASSERT_EQ(split("wm %", joined, sizeof(joined)), 0);
+    ASSERT_EQ(split("   ", joined, sizeof(joined)), 0);
+    ASSERT_EQ(split("%U", joined, sizeof(joined)), 0);
+
+    /* Assignments are only special before the command */
+    ASSERT_EQ(split("env FOO=bar ./wm", joined, sizeof(joined)), 3);
+    ASSERT_STR_EQ(joined, "env|FOO=bar|./wm|");
+
+    /* Output is bounded */
+    char out[8];
+    size_t len = 0;
+    ASSERT_EQ(desktop_exec_split("ab c", out, 5, &len), 2);
+    ASSERT_EQ(len, 5);
+    ASSERT_EQ(desktop_exec_split("ab c", out, 4, &len), 0);
+    ASSERT_EQ(desktop_exec_split(NULL, out, sizeof(out), &len), 0);
+}
+
+/* Test: Reading files through a reusable buffer */
+TEST(test_buf_read) {
+    char path[] = "/tmp/kia_desktop_test_XXXXXX";
+    desktop_buf_t buf = {0};
+    const char *content = "[Desktop Entry]\nName=XFCE\nExec=startxfce4\n";
+
+    int fd = mkstemp(path);
+    ASSERT(fd >= 0);
+    ASSERT_EQ(write(fd, content, strlen(content)), (ssize_t)strlen(content));
+    close(fd);
+
+    ASSERT_EQ(desktop_buf_read(&buf, path), KIA_SUCCESS);
+    ASSERT_EQ(buf.len, strlen(content));
+    ASSERT_STR_EQ(buf.data, content);
+
+    /* Buffer is reused for the next file */
+    char *data = buf.data;
+    ASSERT_EQ(desktop_buf_read(&buf, path), KIA_SUCCESS);
+    ASSERT(buf.data == data);
+
+    unlink(path);
+    ASSERT_EQ(desktop_buf_read(&buf, path), KIA_ERROR_SESSION);
+    ASSERT_EQ(desktop_buf_read(&buf, "/tmp"), KIA_ERROR_SESSION);
+
+    desktop_buf_free(&buf);
+    ASSERT_NULL(buf.data);
+}
+
+/* Test: Only an exact .desktop suffix makes a desktop file ID */
+TEST(test_is_file_id) {
+    ASSERT(desktop_is_file_id("xfce.desktop"));
+    ASSERT(desktop_is_file_id("a.desktop"));
+    ASSERT(!desktop_is_file_id(".desktop"));
+    ASSERT(!desktop_is_file_id("xfce.desktop.bak"));
+    ASSERT(!desktop_is_file_id("xfce.desktop~"));
+    ASSERT(!desktop_is_file_id("xfce.Desktop"));
+    ASSERT(!desktop_is_file_id("desktop"));
+    ASSERT(!desktop_is_file_id(""));
+    ASSERT(!desktop_is_file_id(NULL));
+}
+
+/* Test: Invalid parameters */
+TEST(test_invalid_params) {
+    desktop_entry_t entry;
+    desktop_buf_t buf = {0};
+
+    ASSERT_EQ(desktop_entry_parse(NULL, 0, &entry), KIA_ERROR_SESSION);
+    ASSERT_EQ(desktop_entry_parse("", 0, NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(desktop_buf_read(NULL, "/tmp"), KIA_ERROR_SESSION);
+    ASSERT_EQ(desktop_buf_read(&buf, NULL), KIA_ERROR_SESSION);
+    desktop_buf_free(NULL);
+}
+
+/* Main test runner */
+int main(void) {
+    printf("Running desktop entry parser tests...\n\n");
+
+    test_parse_basic_entry_wrapper();
+    test_parse_booleans_wrapper();
+    test_parse_group_boundaries_wrapper();
+    test_parse_key_forms_wrapper();
+    test_parse_long_line_wrapper();
+    test_parse_no_trailing_newline_wrapper();
+    test_span_copy_wrapper();
+    test_exec_split_wrapper();
+    test_buf_read_wrapper();
+    test_is_file_id_wrapper();
+    test_invalid_params_wrapper();
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,220 @@
+#include "desktop_batch.h"
+#include "desktop.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_STR_EQ(a, b) ASSERT(strcmp((a), (b)) == 0)
+
+/* More files than one ring submission holds */
+#define FIXTURE_FILES (DESKTOP_BATCH_RING_ENTRIES + 20)
+
+/* Shared fixture directory */
+static char temp_dir[] = "/tmp/kia_batch_test_XXXXXX";
+
+/* Helper function to write a file of the given contents */
+static int write_file(const char *name, const char *content, size_t len) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%s", temp_dir, name);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t written = write(fd, content, len);
+    close(fd);
+    return written == (ssize_t)len ? 0 : -1;
+}
+
+/* Helper function to count the descriptors this process has open */
+static int count_fds(void) {
+    int count = 0;
+    DIR *dir = opendir("/proc/self/fd");
+    if (!dir) {
+        return -1;
+    }
+    while (readdir(dir) != NULL) {
+        count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+/* Helper function to queue and read the fixture through a batch */
+static void check_batch(bool use_ring) {
+    desktop_batch_t batch;
+    char name[64], expected[128];
+
+    ASSERT_EQ(desktop_batch_init(&batch, use_ring), KIA_SUCCESS);
+    if (!use_ring) {
+        ASSERT(!desktop_batch_uses_ring(&batch));
+    }
+
+    int dirfd = open(temp_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    ASSERT(dirfd >= 0);
+    int open_fds = count_fds();
+
+    /* Reading twice reuses the batch for another directory listing */
+    for (int round = 0; round < 2; round++) {
+        desktop_batch_clear(&batch);
+        for (int i = 0; i < FIXTURE_FILES; i++) {
+            snprintf(name, sizeof(name), "session-%03d.desktop", i);
+            ASSERT_EQ(desktop_batch_add(&batch, name), i);
+        }
+        int missing = desktop_batch_add(&batch, "missing.desktop");
+        int subdir = desktop_batch_add(&batch, "subdir.desktop");
+        int large = desktop_batch_add(&batch, "large.desktop");
+        int empty = desktop_batch_add(&batch, "empty.desktop");
+        int fifo = desktop_batch_add(&batch, "fifo.desktop");
+
+        ASSERT_EQ(desktop_batch_read(&batch, dirfd), FIXTURE_FILES + 1);
+        ASSERT_EQ(count_fds(), open_fds);
+
+        for (int i = 0; i < FIXTURE_FILES; i++) {
+            size_t len;
+            const char *data = desktop_batch_data(&batch, i, &len);
+            snprintf(expected, sizeof(expected),
+                     "[Desktop Entry]\nName=Session %d\nExec=run-%d\n", i, i);
+            ASSERT(data != NULL);
+            ASSERT_EQ(len, strlen(expected));
+            ASSERT_STR_EQ(data, expected);
+        }
+
+        ASSERT(desktop_batch_data(&batch, missing, NULL) == NULL);
+        ASSERT_EQ(batch.files[missing].error, ENOENT);
+        ASSERT(desktop_batch_data(&batch, subdir, NULL) == NULL);
+        ASSERT_EQ(batch.files[subdir].error, EFBIG);
+        ASSERT(desktop_batch_data(&batch, large, NULL) == NULL);
+        ASSERT_EQ(batch.files[large].error, EFBIG);
+
+        /* A FIFO without a writer is rejected instead of blocking the open */
+        ASSERT(desktop_batch_data(&batch, fifo, NULL) == NULL);
+        ASSERT_EQ(batch.files[fifo].error, EFBIG);
+
+        size_t len = 1;
+        ASSERT_STR_EQ(desktop_batch_data(&batch, empty, &len), "");
+        ASSERT_EQ(len, 0);
+        ASSERT_STR_EQ(desktop_batch_name(&batch, empty), "empty.desktop");
+    }
+
+    /* The ring submits everything in a few calls rather than per file */
+    if (desktop_batch_uses_ring(&batch)) {
+        ASSERT(batch.submits > 0 && batch.submits < FIXTURE_FILES);
+    } else {
+        ASSERT_EQ(batch.submits, 0);
+    }
+
+    close(dirfd);
+    desktop_batch_free(&batch);
+}
+
+/* Test: Files are read through io_uring when the kernel allows it */
+TEST(test_batch_read_ring) {
+    check_batch(true);
+}
+
+/* Test: The plain syscall path gives the same results */
+TEST(test_batch_read_plain) {
+    check_batch(false);
+}
+
+/* Test: Invalid parameters */
+TEST(test_batch_invalid_params) {
+    desktop_batch_t batch;
+
+    ASSERT_EQ(desktop_batch_init(NULL, false), KIA_ERROR_SESSION);
+    ASSERT_EQ(desktop_batch_init(&batch, false), KIA_SUCCESS);
+    ASSERT_EQ(desktop_batch_add(&batch, NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(desktop_batch_add(&batch, ""), KIA_ERROR_SESSION);
+    ASSERT_EQ(desktop_batch_add(&batch, "../escape.desktop"), KIA_ERROR_SESSION);
+    ASSERT_EQ(desktop_batch_add(NULL, "a.desktop"), KIA_ERROR_SESSION);
+    ASSERT_EQ(desktop_batch_read(&batch, -1), KIA_ERROR_SESSION);
+    ASSERT_EQ(desktop_batch_read(NULL, 0), KIA_ERROR_SESSION);
+    ASSERT(desktop_batch_name(&batch, 0) == NULL);
+    ASSERT(desktop_batch_data(&batch, 0, NULL) == NULL);
+    ASSERT(!desktop_batch_uses_ring(NULL));
+    desktop_batch_free(&batch);
+    desktop_batch_free(NULL);
+}
+
+/* Main test runner */
+int main(void) {
+    logger_init("/tmp/kia_desktop_batch_test.log", true);
+
+    printf("Running batched desktop file reader tests...\n\n");
+
+    if (mkdtemp(temp_dir) == NULL) {
+        printf("Failed to create temporary directory\n");
+        return 1;
+    }
+
+    char name[64], content[128], path[600];
+    for (int i = 0; i < FIXTURE_FILES; i++) {
+        snprintf(name, sizeof(name), "session-%03d.desktop", i);
+        snprintf(content, sizeof(content), "[Desktop Entry]\nName=Session %d\nExec=run-%d\n", i, i);
+        write_file(name, content, strlen(content));
+    }
+    char *large = calloc(1, DESKTOP_MAX_FILE_SIZE + 1);
+    if (large) {
+        memset(large, '#', DESKTOP_MAX_FILE_SIZE);
+        write_file("large.desktop", large, DESKTOP_MAX_FILE_SIZE + 1);
+        free(large);
+    }
+    write_file("empty.desktop", "", 0);
+    snprintf(path, sizeof(path), "%s/subdir.desktop", temp_dir);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/fifo.desktop", temp_dir);
+    mkfifo(path, 0644);
+
+    test_batch_read_ring_wrapper();
+    test_batch_read_plain_wrapper();
+    test_batch_invalid_params_wrapper();
+
+    char command[600];
+    snprintf(command, sizeof(command), "rm -rf %s", temp_dir);
+    if (system(command) != 0) {
+        printf("Warning: failed to remove %s\n", temp_dir);
+    }
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    logger_close();
+
+    return tests_failed > 0 ? 1 : 0;
+}
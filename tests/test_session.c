@@ -1,12 +1,19 @@
 #include "session.h"
+#include "session_group.h"
 #include "logger.h"
+#include "test_util.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <assert.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 
 /* Test counter */
 static int tests_passed = 0;
@@ -71,6 +78,68 @@ static int create_desktop_file(const char *dir, const char *filename,
     return 0;
 }
 
+/* Directory of stub session commands put first on PATH */
+static char stub_dir[] = "/tmp/kia_session_bin_XXXXXX";
+
+/* Directory standing in for /var/log/kia and /run/kia, with the two under it */
+static char state_root[] = "/tmp/kia_session_state_XXXXXX";
+static char output_dir[64];
+static char lock_dir[64];
+
+/* Helper function to install an empty executable as a stub command */
+static int install_stub_command(const char *name) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%s", stub_dir, name);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+    if (fd < 0) {
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+/* Helper function to install a stub X server writing the given display to -displayfd */
+static int install_stub_xorg(const char *reported) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%s", stub_dir, SESSION_XORG_SERVER);
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        return -1;
+    }
+    fprintf(fp, "#!/bin/sh\n"
+                "while [ $# -gt 0 ]; do\n"
+                "    case $1 in :*) d=${1#:} ;; -displayfd) fd=$2 ;; esac; shift\n"
+                "done\n"
+                "echo %s > /dev/fd/$fd\n"
+                "exec sleep 30\n", reported);
+    fclose(fp);
+    chmod(path, 0755);
+    age_dir(stub_dir);
+    return 0;
+}
+
+/* Helper function to remove the stub X server */
+static void remove_stub_xorg(void) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%s", stub_dir, SESSION_XORG_SERVER);
+    unlink(path);
+    age_dir(stub_dir);
+}
+
+/* Helper function to read a small file, returning its length or -1 */
+static ssize_t read_small_file(const char *path, char *buf, size_t size) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+    size_t len = fread(buf, 1, size - 1, fp);
+    fclose(fp);
+    buf[len] = '\0';
+    return (ssize_t)len;
+}
+
 /* Helper function to recursively remove directory */
 static void remove_dir_recursive(const char *path) {
     char command[1024];
@@ -94,14 +163,14 @@ TEST(test_session_discovery_mock_filesystem) {
     
     ASSERT_EQ(result, KIA_SUCCESS);
     ASSERT_TRUE(list.count > 0);
-    ASSERT_NOT_NULL(list.sessions);
+    ASSERT_NOT_NULL(list.records);
     
     /* Verify each session has required fields */
     for (int i = 0; i < list.count; i++) {
-        ASSERT_TRUE(strlen(list.sessions[i].name) > 0);
-        ASSERT_TRUE(strlen(list.sessions[i].exec) > 0);
-        ASSERT_TRUE(list.sessions[i].type == SESSION_X11 || 
-                   list.sessions[i].type == SESSION_WAYLAND);
+        ASSERT_TRUE(strlen(session_list_name(&list, i)) > 0);
+        ASSERT_TRUE(strlen(session_list_exec(&list, i)) > 0);
+        ASSERT_TRUE(session_list_type(&list, i) == SESSION_X11 || 
+                   session_list_type(&list, i) == SESSION_WAYLAND);
     }
     
     session_list_free(&list);
@@ -154,54 +223,270 @@ TEST(test_desktop_file_parsing) {
 
 /* Test: Session list management and memory cleanup */
 TEST(test_session_list_management) {
-    session_list_t list;
+    session_list_t list = {0};
     
     /* Initialize empty list */
-    list.sessions = NULL;
-    list.count = 0;
-    
-    /* Allocate some sessions manually */
-    list.sessions = malloc(sizeof(session_info_t) * 3);
-    ASSERT_NOT_NULL(list.sessions);
-    list.count = 3;
-    
-    strcpy(list.sessions[0].name, "Session 1");
-    strcpy(list.sessions[0].exec, "/usr/bin/session1");
-    list.sessions[0].type = SESSION_X11;
-    
-    strcpy(list.sessions[1].name, "Session 2");
-    strcpy(list.sessions[1].exec, "/usr/bin/session2");
-    list.sessions[1].type = SESSION_WAYLAND;
+    ASSERT_NULL(list.records);
+    ASSERT_EQ(list.count, 0);
     
-    strcpy(list.sessions[2].name, "Session 3");
-    strcpy(list.sessions[2].exec, "/usr/bin/session3");
-    list.sessions[2].type = SESSION_X11;
+    /* Add some sessions */
+    ASSERT_EQ(session_list_add(&list, "Session 1", "/usr/bin/session1", SESSION_X11), KIA_SUCCESS);
+    ASSERT_EQ(session_list_add(&list, "Session 2", "/usr/bin/session2", SESSION_WAYLAND),
+              KIA_SUCCESS);
+    ASSERT_EQ(session_list_add(&list, "Session 3", "/usr/bin/session3", SESSION_X11), KIA_SUCCESS);
     
     /* Verify data */
     ASSERT_EQ(list.count, 3);
-    ASSERT_STR_EQ(list.sessions[0].name, "Session 1");
-    ASSERT_EQ(list.sessions[0].type, SESSION_X11);
-    ASSERT_STR_EQ(list.sessions[1].name, "Session 2");
-    ASSERT_EQ(list.sessions[1].type, SESSION_WAYLAND);
+    ASSERT_STR_EQ(session_list_name(&list, 0), "Session 1");
+    ASSERT_EQ(session_list_type(&list, 0), SESSION_X11);
+    ASSERT_STR_EQ(session_list_name(&list, 1), "Session 2");
+    ASSERT_EQ(session_list_type(&list, 1), SESSION_WAYLAND);
+    ASSERT_STR_EQ(session_list_exec(&list, 2), "/usr/bin/session3");
+    
+    /* Views point into the list */
+    session_info_t info;
+    ASSERT_EQ(session_list_get(&list, 1, &info), KIA_SUCCESS);
+    ASSERT_STR_EQ(info.name, "Session 2");
+    ASSERT_STR_EQ(info.exec, "/usr/bin/session2");
+    ASSERT_EQ(info.type, SESSION_WAYLAND);
+    
+    /* Out of range lookups */
+    ASSERT_EQ(session_list_get(&list, 3, &info), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_list_get(&list, -1, &info), KIA_ERROR_SESSION);
+    ASSERT_NULL(session_list_name(&list, 3));
+    ASSERT_NULL(session_list_exec(&list, -1));
     
     /* Free the list */
     session_list_free(&list);
     
     /* Verify cleanup */
-    ASSERT_NULL(list.sessions);
+    ASSERT_NULL(list.records);
+    ASSERT_NULL(list.arena);
     ASSERT_EQ(list.count, 0);
 }
 
+/* Test: Session list grows geometrically */
+TEST(test_session_list_growth) {
+    session_list_t list = {0};
+    char name[32];
+    int reallocations = 0;
+    
+    for (int i = 0; i < 1000; i++) {
+        int capacity = list.capacity;
+        size_t arena_cap = list.arena_cap;
+        snprintf(name, sizeof(name), "Session %d", i);
+        ASSERT_EQ(session_list_add(&list, name, "exec", i % 2 ? SESSION_WAYLAND : SESSION_X11),
+                  KIA_SUCCESS);
+        reallocations += (list.capacity != capacity) + (list.arena_cap != arena_cap);
+    }
+    
+    ASSERT_EQ(list.count, 1000);
+    ASSERT_TRUE(reallocations < 20);
+    ASSERT_STR_EQ(session_list_name(&list, 999), "Session 999");
+    ASSERT_EQ(session_list_type(&list, 999), SESSION_WAYLAND);
+    
+    /* Records stay compact regardless of string lengths */
+    ASSERT_TRUE(sizeof(session_record_t) <= 16);
+    
+    session_list_free(&list);
+}
+
+/* Test: Exec lines are tokenised when sessions are added */
+TEST(test_session_list_args) {
+    session_list_t list = {0};
+    session_info_t info;
+
+    ASSERT_EQ(session_list_add(&list, "Sway", "sway --unsupported-gpu %U", SESSION_WAYLAND),
+              KIA_SUCCESS);
+    ASSERT_EQ(session_list_add(&list, "KDE", "startkde; logout", SESSION_X11), KIA_SUCCESS);
+    ASSERT_EQ(session_list_add(&list, "Quoted", "\"/opt/my wm/bin/wm\"", SESSION_X11), KIA_SUCCESS);
+
+    ASSERT_EQ(session_list_get(&list, 0, &info), KIA_SUCCESS);
+    ASSERT_EQ(info.argc, 2);
+    ASSERT_STR_EQ(info.args, "sway");
+    ASSERT_STR_EQ(info.args + strlen(info.args) + 1, "--unsupported-gpu");
+    ASSERT_STR_EQ(info.exec, "sway --unsupported-gpu %U");
+
+    /* Shell syntax keeps the raw line only */
+    ASSERT_EQ(session_list_get(&list, 1, &info), KIA_SUCCESS);
+    ASSERT_EQ(info.argc, 0);
+    ASSERT_STR_EQ(info.exec, "startkde; logout");
+
+    ASSERT_EQ(session_list_get(&list, 2, &info), KIA_SUCCESS);
+    ASSERT_EQ(info.argc, 1);
+    ASSERT_STR_EQ(info.args, "/opt/my wm/bin/wm");
+
+    /* Arguments survive removal and compaction of other sessions */
+    ASSERT_EQ(session_list_remove(&list, 0), KIA_SUCCESS);
+    ASSERT_EQ(session_list_get(&list, 1, &info), KIA_SUCCESS);
+    ASSERT_STR_EQ(info.args, "/opt/my wm/bin/wm");
+    ASSERT_STR_EQ(session_list_file(&list, 1), "");
+
+    session_list_free(&list);
+}
+
+/* Test: Sessions run their argv directly, or through the shell if needed */
+TEST(test_session_start_exec) {
+    session_list_t list = {0};
+    session_info_t info;
+
+    /* Launching needs to switch to an existing user */
+    if (geteuid() != 0) {
+        return;
+    }
+
+    ASSERT_EQ(session_list_add(&list, "True", "/bin/true %U", SESSION_WAYLAND), KIA_SUCCESS);
+    ASSERT_EQ(session_list_add(&list, "Exit", "sh -c \"exit 3\"", SESSION_WAYLAND), KIA_SUCCESS);
+    ASSERT_EQ(session_list_add(&list, "Shell", "true && test \"$USER\" = root", SESSION_WAYLAND),
+              KIA_SUCCESS);
+    ASSERT_EQ(session_list_add(&list, "Missing", "/nonexistent/kia-session", SESSION_WAYLAND),
+              KIA_SUCCESS);
+
+    ASSERT_EQ(session_list_get(&list, 0, &info), KIA_SUCCESS);
+    ASSERT_EQ(info.argc, 1);
+    ASSERT_EQ(session_start(&info, "root", NULL), KIA_SUCCESS);
+
+    ASSERT_EQ(session_list_get(&list, 1, &info), KIA_SUCCESS);
+    ASSERT_EQ(info.argc, 3);
+    ASSERT_EQ(session_start(&info, "root", NULL), KIA_ERROR_SESSION);
+
+    ASSERT_EQ(session_list_get(&list, 2, &info), KIA_SUCCESS);
+    ASSERT_EQ(info.argc, 0);
+    ASSERT_EQ(session_start(&info, "root", NULL), KIA_SUCCESS);
+
+    ASSERT_EQ(session_list_get(&list, 3, &info), KIA_SUCCESS);
+    ASSERT_EQ(session_start(&info, "root", NULL), KIA_ERROR_SESSION);
+
+    session_list_free(&list);
+}
+
+/* Test: Session output goes to the user's log file, and its end to Kia's log on failure */
+TEST(test_session_start_output) {
+    session_list_t list = {0};
+    session_info_t info;
+    char path[256], buf[512] = "";
+
+    if (geteuid() != 0) {
+        return;
+    }
+
+    ASSERT_EQ(session_list_add(&list, "Chatty",
+                               "echo kia-to-stdout; echo kia-to-stderr >&2; exit 4",
+                               SESSION_WAYLAND), KIA_SUCCESS);
+    ASSERT_EQ(session_list_get(&list, 0, &info), KIA_SUCCESS);
+    ASSERT_EQ(session_start(&info, "root", NULL), KIA_ERROR_SESSION);
+
+    snprintf(path, sizeof(path), "%s/root.log", output_dir);
+    FILE *fp = fopen(path, "r");
+    ASSERT(fp != NULL);
+    size_t len = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[len] = '\0';
+    ASSERT_STR_EQ(buf, "kia-to-stdout\nkia-to-stderr\n");
+
+    fp = fopen("/tmp/kia_session_test.log", "r");
+    ASSERT(fp != NULL);
+    bool logged = false;
+    while (fgets(buf, sizeof(buf), fp)) {
+        logged = logged || strstr(buf, "  | kia-to-stderr") != NULL;
+    }
+    fclose(fp);
+    ASSERT(logged);
+
+    session_list_free(&list);
+}
+
+/* Test: Processes a session leaves behind are stopped with it */
+TEST(test_session_start_teardown) {
+    session_list_t list = {0};
+    session_info_t info;
+    struct timespec start, end;
+    int pid = 0;
+
+    if (geteuid() != 0) {
+        return;
+    }
+
+    /* Orphans are re-parented to the test, as they would be to Kia */
+    ASSERT_EQ(session_group_subreaper(), KIA_SUCCESS);
+    ASSERT_EQ(session_list_add(&list, "Leaver", "sleep 30 & echo $! > /tmp/kia_session_linger.pid",
+                               SESSION_WAYLAND), KIA_SUCCESS);
+    ASSERT_EQ(session_list_get(&list, 0, &info), KIA_SUCCESS);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ASSERT_EQ(session_start(&info, "root", NULL), KIA_SUCCESS);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ASSERT(end.tv_sec - start.tv_sec < SESSION_GROUP_STOP_TIMEOUT_MS / 1000);
+
+    FILE *fp = fopen("/tmp/kia_session_linger.pid", "r");
+    ASSERT(fp != NULL);
+    ASSERT_EQ(fscanf(fp, "%d", &pid), 1);
+    fclose(fp);
+    unlink("/tmp/kia_session_linger.pid");
+    ASSERT(pid > 1);
+    ASSERT_EQ(kill(pid, 0), -1);
+    ASSERT_EQ(errno, ESRCH);
+
+    session_list_free(&list);
+}
+
+/* Test: Sessions get a fresh environment block, not the greeter's */
+TEST(test_session_start_env) {
+    session_list_t list = {0};
+    session_info_t info;
+    session_info_t named = { "Named", "test \"$XDG_CURRENT_DESKTOP\" = KIA:Test",
+                             SESSION_WAYLAND, NULL, 0, "KIA:Test" };
+    const char *pam_env[] = { "KIA_PAM_TEST=yes", "USER=from-pam", "WAYLAND_DISPLAY=pam", NULL };
+
+    if (geteuid() != 0) {
+        return;
+    }
+
+    setenv("KIA_GREETER_ONLY", "1", 1);
+    ASSERT_EQ(session_list_add(&list, "Env",
+                               "test -z \"$KIA_GREETER_ONLY\" && test \"$KIA_PAM_TEST\" = yes && "
+                               "test \"$USER\" = from-pam && test \"$LOGNAME\" = root && "
+                               "test -n \"$WAYLAND_DISPLAY\" && "
+                               "test \"$WAYLAND_DISPLAY\" != pam && test -n \"$PATH\" && "
+                               "test -z \"$XDG_CURRENT_DESKTOP\" && echo ready >&\"$KIA_READY_FD\"",
+                               SESSION_WAYLAND), KIA_SUCCESS);
+    ASSERT_EQ(session_list_get(&list, 0, &info), KIA_SUCCESS);
+    ASSERT_EQ(session_start(&info, "root", pam_env), KIA_SUCCESS);
+
+    /* Without PAM variables the base identity stands */
+    ASSERT_EQ(session_start(&info, "root", NULL), KIA_ERROR_SESSION);
+    unsetenv("KIA_GREETER_ONLY");
+
+    /* DesktopNames reach the session as XDG_CURRENT_DESKTOP */
+    ASSERT_EQ(session_start(&named, "root", NULL), KIA_SUCCESS);
+
+    /* WAYLAND_DISPLAY names the socket allocated to this session, not PAM's */
+    session_info_t shown = { "Shown", "printf %s \"$WAYLAND_DISPLAY\" > \"$KIA_OUT\"",
+                             SESSION_WAYLAND, NULL, 0, NULL };
+    session_proc_t proc;
+    char out[128], out_var[160], seen[64];
+    int status;
+    snprintf(out, sizeof(out), "%s/wayland-display", state_root);
+    snprintf(out_var, sizeof(out_var), "KIA_OUT=%s", out);
+    const char *shown_env[] = { out_var, "WAYLAND_DISPLAY=pam", NULL };
+    ASSERT_EQ(session_launch(&shown, "root", shown_env, &proc), KIA_SUCCESS);
+    ASSERT_EQ(waitpid(proc.pid, &status, 0), proc.pid);
+    ASSERT(read_small_file(out, seen, sizeof(seen)) > 0);
+    ASSERT_STR_EQ(seen, proc.display.wayland_display);
+    session_end(&proc);
+    unlink(out);
+
+    session_list_free(&list);
+}
+
 /* Test: Session list free with NULL */
 TEST(test_session_list_free_null) {
     /* Should not crash */
     session_list_free(NULL);
     
-    session_list_t list;
-    list.sessions = NULL;
-    list.count = 0;
+    session_list_t list = {0};
     
-    /* Should not crash with NULL sessions */
+    /* Should not crash with empty list */
     session_list_free(&list);
 }
 
@@ -213,29 +498,23 @@ TEST(test_session_discover_null) {
 
 /* Test: Session start with invalid parameters */
 TEST(test_session_start_invalid_params) {
-    session_info_t session;
-    strcpy(session.name, "Test Session");
-    strcpy(session.exec, "/bin/true");
-    session.type = SESSION_X11;
+    session_info_t session = { "Test Session", "/bin/true", SESSION_X11, NULL, 0, NULL };
     
     /* NULL session */
-    int result = session_start(NULL, "testuser");
+    int result = session_start(NULL, "testuser", NULL);
     ASSERT_EQ(result, KIA_ERROR_SESSION);
     
     /* NULL username */
-    result = session_start(&session, NULL);
+    result = session_start(&session, NULL, NULL);
     ASSERT_EQ(result, KIA_ERROR_SESSION);
 }
 
 /* Test: Session start with nonexistent user */
 TEST(test_session_start_nonexistent_user) {
-    session_info_t session;
-    strcpy(session.name, "Test Session");
-    strcpy(session.exec, "/bin/true");
-    session.type = SESSION_X11;
+    session_info_t session = { "Test Session", "/bin/true", SESSION_X11, NULL, 0, NULL };
     
     /* Use a username that definitely doesn't exist */
-    int result = session_start(&session, "nonexistent_user_12345");
+    int result = session_start(&session, "nonexistent_user_12345", NULL);
     ASSERT_EQ(result, KIA_ERROR_SESSION);
 }
 
@@ -252,46 +531,622 @@ TEST(test_session_type_enum) {
     ASSERT_TRUE(session.type != SESSION_X11);
 }
 
-/* Test: Session info structure size limits */
+/* Test: Session list field size limits */
 TEST(test_session_info_size_limits) {
-    session_info_t session;
-    
-    /* Test name field size */
-    char long_name[300];
-    memset(long_name, 'A', sizeof(long_name) - 1);
-    long_name[sizeof(long_name) - 1] = '\0';
-    
-    strncpy(session.name, long_name, sizeof(session.name) - 1);
-    session.name[sizeof(session.name) - 1] = '\0';
+    session_list_t list = {0};
     
-    ASSERT_EQ(strlen(session.name), sizeof(session.name) - 1);
+    /* Longest accepted name and exec */
+    char long_name[SESSION_MAX_FIELD_LEN + 2];
+    memset(long_name, 'A', SESSION_MAX_FIELD_LEN);
+    long_name[SESSION_MAX_FIELD_LEN] = '\0';
+    ASSERT_EQ(session_list_add(&list, long_name, long_name, SESSION_X11), KIA_SUCCESS);
+    ASSERT_EQ(strlen(session_list_name(&list, 0)), SESSION_MAX_FIELD_LEN);
+    ASSERT_EQ(strlen(session_list_exec(&list, 0)), SESSION_MAX_FIELD_LEN);
     
-    /* Test exec field size */
-    char long_exec[600];
-    memset(long_exec, 'B', sizeof(long_exec) - 1);
-    long_exec[sizeof(long_exec) - 1] = '\0';
+    /* One byte longer is rejected */
+    long_name[SESSION_MAX_FIELD_LEN] = 'A';
+    long_name[SESSION_MAX_FIELD_LEN + 1] = '\0';
+    ASSERT_EQ(session_list_add(&list, long_name, "exec", SESSION_X11), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_list_add(&list, "name", long_name, SESSION_X11), KIA_ERROR_SESSION);
     
-    strncpy(session.exec, long_exec, sizeof(session.exec) - 1);
-    session.exec[sizeof(session.exec) - 1] = '\0';
+    /* Empty fields are rejected */
+    ASSERT_EQ(session_list_add(&list, "", "exec", SESSION_X11), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_list_add(&list, "name", "", SESSION_X11), KIA_ERROR_SESSION);
+    ASSERT_EQ(list.count, 1);
     
-    ASSERT_EQ(strlen(session.exec), sizeof(session.exec) - 1);
+    session_list_free(&list);
 }
 
 /* Test: Empty session list after discovery failure */
 TEST(test_empty_session_list) {
-    session_list_t list;
-    list.sessions = NULL;
-    list.count = 0;
+    session_list_t list = {0};
     
     /* Verify initial state */
-    ASSERT_NULL(list.sessions);
+    ASSERT_NULL(list.records);
     ASSERT_EQ(list.count, 0);
     
     /* Free should be safe */
     session_list_free(&list);
     
-    ASSERT_NULL(list.sessions);
+    ASSERT_NULL(list.records);
+    ASSERT_EQ(list.count, 0);
+}
+
+/* Test: Discovery in explicit directories with cache round trip */
+TEST(test_session_discover_in_with_cache) {
+    char *temp_dir = create_temp_dir();
+    ASSERT_NOT_NULL(temp_dir);
+    
+    char xsessions_dir[512], wayland_dir[512], cache_path[512];
+    snprintf(xsessions_dir, sizeof(xsessions_dir), "%s/xsessions", temp_dir);
+    snprintf(wayland_dir, sizeof(wayland_dir), "%s/wayland-sessions", temp_dir);
+    snprintf(cache_path, sizeof(cache_path), "%s/cache/sessions.cache", temp_dir);
+    mkdir(xsessions_dir, 0755);
+    mkdir(wayland_dir, 0755);
+    
+    ASSERT_EQ(create_desktop_file(xsessions_dir, "xfce.desktop", "XFCE Session", "startxfce4"), 0);
+    ASSERT_EQ(create_desktop_file(wayland_dir, "sway.desktop", "Sway", "sway"), 0);
+    char xfce_path[600];
+    snprintf(xfce_path, sizeof(xfce_path), "%s/xfce.desktop", xsessions_dir);
+    FILE *xfce = fopen(xfce_path, "a");
+    ASSERT_NOT_NULL(xfce);
+    fputs("DesktopNames=XFCE;;GNOME;\n", xfce);
+    fclose(xfce);
+    age_dir(xsessions_dir);
+    age_dir(wayland_dir);
+    
+    session_dir_t dirs[] = {
+        { xsessions_dir, SESSION_X11 },
+        { wayland_dir, SESSION_WAYLAND }
+    };
+    
+    /* First discovery scans and writes the cache */
+    session_list_t list;
+    ASSERT_EQ(session_discover_in(&list, dirs, 2, cache_path), KIA_SUCCESS);
+    ASSERT_EQ(list.count, 2);
+    ASSERT_NULL(list.mapping);
+    ASSERT_EQ(access(cache_path, R_OK), 0);
+    session_info_t info;
+    ASSERT_EQ(session_list_get(&list, 0, &info), KIA_SUCCESS);
+    ASSERT_STR_EQ(info.desktop_names, "XFCE:GNOME");
+    session_list_free(&list);
+    
+    /* Second discovery is served from the mapped cache */
+    ASSERT_EQ(session_discover_in(&list, dirs, 2, cache_path), KIA_SUCCESS);
+    ASSERT_EQ(list.count, 2);
+    ASSERT_NOT_NULL(list.mapping);
+    ASSERT_STR_EQ(session_list_name(&list, 0), "XFCE Session");
+    ASSERT_EQ(session_list_type(&list, 0), SESSION_X11);
+    ASSERT_STR_EQ(session_list_exec(&list, 1), "sway");
+    ASSERT_EQ(session_list_type(&list, 1), SESSION_WAYLAND);
+    ASSERT_EQ(session_list_get(&list, 0, &info), KIA_SUCCESS);
+    ASSERT_STR_EQ(info.desktop_names, "XFCE:GNOME");
+    ASSERT_EQ(session_list_get(&list, 1, &info), KIA_SUCCESS);
+    ASSERT_STR_EQ(info.desktop_names, "");
+    
+    /* Appending to a cached list moves it to the heap */
+    ASSERT_EQ(session_list_add(&list, "Weston", "weston", SESSION_WAYLAND), KIA_SUCCESS);
+    ASSERT_NULL(list.mapping);
+    ASSERT_EQ(list.count, 3);
+    ASSERT_STR_EQ(session_list_name(&list, 0), "XFCE Session");
+    ASSERT_STR_EQ(session_list_exec(&list, 2), "weston");
+    ASSERT_EQ(session_list_get(&list, 0, &info), KIA_SUCCESS);
+    ASSERT_STR_EQ(info.desktop_names, "XFCE:GNOME");
+    ASSERT_EQ(session_list_get(&list, 2, &info), KIA_SUCCESS);
+    ASSERT_STR_EQ(info.desktop_names, "");
+    session_list_free(&list);
+    ASSERT_NULL(list.mapping);
+    
+    /* Installing a session invalidates the cache */
+    ASSERT_EQ(create_desktop_file(wayland_dir, "weston.desktop", "Weston", "weston"), 0);
+    ASSERT_EQ(session_discover_in(&list, dirs, 2, cache_path), KIA_SUCCESS);
+    ASSERT_EQ(list.count, 3);
+    ASSERT_NULL(list.mapping);
+    session_list_free(&list);
+    
+    /* So does a change to a PATH directory */
+    age_dir(wayland_dir);
+    ASSERT_EQ(session_discover_in(&list, dirs, 2, cache_path), KIA_SUCCESS);
+    session_list_free(&list);
+    ASSERT_EQ(session_discover_in(&list, dirs, 2, cache_path), KIA_SUCCESS);
+    ASSERT_NOT_NULL(list.mapping);
+    session_list_free(&list);
+    ASSERT_EQ(install_stub_command("kia-unrelated"), 0);
+    ASSERT_EQ(session_discover_in(&list, dirs, 2, cache_path), KIA_SUCCESS);
+    ASSERT_NULL(list.mapping);
+    session_list_free(&list);
+    age_dir(stub_dir);
+    
+    remove_dir_recursive(temp_dir);
+    free(temp_dir);
+}
+
+/* Helper function to write a desktop file with a TryExec key */
+static int create_try_exec_file(const char *dir, const char *filename, const char *name,
+                                const char *try_exec, const char *exec) {
+    char filepath[512];
+    snprintf(filepath, sizeof(filepath), "%s/%s", dir, filename);
+
+    FILE *fp = fopen(filepath, "w");
+    if (!fp) {
+        return -1;
+    }
+    fprintf(fp, "[Desktop Entry]\nName=%s\nTryExec=%s\nExec=%s\n", name, try_exec, exec);
+    fclose(fp);
+    return 0;
+}
+
+/* Test: Sessions whose command is not installed are left out */
+TEST(test_session_discover_missing_commands) {
+    char *temp_dir = create_temp_dir();
+    ASSERT_NOT_NULL(temp_dir);
+
+    session_dir_t dirs[] = { { temp_dir, SESSION_WAYLAND } };
+    session_list_t list;
+
+    ASSERT_EQ(create_desktop_file(temp_dir, "sway.desktop", "Sway", "sway %U"), 0);
+    ASSERT_EQ(create_desktop_file(temp_dir, "missing.desktop", "Missing", "kia-missing-wm"), 0);
+    ASSERT_EQ(create_desktop_file(temp_dir, "shell.desktop", "Shell", "kia-missing-wm || sway"), 0);
+    ASSERT_EQ(create_desktop_file(temp_dir, "absolute.desktop", "Absolute", "/bin/sh -l"), 0);
+    ASSERT_EQ(create_try_exec_file(temp_dir, "tried.desktop", "Tried", "/nonexistent/wm",
+                                   "sway"), 0);
+    ASSERT_EQ(create_try_exec_file(temp_dir, "wrapped.desktop", "Wrapped", "sway",
+                                   "kia-missing-wm"), 0);
+
+    ASSERT_EQ(session_discover_in(&list, dirs, 1, NULL), KIA_SUCCESS);
+    ASSERT_EQ(list.count, 4);
+    ASSERT_TRUE(session_list_find_file(&list, SESSION_WAYLAND, "sway.desktop") >= 0);
+    ASSERT_TRUE(session_list_find_file(&list, SESSION_WAYLAND, "absolute.desktop") >= 0);
+    ASSERT_EQ(session_list_find_file(&list, SESSION_WAYLAND, "missing.desktop"), -1);
+    ASSERT_EQ(session_list_find_file(&list, SESSION_WAYLAND, "tried.desktop"), -1);
+
+    /* Shell lines are only checked through TryExec */
+    ASSERT_TRUE(session_list_find_file(&list, SESSION_WAYLAND, "shell.desktop") >= 0);
+    ASSERT_TRUE(session_list_find_file(&list, SESSION_WAYLAND, "wrapped.desktop") >= 0);
+
+    /* Installing the command makes the session available on reload */
+    ASSERT_EQ(install_stub_command("kia-missing-wm"), 0);
+    ASSERT_EQ(session_list_load_file(&list, dirs, 0, "missing.desktop"), KIA_SUCCESS);
+    ASSERT_EQ(list.count, 5);
+    age_dir(stub_dir);
+
+    session_list_free(&list);
+    remove_dir_recursive(temp_dir);
+    free(temp_dir);
+}
+
+/* Test: X11 sessions run against the display their own server reports */
+TEST(test_session_start_xorg) {
+    session_list_t list = {0};
+    session_info_t info;
+
+    if (geteuid() != 0) {
+        return;
+    }
+
+    /* Stub server reporting display 42 on -displayfd */
+    ASSERT_EQ(install_stub_xorg("42"), 0);
+
+    ASSERT_EQ(session_list_add(&list, "X",
+                               "test \"$DISPLAY\" = :42 && test -s \"$XAUTHORITY\"",
+                               SESSION_X11), KIA_SUCCESS);
+    ASSERT_EQ(session_list_get(&list, 0, &info), KIA_SUCCESS);
+    ASSERT_EQ(session_start(&info, "root", NULL), KIA_SUCCESS);
+
+    /* The server went with the session */
+    ASSERT_TRUE(waitpid(-1, NULL, WNOHANG) < 0 && errno == ECHILD);
+
+    remove_stub_xorg();
+    session_list_free(&list);
+}
+
+/* Test: Sessions running at once get their own display and socket name */
+TEST(test_session_launch_concurrent) {
+    session_list_t list = {0};
+    session_info_t wayland, x11;
+    session_proc_t first, second, third;
+    char out[3][128], env[3][160], seen[64], expected[16];
+    const char *pam_env[3][2];
+
+    if (geteuid() != 0) {
+        return;
+    }
+
+    /* Each session writes the display it was given to a file of its own */
+    for (int i = 0; i < 3; i++) {
+        snprintf(out[i], sizeof(out[i]), "%s/display-%d", state_root, i);
+        snprintf(env[i], sizeof(env[i]), "KIA_OUT=%s", out[i]);
+        pam_env[i][0] = env[i];
+        pam_env[i][1] = NULL;
+    }
+    ASSERT_EQ(install_stub_xorg("$d"), 0);
+    ASSERT_EQ(session_list_add(&list, "W", "printf %s \"$WAYLAND_DISPLAY\" > \"$KIA_OUT\"",
+                               SESSION_WAYLAND), KIA_SUCCESS);
+    ASSERT_EQ(session_list_add(&list, "X", "printf %s \"$DISPLAY\" > \"$KIA_OUT\"",
+                               SESSION_X11), KIA_SUCCESS);
+    ASSERT_EQ(session_list_get(&list, 0, &wayland), KIA_SUCCESS);
+    ASSERT_EQ(session_list_get(&list, 1, &x11), KIA_SUCCESS);
+
+    ASSERT_EQ(session_launch(&wayland, "root", pam_env[0], &first), KIA_SUCCESS);
+    ASSERT_EQ(session_launch(&wayland, "root", pam_env[1], &second), KIA_SUCCESS);
+    ASSERT_EQ(session_launch(&x11, "root", pam_env[2], &third), KIA_SUCCESS);
+    ASSERT_TRUE(first.display.wayland_display[0] != '\0');
+    ASSERT_TRUE(strcmp(first.display.wayland_display, second.display.wayland_display) != 0);
+    ASSERT_TRUE(third.display.x_display >= 0);
+    ASSERT_EQ(third.xorg.display, third.display.x_display);
+
+    int status;
+    ASSERT_EQ(waitpid(first.pid, &status, 0), first.pid);
+    ASSERT_EQ(waitpid(second.pid, &status, 0), second.pid);
+    ASSERT_EQ(waitpid(third.pid, &status, 0), third.pid);
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    ASSERT(read_small_file(out[0], seen, sizeof(seen)) > 0);
+    ASSERT_STR_EQ(seen, first.display.wayland_display);
+    ASSERT(read_small_file(out[1], seen, sizeof(seen)) > 0);
+    ASSERT_STR_EQ(seen, second.display.wayland_display);
+    ASSERT(read_small_file(out[2], seen, sizeof(seen)) > 0);
+    snprintf(expected, sizeof(expected), ":%d", third.display.x_display);
+    ASSERT_STR_EQ(seen, expected);
+
+    session_xorg_stop(&third.xorg);
+    session_end(&first);
+    session_end(&second);
+    session_end(&third);
+    ASSERT_EQ(first.display.wayland_lock_fd, -1);
+    ASSERT_TRUE(waitpid(-1, NULL, WNOHANG) < 0 && errno == ECHILD);
+
+    for (int i = 0; i < 3; i++) {
+        unlink(out[i]);
+    }
+    remove_stub_xorg();
+    session_list_free(&list);
+}
+
+/* Test: X servers reaped outside session_xorg_stop() do not stay tracked */
+TEST(test_session_xorg_cycles) {
+    session_list_t list = {0};
+    session_info_t info;
+    session_proc_t proc;
+    int status;
+
+    if (geteuid() != 0) {
+        return;
+    }
+
+    ASSERT_EQ(install_stub_xorg("$d"), 0);
+    ASSERT_EQ(session_list_add(&list, "X", "true", SESSION_X11), KIA_SUCCESS);
+    ASSERT_EQ(session_list_get(&list, 0, &info), KIA_SUCCESS);
+
+    /* Reaped the way the supervisor does, server and client each on its own */
+    for (int i = 0; i < SESSION_GROUP_MAX_TRACKED + 2; i++) {
+        ASSERT_EQ(session_launch(&info, "root", NULL, &proc), KIA_SUCCESS);
+        ASSERT(proc.xorg.pid > 0);
+        ASSERT_EQ(waitpid(proc.pid, &status, 0), proc.pid);
+        kill(proc.xorg.pid, SIGTERM);
+        ASSERT_EQ(waitpid(proc.xorg.pid, &status, 0), proc.xorg.pid);
+        session_end(&proc);
+    }
+
+    /* The table still has room */
+    ASSERT_EQ(session_group_track(getpid()), KIA_SUCCESS);
+    session_group_untrack(getpid());
+
+    remove_stub_xorg();
+    session_list_free(&list);
+}
+
+/* Test: A launch plan outlives its session list and launches repeatedly */
+TEST(test_session_launch_plan) {
+    session_list_t list = {0};
+    session_info_t info;
+    session_plan_t plan;
+    session_proc_t proc;
+    const char *pam_env[] = { "KIA_PLAN=yes", NULL };
+    int status;
+
+    ASSERT_EQ(session_list_add(&list, "Planned", "printenv KIA_PLAN", SESSION_WAYLAND),
+              KIA_SUCCESS);
+    ASSERT_EQ(session_list_get(&list, 0, &info), KIA_SUCCESS);
+    ASSERT_EQ(session_plan_prepare(NULL, &info, "root", NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_plan_prepare(&plan, &info, "nonexistent_user_12345", NULL),
+              KIA_ERROR_SESSION);
+    ASSERT(plan.strings == NULL);
+    ASSERT_EQ(session_launch_plan(&plan, &proc), KIA_ERROR_SESSION);
+    if (geteuid() != 0) {
+        session_list_free(&list);
+        return;
+    }
+
+    ASSERT_EQ(session_plan_prepare(&plan, &info, "root", pam_env), KIA_SUCCESS);
+    session_list_free(&list);
+    ASSERT_STR_EQ(plan.session.name, "Planned");
+    ASSERT_STR_EQ(plan.username, "root");
+    ASSERT_EQ(plan.uid, 0);
+    ASSERT(plan.group_count > 0);
+    ASSERT(plan.command[0] == '/');
+    ASSERT_STR_EQ(session_env_get(&plan.env, "KIA_PLAN"), "yes");
+    ASSERT(session_env_get(&plan.env, "WAYLAND_DISPLAY") == NULL);
+
+    /* printenv fails unless the planned environment reached the session */
+    for (int i = 0; i < 2; i++) {
+        ASSERT_EQ(session_launch_plan(&plan, &proc), KIA_SUCCESS);
+        ASSERT_EQ(waitpid(proc.pid, &status, 0), proc.pid);
+        ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        session_end(&proc);
+    }
+
+    session_plan_free(&plan);
+    ASSERT(plan.strings == NULL);
+    session_plan_free(NULL);
+}
+
+/* Test: Discovery in empty directories fails */
+TEST(test_session_discover_in_empty) {
+    char *temp_dir = create_temp_dir();
+    ASSERT_NOT_NULL(temp_dir);
+    
+    session_dir_t dirs[] = { { temp_dir, SESSION_X11 } };
+    session_list_t list;
+    
+    ASSERT_EQ(session_discover_in(&list, dirs, 1, NULL), KIA_ERROR_SESSION);
+    ASSERT_NULL(list.records);
     ASSERT_EQ(list.count, 0);
+    ASSERT_EQ(session_discover_in(&list, NULL, 0, NULL), KIA_ERROR_SESSION);
+    
+    remove_dir_recursive(temp_dir);
+    free(temp_dir);
+}
+
+/* Test: Removing sessions keeps order and reclaims arena space */
+TEST(test_session_list_remove) {
+    session_list_t list = {0};
+    char name[64];
+    
+    ASSERT_EQ(session_list_add(&list, "A", "a", SESSION_X11), KIA_SUCCESS);
+    ASSERT_EQ(session_list_add(&list, "B", "b", SESSION_X11), KIA_SUCCESS);
+    ASSERT_EQ(session_list_add(&list, "C", "c", SESSION_WAYLAND), KIA_SUCCESS);
+    
+    ASSERT_EQ(session_list_remove(&list, 1), KIA_SUCCESS);
+    ASSERT_EQ(list.count, 2);
+    ASSERT_STR_EQ(session_list_name(&list, 0), "A");
+    ASSERT_STR_EQ(session_list_name(&list, 1), "C");
+    ASSERT_EQ(session_list_type(&list, 1), SESSION_WAYLAND);
+    ASSERT_EQ(session_list_remove(&list, 2), KIA_ERROR_SESSION);
+    
+    /* Churn enough sessions to trigger compaction */
+    for (int i = 0; i < 200; i++) {
+        snprintf(name, sizeof(name), "Churn session %d", i);
+        ASSERT_EQ(session_list_add(&list, name, "churn", SESSION_X11), KIA_SUCCESS);
+        ASSERT_EQ(session_list_remove(&list, 2), KIA_SUCCESS);
+    }
+    ASSERT_EQ(list.count, 2);
+    ASSERT(list.arena_len < 2048);
+    ASSERT_STR_EQ(session_list_name(&list, 0), "A");
+    ASSERT_STR_EQ(session_list_exec(&list, 1), "c");
+    ASSERT_STR_EQ(session_list_file(&list, 1), "");
+    
+    session_list_free(&list);
+}
+
+/* Test: Single desktop files are added, replaced in place and removed */
+TEST(test_session_list_load_file) {
+    char *temp_dir = create_temp_dir();
+    ASSERT_NOT_NULL(temp_dir);
+    char path[512];
+    
+    session_dir_t dirs[] = { { temp_dir, SESSION_WAYLAND } };
+    session_list_t list = {0};
+    
+    ASSERT_EQ(create_desktop_file(temp_dir, "sway.desktop", "Sway", "sway"), 0);
+    ASSERT_EQ(create_desktop_file(temp_dir, "river.desktop", "River", "river"), 0);
+    ASSERT_EQ(session_discover_in(&list, dirs, 1, NULL), KIA_SUCCESS);
+    ASSERT_EQ(list.count, 2);
+    
+    int sway = session_list_find_file(&list, SESSION_WAYLAND, "sway.desktop");
+    ASSERT(sway >= 0);
+    ASSERT_STR_EQ(session_list_file(&list, sway), "sway.desktop");
+    ASSERT_EQ(session_list_find_file(&list, SESSION_X11, "sway.desktop"), -1);
+    
+    /* Changed file replaces the session in place */
+    ASSERT_EQ(create_desktop_file(temp_dir, "sway.desktop", "Sway (GPU)",
+                                  "sway --unsupported-gpu"), 0);
+    ASSERT_EQ(session_list_load_file(&list, dirs, 0, "sway.desktop"), KIA_SUCCESS);
+    ASSERT_EQ(list.count, 2);
+    ASSERT_STR_EQ(session_list_name(&list, sway), "Sway (GPU)");
+    ASSERT_STR_EQ(session_list_exec(&list, sway), "sway --unsupported-gpu");
+    
+    /* New file is appended */
+    ASSERT_EQ(create_desktop_file(temp_dir, "labwc.desktop", "labwc", "labwc"), 0);
+    ASSERT_EQ(session_list_load_file(&list, dirs, 0, "labwc.desktop"), KIA_SUCCESS);
+    ASSERT_EQ(list.count, 3);
+    ASSERT_STR_EQ(session_list_name(&list, 2), "labwc");
+    
+    /* Missing file removes its session */
+    snprintf(path, sizeof(path), "%s/sway.desktop", temp_dir);
+    unlink(path);
+    ASSERT_EQ(session_list_load_file(&list, dirs, 0, "sway.desktop"), KIA_ERROR_SESSION);
+    ASSERT_EQ(list.count, 2);
+    ASSERT_EQ(session_list_find_file(&list, SESSION_WAYLAND, "sway.desktop"), -1);
+    
+    /* Invalid file IDs are rejected */
+    ASSERT_EQ(session_list_load_file(&list, dirs, 0, "../x.desktop"), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_list_load_file(&list, dirs, 0, ""), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_list_load_file(&list, dirs, SESSION_DIR_NONE, "x.desktop"),
+              KIA_ERROR_SESSION);
+    
+    session_list_free(&list);
+    remove_dir_recursive(temp_dir);
+    free(temp_dir);
+}
+
+/* Test: Session directories from XDG_DATA_DIRS */
+TEST(test_session_dirs_from_data_dirs) {
+    session_dir_t dirs[SESSION_MAX_DATA_DIRS * 2];
+    
+    int count = session_dirs_from_data_dirs("/opt/share:/usr/share/:relative::/opt/share", dirs);
+    ASSERT_EQ(count, 4);
+    ASSERT_STR_EQ(dirs[0].path, "/opt/share/xsessions");
+    ASSERT_EQ(dirs[0].type, SESSION_X11);
+    ASSERT_STR_EQ(dirs[1].path, "/opt/share/wayland-sessions");
+    ASSERT_EQ(dirs[1].type, SESSION_WAYLAND);
+    ASSERT_STR_EQ(dirs[2].path, "/usr/share/xsessions");
+    ASSERT_STR_EQ(dirs[3].path, "/usr/share/wayland-sessions");
+    session_dirs_free(dirs, count);
+    
+    /* Unset, empty or unusable values fall back to the defaults */
+    count = session_dirs_from_data_dirs(NULL, dirs);
+    ASSERT_EQ(count, 4);
+    ASSERT_STR_EQ(dirs[0].path, "/usr/local/share/xsessions");
+    ASSERT_STR_EQ(dirs[3].path, "/usr/share/wayland-sessions");
+    session_dirs_free(dirs, count);
+    
+    ASSERT_EQ(session_dirs_from_data_dirs("", dirs), 4);
+    session_dirs_free(dirs, 4);
+    ASSERT_EQ(session_dirs_from_data_dirs("relative:also/relative", dirs), 4);
+    session_dirs_free(dirs, 4);
+    
+    /* The filesystem root does not produce a double slash */
+    count = session_dirs_from_data_dirs("/", dirs);
+    ASSERT_EQ(count, 2);
+    ASSERT_STR_EQ(dirs[0].path, "/xsessions");
+    session_dirs_free(dirs, count);
+    
+    ASSERT_EQ(session_dirs_from_data_dirs("/usr/share", NULL), 0);
+}
+
+/* Test: Earlier data directories shadow later ones by desktop file ID */
+TEST(test_session_discover_shadowing) {
+    char *temp_dir = create_temp_dir();
+    ASSERT_NOT_NULL(temp_dir);
+    char path[600];
+    
+    char local_x11[512], system_x11[512], system_wayland[512];
+    snprintf(local_x11, sizeof(local_x11), "%s/local-xsessions", temp_dir);
+    snprintf(system_x11, sizeof(system_x11), "%s/system-xsessions", temp_dir);
+    snprintf(system_wayland, sizeof(system_wayland), "%s/system-wayland-sessions", temp_dir);
+    mkdir(local_x11, 0755);
+    mkdir(system_x11, 0755);
+    mkdir(system_wayland, 0755);
+    
+    session_dir_t dirs[] = {
+        { local_x11, SESSION_X11 },
+        { system_x11, SESSION_X11 },
+        { system_wayland, SESSION_WAYLAND }
+    };
+    
+    /* Local override wins */
+    ASSERT_EQ(create_desktop_file(local_x11, "xfce.desktop", "Xfce (local)",
+                                  "startxfce4-local"), 0);
+    ASSERT_EQ(create_desktop_file(system_x11, "xfce.desktop", "Xfce", "startxfce4"), 0);
+    
+    /* A hidden local file hides the system one */
+    ASSERT_EQ(create_desktop_file(local_x11, "i3.desktop", "i3", "i3"), 0);
+    snprintf(path, sizeof(path), "%s/i3.desktop", local_x11);
+    FILE *fp = fopen(path, "a");
+    ASSERT_NOT_NULL(fp);
+    fprintf(fp, "Hidden=true\n");
+    fclose(fp);
+    ASSERT_EQ(create_desktop_file(system_x11, "i3.desktop", "i3", "i3"), 0);
+    
+    /* Backups and editor leftovers are not desktop files */
+    ASSERT_EQ(create_desktop_file(local_x11, "xfce.desktop.bak", "Xfce (backup)", "startxfce4"), 0);
+    ASSERT_EQ(create_desktop_file(local_x11, ".desktop", "No stem", "startxfce4"), 0);
+    
+    /* The same ID under another session type is a different session */
+    ASSERT_EQ(create_desktop_file(system_wayland, "xfce.desktop", "Xfce (Wayland)",
+                                  "startxfce4 --wayland"), 0);
+    
+    /* Many distinct IDs across the set are all kept */
+    for (int i = 0; i < 300; i++) {
+        char file[64], name[64];
+        snprintf(file, sizeof(file), "session-%03d.desktop", i);
+        snprintf(name, sizeof(name), "Session %03d", i);
+        ASSERT_EQ(create_desktop_file(i % 2 ? system_x11 : local_x11, file, name, "exec"), 0);
+    }
+    
+    session_list_t list = {0};
+    ASSERT_EQ(session_discover_in(&list, dirs, 3, NULL), KIA_SUCCESS);
+    ASSERT_EQ(list.count, 302);
+    
+    int xfce = session_list_find_file(&list, SESSION_X11, "xfce.desktop");
+    ASSERT(xfce >= 0);
+    ASSERT_STR_EQ(session_list_exec(&list, xfce), "startxfce4-local");
+    ASSERT_EQ(list.records[xfce].dir, 0);
+    ASSERT_EQ(session_list_find_file(&list, SESSION_X11, "i3.desktop"), -1);
+    
+    int wayland = session_list_find_file(&list, SESSION_WAYLAND, "xfce.desktop");
+    ASSERT(wayland >= 0);
+    ASSERT_STR_EQ(session_list_name(&list, wayland), "Xfce (Wayland)");
+    
+    session_list_free(&list);
+    remove_dir_recursive(temp_dir);
+    free(temp_dir);
+}
+
+/* Test: Overlay sessions shadow, extend and restore a discovered list */
+TEST(test_session_list_merge_overlay) {
+    char *temp_dir = create_temp_dir();
+    ASSERT_NOT_NULL(temp_dir);
+    
+    char system_x11[512], user_x11[512];
+    snprintf(system_x11, sizeof(system_x11), "%s/system-xsessions", temp_dir);
+    snprintf(user_x11, sizeof(user_x11), "%s/user-xsessions", temp_dir);
+    mkdir(system_x11, 0755);
+    mkdir(user_x11, 0755);
+    ASSERT_EQ(create_desktop_file(system_x11, "xfce.desktop", "Xfce", "startxfce4"), 0);
+    ASSERT_EQ(create_desktop_file(system_x11, "i3.desktop", "i3", "i3"), 0);
+    ASSERT_EQ(create_desktop_file(user_x11, "xfce.desktop", "Xfce (mine)", "startxfce4-local"), 0);
+    ASSERT_EQ(create_desktop_file(user_x11, "sway.desktop", "Sway", "sway"), 0);
+    
+    session_dir_t system_dirs[] = { { system_x11, SESSION_X11 } };
+    session_dir_t user_dirs[] = { { user_x11, SESSION_X11 } };
+    session_list_t list = {0}, overlay = {0};
+    ASSERT_EQ(session_discover_in(&list, system_dirs, 1, NULL), KIA_SUCCESS);
+    ASSERT_EQ(session_discover_in(&overlay, user_dirs, 1, NULL), KIA_SUCCESS);
+    
+    int xfce = session_list_find_file(&list, SESSION_X11, "xfce.desktop");
+    ASSERT(xfce >= 0);
+    
+    /* Same ID replaces in place, new IDs are appended */
+    ASSERT_EQ(session_list_merge(&list, &overlay, 1), 2);
+    ASSERT_EQ(list.count, 3);
+    ASSERT_EQ(session_list_find_file(&list, SESSION_X11, "xfce.desktop"), xfce);
+    ASSERT_STR_EQ(session_list_name(&list, xfce), "Xfce (mine)");
+    ASSERT_EQ(list.records[xfce].dir, 1);
+    int sway = session_list_find_file(&list, SESSION_X11, "sway.desktop");
+    ASSERT(sway >= 0);
+    session_info_t info;
+    ASSERT_EQ(session_list_get(&list, sway, &info), KIA_SUCCESS);
+    ASSERT_EQ(info.argc, 1);
+    ASSERT_STR_EQ(info.args, "sway");
+    
+    /* Changes to a shadowed system file leave the overlay alone */
+    ASSERT_EQ(create_desktop_file(system_x11, "xfce.desktop", "Xfce (updated)", "startxfce4"), 0);
+    ASSERT_EQ(session_list_resolve_file(&list, system_dirs, 1, SESSION_X11, "xfce.desktop"),
+              KIA_SUCCESS);
+    ASSERT_STR_EQ(session_list_name(&list, xfce), "Xfce (mine)");
+    
+    /* Dropping the overlay brings back what it shadowed */
+    ASSERT_EQ(session_list_drop_overlay(&list, system_dirs, 1), 2);
+    ASSERT_EQ(list.count, 2);
+    xfce = session_list_find_file(&list, SESSION_X11, "xfce.desktop");
+    ASSERT(xfce >= 0);
+    ASSERT_STR_EQ(session_list_name(&list, xfce), "Xfce (updated)");
+    ASSERT_EQ(session_list_find_file(&list, SESSION_X11, "sway.desktop"), -1);
+    ASSERT_EQ(session_list_drop_overlay(&list, system_dirs, 1), 0);
+    
+    /* Invalid parameters */
+    ASSERT_EQ(session_list_merge(&list, &list, 1), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_list_merge(NULL, &overlay, 1), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_list_merge(&list, &overlay, SESSION_DIR_NONE), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_list_resolve_file(&list, system_dirs, 1, SESSION_X11, ""), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_list_drop_overlay(NULL, system_dirs, 1), 0);
+    
+    session_list_free(&overlay);
+    session_list_free(&list);
+    remove_dir_recursive(temp_dir);
+    free(temp_dir);
 }
 
 /* Main test runner */
@@ -301,16 +1156,58 @@ int main(void) {
     
     printf("Running session manager tests...\n\n");
     
+    /* Discovery leaves out sessions whose command is not on PATH */
+    static const char *fixture_commands[] = {
+        "startxfce4", "startxfce4-local", "gnome-session", "sway", "river",
+        "labwc", "weston", "i3", "exec", NULL
+    };
+    char search_path[4096];
+    if (mkdtemp(stub_dir) == NULL || mkdtemp(state_root) == NULL) {
+        printf("Failed to create temporary directory\n");
+        return 1;
+    }
+    snprintf(output_dir, sizeof(output_dir), "%s/log", state_root);
+    snprintf(lock_dir, sizeof(lock_dir), "%s/run", state_root);
+    session_set_dirs(output_dir, lock_dir);
+    for (int i = 0; fixture_commands[i] != NULL; i++) {
+        install_stub_command(fixture_commands[i]);
+    }
+    age_dir(stub_dir);
+    snprintf(search_path, sizeof(search_path), "%s:%s", stub_dir,
+             getenv("PATH") ? getenv("PATH") : "/usr/bin:/bin");
+    setenv("PATH", search_path, 1);
+    
     test_session_discovery_mock_filesystem_wrapper();
     test_desktop_file_parsing_wrapper();
     test_session_list_management_wrapper();
+    test_session_list_growth_wrapper();
+    test_session_list_remove_wrapper();
+    test_session_list_args_wrapper();
+    test_session_list_load_file_wrapper();
+    test_session_dirs_from_data_dirs_wrapper();
+    test_session_discover_shadowing_wrapper();
+    test_session_list_merge_overlay_wrapper();
     test_session_list_free_null_wrapper();
     test_session_discover_null_wrapper();
     test_session_start_invalid_params_wrapper();
     test_session_start_nonexistent_user_wrapper();
+    test_session_start_exec_wrapper();
+    test_session_start_env_wrapper();
+    test_session_start_output_wrapper();
+    test_session_start_teardown_wrapper();
     test_session_type_enum_wrapper();
     test_session_info_size_limits_wrapper();
     test_empty_session_list_wrapper();
+    test_session_discover_in_with_cache_wrapper();
+    test_session_discover_in_empty_wrapper();
+    test_session_discover_missing_commands_wrapper();
+    test_session_start_xorg_wrapper();
+    test_session_launch_concurrent_wrapper();
+    test_session_xorg_cycles_wrapper();
+    test_session_launch_plan_wrapper();
+    
+    remove_dir_recursive(stub_dir);
+    remove_dir_recursive(state_root);
     
     printf("\n");
     printf("Tests passed: %d\n", tests_passed);
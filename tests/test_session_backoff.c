@@ -0,0 +1,169 @@
+#define _GNU_SOURCE
+#include "session_backoff.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+
+/* History file of the tests */
+static char temp_dir[] = "/tmp/kia_backoff_test_XXXXXX";
+static char history_path[600];
+
+/* Test: Delays double with each failure up to the cap */
+TEST(test_backoff_delays) {
+    session_backoff_t backoff;
+
+    session_backoff_init(&backoff, NULL);
+    ASSERT_EQ(session_backoff_remaining(&backoff, 1000), 0);
+    ASSERT(!session_backoff_exhausted(&backoff, 1000));
+
+    ASSERT_EQ(session_backoff_record(&backoff, 1000), KIA_SUCCESS);
+    ASSERT(session_backoff_remaining(&backoff, 1000) == SESSION_BACKOFF_BASE_S);
+    ASSERT(session_backoff_remaining(&backoff, 1001) == SESSION_BACKOFF_BASE_S - 1);
+    ASSERT_EQ(session_backoff_remaining(&backoff, 1000 + SESSION_BACKOFF_BASE_S), 0);
+
+    ASSERT_EQ(session_backoff_record(&backoff, 1010), KIA_SUCCESS);
+    ASSERT(session_backoff_remaining(&backoff, 1010) == 2 * SESSION_BACKOFF_BASE_S);
+    ASSERT_EQ(session_backoff_record(&backoff, 1020), KIA_SUCCESS);
+    ASSERT(session_backoff_remaining(&backoff, 1020) == 4 * SESSION_BACKOFF_BASE_S);
+    ASSERT(!session_backoff_exhausted(&backoff, 1020));
+
+    /* The limit gives up on unattended attempts */
+    for (int i = 3; i < SESSION_BACKOFF_MAX_FAILURES; i++) {
+        ASSERT_EQ(session_backoff_record(&backoff, 1020 + i), KIA_SUCCESS);
+    }
+    ASSERT_EQ(backoff.count, SESSION_BACKOFF_MAX_FAILURES);
+    ASSERT(session_backoff_exhausted(&backoff, 1030));
+    ASSERT(session_backoff_remaining(&backoff, 1030) <= SESSION_BACKOFF_MAX_S);
+
+    /* Old failures fall out of the window */
+    ASSERT(!session_backoff_exhausted(&backoff, 1000 + SESSION_BACKOFF_WINDOW_S + 1));
+    ASSERT_EQ(session_backoff_record(&backoff, 1030 + SESSION_BACKOFF_WINDOW_S), KIA_SUCCESS);
+    ASSERT_EQ(backoff.count, 1);
+
+    session_backoff_reset(&backoff);
+    ASSERT_EQ(backoff.count, 0);
+    ASSERT_EQ(session_backoff_remaining(&backoff, 2000), 0);
+}
+
+/* Test: The history survives a restart and is removed on reset */
+TEST(test_backoff_persist) {
+    session_backoff_t backoff, restarted;
+    struct stat st;
+
+    session_backoff_init(&backoff, history_path);
+    ASSERT_EQ(session_backoff_load(&backoff, 500), KIA_SUCCESS);
+    ASSERT_EQ(backoff.count, 0);
+
+    ASSERT_EQ(session_backoff_record(&backoff, 100), KIA_SUCCESS);
+    ASSERT_EQ(session_backoff_record(&backoff, 400), KIA_SUCCESS);
+    ASSERT_EQ(session_backoff_record(&backoff, 450), KIA_SUCCESS);
+    ASSERT_EQ(stat(history_path, &st), 0);
+
+    /* Only the failures within the window are loaded */
+    session_backoff_init(&restarted, history_path);
+    ASSERT_EQ(session_backoff_load(&restarted, 460), KIA_SUCCESS);
+    ASSERT_EQ(restarted.count, 2);
+    ASSERT(restarted.failures[0] == 400 && restarted.failures[1] == 450);
+    ASSERT(session_backoff_remaining(&restarted, 450) == 2 * SESSION_BACKOFF_BASE_S);
+
+    session_backoff_reset(&restarted);
+    ASSERT_EQ(stat(history_path, &st), -1);
+    ASSERT_EQ(session_backoff_load(&backoff, 460), KIA_SUCCESS);
+    ASSERT_EQ(backoff.count, 0);
+}
+
+/* Test: A garbled history file is no worse than none */
+TEST(test_backoff_garbled) {
+    session_backoff_t backoff;
+
+    FILE *fp = fopen(history_path, "w");
+    ASSERT(fp != NULL);
+    fputs("10\n20\n30\n40\n50\n60\n70\n99999\nnot a number\n", fp);
+    fclose(fp);
+
+    /* At most the limit is kept, and times from a previous boot are ignored */
+    session_backoff_init(&backoff, history_path);
+    ASSERT_EQ(session_backoff_load(&backoff, 100), KIA_SUCCESS);
+    ASSERT_EQ(backoff.count, SESSION_BACKOFF_MAX_FAILURES);
+    ASSERT(backoff.failures[backoff.count - 1] == 70);
+    unlink(history_path);
+
+    /* A history that cannot be saved is still kept in memory */
+    session_backoff_init(&backoff, "/nonexistent/dir/failures");
+    ASSERT_EQ(session_backoff_record(&backoff, 100), KIA_ERROR_SESSION);
+    ASSERT_EQ(backoff.count, 1);
+}
+
+/* Test: Invalid parameters */
+TEST(test_backoff_invalid_params) {
+    ASSERT_EQ(session_backoff_load(NULL, 1), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_backoff_record(NULL, 1), KIA_ERROR_SESSION);
+    ASSERT(!session_backoff_exhausted(NULL, 1));
+    ASSERT_EQ(session_backoff_remaining(NULL, 1), 0);
+    ASSERT(session_backoff_now() > 0);
+    session_backoff_reset(NULL);
+    session_backoff_init(NULL, NULL);
+}
+
+/* Main test runner */
+int main(void) {
+    logger_init("/tmp/kia_session_backoff_test.log", true);
+
+    printf("Running session backoff tests...\n\n");
+
+    if (mkdtemp(temp_dir) == NULL) {
+        printf("Failed to create temporary directory\n");
+        return 1;
+    }
+    snprintf(history_path, sizeof(history_path), "%s/run/session-failures", temp_dir);
+
+    test_backoff_delays_wrapper();
+    test_backoff_persist_wrapper();
+    test_backoff_garbled_wrapper();
+    test_backoff_invalid_params_wrapper();
+
+    char command[600];
+    snprintf(command, sizeof(command), "rm -rf %s", temp_dir);
+    if (system(command) != 0) {
+        printf("Warning: failed to remove %s\n", temp_dir);
+    }
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    logger_close();
+
+    return tests_failed > 0 ? 1 : 0;
+}
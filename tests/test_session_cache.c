@@ -0,0 +1,222 @@
+#include "session_cache.h"
+#include "logger.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_STR_EQ(a, b) ASSERT(strcmp((a), (b)) == 0)
+#define ASSERT_NOT_NULL(x) ASSERT((x) != NULL)
+#define ASSERT_NULL(x) ASSERT((x) == NULL)
+
+/* Shared fixture paths */
+static char temp_dir[] = "/tmp/kia_cache_test_XXXXXX";
+static char x11_dir[512];
+static char wayland_dir[512];
+static char cache_path[512];
+
+/* Helper function to build a two-entry heap session list */
+static void make_list(session_list_t *list) {
+    memset(list, 0, sizeof(*list));
+    session_list_add(list, "XFCE Session", "startxfce4", SESSION_X11);
+    session_list_add(list, "Sway", "sway", SESSION_WAYLAND);
+}
+
+/* Helper function to store the two-entry list for the fixture directories */
+static int store_fixture(const session_dir_t *dirs) {
+    session_list_t list;
+    session_dir_stamp_t stamps[2];
+
+    make_list(&list);
+    session_cache_stamp(dirs, 2, stamps);
+    int result = session_cache_store(cache_path, stamps, 2, &list);
+    session_list_free(&list);
+    return result;
+}
+
+/* Test: Stored cache is loaded from the mapping */
+TEST(test_cache_store_and_load) {
+    session_dir_t dirs[] = { { x11_dir, SESSION_X11 }, { wayland_dir, SESSION_WAYLAND } };
+    session_list_t list = {0};
+
+    ASSERT_EQ(store_fixture(dirs), KIA_SUCCESS);
+    ASSERT_EQ(session_cache_load(cache_path, dirs, 2, &list), KIA_SUCCESS);
+    ASSERT_EQ(list.count, 2);
+    ASSERT_NOT_NULL(list.mapping);
+    ASSERT_EQ(list.capacity, 0);
+    ASSERT_STR_EQ(session_list_name(&list, 0), "XFCE Session");
+    ASSERT_STR_EQ(session_list_exec(&list, 1), "sway");
+    ASSERT_EQ(session_list_type(&list, 1), SESSION_WAYLAND);
+
+    /* Tokenised Exec lines are cached too */
+    session_info_t info;
+    ASSERT_EQ(session_list_get(&list, 1, &info), KIA_SUCCESS);
+    ASSERT_EQ(info.argc, 1);
+    ASSERT_STR_EQ(info.args, "sway");
+
+    session_list_free(&list);
+    ASSERT_NULL(list.records);
+    ASSERT_NULL(list.mapping);
+}
+
+/* Test: Cache is rejected once a directory changes */
+TEST(test_cache_stale_after_change) {
+    session_dir_t dirs[] = { { x11_dir, SESSION_X11 }, { wayland_dir, SESSION_WAYLAND } };
+    session_list_t list = {0};
+    char path[600];
+
+    ASSERT_EQ(store_fixture(dirs), KIA_SUCCESS);
+
+    snprintf(path, sizeof(path), "%s/new.desktop", wayland_dir);
+    FILE *fp = fopen(path, "w");
+    ASSERT_NOT_NULL(fp);
+    fclose(fp);
+
+    ASSERT_EQ(session_cache_load(cache_path, dirs, 2, &list), KIA_ERROR_SESSION);
+    ASSERT_NULL(list.records);
+
+    unlink(path);
+    age_dir(wayland_dir);
+}
+
+/* Test: Cache is rejected for a different directory set */
+TEST(test_cache_rejects_other_dirs) {
+    session_dir_t dirs[] = { { x11_dir, SESSION_X11 }, { wayland_dir, SESSION_WAYLAND } };
+    session_dir_t swapped[] = { { x11_dir, SESSION_WAYLAND }, { wayland_dir, SESSION_X11 } };
+    session_list_t list = {0};
+
+    ASSERT_EQ(store_fixture(dirs), KIA_SUCCESS);
+    ASSERT_EQ(session_cache_load(cache_path, swapped, 2, &list), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_cache_load(cache_path, dirs, 1, &list), KIA_ERROR_SESSION);
+    ASSERT_NULL(list.records);
+}
+
+/* Test: Corrupt or truncated cache files are rejected */
+TEST(test_cache_rejects_corruption) {
+    session_dir_t dirs[] = { { x11_dir, SESSION_X11 }, { wayland_dir, SESSION_WAYLAND } };
+    session_list_t list = {0};
+
+    ASSERT_EQ(store_fixture(dirs), KIA_SUCCESS);
+
+    /* Flip the magic */
+    int fd = open(cache_path, O_WRONLY);
+    ASSERT(fd >= 0);
+    ASSERT_EQ(pwrite(fd, "XXXX", 4, 0), 4);
+    close(fd);
+    ASSERT_EQ(session_cache_load(cache_path, dirs, 2, &list), KIA_ERROR_SESSION);
+
+    /* Truncate a valid cache */
+    ASSERT_EQ(store_fixture(dirs), KIA_SUCCESS);
+    ASSERT_EQ(truncate(cache_path, 100), 0);
+    ASSERT_EQ(session_cache_load(cache_path, dirs, 2, &list), KIA_ERROR_SESSION);
+
+    /* Missing cache */
+    unlink(cache_path);
+    ASSERT_EQ(session_cache_load(cache_path, dirs, 2, &list), KIA_ERROR_SESSION);
+    ASSERT_NULL(list.records);
+}
+
+/* Test: Recently modified directories are not cached */
+TEST(test_cache_skips_racy_directories) {
+    session_dir_t dirs[] = { { x11_dir, SESSION_X11 }, { wayland_dir, SESSION_WAYLAND } };
+    char path[600];
+
+    unlink(cache_path);
+    snprintf(path, sizeof(path), "%s/touch", x11_dir);
+    FILE *fp = fopen(path, "w");
+    ASSERT_NOT_NULL(fp);
+    fclose(fp);
+
+    ASSERT_EQ(store_fixture(dirs), KIA_ERROR_SESSION);
+    ASSERT(access(cache_path, F_OK) != 0);
+
+    unlink(path);
+    age_dir(x11_dir);
+}
+
+/* Test: Invalid parameters */
+TEST(test_cache_invalid_params) {
+    session_dir_t dirs[] = { { x11_dir, SESSION_X11 } };
+    session_dir_stamp_t stamps[1];
+    session_list_t list = {0};
+
+    ASSERT_EQ(session_cache_load(NULL, dirs, 1, &list), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_cache_load(cache_path, NULL, 1, &list), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_cache_load(cache_path, dirs, 0, &list), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_cache_load(cache_path, dirs, 1, NULL), KIA_ERROR_SESSION);
+
+    session_cache_stamp(dirs, 1, stamps);
+    ASSERT_EQ(session_cache_store(cache_path, stamps, 1, &list), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_cache_store(NULL, stamps, 1, &list), KIA_ERROR_SESSION);
+}
+
+/* Main test runner */
+int main(void) {
+    logger_init("/tmp/kia_session_cache_test.log", true);
+
+    printf("Running session cache tests...\n\n");
+
+    if (mkdtemp(temp_dir) == NULL) {
+        printf("Failed to create temporary directory\n");
+        return 1;
+    }
+    snprintf(x11_dir, sizeof(x11_dir), "%s/xsessions", temp_dir);
+    snprintf(wayland_dir, sizeof(wayland_dir), "%s/wayland-sessions", temp_dir);
+    snprintf(cache_path, sizeof(cache_path), "%s/cache/sessions.cache", temp_dir);
+    mkdir(x11_dir, 0755);
+    mkdir(wayland_dir, 0755);
+    age_dir(x11_dir);
+    age_dir(wayland_dir);
+
+    test_cache_store_and_load_wrapper();
+    test_cache_stale_after_change_wrapper();
+    test_cache_rejects_other_dirs_wrapper();
+    test_cache_rejects_corruption_wrapper();
+    test_cache_skips_racy_directories_wrapper();
+    test_cache_invalid_params_wrapper();
+
+    char command[600];
+    snprintf(command, sizeof(command), "rm -rf %s", temp_dir);
+    if (system(command) != 0) {
+        printf("Warning: failed to remove %s\n", temp_dir);
+    }
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    logger_close();
+
+    return tests_failed > 0 ? 1 : 0;
+}
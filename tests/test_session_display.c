@@ -0,0 +1,225 @@
+#define _GNU_SOURCE
+#include "session_display.h"
+#include "config.h"
+#include "logger.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_STR_EQ(a, b) ASSERT(strcmp((a), (b)) == 0)
+
+/* Fixture directories: Kia's locks, X server locks and a runtime directory */
+static char temp_dir[] = "/tmp/kia_display_test_XXXXXX";
+static char lock_dir[600], x_lock_dir[600], runtime_dir[600];
+
+/* Helper function to write an X server lock file for a display */
+static void write_x_lock(int display, pid_t pid) {
+    char path[700];
+    snprintf(path, sizeof(path), "%s/.X%d-lock", x_lock_dir, display);
+    FILE *f = fopen(path, "w");
+    if (f) {
+        fprintf(f, "%10d\n", (int)pid);
+        fclose(f);
+    }
+}
+
+/* Helper function to check whether a file exists */
+static bool file_exists(const char *dir, const char *name) {
+    char path[700];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    return access(path, F_OK) == 0;
+}
+
+/* Test: Sessions started back to back get distinct displays */
+TEST(test_display_alloc_x) {
+    session_display_t first, second, third;
+
+    session_display_init(&first);
+    session_display_init(&second);
+    session_display_init(&third);
+
+    ASSERT_EQ(session_display_alloc_x(&first, lock_dir, x_lock_dir), KIA_SUCCESS);
+    ASSERT_EQ(first.x_display, 0);
+    ASSERT(first.x_lock_fd >= 0);
+    ASSERT_EQ(session_display_alloc_x(&second, lock_dir, x_lock_dir), KIA_SUCCESS);
+    ASSERT_EQ(second.x_display, 1);
+
+    /* A released display is the lowest free one again */
+    session_display_release(&first);
+    ASSERT_EQ(first.x_display, -1);
+    ASSERT_EQ(first.x_lock_fd, -1);
+    ASSERT_EQ(session_display_alloc_x(&third, lock_dir, x_lock_dir), KIA_SUCCESS);
+    ASSERT_EQ(third.x_display, 0);
+
+    session_display_release(&second);
+    session_display_release(&third);
+}
+
+/* Test: Displays of live X servers are skipped, stale server locks removed */
+TEST(test_display_alloc_x_stale) {
+    session_display_t display;
+
+    /* A PID that has certainly exited */
+    pid_t dead = fork();
+    ASSERT(dead >= 0);
+    if (dead == 0) {
+        _exit(0);
+    }
+    waitpid(dead, NULL, 0);
+
+    write_x_lock(0, getpid());
+    write_x_lock(1, dead);
+
+    session_display_init(&display);
+    ASSERT_EQ(session_display_alloc_x(&display, lock_dir, x_lock_dir), KIA_SUCCESS);
+    ASSERT_EQ(display.x_display, 1);
+    ASSERT(file_exists(x_lock_dir, ".X0-lock"));
+    ASSERT(!file_exists(x_lock_dir, ".X1-lock"));
+    session_display_release(&display);
+
+    char path[700];
+    snprintf(path, sizeof(path), "%s/.X0-lock", x_lock_dir);
+    unlink(path);
+}
+
+/* Test: Lock files left by a greeter that died do not block allocation */
+TEST(test_display_alloc_x_crashed_holder) {
+    session_display_t display;
+
+    /* A child takes display 0 and exits without releasing it */
+    pid_t child = fork();
+    ASSERT(child >= 0);
+    if (child == 0) {
+        session_display_t held;
+        session_display_init(&held);
+        _exit(session_display_alloc_x(&held, lock_dir, x_lock_dir) == KIA_SUCCESS ? 0 : 1);
+    }
+    int status;
+    waitpid(child, &status, 0);
+    ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    ASSERT(file_exists(lock_dir, "x-0.lock"));
+
+    session_display_init(&display);
+    ASSERT_EQ(session_display_alloc_x(&display, lock_dir, x_lock_dir), KIA_SUCCESS);
+    ASSERT_EQ(display.x_display, 0);
+    session_display_release(&display);
+}
+
+/* Test: Wayland socket names held by Kia or a running compositor are skipped */
+TEST(test_display_alloc_wayland) {
+    session_display_t first, second;
+    char path[700];
+
+    /* A compositor serving wayland-0; a stale lock file for wayland-1 */
+    snprintf(path, sizeof(path), "%s/wayland-0.lock", runtime_dir);
+    int compositor = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    ASSERT(compositor >= 0);
+    ASSERT_EQ(flock(compositor, LOCK_EX | LOCK_NB), 0);
+    snprintf(path, sizeof(path), "%s/wayland-1.lock", runtime_dir);
+    close(open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600));
+
+    session_display_init(&first);
+    session_display_init(&second);
+    ASSERT_EQ(session_display_alloc_wayland(&first, lock_dir, runtime_dir), KIA_SUCCESS);
+    ASSERT_STR_EQ(first.wayland_display, "wayland-1");
+    ASSERT_EQ(session_display_alloc_wayland(&second, lock_dir, runtime_dir), KIA_SUCCESS);
+    ASSERT_STR_EQ(second.wayland_display, "wayland-2");
+
+    /* Without a runtime directory only Kia's own locks count */
+    session_display_release(&first);
+    ASSERT_STR_EQ(first.wayland_display, "");
+    ASSERT_EQ(session_display_alloc_wayland(&first, lock_dir, NULL), KIA_SUCCESS);
+    ASSERT_STR_EQ(first.wayland_display, "wayland-0");
+
+    session_display_release(&first);
+    session_display_release(&second);
+    close(compositor);
+}
+
+/* Test: Invalid parameters */
+TEST(test_display_invalid_params) {
+    session_display_t display;
+
+    session_display_init(&display);
+    ASSERT_EQ(session_display_alloc_x(NULL, lock_dir, x_lock_dir), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_display_alloc_x(&display, NULL, x_lock_dir), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_display_alloc_x(&display, lock_dir, NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_display_alloc_wayland(NULL, lock_dir, NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_display_alloc_wayland(&display, NULL, NULL), KIA_ERROR_SESSION);
+
+    /* Releasing nothing is harmless */
+    session_display_release(&display);
+    session_display_release(NULL);
+    session_display_init(NULL);
+}
+
+/* Main test runner */
+int main(void) {
+    logger_init("/tmp/kia_session_display_test.log", true);
+
+    printf("Running display allocation tests...\n\n");
+
+    if (mkdtemp(temp_dir) == NULL) {
+        printf("Failed to create temporary directory\n");
+        return 1;
+    }
+    snprintf(lock_dir, sizeof(lock_dir), "%s/kia", temp_dir);
+    snprintf(x_lock_dir, sizeof(x_lock_dir), "%s/x", temp_dir);
+    snprintf(runtime_dir, sizeof(runtime_dir), "%s/runtime", temp_dir);
+    mkdir(x_lock_dir, 0755);
+    mkdir(runtime_dir, 0700);
+
+    test_display_alloc_x_wrapper();
+    test_display_alloc_x_stale_wrapper();
+    test_display_alloc_x_crashed_holder_wrapper();
+    test_display_alloc_wayland_wrapper();
+    test_display_invalid_params_wrapper();
+
+    char command[600];
+    snprintf(command, sizeof(command), "rm -rf %s", temp_dir);
+    if (system(command) != 0) {
+        printf("Warning: failed to remove %s\n", temp_dir);
+    }
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    logger_close();
+
+    return tests_failed > 0 ? 1 : 0;
+}
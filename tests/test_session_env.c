@@ -0,0 +1,129 @@
+#include "session_env.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_STR_EQ(a, b) ASSERT(strcmp((a), (b)) == 0)
+
+/* Test: Variables are set, replaced in place and looked up */
+TEST(test_env_set_get) {
+    session_env_t env = {0};
+
+    ASSERT_EQ(session_env_set(&env, "HOME", "/root"), KIA_SUCCESS);
+    ASSERT_EQ(session_env_set(&env, "USER", "root"), KIA_SUCCESS);
+    ASSERT_EQ(session_env_set(&env, "HOME", "/home/kia"), KIA_SUCCESS);
+    ASSERT_EQ(env.count, 2);
+    ASSERT_STR_EQ(session_env_get(&env, "HOME"), "/home/kia");
+    ASSERT_STR_EQ(session_env_get(&env, "USER"), "root");
+
+    /* Prefixes of a name are different variables */
+    ASSERT(session_env_get(&env, "HOM") == NULL);
+    ASSERT(session_env_get(&env, "HOMEDIR") == NULL);
+
+    ASSERT_EQ(session_env_set(&env, "EMPTY", ""), KIA_SUCCESS);
+    ASSERT_STR_EQ(session_env_get(&env, "EMPTY"), "");
+
+    session_env_free(&env);
+    ASSERT_EQ(env.count, 0);
+}
+
+/* Test: NAME=value strings from PAM override earlier values */
+TEST(test_env_put) {
+    session_env_t env = {0};
+
+    ASSERT_EQ(session_env_set(&env, "PATH", "/bin"), KIA_SUCCESS);
+    ASSERT_EQ(session_env_put(&env, "PATH=/usr/bin:/bin"), KIA_SUCCESS);
+    ASSERT_EQ(session_env_put(&env, "LANG=C.UTF-8"), KIA_SUCCESS);
+    ASSERT_EQ(session_env_put(&env, "EQ=a=b"), KIA_SUCCESS);
+    ASSERT_EQ(env.count, 3);
+    ASSERT_STR_EQ(session_env_get(&env, "PATH"), "/usr/bin:/bin");
+    ASSERT_STR_EQ(session_env_get(&env, "EQ"), "a=b");
+
+    ASSERT_EQ(session_env_put(&env, "NOVALUE"), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_env_put(&env, "=value"), KIA_ERROR_SESSION);
+    ASSERT_EQ(env.count, 3);
+
+    session_env_free(&env);
+}
+
+/* Test: The block is NULL-terminated and keeps insertion order */
+TEST(test_env_block) {
+    session_env_t env = {0};
+    char name[16];
+
+    char *const *block = session_env_block(&env);
+    ASSERT(block != NULL && block[0] == NULL);
+
+    /* Enough variables to grow the array more than once */
+    for (int i = 0; i < 100; i++) {
+        snprintf(name, sizeof(name), "VAR%d", i);
+        ASSERT_EQ(session_env_set(&env, name, "x"), KIA_SUCCESS);
+    }
+    block = session_env_block(&env);
+    ASSERT_STR_EQ(block[0], "VAR0=x");
+    ASSERT_STR_EQ(block[99], "VAR99=x");
+    ASSERT(block[100] == NULL);
+
+    session_env_free(&env);
+}
+
+/* Test: Invalid parameters */
+TEST(test_env_invalid_params) {
+    session_env_t env = {0};
+
+    ASSERT_EQ(session_env_set(NULL, "A", "b"), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_env_set(&env, NULL, "b"), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_env_set(&env, "A", NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_env_set(&env, "", "b"), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_env_set(&env, "A=B", "c"), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_env_put(NULL, "A=b"), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_env_put(&env, NULL), KIA_ERROR_SESSION);
+    ASSERT(session_env_get(NULL, "A") == NULL);
+    ASSERT(session_env_get(&env, NULL) == NULL);
+    ASSERT(session_env_block(NULL) != NULL);
+    ASSERT_EQ(env.count, 0);
+    session_env_free(NULL);
+}
+
+/* Main test runner */
+int main(void) {
+    printf("Running session environment tests...\n\n");
+
+    test_env_set_get_wrapper();
+    test_env_put_wrapper();
+    test_env_block_wrapper();
+    test_env_invalid_params_wrapper();
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
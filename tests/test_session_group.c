@@ -0,0 +1,238 @@
+#define _GNU_SOURCE
+#include "session_group.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/wait.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+
+/* Helper function to start a session leader that leaves children behind */
+static pid_t start_group(bool ignore_term, bool stop_one) {
+    int fds[2];
+    char byte;
+
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    pid_t leader = fork();
+    if (leader == 0) {
+        setpgid(0, 0);
+        close(fds[0]);
+        for (int i = 0; i < 2; i++) {
+            if (fork() == 0) {
+                if (ignore_term) {
+                    signal(SIGTERM, SIG_IGN);
+                }
+                if (write(fds[1], "1", 1) != 1) {
+                    _exit(1);
+                }
+                close(fds[1]);
+                if (stop_one && i == 1) {
+                    raise(SIGSTOP);
+                }
+                for (;;) {
+                    pause();
+                }
+            }
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+
+    /* Both children are set up once they wrote */
+    int ready = 0;
+    while (ready < 2 && read(fds[0], &byte, 1) == 1) {
+        ready++;
+    }
+    close(fds[0]);
+    waitpid(leader, NULL, 0);
+    return ready == 2 ? leader : -1;
+}
+
+/* Helper function for milliseconds elapsed since a start time */
+static long elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+/* Test: Processes left by a session are terminated and reaped */
+TEST(test_group_lingering) {
+    struct timespec start;
+
+    pid_t leader = start_group(false, true);
+    ASSERT(leader > 0);
+    ASSERT(session_group_alive(leader));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ASSERT_EQ(session_group_stop(leader, 2000), KIA_SUCCESS);
+    ASSERT(elapsed_ms(&start) < 1000);
+    ASSERT(!session_group_alive(leader));
+
+    /* As the subreaper, the orphans were reaped here */
+    ASSERT_EQ(waitpid(-1, NULL, WNOHANG), -1);
+    ASSERT_EQ(errno, ECHILD);
+}
+
+/* Test: Processes ignoring SIGTERM are killed at the deadline */
+TEST(test_group_escalation) {
+    struct timespec start;
+
+    pid_t leader = start_group(true, false);
+    ASSERT(leader > 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ASSERT_EQ(session_group_stop(leader, 200), KIA_SUCCESS);
+    long took = elapsed_ms(&start);
+    ASSERT(took >= 200 && took < 200 + SESSION_GROUP_KILL_WAIT_MS);
+    ASSERT(!session_group_alive(leader));
+    ASSERT_EQ(waitpid(-1, NULL, WNOHANG), -1);
+}
+
+/* Test: A session that left nothing behind is not waited for */
+TEST(test_group_empty) {
+    struct timespec start;
+
+    pid_t leader = fork();
+    if (leader == 0) {
+        setpgid(0, 0);
+        _exit(0);
+    }
+    ASSERT(leader > 0);
+    waitpid(leader, NULL, 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ASSERT(!session_group_alive(leader));
+    ASSERT_EQ(session_group_signal(leader, SIGTERM), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_group_stop(leader, 2000), KIA_SUCCESS);
+    ASSERT(elapsed_ms(&start) < 100);
+    ASSERT_EQ(session_group_reap(leader), 0);
+}
+
+/* Test: Processes that left the session's group are found as children */
+TEST(test_group_setsid) {
+    int fds[2];
+    pid_t stray = 0;
+
+    /* A child kept out of sessions, as the PAM helper and X server are */
+    pid_t kept = fork();
+    if (kept == 0) {
+        for (;;) {
+            pause();
+        }
+    }
+    ASSERT(kept > 0);
+    ASSERT_EQ(session_group_track(kept), KIA_SUCCESS);
+
+    /* The session starts a daemon in a session of its own, then exits */
+    ASSERT_EQ(pipe(fds), 0);
+    pid_t leader = fork();
+    if (leader == 0) {
+        setpgid(0, 0);
+        close(fds[0]);
+        pid_t daemon = fork();
+        if (daemon == 0) {
+            setsid();
+            pid_t self = getpid();
+            if (write(fds[1], &self, sizeof(self)) != sizeof(self)) {
+                _exit(1);
+            }
+            for (;;) {
+                pause();
+            }
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    ASSERT(read(fds[0], &stray, sizeof(stray)) == sizeof(stray));
+    close(fds[0]);
+    waitpid(leader, NULL, 0);
+    ASSERT(stray > 0);
+    ASSERT(getpgid(stray) != leader);
+
+    /* Nothing is left in the group, yet the daemon keeps the session alive */
+    ASSERT(kill(-leader, 0) != 0);
+    ASSERT(session_group_alive(leader));
+    ASSERT_EQ(session_group_stop(leader, 2000), KIA_SUCCESS);
+    ASSERT(!session_group_alive(leader));
+    ASSERT(kill(stray, 0) != 0);
+
+    /* The tracked child was neither signalled nor reaped */
+    ASSERT_EQ(waitpid(kept, NULL, WNOHANG), 0);
+    session_group_untrack(kept);
+    kill(kept, SIGKILL);
+    ASSERT_EQ(waitpid(kept, NULL, 0), kept);
+    ASSERT_EQ(waitpid(-1, NULL, WNOHANG), -1);
+}
+
+/* Test: Invalid parameters never reach beyond a session */
+TEST(test_group_invalid_params) {
+    ASSERT_EQ(session_group_signal(-1, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_group_signal(0, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_group_signal(1, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_group_stop(0, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_group_stop(1, 0), KIA_ERROR_SESSION);
+    ASSERT(!session_group_alive(0));
+    ASSERT_EQ(session_group_reap(-1), 0);
+    ASSERT_EQ(session_group_track(0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_group_track(1), KIA_ERROR_SESSION);
+    session_group_untrack(0);
+}
+
+/* Main test runner */
+int main(void) {
+    logger_init("/tmp/kia_session_group_test.log", true);
+
+    printf("Running session process group tests...\n\n");
+
+    if (session_group_subreaper() != KIA_SUCCESS) {
+        printf("Failed to become subreaper\n");
+        return 1;
+    }
+
+    test_group_lingering_wrapper();
+    test_group_escalation_wrapper();
+    test_group_empty_wrapper();
+    test_group_setsid_wrapper();
+    test_group_invalid_params_wrapper();
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    logger_close();
+
+    return tests_failed > 0 ? 1 : 0;
+}
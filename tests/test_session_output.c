@@ -0,0 +1,255 @@
+#define _GNU_SOURCE
+#include "session_output.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+
+/* Output files of the tests */
+static char temp_dir[] = "/tmp/kia_output_test_XXXXXX";
+static char output_path[600];
+
+/* Helper function to read a whole file */
+static size_t read_file(const char *path, char *buf, size_t len) {
+    size_t total = 0;
+    FILE *fp = fopen(path, "r");
+    if (fp) {
+        total = fread(buf, 1, len - 1, fp);
+        fclose(fp);
+    }
+    buf[total] = '\0';
+    return total;
+}
+
+/* Helper function to write from a child and drain until it is done */
+static void drain_child(session_output_t *output, size_t line_count, bool force_flush) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        char line[64];
+        for (size_t i = 0; i < line_count; i++) {
+            int len = snprintf(line, sizeof(line), "line %08zu of the session output\n", i);
+            if (write(output->session_fd, line, (size_t)len) != len) {
+                _exit(1);
+            }
+        }
+        _exit(0);
+    }
+    session_output_close_session(output);
+    struct pollfd pfd = { .fd = output->fd, .events = POLLIN };
+    while (poll(&pfd, 1, 5000) > 0 && session_output_drain(output) == 0) {
+        if (force_flush) {
+            session_output_flush(output, true);
+        }
+        pfd.fd = output->fd;
+    }
+    waitpid(pid, NULL, 0);
+}
+
+/* Test: Output reaches the file, and the previous file is kept */
+TEST(test_output_file) {
+    session_output_t output;
+    char buf[256];
+
+    ASSERT_EQ(session_output_open(&output, output_path), KIA_SUCCESS);
+    ASSERT(output.fd >= 0 && output.session_fd >= 0 && output.file_fd >= 0);
+    ASSERT_EQ(write(output.session_fd, "first session\n", 14), 14);
+    session_output_close(&output);
+    ASSERT_EQ(output.fd, -1);
+    read_file(output_path, buf, sizeof(buf));
+    ASSERT_EQ(strcmp(buf, "first session\n"), 0);
+
+    ASSERT_EQ(session_output_open(&output, output_path), KIA_SUCCESS);
+    ASSERT_EQ(write(output.session_fd, "second\n", 7), 7);
+    session_output_close_session(&output);
+    ASSERT_EQ(session_output_drain(&output), -1);
+    session_output_close(&output);
+    read_file(output_path, buf, sizeof(buf));
+    ASSERT_EQ(strcmp(buf, "second\n"), 0);
+
+    char old_path[700];
+    snprintf(old_path, sizeof(old_path), "%s.old", output_path);
+    read_file(old_path, buf, sizeof(buf));
+    ASSERT_EQ(strcmp(buf, "first session\n"), 0);
+}
+
+/* Test: Writes to the file are rate limited */
+TEST(test_output_rate_limit) {
+    session_output_t output;
+    struct stat st;
+
+    ASSERT_EQ(session_output_open(&output, output_path), KIA_SUCCESS);
+    ASSERT_EQ(session_output_flush_timeout(&output), -1);
+    ASSERT_EQ(write(output.session_fd, "early\n", 6), 6);
+    ASSERT_EQ(session_output_drain(&output), 0);
+
+    /* Held back until the interval has passed */
+    ASSERT_EQ(stat(output_path, &st), 0);
+    ASSERT_EQ(st.st_size, 0);
+    int timeout = session_output_flush_timeout(&output);
+    ASSERT(timeout > 0 && timeout <= SESSION_OUTPUT_FLUSH_INTERVAL_MS);
+
+    struct timespec pause = { timeout / 1000, (long)(timeout % 1000) * 1000000 };
+    nanosleep(&pause, NULL);
+    ASSERT_EQ(session_output_flush_timeout(&output), 0);
+    session_output_flush(&output, false);
+    ASSERT_EQ(stat(output_path, &st), 0);
+    ASSERT_EQ(st.st_size, 6);
+    ASSERT_EQ(session_output_flush_timeout(&output), -1);
+
+    session_output_close(&output);
+}
+
+/* Test: Output beyond the buffer between writes is dropped, and noted */
+TEST(test_output_ring_overflow) {
+    session_output_t output;
+    static char buf[SESSION_OUTPUT_RING_SIZE * 2];
+    char tail[128];
+
+    ASSERT_EQ(session_output_open(&output, output_path), KIA_SUCCESS);
+    drain_child(&output, 8192, false);
+    ASSERT_EQ(output.total, 8192 * 36);
+    ASSERT(output.dropped > 0);
+    ASSERT(output.total - output.dropped <= SESSION_OUTPUT_RING_SIZE + output.file_size);
+
+    /* The end of the output is there for diagnosis */
+    session_output_tail(&output, tail, sizeof(tail));
+    ASSERT(strstr(tail, "line 00008191 of the session output\n") != NULL);
+    ASSERT(strncmp(tail, "line ", 5) == 0);
+
+    session_output_close(&output);
+    size_t size = read_file(output_path, buf, sizeof(buf));
+    ASSERT(size <= SESSION_OUTPUT_RING_SIZE + 64);
+    ASSERT(strstr(buf, "bytes of output dropped]\n") != NULL);
+    ASSERT(strstr(buf, "line 00008191 of the session output\n") != NULL);
+}
+
+/* Test: A file growing past the limit is rotated */
+TEST(test_output_file_limit) {
+    session_output_t output;
+    struct stat st;
+    char old_path[700];
+
+    ASSERT_EQ(session_output_open(&output, output_path), KIA_SUCCESS);
+    drain_child(&output, SESSION_OUTPUT_MAX_FILE_SIZE / 36 + 1000, true);
+    session_output_close(&output);
+    ASSERT_EQ(output.dropped, 0);
+
+    snprintf(old_path, sizeof(old_path), "%s.old", output_path);
+    ASSERT_EQ(stat(old_path, &st), 0);
+    ASSERT(st.st_size <= SESSION_OUTPUT_MAX_FILE_SIZE);
+    ASSERT(st.st_size > SESSION_OUTPUT_MAX_FILE_SIZE / 2);
+    ASSERT_EQ(stat(output_path, &st), 0);
+    ASSERT(st.st_size > 0 && st.st_size <= SESSION_OUTPUT_MAX_FILE_SIZE);
+}
+
+/* Test: Without a file the last output is still kept */
+TEST(test_output_memory_only) {
+    session_output_t output;
+    char tail[12];
+
+    ASSERT_EQ(session_output_open(&output, NULL), KIA_SUCCESS);
+    ASSERT_EQ(output.file_fd, -1);
+    ASSERT_EQ(write(output.session_fd, "first\nsecond\nthird\n", 19), 19);
+    ASSERT_EQ(session_output_drain(&output), 0);
+    ASSERT_EQ(session_output_flush_timeout(&output), -1);
+
+    /* Cut to the last whole lines that fit */
+    ASSERT_EQ(session_output_tail(&output, tail, sizeof(tail)), 6);
+    ASSERT_EQ(strcmp(tail, "third\n"), 0);
+    session_output_log_tail(&output, 64);
+
+    session_output_close(&output);
+    ASSERT_EQ(session_output_tail(&output, tail, sizeof(tail)), 0);
+}
+
+/* Test: Invalid parameters */
+TEST(test_output_invalid_params) {
+    session_output_t output;
+    char tail[8];
+
+    session_output_init(&output);
+    ASSERT_EQ(session_output_open(NULL, NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_output_drain(&output), -1);
+    ASSERT_EQ(session_output_drain(NULL), -1);
+    ASSERT_EQ(session_output_flush_timeout(NULL), -1);
+    ASSERT_EQ(session_output_tail(&output, NULL, 8), 0);
+    ASSERT_EQ(session_output_tail(NULL, tail, sizeof(tail)), 0);
+    session_output_flush(NULL, true);
+    session_output_log_tail(NULL, 64);
+    session_output_close_session(NULL);
+    session_output_close(&output);
+    session_output_close(NULL);
+    session_output_init(NULL);
+
+    /* An unusable file leaves the output in memory */
+    ASSERT_EQ(session_output_open(&output, "/nonexistent/dir/kia.log"), KIA_SUCCESS);
+    ASSERT_EQ(output.file_fd, -1);
+    ASSERT(output.session_fd >= 0);
+    session_output_close(&output);
+}
+
+/* Main test runner */
+int main(void) {
+    logger_init("/tmp/kia_session_output_test.log", true);
+
+    printf("Running session output tests...\n\n");
+
+    if (mkdtemp(temp_dir) == NULL) {
+        printf("Failed to create temporary directory\n");
+        return 1;
+    }
+    snprintf(output_path, sizeof(output_path), "%s/log/user.log", temp_dir);
+
+    test_output_file_wrapper();
+    test_output_rate_limit_wrapper();
+    test_output_ring_overflow_wrapper();
+    test_output_file_limit_wrapper();
+    test_output_memory_only_wrapper();
+    test_output_invalid_params_wrapper();
+
+    char command[600];
+    snprintf(command, sizeof(command), "rm -rf %s", temp_dir);
+    if (system(command) != 0) {
+        printf("Warning: failed to remove %s\n", temp_dir);
+    }
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    logger_close();
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,209 @@
+#include "session_path.h"
+#include "logger.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_STR_EQ(a, b) ASSERT(strcmp((a), (b)) == 0)
+
+/* Shared fixture paths */
+static char temp_dir[] = "/tmp/kia_path_test_XXXXXX";
+static char first_dir[512];
+static char second_dir[512];
+static char search_path[1200];
+
+/* Helper function to create a file with the given mode */
+static int create_file(const char *dir, const char *name, mode_t mode) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (fd < 0) {
+        return -1;
+    }
+    close(fd);
+    return chmod(path, mode);
+}
+
+/* Test: Commands resolve in PATH order and only when executable */
+TEST(test_path_find) {
+    session_path_t cache;
+    char resolved[600], expected[600];
+
+    ASSERT_EQ(create_file(first_dir, "wm", 0755), 0);
+    ASSERT_EQ(create_file(second_dir, "wm", 0755), 0);
+    ASSERT_EQ(create_file(second_dir, "compositor", 0755), 0);
+    ASSERT_EQ(create_file(first_dir, "notes", 0644), 0);
+    snprintf(expected, sizeof(expected), "%s/subdir", first_dir);
+    ASSERT_EQ(mkdir(expected, 0755), 0);
+
+    ASSERT_EQ(session_path_init(&cache, search_path), KIA_SUCCESS);
+    ASSERT_EQ(cache.dir_count, 3);
+
+    snprintf(expected, sizeof(expected), "%s/wm", first_dir);
+    ASSERT_EQ(session_path_find(&cache, "wm", resolved, sizeof(resolved)), KIA_SUCCESS);
+    ASSERT_STR_EQ(resolved, expected);
+
+    snprintf(expected, sizeof(expected), "%s/compositor", second_dir);
+    ASSERT_EQ(session_path_find(&cache, "compositor", resolved, sizeof(resolved)), KIA_SUCCESS);
+    ASSERT_STR_EQ(resolved, expected);
+
+    /* Not executable, a directory, or not there at all */
+    ASSERT_EQ(session_path_find(&cache, "notes", NULL, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_path_find(&cache, "subdir", NULL, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_path_find(&cache, "missing-wm", NULL, 0), KIA_ERROR_SESSION);
+
+    /* Paths are checked as they are */
+    ASSERT_EQ(session_path_find(&cache, expected, resolved, sizeof(resolved)), KIA_SUCCESS);
+    ASSERT_STR_EQ(resolved, expected);
+    ASSERT_EQ(session_path_find(&cache, "/nonexistent/wm", NULL, 0), KIA_ERROR_SESSION);
+
+    /* Result does not fit */
+    ASSERT_EQ(session_path_find(&cache, "wm", resolved, 4), KIA_ERROR_SESSION);
+
+    session_path_free(&cache);
+}
+
+/* Test: Lookups are memoised until a PATH directory changes */
+TEST(test_path_memoised) {
+    session_path_t cache;
+    char path[600];
+
+    age_dir(first_dir);
+    age_dir(second_dir);
+    ASSERT_EQ(session_path_init(&cache, search_path), KIA_SUCCESS);
+
+    ASSERT_EQ(session_path_find(&cache, "compositor", NULL, 0), KIA_SUCCESS);
+    unsigned long probes = cache.probes;
+    ASSERT_EQ(probes, 2);
+    ASSERT_EQ(session_path_find(&cache, "missing-wm", NULL, 0), KIA_ERROR_SESSION);
+    probes = cache.probes;
+
+    /* Same answers without touching the file system */
+    ASSERT_EQ(session_path_refresh(&cache), 0);
+    ASSERT_EQ(session_path_find(&cache, "compositor", NULL, 0), KIA_SUCCESS);
+    ASSERT_EQ(session_path_find(&cache, "missing-wm", NULL, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(cache.probes, probes);
+    ASSERT(cache.hits >= 4);
+
+    /* Installing a command changes its directory */
+    ASSERT_EQ(create_file(second_dir, "missing-wm", 0755), 0);
+    ASSERT_EQ(session_path_refresh(&cache), 1);
+    ASSERT_EQ(session_path_find(&cache, "missing-wm", NULL, 0), KIA_SUCCESS);
+
+    /* Only the changed directory is probed again */
+    probes = cache.probes;
+    ASSERT_EQ(session_path_find(&cache, "compositor", NULL, 0), KIA_SUCCESS);
+    ASSERT_EQ(cache.probes, probes + 1);
+
+    /* Removing it is noticed the same way */
+    snprintf(path, sizeof(path), "%s/missing-wm", second_dir);
+    ASSERT_EQ(unlink(path), 0);
+    ASSERT_EQ(session_path_refresh(&cache), 1);
+    ASSERT_EQ(session_path_find(&cache, "missing-wm", NULL, 0), KIA_ERROR_SESSION);
+
+    session_path_free(&cache);
+}
+
+/* Test: Search path parsing */
+TEST(test_path_init) {
+    session_path_t cache;
+    session_dir_t dirs[SESSION_PATH_MAX_DIRS];
+
+    ASSERT_EQ(session_path_init(&cache, "/usr/bin:relative::/usr/bin/:/bin"), KIA_SUCCESS);
+    ASSERT_EQ(session_path_dirs(&cache, dirs), 2);
+    ASSERT_STR_EQ(dirs[0].path, "/usr/bin");
+    ASSERT_STR_EQ(dirs[1].path, "/bin");
+    session_path_free(&cache);
+
+    ASSERT_EQ(session_path_init(&cache, NULL), KIA_SUCCESS);
+    ASSERT_EQ(cache.dir_count, 3);
+    ASSERT_STR_EQ(cache.dirs[0].path, "/usr/local/bin");
+    ASSERT_EQ(session_path_find(&cache, "sh", NULL, 0), KIA_SUCCESS);
+    session_path_free(&cache);
+}
+
+/* Test: Invalid parameters */
+TEST(test_path_invalid_params) {
+    session_path_t cache;
+    char resolved[16];
+
+    ASSERT_EQ(session_path_init(NULL, NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_path_init(&cache, search_path), KIA_SUCCESS);
+    ASSERT_EQ(session_path_find(NULL, "wm", NULL, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_path_find(&cache, NULL, NULL, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_path_find(&cache, "", NULL, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_path_find(&cache, "wm", resolved, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_path_refresh(NULL), 0);
+    ASSERT_EQ(session_path_dirs(NULL, NULL), 0);
+    session_path_free(&cache);
+    session_path_free(NULL);
+}
+
+/* Main test runner */
+int main(void) {
+    logger_init("/tmp/kia_session_path_test.log", true);
+
+    printf("Running session command resolution tests...\n\n");
+
+    if (mkdtemp(temp_dir) == NULL) {
+        printf("Failed to create temporary directory\n");
+        return 1;
+    }
+    snprintf(first_dir, sizeof(first_dir), "%s/bin", temp_dir);
+    snprintf(second_dir, sizeof(second_dir), "%s/sbin", temp_dir);
+    mkdir(first_dir, 0755);
+    mkdir(second_dir, 0755);
+    snprintf(search_path, sizeof(search_path), "%s:%s/missing:%s", first_dir, temp_dir, second_dir);
+
+    test_path_find_wrapper();
+    test_path_memoised_wrapper();
+    test_path_init_wrapper();
+    test_path_invalid_params_wrapper();
+
+    char command[600];
+    snprintf(command, sizeof(command), "rm -rf %s", temp_dir);
+    if (system(command) != 0) {
+        printf("Warning: failed to remove %s\n", temp_dir);
+    }
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    logger_close();
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,162 @@
+#define _GNU_SOURCE
+#include "session_ready.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+
+/* Helper function to read the first line of a file */
+static int read_line(const char *path, char *line, size_t len) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+    char *result = fgets(line, (int)len, fp);
+    fclose(fp);
+    return result ? 0 : -1;
+}
+
+/* Test: A byte on the pipe is the readiness signal */
+TEST(test_ready_signal) {
+    session_ready_t ready;
+
+    ASSERT_EQ(session_ready_open(&ready), KIA_SUCCESS);
+    ASSERT(ready.fd >= 0 && ready.session_fd >= 0);
+
+    /* Only the write end is inherited across exec */
+    ASSERT(fcntl(ready.fd, F_GETFD) & FD_CLOEXEC);
+    ASSERT_EQ(fcntl(ready.session_fd, F_GETFD) & FD_CLOEXEC, 0);
+
+    ASSERT_EQ(session_ready_check(&ready), 0);
+    ASSERT_EQ(write(ready.session_fd, "READY=1\n", 8), 8);
+    ASSERT_EQ(session_ready_check(&ready), 1);
+    ASSERT_EQ(ready.fd, -1);
+
+    session_ready_close(&ready);
+    ASSERT_EQ(ready.session_fd, -1);
+}
+
+/* Test: Closing the pipe without writing reports no readiness */
+TEST(test_ready_closed) {
+    session_ready_t ready;
+
+    ASSERT_EQ(session_ready_open(&ready), KIA_SUCCESS);
+    session_ready_close_session(&ready);
+    ASSERT_EQ(ready.session_fd, -1);
+    ASSERT_EQ(session_ready_check(&ready), -1);
+    ASSERT_EQ(session_ready_check(&ready), -1);
+    session_ready_close(&ready);
+}
+
+/* Test: Latency records hold each phase, null for phases that did not happen */
+TEST(test_latency_report) {
+    session_latency_t latency;
+    char path[] = "/tmp/kia_ready_stats_XXXXXX";
+    char line[1024];
+
+    int fd = mkstemp(path);
+    ASSERT(fd >= 0);
+    close(fd);
+
+    /* Autologin: no authentication, and the session never signalled */
+    memset(&latency, 0, sizeof(latency));
+    latency.submitted = (struct timespec){ 100, 0 };
+    latency.launch_start = (struct timespec){ 100, 500000000 };
+    latency.spawn_start = (struct timespec){ 101, 0 };
+    latency.exec_done = (struct timespec){ 101, 2000000 };
+    ASSERT_EQ(session_latency_report(&latency, "al\"ice", "Sway\\1", path), KIA_SUCCESS);
+    ASSERT_EQ(read_line(path, line, sizeof(line)), 0);
+    ASSERT(strstr(line, "\"user\":\"al\\\"ice\",\"session\":\"Sway\\\\1\"") != NULL);
+    ASSERT(strstr(line, "\"select_ms\":null,\"auth_ms\":null") != NULL);
+    ASSERT(strstr(line, "\"spawn_ms\":500.000,\"exec_ms\":2.000") != NULL);
+    ASSERT(strstr(line, "\"ready_ms\":null,\"total_ms\":null}") != NULL);
+
+    /* A full login is appended as another line */
+    latency.auth_start = (struct timespec){ 100, 100000000 };
+    latency.auth_done = (struct timespec){ 100, 400000000 };
+    latency.ready = (struct timespec){ 102, 2000000 };
+    ASSERT_EQ(session_latency_report(&latency, "bob", "X", path), KIA_SUCCESS);
+    FILE *fp = fopen(path, "r");
+    ASSERT(fp != NULL);
+    ASSERT(fgets(line, sizeof(line), fp) != NULL);
+    ASSERT(fgets(line, sizeof(line), fp) != NULL);
+    fclose(fp);
+    ASSERT(strstr(line, "\"select_ms\":100.000,\"auth_ms\":300.000") != NULL);
+    ASSERT(strstr(line, "\"ready_ms\":1000.000,\"total_ms\":2002.000}") != NULL);
+
+    unlink(path);
+
+    /* Without a stats file the report is only logged */
+    ASSERT_EQ(session_latency_report(&latency, "bob", "X", NULL), KIA_SUCCESS);
+}
+
+/* Test: Invalid parameters */
+TEST(test_ready_invalid_params) {
+    session_latency_t latency = {0};
+    session_ready_t ready;
+
+    session_ready_init(&ready);
+    ASSERT_EQ(session_ready_open(NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_ready_check(&ready), -1);
+    ASSERT_EQ(session_ready_check(NULL), -1);
+    ASSERT_EQ(session_latency_report(NULL, "bob", "X", NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_latency_report(&latency, NULL, "X", NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_latency_report(&latency, "bob", NULL, NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_latency_report(&latency, "bob", "X", "/nonexistent/dir/stats"),
+              KIA_ERROR_SESSION);
+
+    session_ready_close(&ready);
+    session_ready_close(NULL);
+    session_ready_close_session(NULL);
+    session_ready_init(NULL);
+}
+
+/* Main test runner */
+int main(void) {
+    logger_init("/tmp/kia_session_ready_test.log", true);
+
+    printf("Running session readiness tests...\n\n");
+
+    test_ready_signal_wrapper();
+    test_ready_closed_wrapper();
+    test_latency_report_wrapper();
+    test_ready_invalid_params_wrapper();
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    logger_close();
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,282 @@
+#define _GNU_SOURCE
+#include "session_spawn.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+
+/* Helper function to spawn and reap, returning the exit status or -1 */
+static int spawn_and_wait(const session_spawn_t *spawn) {
+    pid_t pid;
+    int status;
+
+    if (session_spawn(spawn, &pid) != KIA_SUCCESS) {
+        return -1;
+    }
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+/* Test: A program runs and its exit status is seen by the caller */
+TEST(test_spawn_exit_status) {
+    const char *true_argv[] = { "true", NULL };
+    const char *exit_argv[] = { "sh", "-c", "exit 3", NULL };
+    session_spawn_t spawn = { .exec_count = 1, .envp = environ };
+
+    spawn.execs[0] = (session_spawn_exec_t){ "/bin/true", true_argv };
+    ASSERT_EQ(spawn_and_wait(&spawn), 0);
+
+    spawn.execs[0] = (session_spawn_exec_t){ "/bin/sh", exit_argv };
+    ASSERT_EQ(spawn_and_wait(&spawn), 3);
+
+    /* Without a path argv[0] is looked up in PATH */
+    spawn.execs[0] = (session_spawn_exec_t){ NULL, true_argv };
+    ASSERT_EQ(spawn_and_wait(&spawn), 0);
+}
+
+/* Test: The given environment and directory replace the caller's */
+TEST(test_spawn_env_and_dir) {
+    char *envp[] = { "KIA_SPAWN_TEST=yes", "PATH=/usr/bin:/bin", NULL };
+    const char *argv[] = { "sh", "-c",
+                           "test \"$KIA_SPAWN_TEST\" = yes && test -z \"$HOME\" && "
+                           "test \"$(pwd)\" = /", NULL };
+    session_spawn_t spawn = { .exec_count = 1, .envp = envp, .dir = "/" };
+
+    spawn.execs[0] = (session_spawn_exec_t){ "/bin/sh", argv };
+    ASSERT_EQ(spawn_and_wait(&spawn), 0);
+}
+
+/* Test: Without a path argv[0] is found on the PATH in envp, not the caller's */
+TEST(test_spawn_envp_path) {
+    char dir[] = "/tmp/kia_spawn_path_XXXXXX";
+    char script[64];
+    char path_var[64];
+    ASSERT(mkdtemp(dir) != NULL);
+    snprintf(script, sizeof(script), "%s/kia-only-here", dir);
+    snprintf(path_var, sizeof(path_var), "PATH=/nonexistent::%s", dir);
+
+    FILE *fp = fopen(script, "w");
+    ASSERT(fp != NULL);
+    fputs("#!/bin/sh\nexit 7\n", fp);
+    fclose(fp);
+    ASSERT_EQ(chmod(script, 0755), 0);
+
+    const char *argv[] = { "kia-only-here", NULL };
+    char *envp[] = { path_var, NULL };
+    session_spawn_t spawn = { .exec_count = 1, .envp = envp };
+    spawn.execs[0] = (session_spawn_exec_t){ NULL, argv };
+    int status = spawn_and_wait(&spawn);
+
+    unlink(script);
+    rmdir(dir);
+    ASSERT_EQ(status, 7);
+}
+
+/* Test: Output can go to a descriptor instead of the caller's stdout and stderr */
+TEST(test_spawn_redirect_output) {
+    const char *argv[] = { "sh", "-c", "echo out; echo err >&2", NULL };
+    session_spawn_t spawn = { .exec_count = 1, .envp = environ };
+    char buf[64] = "";
+    int fds[2];
+
+    ASSERT_EQ(pipe(fds), 0);
+    spawn.execs[0] = (session_spawn_exec_t){ "/bin/sh", argv };
+    spawn.redirect_output = true;
+    spawn.output_fd = fds[1];
+    ASSERT_EQ(spawn_and_wait(&spawn), 0);
+    close(fds[1]);
+
+    ssize_t total = 0, n;
+    while ((n = read(fds[0], buf + total, sizeof(buf) - 1 - (size_t)total)) > 0) {
+        total += n;
+    }
+    close(fds[0]);
+    ASSERT_EQ(strcmp(buf, "out\nerr\n"), 0);
+}
+
+/* Test: A program can lead a process group of its own */
+TEST(test_spawn_new_group) {
+    const char *argv[] = { "sleep", "0.1", NULL };
+    session_spawn_t spawn = { .exec_count = 1, .envp = environ, .new_group = true };
+    pid_t pid;
+    int status;
+
+    spawn.execs[0] = (session_spawn_exec_t){ NULL, argv };
+    ASSERT_EQ(session_spawn(&spawn, &pid), KIA_SUCCESS);
+    ASSERT_EQ(getpgid(pid), pid);
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT(WIFEXITED(status));
+
+    /* Without it the caller's group is kept */
+    spawn.new_group = false;
+    ASSERT_EQ(session_spawn(&spawn, &pid), KIA_SUCCESS);
+    ASSERT_EQ(getpgid(pid), getpgrp());
+    waitpid(pid, NULL, 0);
+}
+
+/* Test: Exec attempts are tried in order until one works */
+TEST(test_spawn_fallback) {
+    const char *missing_argv[] = { "missing", NULL };
+    const char *true_argv[] = { "true", NULL };
+    session_spawn_t spawn = { .exec_count = 3, .envp = environ };
+
+    spawn.execs[0] = (session_spawn_exec_t){ "/nonexistent/kia-missing", missing_argv };
+    spawn.execs[1] = (session_spawn_exec_t){ NULL, missing_argv };
+    spawn.execs[2] = (session_spawn_exec_t){ "/bin/true", true_argv };
+    ASSERT_EQ(spawn_and_wait(&spawn), 0);
+}
+
+/* Test: Failures are reported to the caller and leave no child behind */
+TEST(test_spawn_failure) {
+    const char *missing_argv[] = { "missing", NULL };
+    const char *true_argv[] = { "true", NULL };
+    session_spawn_t spawn = { .exec_count = 1, .envp = environ };
+    pid_t pid = 0;
+
+    spawn.execs[0] = (session_spawn_exec_t){ "/nonexistent/kia-missing", missing_argv };
+    ASSERT_EQ(session_spawn(&spawn, &pid), KIA_ERROR_SESSION);
+    ASSERT_EQ(pid, 0);
+
+    spawn.execs[0] = (session_spawn_exec_t){ "/bin/true", true_argv };
+    spawn.dir = "/nonexistent/kia-missing";
+    ASSERT_EQ(session_spawn(&spawn, &pid), KIA_ERROR_SESSION);
+    ASSERT_EQ(pid, 0);
+
+    ASSERT_EQ(waitpid(-1, NULL, WNOHANG), -1);
+    ASSERT_EQ(errno, ECHILD);
+}
+
+/* Test: The caller's signal mask is left as it was */
+TEST(test_spawn_signal_mask) {
+    const char *true_argv[] = { "true", NULL };
+    session_spawn_t spawn = { .exec_count = 1, .envp = environ };
+    sigset_t before, after;
+
+    spawn.execs[0] = (session_spawn_exec_t){ "/bin/true", true_argv };
+    sigprocmask(SIG_SETMASK, NULL, &before);
+    ASSERT_EQ(spawn_and_wait(&spawn), 0);
+    sigprocmask(SIG_SETMASK, NULL, &after);
+    ASSERT(!sigismember(&after, SIGTERM));
+    ASSERT_EQ(sigismember(&before, SIGCHLD), sigismember(&after, SIGCHLD));
+}
+
+/* Test: Privileges are dropped to the requested user and groups */
+TEST(test_spawn_set_ids) {
+    if (geteuid() != 0) {
+        printf(" (skipped, needs root)");
+        return;
+    }
+
+    const gid_t groups[] = { 65534 };
+    const char *argv[] = { "sh", "-c",
+                           "test \"$(id -u)\" = 65534 && test \"$(id -g)\" = 65534 && "
+                           "test \"$(id -G)\" = 65534",
+                           NULL };
+    session_spawn_t spawn = {
+        .exec_count = 1,
+        .envp = environ,
+        .set_ids = true,
+        .uid = 65534,
+        .gid = 65534,
+        .groups = groups,
+        .group_count = 1,
+    };
+
+    spawn.execs[0] = (session_spawn_exec_t){ "/bin/sh", argv };
+    ASSERT_EQ(spawn_and_wait(&spawn), 0);
+
+    /* The caller keeps its own credentials */
+    ASSERT_EQ(geteuid(), 0);
+    ASSERT_EQ(getegid(), 0);
+}
+
+/* Test: Invalid parameters */
+TEST(test_spawn_invalid_params) {
+    const char *true_argv[] = { "true", NULL };
+    const char *empty_argv[] = { NULL };
+    session_spawn_t spawn = { .exec_count = 1, .envp = environ };
+    pid_t pid;
+
+    spawn.execs[0] = (session_spawn_exec_t){ "/bin/true", true_argv };
+    ASSERT_EQ(session_spawn(NULL, &pid), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_spawn(&spawn, NULL), KIA_ERROR_SESSION);
+
+    spawn.exec_count = 0;
+    ASSERT_EQ(session_spawn(&spawn, &pid), KIA_ERROR_SESSION);
+    spawn.exec_count = SESSION_SPAWN_MAX_EXECS + 1;
+    ASSERT_EQ(session_spawn(&spawn, &pid), KIA_ERROR_SESSION);
+    spawn.exec_count = 1;
+
+    spawn.execs[0].argv = empty_argv;
+    ASSERT_EQ(session_spawn(&spawn, &pid), KIA_ERROR_SESSION);
+    spawn.execs[0].argv = true_argv;
+
+    spawn.envp = NULL;
+    ASSERT_EQ(session_spawn(&spawn, &pid), KIA_ERROR_SESSION);
+    spawn.envp = environ;
+
+    spawn.group_count = 1;
+    ASSERT_EQ(session_spawn(&spawn, &pid), KIA_ERROR_SESSION);
+}
+
+/* Main test runner */
+int main(void) {
+    logger_init("/tmp/kia_session_spawn_test.log", true);
+
+    printf("Running session spawn tests...\n\n");
+
+    test_spawn_exit_status_wrapper();
+    test_spawn_env_and_dir_wrapper();
+    test_spawn_envp_path_wrapper();
+    test_spawn_redirect_output_wrapper();
+    test_spawn_new_group_wrapper();
+    test_spawn_fallback_wrapper();
+    test_spawn_failure_wrapper();
+    test_spawn_signal_mask_wrapper();
+    test_spawn_set_ids_wrapper();
+    test_spawn_invalid_params_wrapper();
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    logger_close();
+
+    return tests_failed > 0 ? 1 : 0;
+}
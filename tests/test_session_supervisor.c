@@ -0,0 +1,219 @@
+#include "session_supervisor.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_STR_EQ(a, b) ASSERT(strcmp((a), (b)) == 0)
+
+/* Helper function to fork a child that sleeps, then exits with a status */
+static pid_t fork_child(int seconds, int status) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (seconds > 0) {
+            sleep((unsigned)seconds);
+        }
+        _exit(status);
+    }
+    return pid;
+}
+
+/* Test: Exit status and runtime are collected once a child exits */
+TEST(test_supervisor_exit_status) {
+    session_supervisor_t sup;
+    session_child_t exited[SESSION_SUPERVISOR_MAX_CHILDREN];
+
+    ASSERT_EQ(session_supervisor_init(&sup), KIA_SUCCESS);
+    ASSERT(session_supervisor_fd(&sup) >= 0);
+
+    pid_t pid = fork_child(0, 7);
+    ASSERT(pid > 0);
+    ASSERT_EQ(session_supervisor_add(&sup, pid, "Seven"), KIA_SUCCESS);
+    ASSERT_EQ(session_supervisor_count(&sup), 1);
+
+    ASSERT_EQ(session_supervisor_wait(&sup, 5000, NULL), 1);
+    ASSERT_EQ(session_supervisor_process(&sup, exited, SESSION_SUPERVISOR_MAX_CHILDREN), 1);
+    ASSERT_EQ(exited[0].pid, pid);
+    ASSERT_STR_EQ(exited[0].name, "Seven");
+    ASSERT_EQ(exited[0].exit_status, 7);
+    ASSERT_EQ(exited[0].term_signal, 0);
+    ASSERT(exited[0].runtime_ms >= 0);
+    ASSERT_EQ(session_supervisor_count(&sup), 0);
+
+    /* The child has been reaped */
+    ASSERT_EQ(waitpid(pid, NULL, WNOHANG), -1);
+    ASSERT_EQ(errno, ECHILD);
+
+    session_supervisor_free(&sup);
+}
+
+/* Test: Resource usage of a reaped child comes with its exit */
+TEST(test_supervisor_usage) {
+    session_supervisor_t sup;
+    session_child_t exited[SESSION_SUPERVISOR_MAX_CHILDREN];
+
+    ASSERT_EQ(session_supervisor_init(&sup), KIA_SUCCESS);
+
+    /* A child that burns CPU and touches 16 MiB */
+    pid_t pid = fork();
+    if (pid == 0) {
+        size_t size = 16 * 1024 * 1024;
+        volatile char *mem = malloc(size);
+        for (size_t i = 0; mem && i < size; i += 4096) {
+            mem[i] = 1;
+        }
+        struct timespec start, now;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        do {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+        } while ((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000 < 50);
+        _exit(0);
+    }
+    ASSERT(pid > 0);
+    ASSERT_EQ(session_supervisor_add(&sup, pid, "Busy"), KIA_SUCCESS);
+
+    ASSERT_EQ(session_supervisor_wait(&sup, 5000, NULL), 1);
+    ASSERT_EQ(session_supervisor_process(&sup, exited, SESSION_SUPERVISOR_MAX_CHILDREN), 1);
+    ASSERT(exited[0].usage.user_ms + exited[0].usage.system_ms >= 20);
+    ASSERT(exited[0].usage.max_rss_kb >= 16 * 1024);
+    ASSERT(exited[0].usage.minor_faults >= 4096);
+
+    session_supervisor_free(&sup);
+}
+
+/* Test: Running children are not reported and can be signalled */
+TEST(test_supervisor_signal) {
+    session_supervisor_t sup;
+    session_child_t exited[SESSION_SUPERVISOR_MAX_CHILDREN];
+
+    ASSERT_EQ(session_supervisor_init(&sup), KIA_SUCCESS);
+    pid_t first = fork_child(30, 0);
+    pid_t second = fork_child(30, 0);
+    ASSERT(first > 0 && second > 0);
+    ASSERT_EQ(session_supervisor_add(&sup, first, "First"), KIA_SUCCESS);
+    ASSERT_EQ(session_supervisor_add(&sup, second, "Second"), KIA_SUCCESS);
+
+    ASSERT_EQ(session_supervisor_wait(&sup, 0, NULL), 0);
+    ASSERT_EQ(session_supervisor_process(&sup, exited, SESSION_SUPERVISOR_MAX_CHILDREN), 0);
+    ASSERT_EQ(session_supervisor_count(&sup), 2);
+
+    ASSERT_EQ(session_supervisor_signal(&sup, SIGTERM), 2);
+
+    /* Only as many exits as fit are taken per call */
+    int reaped = 0;
+    while (session_supervisor_count(&sup) > 0) {
+        ASSERT_EQ(session_supervisor_wait(&sup, 5000, NULL), 1);
+        int n = session_supervisor_process(&sup, exited, 1);
+        ASSERT(n >= 0 && n <= 1);
+        if (n == 1) {
+            ASSERT_EQ(exited[0].term_signal, SIGTERM);
+            reaped++;
+        }
+    }
+    ASSERT_EQ(reaped, 2);
+
+    session_supervisor_free(&sup);
+}
+
+/* Test: The capacity limit is enforced */
+TEST(test_supervisor_full) {
+    session_supervisor_t sup;
+    session_child_t exited[SESSION_SUPERVISOR_MAX_CHILDREN];
+    pid_t pids[SESSION_SUPERVISOR_MAX_CHILDREN + 1];
+
+    ASSERT_EQ(session_supervisor_init(&sup), KIA_SUCCESS);
+    for (int i = 0; i <= SESSION_SUPERVISOR_MAX_CHILDREN; i++) {
+        pids[i] = fork_child(30, 0);
+        ASSERT(pids[i] > 0);
+    }
+    for (int i = 0; i < SESSION_SUPERVISOR_MAX_CHILDREN; i++) {
+        ASSERT_EQ(session_supervisor_add(&sup, pids[i], "Child"), KIA_SUCCESS);
+    }
+    ASSERT_EQ(session_supervisor_add(&sup, pids[SESSION_SUPERVISOR_MAX_CHILDREN], "Extra"),
+              KIA_ERROR_SESSION);
+
+    kill(pids[SESSION_SUPERVISOR_MAX_CHILDREN], SIGKILL);
+    waitpid(pids[SESSION_SUPERVISOR_MAX_CHILDREN], NULL, 0);
+
+    ASSERT_EQ(session_supervisor_signal(&sup, SIGKILL), SESSION_SUPERVISOR_MAX_CHILDREN);
+    while (session_supervisor_count(&sup) > 0) {
+        ASSERT(session_supervisor_wait(&sup, 5000, NULL) >= 0);
+        ASSERT(session_supervisor_process(&sup, exited, SESSION_SUPERVISOR_MAX_CHILDREN) >= 0);
+    }
+
+    session_supervisor_free(&sup);
+}
+
+/* Test: Invalid parameters */
+TEST(test_supervisor_invalid_params) {
+    session_supervisor_t sup;
+
+    ASSERT_EQ(session_supervisor_init(NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_supervisor_fd(NULL), -1);
+    ASSERT_EQ(session_supervisor_init(&sup), KIA_SUCCESS);
+    ASSERT_EQ(session_supervisor_add(&sup, 0, "None"), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_supervisor_add(&sup, getpid(), NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_supervisor_add(NULL, getpid(), "Self"), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_supervisor_process(&sup, NULL, 1), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_supervisor_process(NULL, NULL, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_supervisor_wait(NULL, 0, NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_supervisor_signal(NULL, SIGTERM), 0);
+    ASSERT_EQ(session_supervisor_count(NULL), 0);
+    session_supervisor_free(&sup);
+    ASSERT_EQ(session_supervisor_fd(&sup), -1);
+    session_supervisor_free(NULL);
+}
+
+/* Main test runner */
+int main(void) {
+    logger_init("/tmp/kia_session_supervisor_test.log", true);
+
+    printf("Running session supervisor tests...\n\n");
+
+    test_supervisor_exit_status_wrapper();
+    test_supervisor_usage_wrapper();
+    test_supervisor_signal_wrapper();
+    test_supervisor_full_wrapper();
+    test_supervisor_invalid_params_wrapper();
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    logger_close();
+
+    return tests_failed > 0 ? 1 : 0;
+}
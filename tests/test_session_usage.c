@@ -0,0 +1,93 @@
+#define _GNU_SOURCE
+#include "session_usage.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+
+/* Test: rusage fields are carried over in milliseconds and KiB */
+TEST(test_usage_from_rusage) {
+    session_usage_t usage;
+    struct rusage ru;
+
+    memset(&ru, 0, sizeof(ru));
+    ru.ru_utime = (struct timeval){ 2, 500000 };
+    ru.ru_stime = (struct timeval){ 0, 1500 };
+    ru.ru_maxrss = 81920;
+    ru.ru_minflt = 1000;
+    ru.ru_majflt = 3;
+    ru.ru_nvcsw = 40;
+    ru.ru_nivcsw = 5;
+
+    session_usage_from_rusage(&usage, &ru);
+    ASSERT(usage.user_ms > 2499.9 && usage.user_ms < 2500.1);
+    ASSERT(usage.system_ms > 1.49 && usage.system_ms < 1.51);
+    ASSERT_EQ(usage.max_rss_kb, 81920);
+    ASSERT_EQ(usage.minor_faults, 1000);
+    ASSERT_EQ(usage.major_faults, 3);
+    ASSERT_EQ(usage.voluntary_switches, 40);
+    ASSERT_EQ(usage.involuntary_switches, 5);
+
+    session_usage_log(&usage, "Sway", 1234);
+}
+
+/* Test: Invalid parameters */
+TEST(test_usage_invalid_params) {
+    session_usage_t usage;
+    struct rusage ru;
+
+    memset(&usage, 0xff, sizeof(usage));
+    memset(&ru, 0, sizeof(ru));
+    session_usage_from_rusage(&usage, NULL);
+    ASSERT_EQ(usage.max_rss_kb, -1);
+    session_usage_from_rusage(NULL, &ru);
+    session_usage_from_rusage(NULL, NULL);
+    session_usage_log(NULL, "Sway", 1);
+}
+
+/* Main test runner */
+int main(void) {
+    logger_init("/tmp/kia_session_usage_test.log", true);
+
+    printf("Running session resource usage tests...\n\n");
+
+    test_usage_from_rusage_wrapper();
+    test_usage_invalid_params_wrapper();
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    logger_close();
+
+    return tests_failed > 0 ? 1 : 0;
+}
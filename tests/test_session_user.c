@@ -0,0 +1,254 @@
+#include "session_user.h"
+#include "logger.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pwd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_STR_EQ(a, b) ASSERT(strcmp((a), (b)) == 0)
+
+/* Shared fixture paths; the scanner only looks under the home directory */
+static char temp_dir[] = "/tmp/kia_user_test_XXXXXX";
+static char system_dir[512];
+static char username[256];
+static char user_dir[512];
+static char created[4][512];   /* Directories made for the test, innermost last */
+static int created_count;
+
+/* Helper function to create a directory and its parents, remembering new ones */
+static int make_dirs(const char *path) {
+    char partial[512];
+
+    for (const char *p = strchr(path + 1, '/'); ; p = strchr(p + 1, '/')) {
+        size_t len = p ? (size_t)(p - path) : strlen(path);
+        snprintf(partial, sizeof(partial), "%.*s", (int)len, path);
+        if (mkdir(partial, 0755) == 0 && created_count < 4) {
+            snprintf(created[created_count++], sizeof(created[0]), "%s", partial);
+        }
+        if (!p) {
+            break;
+        }
+    }
+
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode) ? 0 : -1;
+}
+
+/* Helper function to write a desktop file */
+static int write_desktop_file(const char *dir, const char *filename,
+                              const char *name, const char *exec) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%s", dir, filename);
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        return -1;
+    }
+    fprintf(fp, "[Desktop Entry]\nName=%s\nExec=%s\n", name, exec);
+    fclose(fp);
+    return 0;
+}
+
+/* Helper function to remove a desktop file */
+static void remove_desktop_file(const char *dir, const char *filename) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%s", dir, filename);
+    unlink(path);
+}
+
+/* Helper function to wait for the scanner to report results */
+static int users_ready(const session_user_t *users) {
+    struct pollfd pfd = { .fd = session_user_fd(users), .events = POLLIN };
+    return poll(&pfd, 1, 5000) == 1;
+}
+
+/* Test: A user's sessions are found in the background and merged */
+TEST(test_user_scan_merge) {
+    session_dir_t dirs[] = { { system_dir, SESSION_X11 } };
+    session_list_t list = {0};
+    session_user_t users;
+
+    ASSERT_EQ(write_desktop_file(system_dir, "kia-test-xfce.desktop", "Xfce", "sh"), 0);
+    ASSERT_EQ(write_desktop_file(user_dir, "kia-test-xfce.desktop", "Xfce (mine)", "sh -l"), 0);
+    ASSERT_EQ(write_desktop_file(user_dir, "kia-test-own.desktop", "Own Session", "sh"), 0);
+    age_dir(user_dir);
+
+    ASSERT_EQ(session_discover_in(&list, dirs, 1, NULL), KIA_SUCCESS);
+    int count = list.count;
+    ASSERT_EQ(session_user_init(&users), KIA_SUCCESS);
+    ASSERT_EQ(session_user_fd(&users), -1);
+
+    ASSERT_EQ(session_user_start(&users, username), KIA_SUCCESS);
+    ASSERT(users_ready(&users));
+    ASSERT(session_user_merge(&users, &list, dirs, 1) >= 2);
+    ASSERT_EQ(users.scans, 1);
+
+    int xfce = session_list_find_file(&list, SESSION_X11, "kia-test-xfce.desktop");
+    ASSERT(xfce >= 0);
+    ASSERT_STR_EQ(session_list_name(&list, xfce), "Xfce (mine)");
+    ASSERT(list.records[xfce].dir >= 1);
+    ASSERT(session_list_find_file(&list, SESSION_X11, "kia-test-own.desktop") >= 0);
+
+    /* Merging the same results again changes nothing */
+    ASSERT_EQ(session_user_merge(&users, &list, dirs, 1), 0);
+
+    /* Logging in again after a failed attempt reuses the scan */
+    ASSERT_EQ(session_user_start(&users, username), KIA_SUCCESS);
+    ASSERT(users_ready(&users));
+    ASSERT_EQ(session_user_merge(&users, &list, dirs, 1), 0);
+    ASSERT_EQ(users.scans, 1);
+    ASSERT_EQ(users.hits, 1);
+    ASSERT(session_list_find_file(&list, SESSION_X11, "kia-test-own.desktop") >= 0);
+
+    /* A change to the user's directory is picked up by the next login */
+    remove_desktop_file(user_dir, "kia-test-own.desktop");
+    ASSERT_EQ(session_user_start(&users, username), KIA_SUCCESS);
+    ASSERT(users_ready(&users));
+    ASSERT(session_user_merge(&users, &list, dirs, 1) > 0);
+    ASSERT_EQ(users.scans, 2);
+    ASSERT_EQ(session_list_find_file(&list, SESSION_X11, "kia-test-own.desktop"), -1);
+    xfce = session_list_find_file(&list, SESSION_X11, "kia-test-xfce.desktop");
+    ASSERT(xfce >= 0);
+    ASSERT_STR_EQ(session_list_name(&list, xfce), "Xfce (mine)");
+
+    /* An unknown user drops the previous user's sessions without waiting */
+    ASSERT_EQ(session_user_start(&users, "kia-no-such-user"), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_user_fd(&users), -1);
+    ASSERT(session_user_drop_stale(&users, &list, dirs, 1) > 0);
+    ASSERT_EQ(list.count, count);
+    xfce = session_list_find_file(&list, SESSION_X11, "kia-test-xfce.desktop");
+    ASSERT(xfce >= 0);
+    ASSERT_STR_EQ(session_list_name(&list, xfce), "Xfce");
+    ASSERT_EQ(session_user_drop_stale(&users, &list, dirs, 1), 0);
+
+    session_user_free(&users);
+    session_list_free(&list);
+    remove_desktop_file(system_dir, "kia-test-xfce.desktop");
+    remove_desktop_file(user_dir, "kia-test-xfce.desktop");
+}
+
+/* Test: A FIFO posing as a desktop file neither blocks nor breaks the scan */
+TEST(test_user_scan_fifo) {
+    session_dir_t dirs[] = { { system_dir, SESSION_X11 } };
+    session_list_t list = {0};
+    session_user_t users;
+    char fifo[600];
+
+    snprintf(fifo, sizeof(fifo), "%s/kia-test-fifo.desktop", user_dir);
+    ASSERT_EQ(mkfifo(fifo, 0644), 0);
+    ASSERT_EQ(write_desktop_file(user_dir, "kia-test-own.desktop", "Own Session", "sh"), 0);
+    age_dir(user_dir);
+
+    ASSERT_EQ(session_user_init(&users), KIA_SUCCESS);
+    ASSERT_EQ(session_user_start(&users, username), KIA_SUCCESS);
+    ASSERT(users_ready(&users));
+    ASSERT(session_user_merge(&users, &list, dirs, 1) >= 1);
+    ASSERT_EQ(users.abandoned, 0);
+    ASSERT(session_list_find_file(&list, SESSION_X11, "kia-test-own.desktop") >= 0);
+    ASSERT_EQ(session_list_find_file(&list, SESSION_X11, "kia-test-fifo.desktop"), -1);
+
+    session_user_free(&users);
+    session_list_free(&list);
+    unlink(fifo);
+    remove_desktop_file(user_dir, "kia-test-own.desktop");
+}
+
+/* Test: Invalid parameters */
+TEST(test_user_invalid_params) {
+    session_user_t users;
+    session_list_t list = {0};
+
+    ASSERT_EQ(session_user_init(NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_user_init(&users), KIA_SUCCESS);
+    ASSERT_EQ(session_user_start(NULL, username), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_user_start(&users, NULL), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_user_start(&users, ""), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_user_merge(NULL, &list, NULL, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_user_merge(&users, NULL, NULL, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_user_merge(&users, &list, NULL, 0), 0);
+    ASSERT_EQ(session_user_drop_stale(NULL, &list, NULL, 0), 0);
+    ASSERT_EQ(session_user_fd(NULL), -1);
+    session_user_free(&users);
+    session_user_free(NULL);
+}
+
+/* Main test runner */
+int main(void) {
+    logger_init("/tmp/kia_session_user_test.log", true);
+
+    printf("Running per-user session tests...\n\n");
+
+    struct passwd *pwd = getpwuid(getuid());
+    if (!pwd || !pwd->pw_dir || pwd->pw_dir[0] != '/') {
+        printf("Cannot look up the current user\n");
+        return 1;
+    }
+    snprintf(username, sizeof(username), "%s", pwd->pw_name);
+    snprintf(user_dir, sizeof(user_dir), "%s/" SESSION_USER_DATA_HOME "/xsessions", pwd->pw_dir);
+
+    if (mkdtemp(temp_dir) == NULL || make_dirs(user_dir) != 0) {
+        printf("Failed to create test directories\n");
+        return 1;
+    }
+    snprintf(system_dir, sizeof(system_dir), "%s/xsessions", temp_dir);
+    mkdir(system_dir, 0755);
+
+    test_user_scan_merge_wrapper();
+    test_user_scan_fifo_wrapper();
+    test_user_invalid_params_wrapper();
+
+    /* Leave the home directory as it was found */
+    remove_desktop_file(user_dir, "kia-test-xfce.desktop");
+    remove_desktop_file(user_dir, "kia-test-own.desktop");
+    remove_desktop_file(user_dir, "kia-test-fifo.desktop");
+    for (int i = created_count - 1; i >= 0; i--) {
+        rmdir(created[i]);
+    }
+
+    char command[600];
+    snprintf(command, sizeof(command), "rm -rf %s", temp_dir);
+    if (system(command) != 0) {
+        printf("Warning: failed to remove %s\n", temp_dir);
+    }
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    logger_close();
+
+    return tests_failed > 0 ? 1 : 0;
+}
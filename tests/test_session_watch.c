@@ -0,0 +1,333 @@
+#include "session_watch.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+#define ASSERT_STR_EQ(a, b) ASSERT(strcmp((a), (b)) == 0)
+#define ASSERT_NOT_NULL(x) ASSERT((x) != NULL)
+
+/* Shared fixture paths */
+static char temp_dir[] = "/tmp/kia_watch_test_XXXXXX";
+static char x11_dir[512];
+static char wayland_dir[512];
+
+/* Helper function to write a desktop file in place */
+static int write_desktop_file(const char *dir, const char *filename,
+                              const char *name, const char *exec) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%s", dir, filename);
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        return -1;
+    }
+    fprintf(fp, "[Desktop Entry]\nName=%s\nExec=%s\n", name, exec);
+    fclose(fp);
+    return 0;
+}
+
+/* Helper function to check the watcher has events ready */
+static int watch_ready(const session_watch_t *watch) {
+    struct pollfd pfd = { .fd = session_watch_fd(watch), .events = POLLIN };
+    return poll(&pfd, 1, 1000) == 1;
+}
+
+/* Test: Added, changed and removed files update the list */
+TEST(test_watch_file_changes) {
+    session_dir_t dirs[] = { { x11_dir, SESSION_X11 }, { wayland_dir, SESSION_WAYLAND } };
+    session_list_t list = {0};
+    session_watch_t watch;
+    char path[600], tmp[600];
+
+    ASSERT_EQ(write_desktop_file(x11_dir, "xfce.desktop", "XFCE Session", "startxfce4"), 0);
+    ASSERT_EQ(session_discover_in(&list, dirs, 2, NULL), KIA_SUCCESS);
+    ASSERT_EQ(list.count, 1);
+    ASSERT_EQ(session_watch_init(&watch, dirs, 2), KIA_SUCCESS);
+    ASSERT(session_watch_fd(&watch) >= 0);
+
+    /* Nothing pending */
+    ASSERT_EQ(session_watch_process(&watch, &list), 0);
+
+    /* New file */
+    ASSERT_EQ(write_desktop_file(wayland_dir, "sway.desktop", "Sway", "sway"), 0);
+    ASSERT(watch_ready(&watch));
+    ASSERT(session_watch_process(&watch, &list) > 0);
+    ASSERT_EQ(list.count, 2);
+    ASSERT_STR_EQ(session_list_name(&list, 1), "Sway");
+    ASSERT_EQ(session_list_type(&list, 1), SESSION_WAYLAND);
+
+    /* Rewritten file is updated in place */
+    ASSERT_EQ(write_desktop_file(x11_dir, "xfce.desktop", "Xfce", "startxfce4"), 0);
+    ASSERT(session_watch_process(&watch, &list) > 0);
+    ASSERT_EQ(list.count, 2);
+    ASSERT_STR_EQ(session_list_name(&list, 0), "Xfce");
+
+    /* Package managers rename files into place */
+    ASSERT_EQ(write_desktop_file(wayland_dir, "river.desktop.tmp", "River", "river"), 0);
+    snprintf(tmp, sizeof(tmp), "%s/river.desktop.tmp", wayland_dir);
+    snprintf(path, sizeof(path), "%s/river.desktop", wayland_dir);
+    ASSERT_EQ(rename(tmp, path), 0);
+    ASSERT(session_watch_process(&watch, &list) > 0);
+    ASSERT_EQ(list.count, 3);
+    ASSERT(session_list_find_file(&list, SESSION_WAYLAND, "river.desktop") >= 0);
+    ASSERT_EQ(session_list_find_file(&list, SESSION_WAYLAND, "river.desktop.tmp"), -1);
+
+    /* Removed file */
+    snprintf(path, sizeof(path), "%s/sway.desktop", wayland_dir);
+    ASSERT_EQ(unlink(path), 0);
+    ASSERT(session_watch_process(&watch, &list) > 0);
+    ASSERT_EQ(list.count, 2);
+    ASSERT_EQ(session_list_find_file(&list, SESSION_WAYLAND, "sway.desktop"), -1);
+
+    /* File hidden after the fact */
+    snprintf(path, sizeof(path), "%s/river.desktop", wayland_dir);
+    FILE *fp = fopen(path, "a");
+    ASSERT_NOT_NULL(fp);
+    fprintf(fp, "Hidden=true\n");
+    fclose(fp);
+    ASSERT(session_watch_process(&watch, &list) > 0);
+    ASSERT_EQ(list.count, 1);
+    ASSERT_STR_EQ(session_list_name(&list, 0), "Xfce");
+    unlink(path);
+
+    session_watch_close(&watch);
+    ASSERT_EQ(session_watch_fd(&watch), -1);
+    session_list_free(&list);
+}
+
+/* Test: Directories created or removed while watching */
+TEST(test_watch_directory_lifecycle) {
+    char late_dir[600];
+    snprintf(late_dir, sizeof(late_dir), "%s/late-sessions", temp_dir);
+
+    session_dir_t dirs[] = { { x11_dir, SESSION_X11 }, { late_dir, SESSION_WAYLAND } };
+    session_list_t list = {0};
+    session_watch_t watch;
+
+    ASSERT_EQ(session_discover_in(&list, dirs, 2, NULL), KIA_SUCCESS);
+    ASSERT_EQ(list.count, 1);
+    ASSERT_EQ(session_watch_init(&watch, dirs, 2), KIA_SUCCESS);
+
+    /* Directory appears with a session already in it */
+    char staging[600];
+    snprintf(staging, sizeof(staging), "%s/staging", temp_dir);
+    ASSERT_EQ(mkdir(staging, 0755), 0);
+    ASSERT_EQ(write_desktop_file(staging, "labwc.desktop", "labwc", "labwc"), 0);
+    ASSERT_EQ(rename(staging, late_dir), 0);
+    ASSERT(session_watch_process(&watch, &list) > 0);
+    ASSERT_EQ(list.count, 2);
+    ASSERT_STR_EQ(session_list_name(&list, 1), "labwc");
+
+    /* Files in the new directory are watched */
+    ASSERT_EQ(write_desktop_file(late_dir, "weston.desktop", "Weston", "weston"), 0);
+    ASSERT(session_watch_process(&watch, &list) > 0);
+    ASSERT_EQ(list.count, 3);
+
+    /* Directory goes away with its sessions */
+    char command[700];
+    snprintf(command, sizeof(command), "rm -rf %s", late_dir);
+    ASSERT_EQ(system(command), 0);
+    ASSERT(session_watch_process(&watch, &list) > 0);
+    ASSERT_EQ(list.count, 1);
+    ASSERT_STR_EQ(session_list_name(&list, 0), "Xfce");
+
+    session_watch_close(&watch);
+    session_list_free(&list);
+}
+
+/* Test: Changes respect shadowing between directories of one type */
+TEST(test_watch_shadowing) {
+    char local_dir[600], path[700];
+    snprintf(local_dir, sizeof(local_dir), "%s/local-xsessions", temp_dir);
+    ASSERT_EQ(mkdir(local_dir, 0755), 0);
+
+    session_dir_t dirs[] = { { local_dir, SESSION_X11 }, { x11_dir, SESSION_X11 } };
+    session_list_t list = {0};
+    session_watch_t watch;
+
+    ASSERT_EQ(session_discover_in(&list, dirs, 2, NULL), KIA_SUCCESS);
+    ASSERT_EQ(list.count, 1);
+    ASSERT_EQ(session_watch_init(&watch, dirs, 2), KIA_SUCCESS);
+
+    /* Local override replaces the system session in place */
+    ASSERT_EQ(write_desktop_file(local_dir, "xfce.desktop", "Xfce (local)", "startxfce4"), 0);
+    ASSERT(session_watch_process(&watch, &list) > 0);
+    ASSERT_EQ(list.count, 1);
+    ASSERT_STR_EQ(session_list_name(&list, 0), "Xfce (local)");
+    ASSERT_EQ(list.records[0].dir, 0);
+
+    /* Changes to the shadowed file are ignored */
+    ASSERT_EQ(write_desktop_file(x11_dir, "xfce.desktop", "Xfce (system)", "startxfce4"), 0);
+    ASSERT(session_watch_process(&watch, &list) > 0);
+    ASSERT_STR_EQ(session_list_name(&list, 0), "Xfce (local)");
+
+    /* Removing the override exposes the system file again */
+    snprintf(path, sizeof(path), "%s/xfce.desktop", local_dir);
+    ASSERT_EQ(unlink(path), 0);
+    ASSERT(session_watch_process(&watch, &list) > 0);
+    ASSERT_EQ(list.count, 1);
+    ASSERT_STR_EQ(session_list_name(&list, 0), "Xfce (system)");
+    ASSERT_EQ(list.records[0].dir, 1);
+
+    /* Removing the whole local directory leaves the system session alone */
+    ASSERT_EQ(write_desktop_file(local_dir, "xfce.desktop", "Xfce (local)", "startxfce4"), 0);
+    ASSERT(session_watch_process(&watch, &list) > 0);
+    snprintf(path, sizeof(path), "rm -rf %s", local_dir);
+    ASSERT_EQ(system(path), 0);
+    ASSERT(session_watch_process(&watch, &list) > 0);
+    ASSERT_EQ(list.count, 1);
+    ASSERT_STR_EQ(session_list_name(&list, 0), "Xfce (system)");
+
+    session_watch_close(&watch);
+    session_list_free(&list);
+}
+
+/* Source callback: record that it ran */
+static int count_source(session_list_t *list, void *data) {
+    (void)list;
+    (*(int *)data)++;
+    return 1;
+}
+
+/* Test: Sources run once when their descriptor becomes readable */
+TEST(test_watch_sources) {
+    session_dir_t dirs[] = { { x11_dir, SESSION_X11 } };
+    session_list_t list = {0};
+    session_watch_t watch;
+    int pipe_fds[2];
+    int fired = 0;
+
+    ASSERT_EQ(pipe(pipe_fds), 0);
+    ASSERT_EQ(session_watch_init(&watch, dirs, 1), KIA_SUCCESS);
+    ASSERT_EQ(session_watch_add_source(&watch, pipe_fds[0], count_source, &fired), KIA_SUCCESS);
+    ASSERT_EQ(session_watch_process(&watch, &list), 0);
+    ASSERT_EQ(fired, 0);
+
+    /* The watcher descriptor reports the source, which then goes away */
+    ASSERT_EQ(write(pipe_fds[1], "x", 1), 1);
+    ASSERT(watch_ready(&watch));
+    ASSERT_EQ(session_watch_process(&watch, &list), 1);
+    ASSERT_EQ(fired, 1);
+    ASSERT_EQ(watch.source_count, 0);
+    ASSERT_EQ(session_watch_process(&watch, &list), 0);
+    ASSERT_EQ(fired, 1);
+
+    /* A source dropped before it fires never runs */
+    ASSERT_EQ(session_watch_add_source(&watch, pipe_fds[0], count_source, &fired), KIA_SUCCESS);
+    ASSERT_EQ(session_watch_remove_source(&watch, pipe_fds[0]), KIA_SUCCESS);
+    ASSERT_EQ(session_watch_remove_source(&watch, pipe_fds[0]), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_watch_process(&watch, &list), 0);
+    ASSERT_EQ(fired, 1);
+
+    ASSERT_EQ(session_watch_add_source(&watch, -1, count_source, &fired), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_watch_add_source(&watch, pipe_fds[0], NULL, &fired), KIA_ERROR_SESSION);
+
+    session_watch_close(&watch);
+    ASSERT_EQ(session_watch_add_source(&watch, pipe_fds[0], count_source, &fired),
+              KIA_ERROR_SESSION);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    session_list_free(&list);
+}
+
+/* Test: Invalid parameters */
+TEST(test_watch_invalid_params) {
+    session_dir_t dirs[] = { { x11_dir, SESSION_X11 } };
+    session_list_t list = {0};
+    session_watch_t watch;
+
+    ASSERT_EQ(session_watch_init(NULL, dirs, 1), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_watch_init(&watch, NULL, 1), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_watch_fd(&watch), -1);
+    ASSERT_EQ(session_watch_init(&watch, dirs, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_watch_process(&watch, &list), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_watch_process(NULL, &list), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_watch_fd(NULL), -1);
+    session_watch_close(&watch);
+    session_watch_close(NULL);
+}
+
+/* Main test runner */
+int main(void) {
+    logger_init("/tmp/kia_session_watch_test.log", true);
+
+    printf("Running session watch tests...\n\n");
+
+    if (mkdtemp(temp_dir) == NULL) {
+        printf("Failed to create temporary directory\n");
+        return 1;
+    }
+    snprintf(x11_dir, sizeof(x11_dir), "%s/xsessions", temp_dir);
+    snprintf(wayland_dir, sizeof(wayland_dir), "%s/wayland-sessions", temp_dir);
+    mkdir(x11_dir, 0755);
+    mkdir(wayland_dir, 0755);
+
+    /* Discovery leaves out sessions whose command is not on PATH */
+    static const char *fixture_commands[] = { "startxfce4", "sway", "river", "labwc", "weston",
+                                              NULL };
+    char bin_dir[600], path[700], search_path[4096];
+    snprintf(bin_dir, sizeof(bin_dir), "%s/bin", temp_dir);
+    mkdir(bin_dir, 0755);
+    for (int i = 0; fixture_commands[i] != NULL; i++) {
+        snprintf(path, sizeof(path), "%s/%s", bin_dir, fixture_commands[i]);
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    snprintf(search_path, sizeof(search_path), "%s:%s", bin_dir,
+             getenv("PATH") ? getenv("PATH") : "/usr/bin:/bin");
+    setenv("PATH", search_path, 1);
+
+    test_watch_file_changes_wrapper();
+    test_watch_directory_lifecycle_wrapper();
+    test_watch_shadowing_wrapper();
+    test_watch_sources_wrapper();
+    test_watch_invalid_params_wrapper();
+
+    char command[600];
+    snprintf(command, sizeof(command), "rm -rf %s", temp_dir);
+    if (system(command) != 0) {
+        printf("Warning: failed to remove %s\n", temp_dir);
+    }
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    logger_close();
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,230 @@
+#define _GNU_SOURCE
+#include "session_xorg.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/* Test counter */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test helper macros */
+#define TEST(name) \
+    static void name(void); \
+    static void name##_wrapper(void) { \
+        printf("Running %s...", #name); \
+        name(); \
+        printf(" PASSED\n"); \
+        tests_passed++; \
+    } \
+    static void name(void)
+
+#define ASSERT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("\n  Assertion failed: %s\n", #condition); \
+            printf("  at %s:%d\n", __FILE__, __LINE__); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(a, b) ASSERT((a) == (b))
+
+/* Shared fixture directory holding the stub servers and authority files */
+static char temp_dir[] = "/tmp/kia_xorg_test_XXXXXX";
+
+/* Stub server: checks its arguments and authority file, then reports display 42 */
+static const char *ready_server =
+    "#!/bin/sh\n"
+    "while [ $# -gt 0 ]; do\n"
+    "    case \"$1\" in\n"
+    "        -displayfd) fd=$2; shift ;;\n"
+    "        -auth) auth=$2; shift ;;\n"
+    "    esac\n"
+    "    shift\n"
+    "done\n"
+    "[ -n \"$fd\" ] && [ -s \"$auth\" ] || exit 1\n"
+    "eval \"echo 42 >&$fd\"\n"
+    "exec sleep 30\n";
+
+/* Stub server that exits without reporting a display */
+static const char *failing_server =
+    "#!/bin/sh\n"
+    "exit 1\n";
+
+/* Stub server that never reports a display */
+static const char *hanging_server =
+    "#!/bin/sh\n"
+    "exec sleep 30\n";
+
+/* Helper function to write an executable stub server */
+static void write_server(const char *name, const char *script, char *path, size_t len) {
+    snprintf(path, len, "%s/%s", temp_dir, name);
+    FILE *f = fopen(path, "w");
+    if (f) {
+        fputs(script, f);
+        fclose(f);
+    }
+    chmod(path, 0755);
+}
+
+/* Helper function to get the size of a file, or -1 if it does not exist */
+static long file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+/* Test: Authority entries are laid out as libXau reads them */
+TEST(test_xorg_write_auth) {
+    unsigned char cookie[SESSION_XORG_COOKIE_LEN];
+    unsigned char buf[128];
+    char path[600];
+
+    for (int i = 0; i < SESSION_XORG_COOKIE_LEN; i++) {
+        cookie[i] = (unsigned char)i;
+    }
+    snprintf(path, sizeof(path), "%s/auth", temp_dir);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    ASSERT(fd >= 0);
+
+    ASSERT_EQ(session_xorg_write_auth(fd, cookie, 7), KIA_SUCCESS);
+    ssize_t len = pread(fd, buf, sizeof(buf), 0);
+
+    /* Family, empty address, "7", cookie name and the 16-byte cookie */
+    ASSERT_EQ(len, 2 + 2 + 2 + 1 + 2 + 18 + 2 + SESSION_XORG_COOKIE_LEN);
+    ASSERT(buf[0] == 0xff && buf[1] == 0xff);
+    ASSERT(buf[2] == 0 && buf[3] == 0);
+    ASSERT(buf[4] == 0 && buf[5] == 1 && buf[6] == '7');
+    ASSERT(buf[7] == 0 && buf[8] == 18);
+    ASSERT(memcmp(buf + 9, "MIT-MAGIC-COOKIE-1", 18) == 0);
+    ASSERT(buf[27] == 0 && buf[28] == SESSION_XORG_COOKIE_LEN);
+    ASSERT(memcmp(buf + 29, cookie, SESSION_XORG_COOKIE_LEN) == 0);
+
+    /* Rewriting truncates; the server's entry carries no display number */
+    ASSERT_EQ(session_xorg_write_auth(fd, cookie, -1), KIA_SUCCESS);
+    ASSERT_EQ(file_size(path), 2 + 2 + 2 + 2 + 18 + 2 + SESSION_XORG_COOKIE_LEN);
+
+    close(fd);
+    unlink(path);
+}
+
+/* Test: The display number written to -displayfd is picked up */
+TEST(test_xorg_start_ready) {
+    session_xorg_t xorg;
+    char server[600];
+
+    write_server("ready-server", ready_server, server, sizeof(server));
+    ASSERT_EQ(session_xorg_start(&xorg, server, temp_dir, -1, 5000), KIA_SUCCESS);
+    ASSERT(xorg.pid > 0);
+    ASSERT_EQ(xorg.display, 42);
+    ASSERT(file_size(xorg.server_auth) > 0);
+
+    /* The server keeps running until it is stopped */
+    ASSERT_EQ(waitpid(xorg.pid, NULL, WNOHANG), 0);
+
+    ASSERT_EQ(session_xorg_grant(&xorg, getuid(), getgid()), KIA_SUCCESS);
+    ASSERT_EQ(file_size(xorg.client_auth), 2 + 2 + 2 + 2 + 2 + 18 + 2 + SESSION_XORG_COOKIE_LEN);
+
+    pid_t pid = xorg.pid;
+    char server_auth[sizeof(xorg.server_auth)], client_auth[sizeof(xorg.client_auth)];
+    memcpy(server_auth, xorg.server_auth, sizeof(server_auth));
+    memcpy(client_auth, xorg.client_auth, sizeof(client_auth));
+
+    session_xorg_stop(&xorg);
+    ASSERT_EQ(xorg.pid, 0);
+    ASSERT(kill(pid, 0) != 0 && errno == ESRCH);
+
+    session_xorg_remove_auth(&xorg);
+    ASSERT_EQ(file_size(server_auth), -1);
+    ASSERT_EQ(file_size(client_auth), -1);
+}
+
+/* Test: A server exiting before it reports fails the start and leaves nothing behind */
+TEST(test_xorg_start_exits) {
+    session_xorg_t xorg;
+    char server[600];
+
+    write_server("failing-server", failing_server, server, sizeof(server));
+    ASSERT_EQ(session_xorg_start(&xorg, server, temp_dir, -1, 5000), KIA_ERROR_SESSION);
+    ASSERT_EQ(xorg.pid, 0);
+    ASSERT_EQ(xorg.server_auth[0], '\0');
+    ASSERT(waitpid(-1, NULL, WNOHANG) < 0 && errno == ECHILD);
+}
+
+/* Test: A server that never reports is stopped after the timeout */
+TEST(test_xorg_start_timeout) {
+    session_xorg_t xorg;
+    char server[600];
+
+    write_server("hanging-server", hanging_server, server, sizeof(server));
+    ASSERT_EQ(session_xorg_start(&xorg, server, temp_dir, -1, 200), KIA_ERROR_SESSION);
+    ASSERT_EQ(xorg.pid, 0);
+    ASSERT_EQ(xorg.display, -1);
+    ASSERT(waitpid(-1, NULL, WNOHANG) < 0 && errno == ECHILD);
+}
+
+/* Test: Invalid parameters */
+TEST(test_xorg_invalid_params) {
+    session_xorg_t xorg;
+    unsigned char cookie[SESSION_XORG_COOKIE_LEN] = {0};
+
+    ASSERT_EQ(session_xorg_start(NULL, "Xorg", temp_dir, -1, 1000), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_xorg_start(&xorg, NULL, temp_dir, -1, 1000), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_xorg_start(&xorg, "", temp_dir, -1, 1000), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_xorg_start(&xorg, "Xorg", NULL, -1, 1000), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_xorg_start(&xorg, "Xorg", temp_dir, -1, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_xorg_write_auth(-1, cookie, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_xorg_write_auth(0, NULL, 0), KIA_ERROR_SESSION);
+
+    /* Granting needs a running server */
+    memset(&xorg, 0, sizeof(xorg));
+    xorg.display = -1;
+    ASSERT_EQ(session_xorg_grant(&xorg, 0, 0), KIA_ERROR_SESSION);
+    ASSERT_EQ(session_xorg_grant(NULL, 0, 0), KIA_ERROR_SESSION);
+
+    session_xorg_stop(&xorg);
+    session_xorg_stop(NULL);
+    session_xorg_remove_auth(NULL);
+}
+
+/* Main test runner */
+int main(void) {
+    logger_init("/tmp/kia_session_xorg_test.log", true);
+
+    printf("Running X server launcher tests...\n\n");
+
+    if (mkdtemp(temp_dir) == NULL) {
+        printf("Failed to create temporary directory\n");
+        return 1;
+    }
+
+    test_xorg_write_auth_wrapper();
+    test_xorg_start_ready_wrapper();
+    test_xorg_start_exits_wrapper();
+    test_xorg_start_timeout_wrapper();
+    test_xorg_invalid_params_wrapper();
+
+    char command[600];
+    snprintf(command, sizeof(command), "rm -rf %s", temp_dir);
+    if (system(command) != 0) {
+        printf("Warning: failed to remove %s\n", temp_dir);
+    }
+
+    printf("\n");
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_failed);
+
+    logger_close();
+
+    return tests_failed > 0 ? 1 : 0;
+}
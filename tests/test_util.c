@@ -0,0 +1,12 @@
+#include "test_util.h"
+#include <time.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+void age_dir(const char *path) {
+    struct timespec times[2];
+    clock_gettime(CLOCK_REALTIME, &times[0]);
+    times[0].tv_sec -= 60;
+    times[1] = times[0];
+    utimensat(AT_FDCWD, path, times, 0);
+}
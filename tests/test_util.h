@@ -0,0 +1,11 @@
+#ifndef KIA_TEST_UTIL_H
+#define KIA_TEST_UTIL_H
+
+/**
+ * Push a directory's mtime a minute into the past, so that caches keyed on
+ * it do not take it for one still being modified
+ * @param path Directory to age
+ */
+void age_dir(const char *path);
+
+#endif /* KIA_TEST_UTIL_H */